@@ -18,6 +18,7 @@
 
 #import "MGSFragariaView.h"
 #import "MGSSyntaxError.h"
+#import "MGSSemanticTokensEdit.h"
 #import "MGSTextView.h"
 #import "MGSTextView+MGSTextActions.h"
 #import "MGSTextView+MGSDragging.h"
@@ -27,11 +28,19 @@
 #import "MGSSyntaxParserClient.h"
 #import "MGSSyntaxAwareEditor.h"
 #import "MGSSyntaxParser.h"
+#import "MGSIncrementalSyntaxParser.h"
 #import "MGSClassicFragariaParserFactory.h"
+#import "MGSTextMateParserFactory.h"
 
 #import "MGSColourScheme.h"
 #import "MGSMutableColourScheme.h"
 #import "MGSMutableColourSchemeFromPlistTransformer.h"
 
 #import "NSTextStorage+Fragaria.h"
+#import "MGSPieceTableTextStorage.h"
+#import "MGSMappedFileTextStorage.h"
+#import "MGSHighlightCache.h"
 #import "MGSMutableSubstring.h"
+#import "MGSSearchEngine.h"
+#import "MGSChangeTracker.h"
+#import "MGSSymbolIndex.h"
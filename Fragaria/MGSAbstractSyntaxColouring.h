@@ -13,6 +13,8 @@ NS_ASSUME_NONNULL_BEGIN
 
 @class MGSColourScheme;
 @class MGSSyntaxParser;
+@class MGSSemanticTokenOverlay;
+@class MGSSymbolIndex;
 
 
 @interface MGSAbstractSyntaxColouring : NSObject <MGSSyntaxParserClient>
@@ -55,6 +57,20 @@ NS_ASSUME_NONNULL_BEGIN
  *  attributes applied. */
 - (void)invalidateAllColouring;
 
+/** Marks as invalid the colouring affected by an edit of the text.
+ *  @discussion If the parser conforms to MGSIncrementalSyntaxParser, it is
+ *    informed of the edit and decides which ranges to invalidate. Otherwise
+ *    the lines (or the long line windows) containing the edit are
+ *    invalidated.
+ *  @param newRange The range of the edited characters, after the edit.
+ *  @param changeInLength The difference between the lengths of the text
+ *    after and before the edit. */
+- (void)invalidateColouringForEditedRange:(NSRange)newRange changeInLength:(NSInteger)changeInLength;
+
+/** Informs the parser, if it conforms to MGSIncrementalSyntaxParser, that
+ *  the text was replaced in a way that cannot be described by an edit. */
+- (void)resetIncrementalParsing;
+
 /** Forces a recolouring of the character range specified. The recolouring will
  * be done anew even if the specified range is already valid (wholly or in
  * part).
@@ -64,6 +80,61 @@ NS_ASSUME_NONNULL_BEGIN
 - (NSRange)recolourChangedRange:(NSRange)rangeToRecolour;
 
 
+/// @name Inspecting the Colouring
+
+/** Calls a block for each run of characters belonging to the same syntax
+ *  group in a range, including the runs which are not part of any token.
+ *  @discussion The semantic tokens coloured by the colour scheme take the
+ *    place of the tokens found by the parser which they overlap, as they
+ *    do when they are coloured. This method does not update the colouring;
+ *    use -recolourRange: first to make sure it is valid.
+ *  @param range The range of characters to enumerate.
+ *  @param block The block to call, once per run, in ascending order. Its
+ *    group argument is nil for the characters which are not part of a
+ *    token. Set *stop to YES to stop the enumeration. */
+- (void)enumerateTokenGroupsInRange:(NSRange)range usingBlock:(void (^)(NSRange runRange, MGSSyntaxGroup __nullable group, BOOL *stop))block;
+
+
+/// @name Semantic Tokens
+
+/** The semantic tokens coloured on top of the tokens found by the parser.
+ *  @discussion The character ranges of the semantic tokens are updated
+ *    when the text is edited. */
+@property (nonatomic, readonly) MGSSemanticTokenOverlay *semanticTokens;
+
+/** Marks as invalid the colouring of the lines where the semantic tokens
+ *  have changed, and removes the colouring attributes applied to them.
+ *  @param ranges The character ranges returned by the MGSSemanticTokenOverlay
+ *    method which changed the tokens. */
+- (void)invalidateColouringOfSemanticTokenRanges:(NSIndexSet *)ranges;
+
+
+/// @name Indexing Symbols
+
+
+/** The symbol index which is told when the text is parsed or edited, set
+ *  by the symbol index itself. */
+@property (nonatomic, weak, nullable) MGSSymbolIndex *symbolIndex;
+
+
+/// @name Archiving Tokens
+
+/** Returns a compact representation of the tokens in the ranges where the
+ *  colouring is valid.
+ *  @discussion The data only contains the tokens and the valid ranges, not
+ *    the colours, so that it can be restored with a different colour
+ *    scheme. */
+- (NSData *)tokenArchive;
+
+/** Replaces the colouring with the tokens stored in an archive returned by
+ *  -tokenArchive, and marks the ranges that were valid when the archive was
+ *  created as valid.
+ *  @param data The archive.
+ *  @returns NO if the archive is malformed or refers to a text of a
+ *    different length. In this case the colouring is not modified. */
+- (BOOL)restoreTokenArchive:(NSData *)data;
+
+
 @end
 
 
@@ -10,6 +10,10 @@
 #import "NSScanner+Fragaria.h"
 #import "MGSColourScheme.h"
 #import "MGSSyntaxParser.h"
+#import "MGSIncrementalSyntaxParser.h"
+#import "NSString+Fragaria.h"
+#import "MGSSemanticTokenOverlay.h"
+#import "MGSSymbolIndexPrivate.h"
 
 
 // syntax colouring information dictionary keys
@@ -27,12 +31,53 @@ NSString * const MGSSyntaxGroupAttribute    = @"attribute";
 NSString * const MGSSyntaxGroupComment      = @"comments";
 
 
+/* Identifies the format of the data returned by -tokenArchive */
+#define MGSTokenArchiveMagic    (0x4B544746)
+#define MGSTokenArchiveVersion  (1)
+
+
+static void MGSAppendVarint(NSMutableData *data, uint64_t v)
+{
+    uint8_t buf[10];
+    NSUInteger n = 0;
+    
+    do {
+        buf[n] = (v & 0x7F) | (v > 0x7F ? 0x80 : 0);
+        v >>= 7;
+        n++;
+    } while (v);
+    [data appendBytes:buf length:n];
+}
+
+
+/* Reads a varint at *p, not going past end. Returns NO if the data ends
+ * before the varint does. */
+static BOOL MGSReadVarint(const uint8_t **p, const uint8_t *end, uint64_t *v)
+{
+    uint64_t res = 0;
+    unsigned shift = 0;
+    uint8_t b;
+    
+    do {
+        if (*p >= end || shift > 63)
+            return NO;
+        b = *(*p)++;
+        res |= (uint64_t)(b & 0x7F) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    *v = res;
+    return YES;
+}
+
+
 @interface MGSAbstractSyntaxColouring ()
 
 @property (nonatomic) NSString *stringToParse;
 
 @property (nonatomic) NSRange rangeToParse;
 
+@property (nonatomic) NSUInteger textGeneration;
+
 @end
 
 
@@ -43,6 +88,7 @@ NSString * const MGSSyntaxGroupComment      = @"comments";
 {
     if ((self = [super init])) {
         _inspectedCharacterIndexes = [[NSMutableIndexSet alloc] init];
+        _semanticTokens = [[MGSSemanticTokenOverlay alloc] init];
     
         NSString *sdname = [MGSSyntaxController standardSyntaxDefinitionName];
         _parser = [[MGSSyntaxController sharedInstance] parserForSyntaxDefinitionName:sdname];
@@ -72,6 +118,8 @@ NSString * const MGSSyntaxGroupComment      = @"comments";
 {
     [self invalidateAllColouring];
     _parser = parser;
+    [self resetIncrementalParsing];
+    [self.symbolIndex invalidateAllSymbols];
 }
 
 
@@ -130,6 +178,51 @@ NSString * const MGSSyntaxGroupComment      = @"comments";
 }
 
 
+- (void)invalidateColouringForEditedRange:(NSRange)newRange changeInLength:(NSInteger)changeInLength
+{
+    NSMutableIndexSet *insp = self.inspectedCharacterIndexes;
+    NSString *string = self.textStorage.string;
+    NSRange oldRange = newRange;
+    id<MGSIncrementalSyntaxParser> incParser;
+    MGSTextEditDelta delta;
+    NSIndexSet *changed = nil;
+    
+    oldRange.length -= changeInLength;
+    [insp shiftIndexesStartingAtIndex:NSMaxRange(oldRange) by:changeInLength];
+    [self.semanticTokens shiftTokensForEditedRange:oldRange changeInLength:changeInLength];
+    [self.symbolIndex textDidChangeInRange:newRange changeInLength:changeInLength];
+    self.textGeneration++;
+    
+    if ([self.parser conformsToProtocol:@protocol(MGSIncrementalSyntaxParser)]) {
+        incParser = (id<MGSIncrementalSyntaxParser>)self.parser;
+        delta.oldRange = oldRange;
+        delta.newRange = newRange;
+        delta.changeInLength = changeInLength;
+        delta.generation = self.textGeneration;
+        changed = [incParser applyEditDelta:delta toString:string];
+    }
+    
+    if (changed) {
+        [insp removeIndexes:changed];
+        [insp removeIndexesInRange:newRange];
+    } else {
+        [insp removeIndexesInRange:[string mgs_highlightingRangeForRange:newRange]];
+    }
+}
+
+
+- (void)resetIncrementalParsing
+{
+    id<MGSIncrementalSyntaxParser> incParser;
+    
+    self.textGeneration++;
+    if (![self.parser conformsToProtocol:@protocol(MGSIncrementalSyntaxParser)])
+        return;
+    incParser = (id<MGSIncrementalSyntaxParser>)self.parser;
+    [incParser resetIncrementalParsingWithString:self.textStorage.string ?: @"" generation:self.textGeneration];
+}
+
+
 - (void)recolourRange:(NSRange)range
 {
     NSMutableIndexSet *invalidRanges;
@@ -151,9 +244,269 @@ NSString * const MGSSyntaxGroupComment      = @"comments";
 
 - (NSRange)recolourChangedRange:(NSRange)rangeToRecolour
 {
+    NSRange coloured;
+    
     self.stringToParse = self.textStorage.string;
     self.rangeToParse = rangeToRecolour;
-    return [self.parser parseForClient:self];
+    coloured = [self.parser parseForClient:self];
+    [self applySemanticTokensInRange:coloured];
+    [self.symbolIndex tokensDidChangeInRange:coloured];
+    return coloured;
+}
+
+
+#pragma mark - Inspecting the Colouring
+
+
+- (void)enumerateTokenGroupsInRange:(NSRange)range usingBlock:(void (^)(NSRange runRange, MGSSyntaxGroup __nullable group, BOOL *stop))block
+{
+    NSMutableArray<NSValue *> *semRanges = [NSMutableArray array];
+    NSMutableArray<MGSSyntaxGroup> *semGroups = [NSMutableArray array];
+    MGSColourScheme *scheme = self.colourScheme;
+    __block NSUInteger k = 0;
+    __block BOOL stop = NO;
+    
+    [self.semanticTokens enumerateTokensInRange:range usingBlock:^(NSRange tokenRange, MGSSyntaxGroup group, BOOL *stop2) {
+        MGSSyntaxGroup resolved = [scheme resolveSyntaxGroup:group];
+        
+        /* Semantic tokens not coloured by the scheme leave the colouring of
+         * the parser visible */
+        if (!resolved || ![scheme coloursSyntaxGroup:resolved])
+            return;
+        [semRanges addObject:[NSValue valueWithRange:NSIntersectionRange(tokenRange, range)]];
+        [semGroups addObject:group];
+    }];
+    
+    [self.textStorage enumerateAttribute:MGSSyntaxGroupAttributeName inRange:range options:0 usingBlock:^(NSString *raw, NSRange run, BOOL *stop2) {
+        MGSSyntaxGroup group = raw ? [raw substringFromIndex:2] : nil;
+        NSUInteger i, n, end;
+        NSRange sem;
+        
+        i = run.location;
+        end = NSMaxRange(run);
+        while (i < end && !stop) {
+            while (k < semRanges.count && NSMaxRange([semRanges[k] rangeValue]) <= i)
+                k++;
+            if (k < semRanges.count) {
+                sem = [semRanges[k] rangeValue];
+                if (sem.location <= i) {
+                    n = MIN(end, NSMaxRange(sem));
+                    block(NSMakeRange(i, n - i), semGroups[k], &stop);
+                } else {
+                    n = MIN(end, sem.location);
+                    block(NSMakeRange(i, n - i), group, &stop);
+                }
+            } else {
+                n = end;
+                block(NSMakeRange(i, n - i), group, &stop);
+            }
+            i = n;
+        }
+        *stop2 = stop;
+    }];
+}
+
+
+#pragma mark - Semantic Tokens
+
+
+/* Colours the semantic tokens which intersect with the specified range over
+ * the tokens found by the parser. */
+- (void)applySemanticTokensInRange:(NSRange)range
+{
+    NSMutableDictionary<MGSSyntaxGroup, NSDictionary *> *attributes;
+    NSMutableAttributedString *ts = self.textStorage;
+    
+    if (self.semanticTokens.count == 0)
+        return;
+    
+    attributes = [NSMutableDictionary dictionary];
+    [self.semanticTokens enumerateTokensInRange:range usingBlock:^(NSRange tokenRange, MGSSyntaxGroup group, BOOL *stop) {
+        NSDictionary *attr = attributes[group];
+        if (!attr) {
+            attr = [self.colourScheme attributesForSyntaxGroup:group textFont:self.textFont];
+            attributes[group] = attr;
+        }
+        if (attr.count)
+            [ts addAttributes:attr range:tokenRange];
+    }];
+}
+
+
+- (void)invalidateColouringOfSemanticTokenRanges:(NSIndexSet *)ranges
+{
+    NSMutableAttributedString *ts = self.textStorage;
+    NSString *string = ts.string;
+    NSUInteger len = string.length;
+    
+    if (ranges.count == 0)
+        return;
+    
+    [ts beginEditing];
+    [ranges enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        if (range.location >= len) {
+            *stop = YES;
+            return;
+        }
+        range = NSIntersectionRange(range, NSMakeRange(0, len));
+        range = [self resetTokenGroupsInRange:[string mgs_highlightingRangeForRange:range]];
+        [self.inspectedCharacterIndexes removeIndexesInRange:range];
+    }];
+    [ts endEditing];
+}
+
+
+#pragma mark - Archiving Tokens
+
+
+/* The archive is a sequence of varints:
+ *   magic, version, length of the text,
+ *   number of groups, then for each group the length of its UTF-8 name
+ *     followed by the name bytes,
+ *   number of valid ranges, then for each range its distance from the end
+ *     of the previous one and its length,
+ *   number of tokens, then for each token its distance from the end of the
+ *     previous one, its length and the index of its group. */
+- (NSData *)tokenArchive
+{
+    NSMutableData *data = [NSMutableData data];
+    NSMutableData *tokens = [NSMutableData data];
+    NSMutableDictionary<NSString *, NSNumber *> *groupIndexes = [NSMutableDictionary dictionary];
+    NSMutableArray<NSString *> *groups = [NSMutableArray array];
+    NSIndexSet *valid = self.inspectedCharacterIndexes;
+    NSMutableAttributedString *ts = self.textStorage;
+    __block NSUInteger prevEnd, tokenCount = 0, rangeCount = 0;
+    NSData *name;
+    
+    prevEnd = 0;
+    [valid enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        rangeCount++;
+        [ts enumerateAttribute:MGSSyntaxGroupAttributeName inRange:range options:0 usingBlock:^(NSString *group, NSRange tokenRange, BOOL *stop2) {
+            NSNumber *gi;
+            
+            if (!group)
+                return;
+            if (!(gi = groupIndexes[group])) {
+                gi = @(groups.count);
+                groupIndexes[group] = gi;
+                [groups addObject:group];
+            }
+            MGSAppendVarint(tokens, tokenRange.location - prevEnd);
+            MGSAppendVarint(tokens, tokenRange.length);
+            MGSAppendVarint(tokens, gi.unsignedIntegerValue);
+            prevEnd = NSMaxRange(tokenRange);
+            tokenCount++;
+        }];
+    }];
+    
+    MGSAppendVarint(data, MGSTokenArchiveMagic);
+    MGSAppendVarint(data, MGSTokenArchiveVersion);
+    MGSAppendVarint(data, ts.length);
+    
+    MGSAppendVarint(data, groups.count);
+    for (NSString *group in groups) {
+        name = [group dataUsingEncoding:NSUTF8StringEncoding];
+        MGSAppendVarint(data, name.length);
+        [data appendData:name];
+    }
+    
+    MGSAppendVarint(data, rangeCount);
+    prevEnd = 0;
+    [valid enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        MGSAppendVarint(data, range.location - prevEnd);
+        MGSAppendVarint(data, range.length);
+        prevEnd = NSMaxRange(range);
+    }];
+    
+    MGSAppendVarint(data, tokenCount);
+    [data appendData:tokens];
+    return data;
+}
+
+
+- (BOOL)restoreTokenArchive:(NSData *)data
+{
+    const uint8_t *p = data.bytes, *end = p + data.length;
+    NSMutableAttributedString *ts = self.textStorage;
+    NSUInteger len = ts.length;
+    NSMutableArray<NSString *> *groups;
+    NSMutableArray<NSDictionary *> *groupAttributes;
+    NSMutableIndexSet *valid;
+    NSMutableData *tokens;
+    NSRange *tokenRanges;
+    NSUInteger *tokenGroups;
+    uint64_t v, n, i, loc, l, gi;
+    NSString *group;
+    NSRange r;
+    
+    if (!MGSReadVarint(&p, end, &v) || v != MGSTokenArchiveMagic)
+        return NO;
+    if (!MGSReadVarint(&p, end, &v) || v != MGSTokenArchiveVersion)
+        return NO;
+    if (!MGSReadVarint(&p, end, &v) || v != len)
+        return NO;
+    
+    if (!MGSReadVarint(&p, end, &n) || n > (uint64_t)(end - p))
+        return NO;
+    groups = [NSMutableArray array];
+    groupAttributes = [NSMutableArray array];
+    for (i = 0; i < n; i++) {
+        if (!MGSReadVarint(&p, end, &l) || l > (uint64_t)(end - p))
+            return NO;
+        group = [[NSString alloc] initWithBytes:p length:l encoding:NSUTF8StringEncoding];
+        p += l;
+        if (group.length < 2)
+            return NO;
+        [groups addObject:group];
+        [groupAttributes addObject:[self.colourScheme attributesForSyntaxGroup:[group substringFromIndex:2] textFont:self.textFont]];
+    }
+    
+    if (!MGSReadVarint(&p, end, &n) || n > (uint64_t)(end - p))
+        return NO;
+    valid = [NSMutableIndexSet indexSet];
+    loc = 0;
+    for (i = 0; i < n; i++) {
+        if (!MGSReadVarint(&p, end, &v) || !MGSReadVarint(&p, end, &l))
+            return NO;
+        loc += v;
+        if (loc > len || l > len - loc)
+            return NO;
+        [valid addIndexesInRange:NSMakeRange(loc, l)];
+        loc += l;
+    }
+    
+    /* Validate all the tokens before modifying the text storage */
+    if (!MGSReadVarint(&p, end, &n) || n > (uint64_t)(end - p))
+        return NO;
+    tokens = [NSMutableData dataWithLength:n * (sizeof(NSRange) + sizeof(NSUInteger))];
+    tokenRanges = tokens.mutableBytes;
+    tokenGroups = (NSUInteger *)(tokenRanges + n);
+    loc = 0;
+    for (i = 0; i < n; i++) {
+        if (!MGSReadVarint(&p, end, &v) || !MGSReadVarint(&p, end, &l) || !MGSReadVarint(&p, end, &gi))
+            return NO;
+        loc += v;
+        if (loc > len || l > len - loc || gi >= groups.count)
+            return NO;
+        tokenRanges[i] = NSMakeRange(loc, l);
+        tokenGroups[i] = gi;
+        loc += l;
+    }
+    
+    [ts beginEditing];
+    [self invalidateAllColouring];
+    for (i = 0; i < n; i++) {
+        r = tokenRanges[i];
+        [ts addAttributes:groupAttributes[tokenGroups[i]] range:r];
+        [ts addAttribute:MGSSyntaxGroupAttributeName value:groups[tokenGroups[i]] range:r];
+    }
+    [self.inspectedCharacterIndexes addIndexes:valid];
+    [valid enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        [self applySemanticTokensInRange:range];
+    }];
+    [ts endEditing];
+    
+    return YES;
 }
 
 
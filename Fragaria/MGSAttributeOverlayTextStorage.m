@@ -6,9 +6,14 @@
 //
 
 #import "MGSAttributeOverlayTextStorage.h"
+#import "MGSAttributeOverlayTextStoragePrivate.h"
 #import "MGSRangeEntries.h"
 
 
+/* Number of slots of the merged attribute cache. Must be a power of 2. */
+#define MGSMergedAttributesCacheSize 64
+
+
 @interface MGSAttributeOverlayTextStorage ()
 
 @end
@@ -19,6 +24,14 @@
     NSInteger editingBlockLevel;
     BOOL parentEditInProgress;
     MGSRangeEntries *attributeRanges;
+    
+    /* Direct-mapped cache of the attribute dictionaries returned by
+     * attributesAtIndex:effectiveRange:, keyed by the identity of the
+     * parent's and the overlay's attribute dictionaries. The keys are
+     * retained so that their addresses cannot be reused while cached. */
+    NSDictionary *mergeCacheParent[MGSMergedAttributesCacheSize];
+    NSDictionary *mergeCacheOverlay[MGSMergedAttributesCacheSize];
+    NSDictionary *mergeCacheResult[MGSMergedAttributesCacheSize];
 }
 
 
@@ -71,6 +84,7 @@
     MGSRangeEntriesExpandAndWipe(attributeRanges, range, delta);
     if (MGSCountRangeEntries(attributeRanges) == 0)
         MGSRangeEntryInsert(attributeRanges, NSMakeRange(0, self.parentTextStorage.length), @{});
+    [self invalidateMergedAttributesCache];
     [self edited:self.parentTextStorage.editedMask range:range changeInLength:self.parentTextStorage.changeInLength];
     
     parentEditInProgress = NO;
@@ -91,16 +105,52 @@
         *range = NSIntersectionRange(pRange, myRange);
     }
     
+    return [self mergedAttributesOfParentAttributes:pAttrib overlayAttributes:myAttrib];
+}
+
+
+#pragma mark - Merged attribute cache
+
+
+- (NSDictionary *)mergedAttributesOfParentAttributes:(NSDictionary *)pAttrib overlayAttributes:(NSDictionary *)myAttrib
+{
+    NSUInteger slot;
+    
+    if ([myAttrib count] == 0)
+        return pAttrib;
+    
+    slot = (((uintptr_t)pAttrib >> 4) ^ ((uintptr_t)myAttrib >> 3)) & (MGSMergedAttributesCacheSize - 1);
+    if (mergeCacheParent[slot] == pAttrib && mergeCacheOverlay[slot] == myAttrib)
+        return mergeCacheResult[slot];
+    
     NSMutableDictionary *res = [pAttrib mutableCopy];
     NSSet *removalSet = [myAttrib keysOfEntriesPassingTest:^BOOL(id  _Nonnull key, id  _Nonnull obj, BOOL * _Nonnull stop) {
         return obj == [NSNull null];
     }];
     [res addEntriesFromDictionary:myAttrib];
     [res removeObjectsForKeys:[removalSet allObjects]];
-    return res;
+    
+    mergeCacheParent[slot] = pAttrib;
+    mergeCacheOverlay[slot] = myAttrib;
+    mergeCacheResult[slot] = [res copy];
+    _numberOfMergedAttributeDictionaries++;
+    return mergeCacheResult[slot];
+}
+
+
+- (void)invalidateMergedAttributesCache
+{
+    for (NSUInteger i = 0; i < MGSMergedAttributesCacheSize; i++) {
+        mergeCacheParent[i] = nil;
+        mergeCacheOverlay[i] = nil;
+        mergeCacheResult[i] = nil;
+    }
 }
 
 
+#pragma mark - Editing
+
+
 - (void)beginEditing
 {
     editingBlockLevel++;
@@ -125,6 +175,7 @@
     MGSRangeEntriesExpandAndWipe(attributeRanges, range, delta);
     if (MGSCountRangeEntries(attributeRanges) == 0)
         MGSRangeEntryInsert(attributeRanges, NSMakeRange(0, self.parentTextStorage.length), @{});
+    [self invalidateMergedAttributesCache];
     [self edited:NSTextStorageEditedCharacters range:range changeInLength:str.length-range.length];
     [self endEditing];
 }
@@ -154,6 +205,7 @@
         MGSRangeEntryInsert(attributeRanges, range, newAttributes);
     }
     
+    [self invalidateMergedAttributesCache];
     [self edited:NSTextStorageEditedAttributes range:range changeInLength:0];
     [self endEditing];
 }
@@ -0,0 +1,27 @@
+//
+//  MGSAttributeOverlayTextStoragePrivate.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Cocoa/Cocoa.h>
+#import "MGSAttributeOverlayTextStorage.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@interface MGSAttributeOverlayTextStorage ()
+
+
+/** The number of merged attribute dictionaries which were created because
+ *  they were not found in the cache of merged attributes. Used by the unit
+ *  tests to check the effectiveness of the cache. */
+@property (readonly) NSUInteger numberOfMergedAttributeDictionaries;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
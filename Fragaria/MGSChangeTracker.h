@@ -0,0 +1,91 @@
+//
+//  MGSChangeTracker.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/** The ways in which a line differs from the baseline of a
+ *  MGSChangeTracker. */
+typedef NS_OPTIONS(NSUInteger, MGSLineChanges) {
+    /** The line is the same as in the baseline. */
+    MGSLineChangeNone = 0,
+    /** The line is not in the baseline. */
+    MGSLineChangeAdded = 1 << 0,
+    /** The line replaces one or more lines of the baseline. */
+    MGSLineChangeModified = 1 << 1,
+    /** Some lines of the baseline have been deleted before this line. */
+    MGSLineChangeDeletedBefore = 1 << 2,
+    /** Some lines of the baseline have been deleted after this line, which
+     *  is the last line of the text. */
+    MGSLineChangeDeletedAfter = 1 << 3
+};
+
+
+/** Posted by a MGSChangeTracker when the changes of some lines have been
+ *  updated. */
+extern NSString * const MGSChangeTrackerDidUpdateChangesNotification;
+
+
+/** Tracks which lines of the text of a text view have been added, modified
+ *  or deleted with respect to a baseline, such as the last saved or
+ *  committed version of the text.
+ *
+ *  The baseline and the text are kept as arrays of line hashes, and the
+ *  differences between them as a list of regions where the lines differ.
+ *  When the text is edited, only the hashes of the edited lines are
+ *  computed again, and only the region around the edit is compared to the
+ *  baseline again; the cost of an edit thus depends on the size of the
+ *  changes near it, and not on the length of the text.
+ *
+ *  When the lines of the text and of the baseline differ in too many places
+ *  in a single region, the region is not compared line by line, and all of
+ *  its lines are marked as modified. */
+@interface MGSChangeTracker : NSObject
+
+
+/** Initializes a change tracker for the text of a text view.
+ *  @param textView The text view. */
+- (instancetype)initWithTextView:(NSTextView *)textView;
+
+/** The text view whose text is compared to the baseline. */
+@property (nonatomic, weak, readonly) NSTextView *textView;
+
+
+/** Sets the text to which the text of the text view is compared.
+ *  @param string The baseline, or nil to stop tracking changes. */
+- (void)setBaselineString:(nullable NSString *)string;
+
+/** Sets the baseline to the current text of the text view; for example,
+ *  after the text has been saved. */
+- (void)setBaselineToCurrentText;
+
+/** YES if a baseline has been set. */
+@property (nonatomic, readonly) BOOL hasBaseline;
+
+
+/** Returns the changes of a line.
+ *  @param line A zero-based line number. */
+- (MGSLineChanges)changesOfLine:(NSUInteger)line;
+
+/** The number of regions of contiguous lines which differ from the
+ *  baseline. */
+@property (nonatomic, readonly) NSUInteger numberOfChangedRegions;
+
+
+/** Compares the whole text of the text view with the baseline again.
+ *  @discussion This method must be called when the text storage of the
+ *    text view is replaced. Edits to the text are tracked
+ *    automatically. */
+- (void)updateAllChanges;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
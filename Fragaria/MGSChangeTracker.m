@@ -0,0 +1,422 @@
+//
+//  MGSChangeTracker.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSChangeTracker.h"
+#import "NSTextStorage+Fragaria.h"
+
+
+NSString * const MGSChangeTrackerDidUpdateChangesNotification = @"MGSChangeTrackerDidUpdateChangesNotification";
+
+
+/* Maximum number of lines added or deleted in a region for which the
+ * lines are compared one by one. */
+#define MGSChangeTrackerMaxEditDistance     (1024)
+
+
+/* A region of contiguous lines which differ from the baseline. */
+typedef struct {
+    NSUInteger start;
+    NSUInteger length;
+    NSUInteger baseStart;
+    NSUInteger baseLength;
+} MGSChangeHunk;
+
+
+#define MGSHashCount(d)     ((d).length / sizeof(uint64_t))
+#define MGSHunkCount(d)     ((d).length / sizeof(MGSChangeHunk))
+
+
+static uint64_t MGSHashOfCharacters(NSString *s, NSRange range)
+{
+    unichar buf[256];
+    uint64_t h = 0xcbf29ce484222325ULL;
+    NSRange chunk;
+    NSUInteger i;
+    
+    while (range.length > 0) {
+        chunk = NSMakeRange(range.location, MIN(range.length, 256));
+        [s getCharacters:buf range:chunk];
+        for (i = 0; i < chunk.length; i++) {
+            h ^= buf[i];
+            h *= 0x100000001b3ULL;
+        }
+        range.location += chunk.length;
+        range.length -= chunk.length;
+    }
+    return h;
+}
+
+
+/* Appends to buf the hashes of the contents of count lines of s, starting
+ * from the line which begins at index start. The empty line after a
+ * trailing line terminator is counted as a line. */
+static void MGSAppendHashesOfLines(NSString *s, NSUInteger start, NSUInteger count, NSMutableData *buf)
+{
+    NSUInteger len = s.length, next, end, k;
+    uint64_t h;
+    
+    for (k = 0; k < count; k++) {
+        if (start >= len) {
+            h = MGSHashOfCharacters(s, NSMakeRange(len, 0));
+        } else {
+            [s getLineStart:NULL end:&next contentsEnd:&end forRange:NSMakeRange(start, 0)];
+            h = MGSHashOfCharacters(s, NSMakeRange(start, end - start));
+            start = next;
+        }
+        [buf appendBytes:&h length:sizeof(h)];
+    }
+}
+
+
+/* Appends to buf the hashes of all the lines of s. */
+static void MGSAppendHashesOfAllLines(NSString *s, NSMutableData *buf)
+{
+    NSUInteger len = s.length, start = 0, next, end = 0;
+    uint64_t h;
+    
+    while (start < len) {
+        [s getLineStart:NULL end:&next contentsEnd:&end forRange:NSMakeRange(start, 0)];
+        h = MGSHashOfCharacters(s, NSMakeRange(start, end - start));
+        [buf appendBytes:&h length:sizeof(h)];
+        start = next;
+    }
+    if (len == 0 || end < len)
+        MGSAppendHashesOfLines(s, len, 1, buf);
+}
+
+
+static void MGSAppendHunk(NSMutableData *out, NSUInteger start, NSUInteger length, NSUInteger baseStart, NSUInteger baseLength)
+{
+    MGSChangeHunk h = {start, length, baseStart, baseLength};
+    [out appendBytes:&h length:sizeof(h)];
+}
+
+
+/* Compares lines [ba, ba+bn) of the baseline with lines [ca, ca+cn) of the
+ * text, and appends the regions where they differ to out, using the
+ * algorithm described in E. Myers, "An O(ND) difference algorithm and its
+ * variations". */
+static void MGSDiffLines(const uint64_t *base, NSUInteger ba, NSUInteger bn, const uint64_t *cur, NSUInteger ca, NSUInteger cn, NSMutableData *out)
+{
+    const uint64_t *a, *b;
+    NSInteger n, m, maxd, d, k, x, y, pk, px, *vbuf, *v;
+    const NSInteger *tp;
+    NSMutableData *trace;
+    NSUInteger i, j, i0, j0;
+    BOOL *del, *ins;
+    
+    while (bn > 0 && cn > 0 && base[ba] == cur[ca]) {
+        ba++; ca++; bn--; cn--;
+    }
+    while (bn > 0 && cn > 0 && base[ba + bn - 1] == cur[ca + cn - 1]) {
+        bn--; cn--;
+    }
+    if (bn == 0 && cn == 0)
+        return;
+    if (bn == 0 || cn == 0) {
+        MGSAppendHunk(out, ca, cn, ba, bn);
+        return;
+    }
+    
+    a = base + ba;
+    b = cur + ca;
+    n = bn;
+    m = cn;
+    maxd = MIN(n + m, MGSChangeTrackerMaxEditDistance);
+    vbuf = calloc(2 * maxd + 3, sizeof(NSInteger));
+    v = vbuf + maxd + 1;
+    trace = [NSMutableData data];
+    
+    /* Find the shortest edit script, saving the furthest reaching paths of
+     * each step for backtracking */
+    for (d = 0; d <= maxd; d++) {
+        for (k = -d; k <= d; k += 2) {
+            if (k == -d || (k != d && v[k-1] < v[k+1]))
+                x = v[k+1];
+            else
+                x = v[k-1] + 1;
+            y = x - k;
+            while (x < n && y < m && a[x] == b[y]) {
+                x++; y++;
+            }
+            v[k] = x;
+            if (x >= n && y >= m)
+                goto found;
+        }
+        [trace appendBytes:v - d length:(2 * d + 1) * sizeof(NSInteger)];
+    }
+    
+    /* Too many differences; mark all the lines as modified */
+    free(vbuf);
+    MGSAppendHunk(out, ca, cn, ba, bn);
+    return;
+    
+found:
+    del = calloc(n + m, sizeof(BOOL));
+    ins = del + n;
+    x = n;
+    y = m;
+    for (; d > 0; d--) {
+        tp = (const NSInteger *)trace.bytes + (d - 1) * (d - 1) + (d - 1);
+        k = x - y;
+        if (k == -d || (k != d && tp[k-1] < tp[k+1]))
+            pk = k + 1;
+        else
+            pk = k - 1;
+        px = tp[pk];
+        if (pk == k + 1)
+            ins[px - pk] = YES;
+        else
+            del[px] = YES;
+        x = px;
+        y = px - pk;
+    }
+    free(vbuf);
+    
+    /* Group the deleted and inserted lines between matching lines */
+    i = j = 0;
+    while (i < bn || j < cn) {
+        if ((i < bn && del[i]) || (j < cn && ins[j])) {
+            i0 = i;
+            j0 = j;
+            while ((i < bn && del[i]) || (j < cn && ins[j])) {
+                while (i < bn && del[i])
+                    i++;
+                while (j < cn && ins[j])
+                    j++;
+            }
+            MGSAppendHunk(out, ca + j0, j - j0, ba + i0, i - i0);
+        } else {
+            i++;
+            j++;
+        }
+    }
+    free(del);
+}
+
+
+/* Returns the line of the baseline corresponding to a line of the text
+ * which follows the hunk at index i, or which precedes all the hunks if i
+ * is negative. */
+static NSUInteger MGSBaseLineAfterHunk(const MGSChangeHunk *h, NSInteger i, NSUInteger line)
+{
+    if (i < 0)
+        return line;
+    return line - (h[i].start + h[i].length) + (h[i].baseStart + h[i].baseLength);
+}
+
+
+@implementation MGSChangeTracker
+{
+    NSMutableData *_base;
+    NSMutableData *_lines;
+    NSMutableData *_hunks;
+}
+
+
+#pragma mark - Initialization
+
+
+- (instancetype)initWithTextView:(NSTextView *)textView
+{
+    self = [super init];
+    
+    _textView = textView;
+    _lines = [NSMutableData data];
+    _hunks = [NSMutableData data];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(textStorageDidProcessEditing:) name:NSTextStorageDidProcessEditingNotification object:nil];
+    
+    return self;
+}
+
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+
+#pragma mark - Setting the Baseline
+
+
+- (void)setBaselineString:(NSString *)string
+{
+    if (!string) {
+        _base = nil;
+        _lines.length = 0;
+        _hunks.length = 0;
+        [self didUpdateChanges];
+        return;
+    }
+    
+    _base = [NSMutableData data];
+    MGSAppendHashesOfAllLines(string, _base);
+    [self updateAllChanges];
+}
+
+
+- (void)setBaselineToCurrentText
+{
+    _lines.length = 0;
+    MGSAppendHashesOfAllLines(self.textView.textStorage.string, _lines);
+    _base = [_lines mutableCopy];
+    _hunks.length = 0;
+    [self didUpdateChanges];
+}
+
+
+- (BOOL)hasBaseline
+{
+    return _base != nil;
+}
+
+
+#pragma mark - Comparing with the Baseline
+
+
+- (void)updateAllChanges
+{
+    if (!_base)
+        return;
+    
+    _lines.length = 0;
+    MGSAppendHashesOfAllLines(self.textView.textStorage.string, _lines);
+    _hunks.length = 0;
+    MGSDiffLines(_base.bytes, 0, MGSHashCount(_base), _lines.bytes, 0, MGSHashCount(_lines), _hunks);
+    [self didUpdateChanges];
+}
+
+
+- (void)textStorageDidProcessEditing:(NSNotification *)notification
+{
+    NSTextStorage *ts = notification.object;
+    NSRange edited;
+    NSUInteger count, newCount, a, bNew;
+    NSInteger delta, bOld;
+    NSMutableData *hashes;
+    
+    if (ts != self.textView.textStorage || !_base || !(ts.editedMask & NSTextStorageEditedCharacters))
+        return;
+    
+    /* Find the lines which were replaced by the edit. The line before the
+     * edit is included in case a CRLF was split or joined. */
+    edited = ts.editedRange;
+    count = MGSHashCount(_lines);
+    newCount = ts.mgs_lineCount;
+    delta = (NSInteger)newCount - (NSInteger)count;
+    a = [ts mgs_rowOfCharacter:edited.location > 0 ? edited.location - 1 : 0];
+    bNew = MIN([ts mgs_rowOfCharacter:NSMaxRange(edited)] + 1, newCount);
+    bOld = (NSInteger)bNew - delta;
+    if (a == NSNotFound || bNew < a || bOld < (NSInteger)a || bOld > (NSInteger)count) {
+        [self updateAllChanges];
+        return;
+    }
+    
+    hashes = [NSMutableData dataWithCapacity:(bNew - a) * sizeof(uint64_t)];
+    MGSAppendHashesOfLines(ts.string, [ts mgs_firstCharacterInRow:a], bNew - a, hashes);
+    [_lines replaceBytesInRange:NSMakeRange(a * sizeof(uint64_t), (bOld - a) * sizeof(uint64_t)) withBytes:hashes.bytes length:hashes.length];
+    
+    [self compareLinesReplacingRange:NSMakeRange(a, bOld - a) lineDelta:delta];
+    [self didUpdateChanges];
+}
+
+
+/* Compares again with the baseline the lines of the text around a range of
+ * lines which has been replaced, and the regions of changed lines which
+ * overlap or touch it.
+ * range is the range of lines replaced, before the edit; delta is the
+ * difference between the number of lines after and before the edit. */
+- (void)compareLinesReplacingRange:(NSRange)range lineDelta:(NSInteger)delta
+{
+    MGSChangeHunk *h = _hunks.mutableBytes;
+    NSUInteger count = MGSHunkCount(_hunks);
+    NSUInteger first, last, lo, hi, mid, ca, cb, ba, bb, i;
+    NSMutableData *found;
+    
+    /* The first hunk which ends at or after the start of the range */
+    lo = 0;
+    hi = count;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (h[mid].start + h[mid].length >= range.location)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    first = last = lo;
+    while (last < count && h[last].start <= NSMaxRange(range))
+        last++;
+    
+    ca = range.location;
+    cb = NSMaxRange(range);
+    if (first < last) {
+        ca = MIN(ca, h[first].start);
+        cb = MAX(cb, h[last-1].start + h[last-1].length);
+    }
+    if (first < last && ca == h[first].start)
+        ba = h[first].baseStart;
+    else
+        ba = MGSBaseLineAfterHunk(h, (NSInteger)first - 1, ca);
+    if (first < last && cb == h[last-1].start + h[last-1].length)
+        bb = h[last-1].baseStart + h[last-1].baseLength;
+    else
+        bb = MGSBaseLineAfterHunk(h, (NSInteger)last - 1, cb);
+    
+    found = [NSMutableData data];
+    MGSDiffLines(_base.bytes, ba, bb - ba, _lines.bytes, ca, cb + delta - ca, found);
+    
+    for (i = last; i < count; i++)
+        h[i].start += delta;
+    [_hunks replaceBytesInRange:NSMakeRange(first * sizeof(MGSChangeHunk), (last - first) * sizeof(MGSChangeHunk)) withBytes:found.bytes length:found.length];
+}
+
+
+- (void)didUpdateChanges
+{
+    [[NSNotificationCenter defaultCenter] postNotificationName:MGSChangeTrackerDidUpdateChangesNotification object:self];
+}
+
+
+#pragma mark - Querying the Changes
+
+
+- (MGSLineChanges)changesOfLine:(NSUInteger)line
+{
+    const MGSChangeHunk *h = _hunks.bytes;
+    NSUInteger count = MGSHunkCount(_hunks), lineCount = MGSHashCount(_lines);
+    NSUInteger lo = 0, hi = count, mid;
+    MGSLineChanges res = MGSLineChangeNone;
+    
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (h[mid].start + h[mid].length > line || h[mid].start >= line)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    
+    if (lo < count && h[lo].start <= line) {
+        if (h[lo].length == 0)
+            res |= MGSLineChangeDeletedBefore;
+        else if (h[lo].baseLength == 0)
+            res |= MGSLineChangeAdded;
+        else
+            res |= MGSLineChangeModified;
+    }
+    if (line + 1 == lineCount && count > 0 && h[count-1].length == 0 && h[count-1].start == lineCount)
+        res |= MGSLineChangeDeletedAfter;
+    return res;
+}
+
+
+- (NSUInteger)numberOfChangedRegions
+{
+    return MGSHunkCount(_hunks);
+}
+
+
+@end
@@ -9,9 +9,24 @@
 #import <Foundation/Foundation.h>
 #import "MGSAutoCompleteDelegate.h"
 #import "MGSSyntaxParserClient.h"
+#import "MGSNumberLexer.h"
 
 
 @class MGSFragariaView;
+@class MGSSymbolPattern;
+
+
+/** The character classes of a syntax definition, one for each of its
+ *  character sets. */
+typedef NS_OPTIONS(uint8_t, MGSCharacterClass) {
+    MGSCharacterClassKeywordStart = 1 << 0,
+    MGSCharacterClassKeywordEnd = 1 << 1,
+    MGSCharacterClassName = 1 << 2,
+    MGSCharacterClassNumber = 1 << 3,
+    MGSCharacterClassBeginVariable = 1 << 4,
+    MGSCharacterClassEndVariable = 1 << 5,
+    MGSCharacterClassAttribute = 1 << 6
+};
 
 
 /** An MGSClassicFragariaSyntaxDefinition is a model object that describes how
@@ -95,6 +110,12 @@
  *  attribute and will be coloured as such. */
 @property (readonly) NSCharacterSet *attributesCharacterSet;
 
+/** The syntax of the numbers, for recognizing them with MGSNumberLexerScan.
+ *  @discussion This property supersedes numberDefinition, numberCharacterSet
+ *      and decimalPointCharacter. If this property is zero, a syntax
+ *      colourer should use those properties instead, otherwise they are
+ *      ignored. */
+@property (readonly) MGSNumberDialect numberDialect;
 /** A regular expression that matches numbers.
  *  @discussion This property supersedes numberCharacterSet, nameCharacterSet
  *      and decimalPointCharacter. If this property is nil, a syntax
@@ -105,13 +126,27 @@
  *  includes eventual decimal separators. */
 @property (readonly) NSCharacterSet *numberCharacterSet;
 /** Characters that should not precede a number for it to be coloured.
- *  @discussion This property has no effect if numberDefinition is non-nil. */
+ *  @discussion This property has no effect if numberDefinition is non-nil
+ *      and numberDialect is zero. */
 @property (readonly) NSCharacterSet *nameCharacterSet;
 /** A character that will not be coloured as a number - even if included in
  *  numberCharacterSet - if it is the last character of the number.
  *  @discussion This property has no effect if numberDefinition is non-nil. */
 @property (readonly) unichar decimalPointCharacter;
 
+/** A table which maps each UTF-16 code unit to the set of character classes
+ *  it belongs to.
+ *  @discussion The table has 65536 entries, and it is built from the
+ *      character sets of this definition the first time it is accessed.
+ *      A code unit belongs to a class if it is a member of the corresponding
+ *      character set. */
+@property (readonly) const MGSCharacterClass *characterClassTable;
+
+
+/** The patterns which match the declarations of the symbols indexed by
+ *  MGSSymbolIndex, in order of priority. Might be nil. */
+@property (readonly) NSArray<MGSSymbolPattern *> *symbolPatterns;
+
 
 /** Returns the array of syntax groups that MGSClassicFragariaSyntaxParser
  *  will use for colouring the text with this definition. */
@@ -134,6 +169,10 @@
 /** A name associated with this syntax definition. Might be nil. */
 @property (readonly) NSString *name;
 
+/** A hash of the contents of the dictionary this definition was initialized
+ *  from, which changes whenever a custom definition is edited. */
+@property (readonly) NSString *contentHash;
+
 
 /** Designated initializer.
  *  Initializes a new syntax definition object from a dictionary object,
@@ -8,6 +8,8 @@
 
 #import "MGSClassicFragariaSyntaxDefinition.h"
 #import "NSCharacterSet+Fragaria.h"
+#import "MGSSymbolIndex.h"
+#import "MGSHighlightCache.h"
 
 
 // syntax definition dictionary keys
@@ -15,6 +17,7 @@
 NSString *SMLSyntaxDefinitionAllowSyntaxColouring = @"allowSyntaxColouring";
 
 NSString *SMLSyntaxDefinitionAlternativeNumberRegex = @"numberDefinition";
+NSString *SMLSyntaxDefinitionNumberDialect = @"numberDialect";
 
 NSString *SMLSyntaxDefinitionKeywords = @"keywords";
 NSString *SMLSyntaxDefinitionAutocompleteWords = @"autocompleteWords";
@@ -50,9 +53,14 @@ NSString *SMLSyntaxDefinitionIncludeInKeywordEndCharacterSet = @"includeInKeywor
 
 NSString *SMLSyntaxDefinitionGroupSpecialization = @"groupSpecialization";
 
+NSString *SMLSyntaxDefinitionSymbolPatterns = @"symbolPatterns";
+NSString *SMLSyntaxDefinitionSymbolPatternKind = @"kind";
+NSString *SMLSyntaxDefinitionSymbolPatternRegex = @"regex";
+
 
 @implementation MGSClassicFragariaSyntaxDefinition {
     NSArray *sortedAutocompleteWords;
+    NSMutableData *characterClassData;
 }
 
 
@@ -62,6 +70,7 @@ NSString *SMLSyntaxDefinitionGroupSpecialization = @"groupSpecialization";
     [self setDefaults];
 
     _name = name;
+    _contentHash = [MGSHighlightCache contentHashOfPropertyList:syntaxDictionary];
     
     #define RETURN_NIL_IF_FALSE(b, ...) do { \
         if (!(b)) { \
@@ -97,6 +106,15 @@ NSString *SMLSyntaxDefinitionGroupSpecialization = @"groupSpecialization";
         RETURN_NIL_IF_FALSE(_numberDefinition, @"Incorrect regex syntax in %@", SMLSyntaxDefinitionAlternativeNumberRegex);
     }
     
+    // number dialect
+    value = [syntaxDictionary objectForKey:SMLSyntaxDefinitionNumberDialect];
+    if (value) {
+        NSString *invalidName;
+        RETURN_NIL_IF_FALSE([value isKindOfClass:[NSArray class]], @"NSArray expected");
+        _numberDialect = MGSNumberDialectFromNames(value, &invalidName);
+        RETURN_NIL_IF_FALSE(_numberDialect, @"Unknown number syntax feature %@ in %@", invalidName, SMLSyntaxDefinitionNumberDialect);
+    }
+    
     // keywords
     value = [syntaxDictionary valueForKey:SMLSyntaxDefinitionKeywords];
     if (value) {
@@ -265,6 +283,23 @@ NSString *SMLSyntaxDefinitionGroupSpecialization = @"groupSpecialization";
         _syntaxGroupSpecialization = value;
     }
     
+    // symbol patterns
+    value = [syntaxDictionary objectForKey:SMLSyntaxDefinitionSymbolPatterns];
+    if (value) {
+        RETURN_NIL_IF_FALSE([value isKindOfClass:[NSArray class]], @"NSArray expected");
+        NSMutableArray *patterns = [NSMutableArray array];
+        for (NSDictionary *item in value) {
+            RETURN_NIL_IF_FALSE([item isKindOfClass:[NSDictionary class]], @"NSDictionary expected");
+            NSString *kind = [item objectForKey:SMLSyntaxDefinitionSymbolPatternKind];
+            NSString *pattern = [item objectForKey:SMLSyntaxDefinitionSymbolPatternRegex];
+            RETURN_NIL_IF_FALSE([kind isKindOfClass:[NSString class]] && [pattern isKindOfClass:[NSString class]], @"NSString expected");
+            NSRegularExpression *regex = [NSRegularExpression regularExpressionWithPattern:pattern options:NSRegularExpressionAnchorsMatchLines error:nil];
+            RETURN_NIL_IF_FALSE(regex, @"Incorrect regex syntax in %@", SMLSyntaxDefinitionSymbolPatterns);
+            [patterns addObject:[[MGSSymbolPattern alloc] initWithKind:kind regularExpression:regex]];
+        }
+        _symbolPatterns = [patterns copy];
+    }
+    
     // exclude characters from keyword start character set
     value = [syntaxDictionary valueForKey:SMLSyntaxDefinitionExcludeFromKeywordStartCharacterSet];
     if (value) {
@@ -389,6 +424,40 @@ NSString *SMLSyntaxDefinitionGroupSpecialization = @"groupSpecialization";
 }
 
 
+- (const MGSCharacterClass *)characterClassTable
+{
+    if (!characterClassData) {
+        NSCharacterSet *sets[] = {
+            self.keywordStartCharacterSet, self.keywordEndCharacterSet,
+            self.nameCharacterSet, self.numberCharacterSet,
+            self.beginVariableCharacterSet, self.endVariableCharacterSet,
+            self.attributesCharacterSet};
+        MGSCharacterClass classes[] = {
+            MGSCharacterClassKeywordStart, MGSCharacterClassKeywordEnd,
+            MGSCharacterClassName, MGSCharacterClassNumber,
+            MGSCharacterClassBeginVariable, MGSCharacterClassEndVariable,
+            MGSCharacterClassAttribute};
+        NSMutableData *data = [NSMutableData dataWithLength:0x10000 * sizeof(MGSCharacterClass)];
+        MGSCharacterClass *table = data.mutableBytes;
+        NSData *bitmap;
+        const uint8_t *bits;
+        
+        /* The first 8 KiB of the bitmap representation of a character set
+         * are the bits of the Basic Multilingual Plane. */
+        for (NSUInteger k = 0; k < sizeof(classes) / sizeof(MGSCharacterClass); k++) {
+            bitmap = [sets[k] bitmapRepresentation];
+            bits = bitmap.bytes;
+            for (NSUInteger c = 0; c < 0x10000; c++) {
+                if (bits[c >> 3] & (1 << (c & 7)))
+                    table[c] |= classes[k];
+            }
+        }
+        characterClassData = data;
+    }
+    return characterClassData.bytes;
+}
+
+
 - (NSArray*)completions
 {
     if (!sortedAutocompleteWords) {
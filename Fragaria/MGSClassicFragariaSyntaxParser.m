@@ -12,6 +12,7 @@
 #import "MGSSyntaxAwareEditor.h"
 #import "MGSMutableSubstring.h"
 #import "NSCharacterSet+Fragaria.h"
+#import "NSString+Fragaria.h"
 
 
 // syntax colouring group IDs
@@ -33,6 +34,30 @@ enum {
 typedef NSInteger SMLSyntaxGroupInteger;
 
 
+/* Returns the index of the first character at or after i which belongs to
+ * one of the classes in cls, or len if there is no such character.
+ * Runs of characters not in cls are skipped four characters at a time. */
+static NSUInteger MGSScanUpToCharacterClass(const unichar *chars, NSUInteger i, NSUInteger len, const MGSCharacterClass *table, MGSCharacterClass cls)
+{
+    while (i + 4 <= len && !((table[chars[i]] | table[chars[i+1]] | table[chars[i+2]] | table[chars[i+3]]) & cls))
+        i += 4;
+    while (i < len && !(table[chars[i]] & cls))
+        i++;
+    return i;
+}
+
+
+/* Returns the index of the first character at or after i which does not
+ * belong to any of the classes in cls, or len if there is no such
+ * character. */
+static NSUInteger MGSScanCharacterClass(const unichar *chars, NSUInteger i, NSUInteger len, const MGSCharacterClass *table, MGSCharacterClass cls)
+{
+    while (i < len && (table[chars[i]] & cls))
+        i++;
+    return i;
+}
+
+
 @interface MGSClassicFragariaSyntaxParser ()
 
 @property (nonatomic, weak) id<MGSSyntaxParserClient> client;
@@ -44,6 +69,9 @@ typedef NSInteger SMLSyntaxGroupInteger;
 {
     NSString *firstStringPattern, *secondStringPattern;
     NSString *firstMultilineStringPattern, *secondMultilineStringPattern;
+    NSMutableData *rangeCharacterData;
+    const unichar *rangeCharacters;
+    const MGSCharacterClass *characterClasses;
 }
 
 
@@ -97,17 +125,18 @@ typedef NSInteger SMLSyntaxGroupInteger;
     NSString *documentString = [documentScanner string];
     NSString *rangeString = [rangeScanner string];
     NSUInteger rangeStringLength = [rangeString length];
+    NSUInteger scanLocation = [rangeScanner scanLocation];
     
     // scan range to end
-    while (![rangeScanner isAtEnd]) {
-        [rangeScanner scanUpToCharactersFromSet:self.syntaxDefinition.keywordStartCharacterSet intoString:nil];
-        colourStartLocation = [rangeScanner scanLocation];
+    while (scanLocation < rangeStringLength) {
+        colourStartLocation = MGSScanUpToCharacterClass(rangeCharacters, scanLocation, rangeStringLength, characterClasses, MGSCharacterClassKeywordStart);
+        scanLocation = colourStartLocation;
         if ((colourStartLocation + 1) < rangeStringLength) {
-            [rangeScanner mgs_setScanLocation:(colourStartLocation + 1)];
+            scanLocation = colourStartLocation + 1;
         }
-        [rangeScanner scanUpToCharactersFromSet:self.syntaxDefinition.keywordEndCharacterSet intoString:nil];
+        colourEndLocation = MGSScanUpToCharacterClass(rangeCharacters, scanLocation, rangeStringLength, characterClasses, MGSCharacterClassKeywordEnd);
+        scanLocation = colourEndLocation;
         
-        colourEndLocation = [rangeScanner scanLocation];
         if (colourEndLocation > rangeStringLength || colourStartLocation == colourEndLocation) {
             break;
         }
@@ -124,9 +153,10 @@ typedef NSInteger SMLSyntaxGroupInteger;
                     continue;
                 }
             }
-            [self setBaseGroup:group range:NSMakeRange(colourStartLocation + rangeLocation, [rangeScanner scanLocation] - colourStartLocation) atomic:atomic];
+            [self setBaseGroup:group range:NSMakeRange(colourStartLocation + rangeLocation, colourEndLocation - colourStartLocation) atomic:atomic];
         }
     }
+    [rangeScanner mgs_setScanLocation:scanLocation];
 }
 
 
@@ -153,7 +183,9 @@ typedef NSInteger SMLSyntaxGroupInteger;
     
     // setup
     self.client = client;
-    NSRange effectiveRange = [documentString lineRangeForRange:rangeToRecolour];
+    // Lines longer than MGSLongLineThreshold are coloured one window at a
+    // time.
+    NSRange effectiveRange = [documentString mgs_highlightingRangeForRange:rangeToRecolour];
 
     // trace
     //NSLog(@"rangeToRecolor location %i length %i", rangeToRecolour.location, rangeToRecolour.length);
@@ -171,7 +203,7 @@ typedef NSInteger SMLSyntaxGroupInteger;
         NSInteger beginFirstStringInMultiLine = [documentString rangeOfString:self.syntaxDefinition.firstString options:NSBackwardsSearch range:NSMakeRange(0, effectiveRange.location)].location;
         if (beginFirstStringInMultiLine != NSNotFound) {
             if ([self tokenAtIndex:beginFirstStringInMultiLine hasBaseGroup:@"strings"]) {
-                NSInteger startOfLine = [documentString lineRangeForRange:NSMakeRange(beginFirstStringInMultiLine, 0)].location;
+                NSInteger startOfLine = [documentString mgs_highlightingRangeForRange:NSMakeRange(beginFirstStringInMultiLine, 0)].location;
                 effectiveRange = NSMakeRange(startOfLine, rangeToRecolour.length + (rangeToRecolour.location - startOfLine));
             }
         }
@@ -183,7 +215,7 @@ typedef NSInteger SMLSyntaxGroupInteger;
             restOfString.length = [documentString length] - restOfString.location;
             NSInteger lastStringEnd = [documentString rangeOfString:self.syntaxDefinition.firstString options:0 range:restOfString].location;
             if (lastStringEnd != NSNotFound) {
-                NSInteger endOfLine = NSMaxRange([documentString lineRangeForRange:NSMakeRange(lastStringEnd, 0)]);
+                NSInteger endOfLine = NSMaxRange([documentString mgs_highlightingRangeForRange:NSMakeRange(lastStringEnd, 0)]);
                 effectiveRange = NSUnionRange(effectiveRange, NSMakeRange(lastStringBegin, endOfLine-lastStringBegin));
             }
         }
@@ -193,7 +225,9 @@ typedef NSInteger SMLSyntaxGroupInteger;
         return effectiveRange;
     
     /* Expand the range to not start or end in the middle of an already coloured
-     * block. */
+     * block. This is also what allows to resume colouring at the boundary
+     * between the windows of a long line: a token which spans across a window
+     * boundary is coloured again as a whole. */
     NSRange longRange;
     
     if ([client groupOfTokenAtCharacterIndex:effectiveRange.location isAtomic:NULL range:&longRange]) {
@@ -210,6 +244,12 @@ typedef NSInteger SMLSyntaxGroupInteger;
         return effectiveRange;
     }
     
+    // copy the range string's characters, to classify them via table lookups
+    rangeCharacterData = [NSMutableData dataWithLength:rangeStringLength * sizeof(unichar)];
+    [rangeString getCharacters:rangeCharacterData.mutableBytes range:NSMakeRange(0, rangeStringLength)];
+    rangeCharacters = rangeCharacterData.bytes;
+    characterClasses = self.syntaxDefinition.characterClassTable;
+    
     // allocate the range scanner
     NSScanner *rangeScanner = [[NSScanner alloc] initWithString:rangeString];
     [rangeScanner setCharactersToBeSkipped:nil];
@@ -229,6 +269,9 @@ typedef NSInteger SMLSyntaxGroupInteger;
     } @catch (NSException *exception) {
         NSLog(@"Syntax colouring exception: %@", exception);
     }
+    
+    rangeCharacters = NULL;
+    rangeCharacterData = nil;
 
     return effectiveRange;
 }
@@ -331,9 +374,15 @@ typedef NSInteger SMLSyntaxGroupInteger;
     NSInteger rangeLocation = colouringRange.location;
     unichar testCharacter;
     NSString *documentString = [documentScanner string];
-    NSString *rangeString = [rangeScanner string];
+    NSUInteger rangeStringLength = [[rangeScanner string] length];
+    NSUInteger scanLocation = [rangeScanner scanLocation];
     
     
+    if (self.syntaxDefinition.numberDialect) {
+        [self lexNumbersInRange:colouringRange documentString:documentString];
+        return;
+    }
+    
     if (self.syntaxDefinition.numberDefinition) {
         [self recognizeMatchesOfPattern:self.syntaxDefinition.numberDefinition ofGroup:MGSSyntaxGroupNumber inString:documentString range:colouringRange atomicTokens:YES];
         return;
@@ -341,15 +390,14 @@ typedef NSInteger SMLSyntaxGroupInteger;
     
     
     // scan range to end
-    while (![rangeScanner isAtEnd]) {
+    while (scanLocation < rangeStringLength) {
         
         // scan up to a number character
-        [rangeScanner scanUpToCharactersFromSet:self.syntaxDefinition.numberCharacterSet intoString:NULL];
-        colourStartLocation = [rangeScanner scanLocation];
+        colourStartLocation = MGSScanUpToCharacterClass(rangeCharacters, scanLocation, rangeStringLength, characterClasses, MGSCharacterClassNumber);
         
         // scan to number end
-        [rangeScanner scanCharactersFromSet:self.syntaxDefinition.numberCharacterSet intoString:NULL];
-        colourEndLocation = [rangeScanner scanLocation];
+        colourEndLocation = MGSScanCharacterClass(rangeCharacters, colourStartLocation, rangeStringLength, characterClasses, MGSCharacterClassNumber);
+        scanLocation = colourEndLocation;
         
         if (colourStartLocation == colourEndLocation) {
             break;
@@ -363,7 +411,7 @@ typedef NSInteger SMLSyntaxGroupInteger;
             
             // numbers can occur in variable, class and function names
             // eg: var_1 should not be coloured as a number
-            if ([self.syntaxDefinition.nameCharacterSet characterIsMember:testCharacter]) {
+            if (characterClasses[testCharacter] & MGSCharacterClassName) {
                 continue;
             }
         }
@@ -373,7 +421,7 @@ typedef NSInteger SMLSyntaxGroupInteger;
         // don't colour a trailing decimal point as some languages may use it as a line terminator
         if (colourEndLocation > 0) {
             queryLocation = colourEndLocation - 1;
-            testCharacter = [rangeString characterAtIndex:queryLocation];
+            testCharacter = rangeCharacters[queryLocation];
             if (testCharacter == self.syntaxDefinition.decimalPointCharacter) {
                 colourEndLocation--;
             }
@@ -384,6 +432,35 @@ typedef NSInteger SMLSyntaxGroupInteger;
 }
 
 
+- (void)lexNumbersInRange:(NSRange)colouringRange documentString:(NSString *)documentString
+{
+    NSUInteger rangeStringLength = colouringRange.length;
+    MGSNumberDialect dialect = self.syntaxDefinition.numberDialect;
+    NSUInteger i = 0, length;
+    unichar c, previous;
+    
+    previous = colouringRange.location > 0 ? [documentString characterAtIndex:colouringRange.location - 1] : ' ';
+    while (i < rangeStringLength) {
+        c = rangeCharacters[i];
+        
+        // numbers can occur in variable, class and function names
+        // eg: var_1 should not be coloured as a number
+        // a decimal point after another one is part of a range operator
+        if (((c >= '0' && c <= '9') || (c == '.' && previous != '.')) && !(characterClasses[previous] & MGSCharacterClassName) && !(previous >= '0' && previous <= '9')) {
+            length = MGSNumberLexerScan(rangeCharacters, i, rangeStringLength, dialect);
+            if (length > 0) {
+                [self setBaseGroup:MGSSyntaxGroupNumber range:NSMakeRange(colouringRange.location + i, length) atomic:YES];
+                i += length;
+                previous = rangeCharacters[i - 1];
+                continue;
+            }
+        }
+        previous = c;
+        i++;
+    }
+}
+
+
 - (void)colourCommandsInRange:(NSRange)colouringRange withRangeScanner:(NSScanner*)rangeScanner documentScanner:(NSScanner*)documentScanner
 {
     NSInteger colourStartLocation;
@@ -510,7 +587,7 @@ typedef NSInteger SMLSyntaxGroupInteger;
 {
     NSUInteger colourStartLocation;
     NSInteger rangeLocation = rangeToRecolour.location;
-    NSUInteger endOfLine, colourLength;
+    NSUInteger endOfLine, colourLength, colourEndLocation;
     NSString *rangeString = [rangeScanner string];
     NSUInteger rangeStringLength = [rangeString length];
     
@@ -521,10 +598,10 @@ typedef NSInteger SMLSyntaxGroupInteger;
     
     // scan range to end
     while (![rangeScanner isAtEnd]) {
-        [rangeScanner scanUpToCharactersFromSet:self.syntaxDefinition.beginVariableCharacterSet intoString:nil];
-        colourStartLocation = [rangeScanner scanLocation];
+        colourStartLocation = MGSScanUpToCharacterClass(rangeCharacters, [rangeScanner scanLocation], rangeStringLength, characterClasses, MGSCharacterClassBeginVariable);
+        [rangeScanner mgs_setScanLocation:colourStartLocation];
         if (colourStartLocation + 1 < rangeStringLength) {
-            if ([[self.syntaxDefinition.singleLineComments firstObject] isEqual:@"%"] && [rangeString characterAtIndex:colourStartLocation + 1] == '%') { // To avoid a problem in LaTex with \%
+            if ([[self.syntaxDefinition.singleLineComments firstObject] isEqual:@"%"] && rangeCharacters[colourStartLocation + 1] == '%') { // To avoid a problem in LaTex with \%
                 if ([rangeScanner scanLocation] < rangeStringLength) {
                     [rangeScanner mgs_setScanLocation:colourStartLocation + 1];
                 }
@@ -532,7 +609,9 @@ typedef NSInteger SMLSyntaxGroupInteger;
             }
         }
         endOfLine = NSMaxRange([rangeString lineRangeForRange:NSMakeRange(colourStartLocation, 0)]);
-        if (![rangeScanner scanUpToCharactersFromSet:self.syntaxDefinition.endVariableCharacterSet intoString:nil] || [rangeScanner scanLocation] >= endOfLine) {
+        colourEndLocation = MGSScanUpToCharacterClass(rangeCharacters, colourStartLocation, rangeStringLength, characterClasses, MGSCharacterClassEndVariable);
+        [rangeScanner mgs_setScanLocation:colourEndLocation];
+        if (colourEndLocation == colourStartLocation || colourEndLocation >= endOfLine) {
             [rangeScanner mgs_setScanLocation:endOfLine];
             colourLength = [rangeScanner scanLocation] - colourStartLocation;
         } else {
@@ -616,8 +695,8 @@ typedef NSInteger SMLSyntaxGroupInteger;
             continue;
         }
         
-        [rangeScanner scanCharactersFromSet:self.syntaxDefinition.attributesCharacterSet intoString:nil];
-        colourEndLocation = [rangeScanner scanLocation];
+        colourEndLocation = MGSScanCharacterClass(rangeCharacters, [rangeScanner scanLocation], rangeStringLength, characterClasses, MGSCharacterClassAttribute);
+        [rangeScanner mgs_setScanLocation:colourEndLocation];
         
         if (colourEndLocation + 1 < rangeStringLength) {
             [rangeScanner mgs_setScanLocation:[rangeScanner scanLocation] + 1];
@@ -891,7 +970,7 @@ typedef NSInteger SMLSyntaxGroupInteger;
             [line insertString:comment atIndex:0];
         };
     }
-    [string enumerateMutableSubstringsOfLinesUsingBlock:workblock];
+    [string enumerateMutableSubstringsOfLinesWithOptions:MGSMutableSubstringEnumerationDeferEdits usingBlock:workblock];
 }
 
 
@@ -910,4 +989,22 @@ typedef NSInteger SMLSyntaxGroupInteger;
 }
 
 
+#pragma mark - Indexing Symbols
+
+
+- (NSArray<MGSSymbolPattern *> *)symbolPatterns
+{
+    return self.syntaxDefinition.symbolPatterns;
+}
+
+
+#pragma mark - Caching Parse Results
+
+
+- (NSString *)tokenCacheVersion
+{
+    return [NSString stringWithFormat:@"%@ %@", [super tokenCacheVersion], self.syntaxDefinition.contentHash];
+}
+
+
 @end
@@ -0,0 +1,156 @@
+//
+//  MGSFoldingController.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class MGSTextView;
+
+
+/** Manages the folded regions of the text of a MGSTextView.
+ *
+ *  A fold hides a range of characters which ends after a line terminator,
+ *  or at the end of the text. The lines after the one where the range
+ *  begins, up to the one where it ends, are hidden; the line where the
+ *  range begins is displayed with a placeholder in place of the folded
+ *  text, and the line which follows the fold keeps its own row. The layout
+ *  manager generates null glyphs for the folded characters, so that they
+ *  are not typeset, and the text view does not colour them when drawing.
+ *  Folded text is still parsed whenever the parser needs it to colour the
+ *  text which follows, and by the other clients of the syntax colouring
+ *  such as the symbol index; only the colouring done for drawing skips
+ *  it.
+ *
+ *  The blocks of lines which can be folded are delimited by brackets, by
+ *  block comments or by indentation. Brackets inside comments and strings
+ *  are ignored.
+ *
+ *  Folds never overlap. They are moved when the text before them is edited,
+ *  and they are removed when the text they hide is edited. */
+@interface MGSFoldingController : NSObject
+
+
+/** Initializes a folding controller for a text view.
+ *  @param textView The text view. */
+- (instancetype)initWithTextView:(MGSTextView *)textView;
+
+/** The text view whose text is folded. */
+@property (nonatomic, weak, readonly) MGSTextView *textView;
+
+
+/// @name Finding Foldable Blocks
+
+
+/** Returns the range of characters which would be hidden by folding the
+ *  block which begins at a line.
+ *  @param line A zero-based line number.
+ *  @returns A range, or {NSNotFound, 0} if no block begins at the line.
+ *  @discussion This method may colour the text up to the end of the
+ *    block, to find which brackets are part of comments and strings. The
+ *    end of a block delimited by brackets is searched for in the first
+ *    million characters following its beginning; longer blocks are only
+ *    found by indentation. */
+- (NSRange)foldableRangeOfLine:(NSUInteger)line;
+
+/** Returns YES if a block seems to begin at a line.
+ *  @param line A zero-based line number.
+ *  @discussion Only the beginning of the line itself and the following
+ *    line are examined, and the text is not coloured; thus this method is
+ *    fast enough to be called while drawing, but -foldableRangeOfLine: may
+ *    still fail to find the end of the block. */
+- (BOOL)isLineFoldable:(NSUInteger)line;
+
+
+/// @name Folding and Unfolding
+
+
+/** Folds the block which begins at a line.
+ *  @param line A zero-based line number.
+ *  @returns NO if no block begins at the line. */
+- (BOOL)foldLine:(NSUInteger)line;
+
+/** Folds a range of characters. The folds which overlap it are removed.
+ *  @param range A range of characters. The characters after its last line
+ *    terminator are not folded, unless the range ends at the end of the
+ *    text.
+ *  @returns NO if the range does not hide any line. */
+- (BOOL)foldCharactersInRange:(NSRange)range;
+
+/** Removes the folds which begin at a line or which hide it.
+ *  @param line A zero-based line number.
+ *  @returns NO if there was no such fold. */
+- (BOOL)unfoldLine:(NSUInteger)line;
+
+/** Removes all the folds. */
+- (void)unfoldAll;
+
+/** Returns YES if a fold begins at a line.
+ *  @param line A zero-based line number. */
+- (BOOL)isLineFolded:(NSUInteger)line;
+
+
+/// @name Inspecting the Folds
+
+
+/** The number of folds. */
+@property (nonatomic, readonly) NSUInteger numberOfFolds;
+
+/** Returns the range of the fold which hides a character.
+ *  @param i A character index.
+ *  @returns A range, or {NSNotFound, 0} if the character is not folded. */
+- (NSRange)foldedRangeContainingCharacterIndex:(NSUInteger)i;
+
+/** Calls a block for each fold which intersects a range of characters, in
+ *  ascending order.
+ *  @param range A range of characters.
+ *  @param block The block to call. Set *stop to YES to stop the
+ *    enumeration. */
+- (void)enumerateFoldsInRange:(NSRange)range usingBlock:(void (^)(NSRange fold, BOOL *stop))block;
+
+/** Returns the characters in a range which are not folded.
+ *  @param range A range of characters. */
+- (NSIndexSet *)unfoldedCharacterIndexesInRange:(NSRange)range;
+
+
+/// @name Mapping Lines to Visible Rows
+
+
+/** Returns the zero-based index of the row where a line is displayed.
+ *  @param line A zero-based line number.
+ *  @discussion A hidden line is displayed in the same row as the line where
+ *    its fold begins. */
+- (NSUInteger)visibleRowOfLine:(NSUInteger)line;
+
+/** Returns the first line displayed in a row.
+ *  @param row The zero-based index of a row. */
+- (NSUInteger)lineOfVisibleRow:(NSUInteger)row;
+
+/** Returns the first line displayed in the row which follows the row of a
+ *  line, skipping the lines hidden in between.
+ *  @param line A zero-based line number. */
+- (NSUInteger)nextVisibleLineAfterLine:(NSUInteger)line;
+
+/** Returns YES if a line is hidden by a fold.
+ *  @param line A zero-based line number. */
+- (BOOL)isLineHidden:(NSUInteger)line;
+
+
+/// @name Tracking Edits
+
+
+/** Generates again the glyphs of the text whose folds were removed by the
+ *  last edit. Called by the layout manager once it has processed the edit,
+ *  since the text storage notifies the folding controller before. */
+- (void)layoutManagerDidProcessEditing;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
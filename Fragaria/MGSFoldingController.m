@@ -0,0 +1,681 @@
+//
+//  MGSFoldingController.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSFoldingController.h"
+#import "MGSTextView.h"
+#import "MGSTextViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "NSTextStorage+Fragaria.h"
+
+
+/* Number of characters coloured at a time while looking for the end of a
+ * block. */
+#define MGSFoldScanChunkLength  (16384)
+
+/* Maximum number of characters scanned while looking for the end of a
+ * block. Longer blocks can only be folded by indentation. */
+#define MGSFoldMaximumBlockLength   (1048576)
+
+/* Maximum number of characters of a line examined while drawing its
+ * folding marker. */
+#define MGSFoldMaximumLineScanLength    (4096)
+
+
+static const NSRange MGSNoFold = {NSNotFound, 0};
+
+
+/* The lines of a fold, computed from its character range. */
+typedef struct {
+    NSUInteger headerLine;      /* The line where the fold begins */
+    NSUInteger hiddenLines;     /* The number of lines hidden by the fold */
+    NSUInteger hiddenBefore;    /* The lines hidden by the previous folds */
+} MGSFoldLines;
+
+
+static inline NSUInteger MGSFoldCount(NSData *folds)
+{
+    return folds.length / sizeof(NSRange);
+}
+
+
+static inline unichar MGSClosingBracket(unichar c)
+{
+    switch (c) {
+        case '(': return ')';
+        case '[': return ']';
+        case '{': return '}';
+    }
+    return 0;
+}
+
+
+@implementation MGSFoldingController
+{
+    NSMutableData *_folds;          /* NSRange, sorted and disjoint */
+    NSMutableData *_foldLines;      /* MGSFoldLines, one per fold */
+    BOOL _foldLinesAreValid;
+    NSRange _unfoldedRange;         /* Unfolded by an edit, or MGSNoFold */
+}
+
+
+#pragma mark - Initialization
+
+
+- (instancetype)initWithTextView:(MGSTextView *)textView
+{
+    self = [super init];
+    
+    _textView = textView;
+    _folds = [NSMutableData data];
+    _foldLines = [NSMutableData data];
+    _unfoldedRange = MGSNoFold;
+    
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(textStorageDidProcessEditing:) name:NSTextStorageDidProcessEditingNotification object:nil];
+    
+    return self;
+}
+
+
+- (void)dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+
+#pragma mark - Finding Foldable Blocks
+
+
+- (NSRange)foldableRangeOfLine:(NSUInteger)line
+{
+    MGSTextView *tv = self.textView;
+    NSUInteger start, end, open, close;
+    NSRange res;
+    
+    if (![self getStart:&start contentsEnd:&end ofLine:line])
+        return MGSNoFold;
+    if (tv.isSyntaxColoured)
+        [tv.syntaxColouring recolourRange:NSMakeRange(start, end - start)];
+    
+    open = [self indexOfUnclosedBracketInRange:NSMakeRange(start, end - start)];
+    if (open != NSNotFound) {
+        close = [self indexOfBracketClosingBracketAtIndex:open];
+        if (close != NSNotFound && close > end) {
+            res = [self foldRangeForRange:NSMakeRange(open + 1, close - open - 1)];
+            if (res.location != NSNotFound)
+                return res;
+        }
+    }
+    
+    res = [self commentFoldRangeOfLineWithStart:start contentsEnd:end];
+    if (res.location != NSNotFound)
+        return res;
+    
+    return [self indentationFoldRangeOfLineWithStart:start contentsEnd:end onlyFirstLine:NO];
+}
+
+
+- (BOOL)isLineFoldable:(NSUInteger)line
+{
+    NSUInteger start, end;
+    
+    if (![self getStart:&start contentsEnd:&end ofLine:line])
+        return NO;
+    
+    if ([self indexOfUnclosedBracketInRange:NSMakeRange(start, MIN(end - start, MGSFoldMaximumLineScanLength))] != NSNotFound)
+        return YES;
+    if ([self commentFoldRangeOfLineWithStart:start contentsEnd:end].location != NSNotFound)
+        return YES;
+    return [self indentationFoldRangeOfLineWithStart:start contentsEnd:end onlyFirstLine:YES].location != NSNotFound;
+}
+
+
+- (BOOL)getStart:(NSUInteger *)start contentsEnd:(NSUInteger *)end ofLine:(NSUInteger)line
+{
+    NSTextStorage *ts = self.textView.textStorage;
+    NSUInteger s;
+    
+    if (line >= [ts mgs_lineCount])
+        return NO;
+    s = [ts mgs_firstCharacterInRow:line];
+    if (s == NSNotFound || s > ts.length)
+        return NO;
+    [ts.string getLineStart:NULL end:NULL contentsEnd:end forRange:NSMakeRange(s, 0)];
+    *start = s;
+    return YES;
+}
+
+
+/* Returns the part of a range which ends after its last line terminator, or
+ * at the end of the text, so that the line where the range ends is left
+ * visible in its own row. Returns MGSNoFold if that part hides no line. */
+- (NSRange)foldRangeForRange:(NSRange)range
+{
+    NSTextStorage *ts = self.textView.textStorage;
+    NSString *string = ts.string;
+    NSUInteger end = NSMaxRange(range);
+    
+    if (end > string.length)
+        return MGSNoFold;
+    if (end < string.length)
+        [string getLineStart:&end end:NULL contentsEnd:NULL forRange:NSMakeRange(end, 0)];
+    if (end <= range.location || [ts mgs_rowOfCharacter:end - 1] <= [ts mgs_rowOfCharacter:range.location])
+        return MGSNoFold;
+    return NSMakeRange(range.location, end - range.location);
+}
+
+
+/* Calls a block for each character in a range which is not part of a
+ * comment or of a string. If recolour is YES, the text is coloured chunk by
+ * chunk as the enumeration proceeds; otherwise the current colouring is
+ * used. */
+- (void)enumerateCodeCharactersInRange:(NSRange)range recolouring:(BOOL)recolour usingBlock:(void (^)(NSUInteger i, unichar c, BOOL *stop))block
+{
+    MGSTextView *tv = self.textView;
+    MGSSyntaxColouring *sc = tv.syntaxColouring;
+    NSString *string = tv.string;
+    NSUInteger chunk;
+    __block BOOL stop = NO;
+    
+    recolour = recolour && tv.isSyntaxColoured;
+    for (chunk = range.location; chunk < NSMaxRange(range) && !stop; chunk += MGSFoldScanChunkLength) {
+        NSRange chunkRange = NSMakeRange(chunk, MIN(MGSFoldScanChunkLength, NSMaxRange(range) - chunk));
+        
+        if (recolour)
+            [sc recolourRange:chunkRange];
+        [sc enumerateTokenGroupsInRange:chunkRange usingBlock:^(NSRange run, MGSSyntaxGroup group, BOOL *stop2) {
+            NSUInteger i;
+            
+            if ([group isEqual:MGSSyntaxGroupComment] || [group isEqual:MGSSyntaxGroupString])
+                return;
+            for (i = run.location; i < NSMaxRange(run) && !stop; i++)
+                block(i, [string characterAtIndex:i], &stop);
+            *stop2 = stop;
+        }];
+    }
+}
+
+
+/* Returns the index of the last bracket opened in a range and not closed
+ * in the same range, or NSNotFound. */
+- (NSUInteger)indexOfUnclosedBracketInRange:(NSRange)range
+{
+    NSMutableData *stack = [NSMutableData data];
+    NSString *string = self.textView.string;
+    const NSUInteger *open;
+    NSUInteger n;
+    
+    [self enumerateCodeCharactersInRange:range recolouring:NO usingBlock:^(NSUInteger i, unichar c, BOOL *stop) {
+        const NSUInteger *s = stack.bytes;
+        NSUInteger count = stack.length / sizeof(NSUInteger);
+        
+        if (MGSClosingBracket(c)) {
+            [stack appendBytes:&i length:sizeof(NSUInteger)];
+        } else if ((c == ')' || c == ']' || c == '}') && count > 0) {
+            if (MGSClosingBracket([string characterAtIndex:s[count-1]]) == c)
+                stack.length -= sizeof(NSUInteger);
+        }
+    }];
+    
+    open = stack.bytes;
+    n = stack.length / sizeof(NSUInteger);
+    return n > 0 ? open[n-1] : NSNotFound;
+}
+
+
+/* Returns the index of the bracket which closes the bracket at an index,
+ * or NSNotFound if it is not closed within MGSFoldMaximumBlockLength
+ * characters. */
+- (NSUInteger)indexOfBracketClosingBracketAtIndex:(NSUInteger)open
+{
+    NSString *string = self.textView.string;
+    unichar o = [string characterAtIndex:open], c = MGSClosingBracket(o);
+    __block NSUInteger depth = 1, res = NSNotFound;
+    NSRange rest = NSMakeRange(open + 1, MIN(string.length - open - 1, MGSFoldMaximumBlockLength));
+    
+    [self enumerateCodeCharactersInRange:rest recolouring:YES usingBlock:^(NSUInteger i, unichar ch, BOOL *stop) {
+        if (ch == o) {
+            depth++;
+        } else if (ch == c && --depth == 0) {
+            res = i;
+            *stop = YES;
+        }
+    }];
+    return res;
+}
+
+
+/* Returns the range which hides the rest of a block comment beginning at
+ * the start of a line, or MGSNoFold. */
+- (NSRange)commentFoldRangeOfLineWithStart:(NSUInteger)start contentsEnd:(NSUInteger)end
+{
+    MGSTextView *tv = self.textView;
+    NSString *string = tv.string;
+    NSCharacterSet *ws = [NSCharacterSet whitespaceCharacterSet];
+    NSCharacterSet *nl = [NSCharacterSet newlineCharacterSet];
+    NSUInteger i, last;
+    MGSSyntaxGroup group;
+    NSRange run;
+    
+    for (i = start; i < end && [ws characterIsMember:[string characterAtIndex:i]]; i++);
+    if (i >= end)
+        return MGSNoFold;
+    
+    group = [tv.syntaxColouring groupOfTokenAtCharacterIndex:i isAtomic:NULL range:&run];
+    if (![group isEqual:MGSSyntaxGroupComment])
+        return MGSNoFold;
+    
+    last = NSMaxRange(run);
+    while (last > end && [nl characterIsMember:[string characterAtIndex:last - 1]])
+        last--;
+    if (last <= end)
+        return MGSNoFold;
+    return [self foldRangeForRange:NSMakeRange(end, last - end)];
+}
+
+
+/* Returns the indentation width of a line, or NSNotFound if the line is
+ * blank. */
+- (NSUInteger)indentationOfLineWithStart:(NSUInteger)start contentsEnd:(NSUInteger)end
+{
+    NSString *string = self.textView.string;
+    NSUInteger tabWidth = MAX(1, self.textView.tabWidth);
+    NSUInteger i, width = 0;
+    unichar c;
+    
+    for (i = start; i < end; i++) {
+        c = [string characterAtIndex:i];
+        if (c == ' ')
+            width++;
+        else if (c == '\t')
+            width = (width / tabWidth + 1) * tabWidth;
+        else
+            return width;
+    }
+    return NSNotFound;
+}
+
+
+/* Returns the range which hides the lines following a line which are
+ * indented more than it, or MGSNoFold. If onlyFirstLine is YES, only the
+ * first non-blank line following the line is examined, and the range
+ * returned hides just that line. */
+- (NSRange)indentationFoldRangeOfLineWithStart:(NSUInteger)start contentsEnd:(NSUInteger)end onlyFirstLine:(BOOL)onlyFirstLine
+{
+    NSString *string = self.textView.string;
+    NSUInteger len = string.length;
+    NSUInteger base, indent, pos, next, contentsEnd, last = NSNotFound;
+    
+    base = [self indentationOfLineWithStart:start contentsEnd:end];
+    if (base == NSNotFound)
+        return MGSNoFold;
+    
+    [string getLineStart:NULL end:&pos contentsEnd:NULL forRange:NSMakeRange(start, 0)];
+    while (pos < len) {
+        [string getLineStart:NULL end:&next contentsEnd:&contentsEnd forRange:NSMakeRange(pos, 0)];
+        indent = [self indentationOfLineWithStart:pos contentsEnd:contentsEnd];
+        if (indent != NSNotFound) {
+            if (indent <= base)
+                break;
+            last = next;
+            if (onlyFirstLine)
+                break;
+        }
+        pos = next;
+    }
+    
+    if (last == NSNotFound)
+        return MGSNoFold;
+    return [self foldRangeForRange:NSMakeRange(end, last - end)];
+}
+
+
+#pragma mark - Folding and Unfolding
+
+
+- (BOOL)foldLine:(NSUInteger)line
+{
+    NSRange range = [self foldableRangeOfLine:line];
+    
+    if (range.location == NSNotFound)
+        return NO;
+    return [self foldCharactersInRange:range];
+}
+
+
+- (BOOL)foldCharactersInRange:(NSRange)range
+{
+    MGSTextView *tv = self.textView;
+    const NSRange *f;
+    NSRange changed, sel;
+    NSUInteger i, n;
+    
+    range = [self foldRangeForRange:range];
+    if (range.location == NSNotFound)
+        return NO;
+    changed = range;
+    
+    /* Replace the folds which overlap the new one */
+    f = _folds.bytes;
+    n = MGSFoldCount(_folds);
+    for (i = n; i > 0; i--) {
+        if (NSIntersectionRange(f[i-1], range).length > 0) {
+            changed = NSUnionRange(changed, f[i-1]);
+            [_folds replaceBytesInRange:NSMakeRange((i-1) * sizeof(NSRange), sizeof(NSRange)) withBytes:NULL length:0];
+            f = _folds.bytes;
+        }
+    }
+    n = MGSFoldCount(_folds);
+    for (i = 0; i < n && f[i].location < range.location; i++);
+    [_folds replaceBytesInRange:NSMakeRange(i * sizeof(NSRange), 0) withBytes:&range length:sizeof(NSRange)];
+    
+    /* Do not leave the selection inside the folded text */
+    sel = tv.selectedRange;
+    if (NSMaxRange(sel) > range.location && sel.location < NSMaxRange(range))
+        tv.selectedRange = NSMakeRange(range.location, 0);
+    
+    [self foldsDidChangeInRange:changed];
+    return YES;
+}
+
+
+- (BOOL)unfoldLine:(NSUInteger)line
+{
+    const MGSFoldLines *l;
+    const NSRange *f;
+    NSRange changed = MGSNoFold;
+    NSUInteger i;
+    
+    [self validateFoldLines];
+    l = _foldLines.bytes;
+    f = _folds.bytes;
+    
+    /* Prefer the folds which begin at the line to the one hiding it */
+    for (i = [self numberOfFoldsBeginningBeforeLine:line]; i < MGSFoldCount(_folds) && l[i].headerLine == line; i++)
+        changed = changed.location == NSNotFound ? f[i] : NSUnionRange(changed, f[i]);
+    if (changed.location == NSNotFound) {
+        i = [self numberOfFoldsBeginningBeforeLine:line];
+        if (i == 0 || line > l[i-1].headerLine + l[i-1].hiddenLines)
+            return NO;
+        changed = f[i-1];
+    }
+    
+    [self removeFoldsInRange:changed];
+    [self foldsDidChangeInRange:changed];
+    return YES;
+}
+
+
+- (void)unfoldAll
+{
+    NSUInteger n = MGSFoldCount(_folds);
+    const NSRange *f = _folds.bytes;
+    NSRange changed;
+    
+    if (n == 0)
+        return;
+    changed = NSUnionRange(f[0], f[n-1]);
+    _folds.length = 0;
+    [self foldsDidChangeInRange:changed];
+}
+
+
+- (BOOL)isLineFolded:(NSUInteger)line
+{
+    const MGSFoldLines *l;
+    NSUInteger i;
+    
+    [self validateFoldLines];
+    l = _foldLines.bytes;
+    i = [self numberOfFoldsBeginningBeforeLine:line];
+    return i < MGSFoldCount(_folds) && l[i].headerLine == line;
+}
+
+
+/* Removes the folds contained in a range. */
+- (void)removeFoldsInRange:(NSRange)range
+{
+    const NSRange *f = _folds.bytes;
+    NSUInteger i;
+    
+    for (i = MGSFoldCount(_folds); i > 0; i--) {
+        if (NSEqualRanges(NSIntersectionRange(f[i-1], range), f[i-1])) {
+            [_folds replaceBytesInRange:NSMakeRange((i-1) * sizeof(NSRange), sizeof(NSRange)) withBytes:NULL length:0];
+            f = _folds.bytes;
+        }
+    }
+}
+
+
+/* Makes the layout manager generate the glyphs of a range again, and
+ * redisplays the text view and the gutter. */
+- (void)foldsDidChangeInRange:(NSRange)range
+{
+    MGSTextView *tv = self.textView;
+    NSLayoutManager *lm = tv.layoutManager;
+    NSString *string = lm.textStorage.string;
+    
+    _foldLinesAreValid = NO;
+    if (NSMaxRange(range) > string.length)
+        range = NSMakeRange(MIN(range.location, string.length), string.length - MIN(range.location, string.length));
+    range = [string lineRangeForRange:range];
+    
+    [lm invalidateGlyphsForCharacterRange:range changeInLength:0 actualCharacterRange:NULL];
+    [lm invalidateLayoutForCharacterRange:range actualCharacterRange:NULL];
+    [tv setNeedsDisplay:YES];
+    [tv.enclosingScrollView.verticalRulerView setNeedsDisplay:YES];
+}
+
+
+#pragma mark - Inspecting the Folds
+
+
+- (NSUInteger)numberOfFolds
+{
+    return MGSFoldCount(_folds);
+}
+
+
+/* Returns the number of folds which end before a character index. */
+- (NSUInteger)numberOfFoldsEndingBeforeCharacterIndex:(NSUInteger)i
+{
+    const NSRange *f = _folds.bytes;
+    NSUInteger lo = 0, hi = MGSFoldCount(_folds), mid;
+    
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (NSMaxRange(f[mid]) <= i)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+- (NSRange)foldedRangeContainingCharacterIndex:(NSUInteger)i
+{
+    const NSRange *f = _folds.bytes;
+    NSUInteger k = [self numberOfFoldsEndingBeforeCharacterIndex:i];
+    
+    if (k < MGSFoldCount(_folds) && f[k].location <= i)
+        return f[k];
+    return MGSNoFold;
+}
+
+
+- (void)enumerateFoldsInRange:(NSRange)range usingBlock:(void (^)(NSRange fold, BOOL *stop))block
+{
+    const NSRange *f = _folds.bytes;
+    NSUInteger i, n = MGSFoldCount(_folds);
+    BOOL stop = NO;
+    
+    for (i = [self numberOfFoldsEndingBeforeCharacterIndex:range.location]; i < n && !stop; i++) {
+        if (f[i].location >= NSMaxRange(range))
+            break;
+        block(f[i], &stop);
+    }
+}
+
+
+- (NSIndexSet *)unfoldedCharacterIndexesInRange:(NSRange)range
+{
+    NSMutableIndexSet *res = [NSMutableIndexSet indexSetWithIndexesInRange:range];
+    
+    [self enumerateFoldsInRange:range usingBlock:^(NSRange fold, BOOL *stop) {
+        [res removeIndexesInRange:fold];
+    }];
+    return res;
+}
+
+
+#pragma mark - Mapping Lines to Visible Rows
+
+
+- (void)validateFoldLines
+{
+    NSTextStorage *ts = self.textView.textStorage;
+    const NSRange *f = _folds.bytes;
+    NSUInteger i, n = MGSFoldCount(_folds), hidden = 0;
+    MGSFoldLines *l;
+    
+    if (_foldLinesAreValid)
+        return;
+    
+    _foldLines.length = n * sizeof(MGSFoldLines);
+    l = _foldLines.mutableBytes;
+    for (i = 0; i < n; i++) {
+        l[i].headerLine = [ts mgs_rowOfCharacter:f[i].location];
+        l[i].hiddenLines = [ts mgs_rowOfCharacter:NSMaxRange(f[i]) - 1] - l[i].headerLine;
+        l[i].hiddenBefore = hidden;
+        hidden += l[i].hiddenLines;
+    }
+    _foldLinesAreValid = YES;
+}
+
+
+/* Returns the number of folds which begin before a line. */
+- (NSUInteger)numberOfFoldsBeginningBeforeLine:(NSUInteger)line
+{
+    const MGSFoldLines *l = _foldLines.bytes;
+    NSUInteger lo = 0, hi = MGSFoldCount(_folds), mid;
+    
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (l[mid].headerLine < line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+- (NSUInteger)visibleRowOfLine:(NSUInteger)line
+{
+    const MGSFoldLines *l;
+    NSUInteger k;
+    
+    [self validateFoldLines];
+    l = _foldLines.bytes;
+    k = [self numberOfFoldsBeginningBeforeLine:line];
+    if (k == 0)
+        return line;
+    if (line <= l[k-1].headerLine + l[k-1].hiddenLines)
+        return l[k-1].headerLine - l[k-1].hiddenBefore;
+    return line - l[k-1].hiddenBefore - l[k-1].hiddenLines;
+}
+
+
+- (NSUInteger)lineOfVisibleRow:(NSUInteger)row
+{
+    const MGSFoldLines *l;
+    NSUInteger lo = 0, hi = MGSFoldCount(_folds), mid;
+    
+    [self validateFoldLines];
+    l = _foldLines.bytes;
+    
+    /* Find the folds beginning in a row before this one */
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (l[mid].headerLine - l[mid].hiddenBefore < row)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return row;
+    return row + l[lo-1].hiddenBefore + l[lo-1].hiddenLines;
+}
+
+
+- (NSUInteger)nextVisibleLineAfterLine:(NSUInteger)line
+{
+    if (MGSFoldCount(_folds) == 0)
+        return line + 1;
+    return [self lineOfVisibleRow:[self visibleRowOfLine:line] + 1];
+}
+
+
+- (BOOL)isLineHidden:(NSUInteger)line
+{
+    if (MGSFoldCount(_folds) == 0)
+        return NO;
+    return [self lineOfVisibleRow:[self visibleRowOfLine:line]] != line;
+}
+
+
+#pragma mark - Tracking Edits
+
+
+- (void)textStorageDidProcessEditing:(NSNotification *)notification
+{
+    NSTextStorage *ts = notification.object;
+    NSRange edited, old, fold, *f;
+    NSInteger delta, start, end;
+    NSUInteger i;
+    
+    if (ts != self.textView.textStorage || !(ts.editedMask & NSTextStorageEditedCharacters))
+        return;
+    
+    _foldLinesAreValid = NO;
+    edited = ts.editedRange;
+    delta = ts.changeInLength;
+    old = NSMakeRange(edited.location, edited.length - delta);
+    
+    /* Move the folds after the edit, and remove the ones it touches */
+    f = _folds.mutableBytes;
+    for (i = MGSFoldCount(_folds); i > 0; i--) {
+        fold = f[i-1];
+        if (old.location >= NSMaxRange(fold))
+            break;
+        if (NSMaxRange(old) <= fold.location) {
+            f[i-1].location += delta;
+            continue;
+        }
+        
+        start = MIN(fold.location, edited.location);
+        end = MAX((NSInteger)NSMaxRange(fold) + delta, (NSInteger)NSMaxRange(edited));
+        fold = NSMakeRange(start, end - start);
+        _unfoldedRange = _unfoldedRange.location == NSNotFound ? fold : NSUnionRange(_unfoldedRange, fold);
+        [_folds replaceBytesInRange:NSMakeRange((i-1) * sizeof(NSRange), sizeof(NSRange)) withBytes:NULL length:0];
+        f = _folds.mutableBytes;
+    }
+}
+
+
+- (void)layoutManagerDidProcessEditing
+{
+    NSRange unfolded = _unfoldedRange;
+    
+    if (unfolded.location == NSNotFound)
+        return;
+    _unfoldedRange = MGSNoFold;
+    [self foldsDidChangeInRange:unfolded];
+}
+
+
+@end
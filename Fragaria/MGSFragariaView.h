@@ -8,12 +8,18 @@
 
 #import <Cocoa/Cocoa.h>
 #import "FragariaMacros.h"
+#import "MGSSyntaxError.h"
+#import "MGSSemanticTokensEdit.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
 
 @class MGSTextView;
 @class MGSColourScheme;
+@class MGSHighlightCache;
+@class MGSSearchEngine;
+@class MGSChangeTracker;
+@class MGSSymbolIndex;
 
 @protocol MGSAutoCompleteDelegate;
 @protocol MGSBreakpointDelegate;
@@ -67,6 +73,62 @@ IB_DESIGNABLE
  *  @warning Do not use textView.textStorage instead! */
 - (NSTextStorage *)textStorage;
 
+/** Displays the contents of a file without loading it in memory, and makes
+ *  the text editor read-only.
+ *  @param url The URL of a file encoded in UTF-8.
+ *  @param err Upon return, if the file could not be opened, contains an
+ *         NSError object that describes the problem.
+ *  @returns YES if the file was opened successfully.
+ *  @discussion The text storage of the text editor is replaced by a
+ *         MGSMappedFileTextStorage, which is suitable for viewing files too
+ *         large to be edited comfortably. To resume editing, set the
+ *         editable property of the text view back to YES and use
+ *         replaceTextStorage: to replace the text storage again. */
+- (BOOL)openFileForViewingAtURL:(NSURL *)url error:(out NSError **)err;
+
+
+/** Starts replacing the contents of the text editor progressively.
+ *  @param length The expected length of the contents, in characters, or
+ *         -1 if it is not known.
+ *  @returns A progress object which tracks the amount of characters
+ *         appended so far.
+ *  @discussion The text editor is cleared and becomes read-only until the
+ *         first chunk of the contents is appended with
+ *         appendStringToProgressiveLoad:. Each chunk is displayed and
+ *         coloured as soon as it is appended; the line numbers and the
+ *         layout of the rest of the text are computed incrementally.
+ *         The user can edit the text while the loading is in progress.
+ *         Setting the string property or replacing the text storage
+ *         cancels the loading. */
+- (NSProgress *)beginProgressiveLoadWithExpectedLength:(int64_t)length;
+
+/** Appends a chunk of text at the end of the text editor during a
+ *  progressive load.
+ *  @param chunk The text to append. */
+- (void)appendStringToProgressiveLoad:(NSString *)chunk;
+
+/** Ends a progressive load started by beginProgressiveLoadWithExpectedLength:. */
+- (void)endProgressiveLoad;
+
+/** Replaces the contents of the text editor with the contents of a
+ *  stream, progressively.
+ *  @param stream An unopened stream of UTF-8 text. It is opened and read
+ *         on a background thread, thus it must not be scheduled in a run
+ *         loop. Invalid UTF-8 sequences are replaced by U+FFFD.
+ *  @param length The expected length of the stream in bytes, or -1 if it
+ *         is not known.
+ *  @param handler A block called on the main thread when the loading ends.
+ *         Its error argument is nil if the whole stream was read.
+ *  @returns A progress object which tracks the amount of bytes read. It
+ *         can be used to cancel the loading.
+ *  @discussion The first screen of text is displayed as soon as it is
+ *         read. See beginProgressiveLoadWithExpectedLength: for more
+ *         information. */
+- (NSProgress *)loadStringFromStream:(NSInputStream *)stream expectedLength:(int64_t)length completionHandler:(nullable void (^)(NSError * _Nullable error))handler;
+
+/** Indicates if a progressive load is in progress. */
+@property (nonatomic, readonly, getter=isLoading) BOOL loading;
+
 
 #pragma mark - Getting Line and Column Information
 /// @name Getting Line and Column Information
@@ -153,6 +215,118 @@ IB_DESIGNABLE
 @property BOOL coloursOnlyUntilEndOfLine;
 
 
+#pragma mark - Caching Syntax Highlighting
+/// @name Caching Syntax Highlighting
+
+
+/** The cache where the syntax highlighting of the text can be saved, or nil
+ *  to disable highlight caching.
+ *  @discussion When this property is set, every time the string is replaced
+ *    (by setting the string property, at the end of a progressive load or by
+ *    opening a file for viewing) the colouring is restored from the cache if
+ *    the cache contains the same text parsed with the same syntax
+ *    definition. The colouring is saved automatically before the string is
+ *    replaced, when the window of this view is closed and when the
+ *    application terminates; call saveColouringToHighlightCache to save it at
+ *    other times, for example when the document is saved. The cache entries
+ *    are keyed by the text, the syntax definition and its contents, so that
+ *    editing a custom syntax definition does not restore stale colouring. */
+@property (nonatomic, strong, nullable) MGSHighlightCache *highlightCache;
+
+/** Saves the syntax highlighting of the text to the highlight cache.
+ *  @discussion Only the parts of the text which have already been coloured
+ *    are saved. */
+- (void)saveColouringToHighlightCache;
+
+/** Restores the syntax highlighting of the text from the highlight cache.
+ *  @returns YES if the cache contained the colouring of the current text. */
+- (BOOL)restoreColouringFromHighlightCache;
+
+
+#pragma mark - Showing Semantic Tokens
+/// @name Showing Semantic Tokens
+
+
+/** The syntax groups used for colouring the semantic tokens, indexed by
+ *  token type.
+ *  @discussion Semantic tokens are coloured using the attributes the colour
+ *    scheme specifies for these groups, on top of the syntax colouring.
+ *    Tokens whose group is not coloured by the colour scheme keep the
+ *    colours of the syntax colouring. */
+@property (nonatomic, copy) NSArray<NSString *> *semanticTokenTypes;
+
+/** The names of the semantic token modifiers, indexed by bit.
+ *  @discussion A token which has modifiers is coloured with the group of
+ *    its type followed by a dot and the name of the modifier corresponding
+ *    to the lowest bit set. For example a token of type "variable" with the
+ *    modifier "readonly" uses the "variable.readonly" group if the colour
+ *    scheme defines it, and the "variable" group otherwise. */
+@property (nonatomic, copy) NSArray<NSString *> *semanticTokenModifiers;
+
+/** Replaces the semantic tokens of the text.
+ *  @param data The tokens, delta-encoded as in the Language Server Protocol:
+ *    5 integers for each token, specifying the line (relative to the line of
+ *    the previous token), the start column (relative to the start column of
+ *    the previous token if they are on the same line), the length, the type
+ *    and the modifiers of the token. Columns and lengths are in UTF-16 code
+ *    units.
+ *  @param count The number of integers in data.
+ *  @discussion The tokens are moved when the text is edited, and the tokens
+ *    which overlap with an edit are removed. Only the parts of the text where
+ *    the tokens have changed are coloured again. */
+- (void)setSemanticTokens:(const uint32_t *)data count:(NSUInteger)count;
+
+/** Edits the semantic tokens set by the last call to
+ *  -setSemanticTokens:count:, as described by a semantic token delta.
+ *  @param edits The edits, all relative to the previous token data.
+ *  @param count The number of edits.
+ *  @returns NO if there are no previous tokens or the edits are out of
+ *    bounds. In this case the tokens are not modified, and the complete
+ *    tokens should be set again. */
+- (BOOL)applySemanticTokensEdits:(const MGSSemanticTokensEdit *)edits count:(NSUInteger)count;
+
+/** Removes all the semantic tokens. */
+- (void)removeAllSemanticTokens;
+
+
+#pragma mark - Searching
+/// @name Searching
+
+
+/** The search engine which finds the matches of a regular expression in the
+ *  text of this instance of Fragaria.
+ *  @discussion The text is searched in the background, and the matches are
+ *    kept up to date as the text is edited. Replacing the text storage ends
+ *    the current search. */
+@property (nonatomic, readonly) MGSSearchEngine *searchEngine;
+
+
+#pragma mark - Tracking Changes
+/// @name Tracking Changes
+
+
+/** The change tracker which compares the text of this instance of Fragaria
+ *  with a baseline, such as the last saved version of the text.
+ *  @discussion Once a baseline is set, the lines which were added, modified
+ *    or deleted with respect to it are marked in the gutter. */
+@property (nonatomic, readonly) MGSChangeTracker *changeTracker;
+
+
+#pragma mark - Indexing Symbols
+/// @name Indexing Symbols
+
+
+/** The index of the symbols declared in the text of this instance of
+ *  Fragaria, such as functions and classes.
+ *  @discussion The symbols are found with the symbol patterns of the
+ *    current syntax definition, while the text is parsed for colouring.
+ *    The text is indexed after this property is accessed for the first
+ *    time, and the index is kept up to date as the text is edited. Very
+ *    long texts, and files opened for viewing, are only indexed as they
+ *    are displayed. */
+@property (nonatomic, readonly) MGSSymbolIndex *symbolIndex;
+
+
 #pragma mark - Configuring Autocompletion
 /// @name Configuring Autocompletion
 
@@ -185,6 +359,15 @@ IB_DESIGNABLE
 @property (nonatomic, assign) BOOL highlightsCurrentLine;
 
 
+#pragma mark - Highlighting Occurrences of the Selected Word
+/// @name Highlighting Occurrences of the Selected Word
+
+
+/** Specifies whether all the occurrences of the selected word, or of the
+ *  word containing the insertion point, should be highlighted.*/
+@property (nonatomic, assign) BOOL highlightsOccurrencesOfSelectedWord;
+
+
 #pragma mark - Configuring the Gutter
 /// @name Configuring the Gutter
 
@@ -202,6 +385,10 @@ IB_DESIGNABLE
 /** Indicates whether or not the separator are displayed when the gutter is visible.*/
 @property (nonatomic, assign) BOOL showsGutterSeparator;
 
+/** Indicates whether or not the lines where a block of text can be folded
+ *  are marked in the gutter. Clicking a marker folds or unfolds the block.*/
+@property (nonatomic, assign) BOOL showsFoldingMarkers;
+
 /** Specifies the standard font for the line numbers in the gutter.*/
 @property (nonatomic, assign) IBInspectable NSFont *gutterFont;
 
@@ -217,6 +404,36 @@ IB_DESIGNABLE
  *   - providing a description of the syntax errors in popovers. */
 @property (nonatomic, assign, nullable) NSArray *syntaxErrors;
 
+/** Replaces the syntax errors with the ones described by a C array of
+ *  syntax error records.
+ *  @discussion The records are compared with the syntax errors shown at
+ *    the moment, and only the lines whose errors changed are updated. This
+ *    method is more efficient than setting the syntaxErrors property when
+ *    most of the errors do not change, as it happens when re-running a
+ *    linter after a small edit.
+ *  @param records A C array of syntax error records.
+ *  @param count The number of records in the array. */
+- (void)setSyntaxErrorRecords:(const MGSSyntaxErrorRecord *)records count:(NSUInteger)count;
+
+/** Starts replacing the syntax errors with records which will be passed
+ *  progressively to -addSyntaxErrorRecords:count:.
+ *  @discussion Use this method (together with -addSyntaxErrorRecords:count:
+ *    and -endSyntaxErrorRecordUpdate) when the syntax errors are produced
+ *    progressively, for example when reading the output of a linter. The
+ *    syntax errors of the lines which have not been reported yet are kept
+ *    until -endSyntaxErrorRecordUpdate is invoked. */
+- (void)beginSyntaxErrorRecordUpdate;
+
+/** Adds some syntax error records to the update started by
+ *  -beginSyntaxErrorRecordUpdate, and shows them immediately.
+ *  @param records A C array of syntax error records.
+ *  @param count The number of records in the array. */
+- (void)addSyntaxErrorRecords:(const MGSSyntaxErrorRecord *)records count:(NSUInteger)count;
+
+/** Ends the update started by -beginSyntaxErrorRecordUpdate, removing the
+ *  syntax errors of all the lines which did not receive any record. */
+- (void)endSyntaxErrorRecordUpdate;
+
 /** Indicates whether or not error warnings are displayed.*/
 @property (nonatomic, assign) BOOL showsSyntaxErrors;
 
@@ -28,6 +28,19 @@
 #import "MGSTextViewPrivate.h"
 #import "MGSTextView+MGSTextActions.h"
 #import "MGSAttributeOverlayTextStorage.h"
+#import "MGSMappedFileTextStorage.h"
+#import "MGSHighlightCache.h"
+#import "MGSSemanticTokenOverlay.h"
+#import "MGSSearchEngine.h"
+#import "MGSChangeTracker.h"
+#import "MGSSymbolIndex.h"
+
+
+/* Length in bytes of the first chunk read by a progressive load; it is small
+ * so that the first screen appears quickly */
+#define MGSProgressiveLoadFirstChunkLength  (65536)
+/* Length in bytes of the other chunks read by a progressive load */
+#define MGSProgressiveLoadChunkLength       (1048576)
 
 
 #pragma mark - IMPLEMENTATION
@@ -37,6 +50,12 @@
 {
     MGSMutableColourScheme *_colourScheme;
     NSTextStorage *_backingTextStorage;
+    NSProgress *_loadProgress;
+    BOOL _loadHasFirstChunk;
+    BOOL _editableBeforeLoad;
+    MGSSearchEngine *_searchEngine;
+    MGSChangeTracker *_changeTracker;
+    MGSSymbolIndex *_symbolIndex;
 }
 
 /* Synthesis required in order to implement protocol declarations. */
@@ -108,7 +127,11 @@
  */
 - (void)setString:(NSString *)string
 {
+    [self saveColouringOfReplacedText];
+    [self cancelProgressiveLoad];
     self.textView.string = string ?: @"";
+    if (self.highlightCache)
+        [self restoreColouringFromHighlightCache];
     [self mgs_propagateValue:string forBinding:NSStringFromSelector(@selector(string))];
 }
 
@@ -133,6 +156,366 @@
 }
 
 
+- (BOOL)openFileForViewingAtURL:(NSURL *)url error:(out NSError **)err
+{
+    NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
+    MGSMappedFileTextStorage *ts;
+    
+    ts = [[MGSMappedFileTextStorage alloc] initWithContentsOfURL:url error:err];
+    if (!ts)
+        return NO;
+    
+    /* Ending a pending load would restore the editability it saved */
+    [self cancelProgressiveLoad];
+    [self.textView setEditable:NO];
+    [nc removeObserver:self name:MGSMappedFileTextStorageDidFinishIndexingNotification object:nil];
+    [self replaceTextStorage:ts];
+    [nc addObserver:self selector:@selector(mappedFileTextStorageDidFinishIndexing:) name:MGSMappedFileTextStorageDidFinishIndexingNotification object:ts];
+    if (self.highlightCache)
+        [self restoreColouringFromHighlightCache];
+    return YES;
+}
+
+
+- (void)mappedFileTextStorageDidFinishIndexing:(NSNotification *)notification
+{
+    /* The line count is exact now; the gutter width may have to change */
+    [self.gutterView setNeedsDisplay:YES];
+}
+
+
+#pragma mark - Progressive Loading
+
+
+- (NSProgress *)beginProgressiveLoadWithExpectedLength:(int64_t)length
+{
+    [self saveColouringOfReplacedText];
+    [self cancelProgressiveLoad];
+    self.textView.string = @"";
+    
+    _loadProgress = [[NSProgress alloc] initWithParent:nil userInfo:nil];
+    _loadProgress.totalUnitCount = length;
+    _loadProgress.cancellable = YES;
+    _loadHasFirstChunk = NO;
+    _editableBeforeLoad = self.textView.isEditable;
+    [self.textView setEditable:NO];
+    return _loadProgress;
+}
+
+
+- (void)appendStringToProgressiveLoad:(NSString *)chunk
+{
+    [self appendLoadedString:chunk];
+    _loadProgress.completedUnitCount += chunk.length;
+}
+
+
+/* Appends text to the backing text storage. Only the appended range is
+ * invalidated in the line cache and in the syntax colouring, and the
+ * layout manager lays it out lazily, thus the cost of each chunk does not
+ * depend on the amount of text already loaded. */
+- (void)appendLoadedString:(NSString *)chunk
+{
+    NSAttributedString *as;
+    
+    if (!_loadProgress)
+        [NSException raise:NSInternalInconsistencyException format:@"No progressive load in progress"];
+    
+    as = [[NSAttributedString alloc] initWithString:chunk attributes:self.textView.typingAttributes];
+    [_backingTextStorage replaceCharactersInRange:NSMakeRange(_backingTextStorage.length, 0) withAttributedString:as];
+    
+    if (!_loadHasFirstChunk) {
+        _loadHasFirstChunk = YES;
+        [self.textView setEditable:_editableBeforeLoad];
+    }
+}
+
+
+- (void)endProgressiveLoad
+{
+    if (!_loadProgress)
+        return;
+    if (!_loadProgress.isCancelled && _loadProgress.totalUnitCount >= 0)
+        _loadProgress.completedUnitCount = _loadProgress.totalUnitCount;
+    if (!_loadHasFirstChunk)
+        [self.textView setEditable:_editableBeforeLoad];
+    if (!_loadProgress.isCancelled && self.highlightCache)
+        [self restoreColouringFromHighlightCache];
+    _loadProgress = nil;
+}
+
+
+- (void)cancelProgressiveLoad
+{
+    [_loadProgress cancel];
+    [self endProgressiveLoad];
+}
+
+
+- (BOOL)isLoading
+{
+    return _loadProgress != nil;
+}
+
+
+- (NSProgress *)loadStringFromStream:(NSInputStream *)stream expectedLength:(int64_t)length completionHandler:(void (^)(NSError *))handler
+{
+    MGSFragariaView * __weak weakSelf = self;
+    NSProgress *progress;
+    
+    progress = [self beginProgressiveLoadWithExpectedLength:length];
+    
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        uint8_t *buf = malloc(MGSProgressiveLoadChunkLength + 4);
+        NSUInteger maxRead = MGSProgressiveLoadFirstChunkLength;
+        NSUInteger carry = 0, avail, keep;
+        NSInteger n;
+        NSString *str;
+        NSError *err = nil;
+        
+        [stream open];
+        while (!progress.isCancelled) {
+            n = [stream read:buf + carry maxLength:maxRead];
+            if (n < 0)
+                err = stream.streamError;
+            if (n <= 0)
+                break;
+            
+            /* Keep a trailing incomplete UTF-8 sequence for the next chunk */
+            avail = carry + n;
+            keep = MGSIncompleteUTF8SequenceLength(buf, avail);
+            str = [NSString mgs_stringWithUTF8Bytes:buf length:avail - keep];
+            memmove(buf, buf + avail - keep, keep);
+            carry = keep;
+            
+            dispatch_async(dispatch_get_main_queue(), ^{
+                MGSFragariaView *fv = weakSelf;
+                if (!fv || fv->_loadProgress != progress)
+                    return;
+                [fv appendLoadedString:str];
+                progress.completedUnitCount += n;
+            });
+            maxRead = MGSProgressiveLoadChunkLength;
+        }
+        [stream close];
+        
+        if (!err && !progress.isCancelled && carry > 0) {
+            str = [NSString mgs_stringWithUTF8Bytes:buf length:carry];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                MGSFragariaView *fv = weakSelf;
+                if (fv && fv->_loadProgress == progress)
+                    [fv appendLoadedString:str];
+            });
+        }
+        free(buf);
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            MGSFragariaView *fv = weakSelf;
+            NSError *res = err;
+            
+            if (fv && fv->_loadProgress == progress)
+                [fv endProgressiveLoad];
+            if (!res && progress.isCancelled)
+                res = [NSError errorWithDomain:NSCocoaErrorDomain code:NSUserCancelledError userInfo:nil];
+            if (handler)
+                handler(res);
+        });
+    });
+    
+    return progress;
+}
+
+
+#pragma mark - Caching Syntax Highlighting
+
+
+/* Returns the string which identifies the parser configuration in the keys
+ * of the highlight cache, or nil if the colouring cannot be cached. */
+- (NSString *)highlightCacheDescriptor
+{
+    NSString *version = self.syntaxColouring.parser.tokenCacheVersion;
+    
+    if (!self.highlightCache || !version || !self.isSyntaxColoured)
+        return nil;
+    return [NSString stringWithFormat:@"%@\n%@\n%d %d", self.syntaxDefinitionName, version,
+      (int)self.coloursMultiLineStrings, (int)self.coloursOnlyUntilEndOfLine];
+}
+
+
+- (void)saveColouringToHighlightCache
+{
+    NSString *descriptor;
+    
+    if (self.syntaxColouring.inspectedCharacterIndexes.count == 0)
+        return;
+    if (!(descriptor = [self highlightCacheDescriptor]))
+        return;
+    /* The text is hashed in the background, as this is called on the main
+     * thread when the text is replaced or the window is closed. Copying the
+     * string is much cheaper than hashing it, and the string of a mapped
+     * file is immutable, thus it is not copied at all. */
+    [self.highlightCache setData:[self.syntaxColouring tokenArchive] forString:[self.textView.textStorage.string copy] descriptor:descriptor];
+}
+
+
+- (BOOL)restoreColouringFromHighlightCache
+{
+    NSString *descriptor, *key;
+    NSData *data;
+    
+    if (!(descriptor = [self highlightCacheDescriptor]))
+        return NO;
+    key = [self.highlightCache keyForString:self.textView.textStorage.string descriptor:descriptor];
+    if (!(data = [self.highlightCache dataForKey:key]))
+        return NO;
+    if (![self.syntaxColouring restoreTokenArchive:data])
+        return NO;
+    [self.textView setNeedsDisplay:YES];
+    return YES;
+}
+
+
+/* Saves the colouring of the text which is about to be replaced, unless the
+ * text is still being loaded. */
+- (void)saveColouringOfReplacedText
+{
+    if (self.highlightCache && !self.isLoading)
+        [self saveColouringToHighlightCache];
+}
+
+
+- (void)viewWillMoveToWindow:(NSWindow *)newWindow
+{
+    NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
+    
+    [super viewWillMoveToWindow:newWindow];
+    if (self.window)
+        [nc removeObserver:self name:NSWindowWillCloseNotification object:self.window];
+    if (newWindow)
+        [nc addObserver:self selector:@selector(windowWillClose:) name:NSWindowWillCloseNotification object:newWindow];
+}
+
+
+- (void)windowWillClose:(NSNotification *)notification
+{
+    if (self.highlightCache)
+        [self saveColouringToHighlightCache];
+}
+
+
+- (void)applicationWillTerminate:(NSNotification *)notification
+{
+    if (self.highlightCache)
+        [self saveColouringToHighlightCache];
+}
+
+
+#pragma mark - Showing Semantic Tokens
+
+
+- (void)setSemanticTokenTypes:(NSArray<NSString *> *)semanticTokenTypes
+{
+    MGSSemanticTokenOverlay *overlay = self.syntaxColouring.semanticTokens;
+    NSIndexSet *changed;
+    
+    changed = [overlay setTokenTypes:semanticTokenTypes modifiers:overlay.tokenModifiers];
+    [self invalidateColouringOfSemanticTokenRanges:changed];
+}
+
+
+- (NSArray<NSString *> *)semanticTokenTypes
+{
+    return self.syntaxColouring.semanticTokens.tokenTypes;
+}
+
+
+- (void)setSemanticTokenModifiers:(NSArray<NSString *> *)semanticTokenModifiers
+{
+    MGSSemanticTokenOverlay *overlay = self.syntaxColouring.semanticTokens;
+    NSIndexSet *changed;
+    
+    changed = [overlay setTokenTypes:overlay.tokenTypes modifiers:semanticTokenModifiers];
+    [self invalidateColouringOfSemanticTokenRanges:changed];
+}
+
+
+- (NSArray<NSString *> *)semanticTokenModifiers
+{
+    return self.syntaxColouring.semanticTokens.tokenModifiers;
+}
+
+
+- (void)setSemanticTokens:(const uint32_t *)data count:(NSUInteger)count
+{
+    NSIndexSet *changed;
+    
+    changed = [self.syntaxColouring.semanticTokens setTokenData:data count:count textStorage:self.textView.textStorage];
+    [self invalidateColouringOfSemanticTokenRanges:changed];
+}
+
+
+- (BOOL)applySemanticTokensEdits:(const MGSSemanticTokensEdit *)edits count:(NSUInteger)count
+{
+    NSIndexSet *changed;
+    
+    changed = [self.syntaxColouring.semanticTokens applyEdits:edits count:count textStorage:self.textView.textStorage];
+    if (!changed)
+        return NO;
+    [self invalidateColouringOfSemanticTokenRanges:changed];
+    return YES;
+}
+
+
+- (void)removeAllSemanticTokens
+{
+    [self invalidateColouringOfSemanticTokenRanges:[self.syntaxColouring.semanticTokens removeAllTokens]];
+}
+
+
+- (void)invalidateColouringOfSemanticTokenRanges:(NSIndexSet *)ranges
+{
+    if (ranges.count == 0)
+        return;
+    [self.syntaxColouring invalidateColouringOfSemanticTokenRanges:ranges];
+    [self.textView setNeedsDisplay:YES];
+}
+
+
+#pragma mark - Searching
+
+
+- (MGSSearchEngine *)searchEngine
+{
+    if (!_searchEngine)
+        _searchEngine = [[MGSSearchEngine alloc] initWithTextView:self.textView];
+    return _searchEngine;
+}
+
+
+#pragma mark - Tracking Changes
+
+
+- (MGSChangeTracker *)changeTracker
+{
+    if (!_changeTracker) {
+        _changeTracker = [[MGSChangeTracker alloc] initWithTextView:self.textView];
+        self.gutterView.changeTracker = _changeTracker;
+    }
+    return _changeTracker;
+}
+
+
+#pragma mark - Indexing Symbols
+
+
+- (MGSSymbolIndex *)symbolIndex
+{
+    if (!_symbolIndex)
+        _symbolIndex = [[MGSSymbolIndex alloc] initWithTextView:self.textView];
+    return _symbolIndex;
+}
+
+
 #pragma mark - Creating Split Panels
 
 
@@ -143,6 +526,11 @@
 {
     NSDictionary *attr;
     
+    [self saveColouringOfReplacedText];
+    [self cancelProgressiveLoad];
+    [self removeAllSemanticTokens];
+    [_searchEngine endSearch];
+    [self.textView unfoldAllLines];
     [self.gutterView layoutManagerWillChangeTextStorage];
     [self.syntaxErrorController layoutManagerWillChangeTextStorage];
     [self.textView.syntaxColouring layoutManagerWillChangeTextStorage];
@@ -157,6 +545,7 @@
     [self.gutterView layoutManagerDidChangeTextStorage];
     [self.syntaxErrorController layoutManagerDidChangeTextStorage];
     [self.textView.syntaxColouring layoutManagerDidChangeTextStorage];
+    [_changeTracker updateAllChanges];
 }
 
 
@@ -355,6 +744,24 @@
 }
 
 
+#pragma mark - Highlighting Occurrences of the Selected Word
+
+
+/*
+ * @property highlightsOccurrencesOfSelectedWord
+ */
+- (void)setHighlightsOccurrencesOfSelectedWord:(BOOL)highlightsOccurrencesOfSelectedWord
+{
+    self.textView.highlightsOccurrencesOfSelectedWord = highlightsOccurrencesOfSelectedWord;
+    [self mgs_propagateValue:@(highlightsOccurrencesOfSelectedWord) forBinding:NSStringFromSelector(@selector(highlightsOccurrencesOfSelectedWord))];
+}
+
+- (BOOL)highlightsOccurrencesOfSelectedWord
+{
+    return self.textView.highlightsOccurrencesOfSelectedWord;
+}
+
+
 #pragma mark - Configuring the Gutter
 
 
@@ -437,6 +844,21 @@
 }
 
 
+/*
+ * @property showsFoldingMarkers
+ */
+- (void)setShowsFoldingMarkers:(BOOL)showsFoldingMarkers
+{
+    self.gutterView.showsFoldingMarkers = showsFoldingMarkers;
+    [self mgs_propagateValue:@(showsFoldingMarkers) forBinding:NSStringFromSelector(@selector(showsFoldingMarkers))];
+}
+
+- (BOOL)showsFoldingMarkers
+{
+    return self.gutterView.showsFoldingMarkers;
+}
+
+
 /*
  * @property gutterFont
  */
@@ -469,6 +891,30 @@
 }
 
 
+- (void)setSyntaxErrorRecords:(const MGSSyntaxErrorRecord *)records count:(NSUInteger)count
+{
+	[self.syntaxErrorController setSyntaxErrorRecords:records count:count];
+}
+
+
+- (void)beginSyntaxErrorRecordUpdate
+{
+	[self.syntaxErrorController beginSyntaxErrorRecordUpdate];
+}
+
+
+- (void)addSyntaxErrorRecords:(const MGSSyntaxErrorRecord *)records count:(NSUInteger)count
+{
+	[self.syntaxErrorController addSyntaxErrorRecords:records count:count];
+}
+
+
+- (void)endSyntaxErrorRecordUpdate
+{
+	[self.syntaxErrorController endSyntaxErrorRecordUpdate];
+}
+
+
 /*
  * @property showsSyntaxErrors
  */
@@ -936,6 +1382,7 @@
     self.colourScheme = [[MGSColourScheme alloc] init];
     
     [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(textDidChange:) name:NSTextDidChangeNotification object:self.textView];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(applicationWillTerminate:) name:NSApplicationWillTerminateNotification object:nil];
 }
 
 - (void)dealloc
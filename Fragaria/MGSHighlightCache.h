@@ -0,0 +1,99 @@
+//
+//  MGSHighlightCache.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/** A size-bounded on-disk cache of syntax highlighting results.
+ *
+ *  When a MGSFragariaView has a highlight cache, the syntax colouring of its
+ *  text can be saved to the cache, and it is restored from the cache instead
+ *  of parsing the text again when the same text is loaded later with the
+ *  same syntax definition.
+ *
+ *  Each entry of the cache is stored in a separate file in the cache
+ *  directory. Its key is formed by a hash of the text and by a hash of the
+ *  parser configuration. When the total size of the entries exceeds the
+ *  maximum size of the cache, the entries which were used least recently are
+ *  removed.
+ *
+ *  A highlight cache can be shared between multiple instances of
+ *  MGSFragariaView. Its methods can be called from any thread. */
+@interface MGSHighlightCache : NSObject
+
+
+/** Initializes a highlight cache which stores its entries in a directory.
+ *  @param url The URL of the directory. It is created if it does not exist.
+ *  @param size The maximum size of the cache, in bytes. */
+- (instancetype)initWithDirectoryURL:(NSURL *)url maximumSize:(unsigned long long)size;
+
+
+/** The directory containing the entries of the cache. */
+@property (nonatomic, readonly) NSURL *directoryURL;
+
+/** The maximum size of the cache, in bytes. */
+@property (atomic) unsigned long long maximumSize;
+
+
+/** Computes a hash of the contents of a string.
+ *  @param string The string to hash.
+ *  @returns A string of hexadecimal digits.
+ *  @discussion The hash is computed in a single pass over the characters of
+ *    the string, without copying it. It is not a cryptographic hash, but it is
+ *    wide enough that accidental collisions are extremely unlikely. */
++ (NSString *)contentHashOfString:(NSString *)string;
+
+/** Computes a hash of the contents of a property list.
+ *  @param plist The property list to hash.
+ *  @returns A string of hexadecimal digits.
+ *  @discussion The entries of the dictionaries are hashed in the order of
+ *    their keys, thus two property lists with the same contents have the
+ *    same hash, regardless of how they were loaded. */
++ (NSString *)contentHashOfPropertyList:(id)plist;
+
+/** Returns the key of a cache entry.
+ *  @param string The text to which the entry refers.
+ *  @param descriptor A string which identifies the parser and its
+ *    configuration.
+ *  @returns A key suitable for -dataForKey: and -setData:forKey:. */
+- (NSString *)keyForString:(NSString *)string descriptor:(NSString *)descriptor;
+
+
+/** Returns the contents of an entry of the cache, and marks it as recently
+ *  used.
+ *  @param key The key of the entry.
+ *  @returns The data of the entry, or nil if it does not exist. */
+- (nullable NSData *)dataForKey:(NSString *)key;
+
+/** Adds or replaces an entry of the cache.
+ *  @param data The data of the entry.
+ *  @param key The key of the entry.
+ *  @discussion The data is written to disk in the background. Then, older
+ *    entries are removed as needed to make the cache fit in its maximum
+ *    size. */
+- (void)setData:(NSData *)data forKey:(NSString *)key;
+
+/** Adds or replaces the entry of the cache which refers to a text.
+ *  @param data The data of the entry.
+ *  @param string The text to which the entry refers. It must not be
+ *    mutated afterwards; pass a copy of a mutable string.
+ *  @param descriptor A string which identifies the parser and its
+ *    configuration.
+ *  @discussion Unlike -setData:forKey:, the key of the entry is computed in
+ *    the background, thus hashing a long text does not block the caller. */
+- (void)setData:(NSData *)data forString:(NSString *)string descriptor:(NSString *)descriptor;
+
+/** Removes all the entries from the cache. */
+- (void)removeAllData;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
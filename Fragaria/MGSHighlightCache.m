@@ -0,0 +1,248 @@
+//
+//  MGSHighlightCache.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSHighlightCache.h"
+#import "NSString+Fragaria.h"
+
+
+/* Extension of the files containing the entries of the cache */
+#define MGSHighlightCacheExtension  @"fragariatokens"
+
+
+/* A 128 bit hash made of two independent 64 bit lanes: FNV-1a, and a
+ * multiply-rotate hash. */
+typedef struct {
+    uint64_t a;
+    uint64_t b;
+} MGSContentHash;
+
+
+static void MGSContentHashInit(MGSContentHash *h)
+{
+    h->a = 0xcbf29ce484222325ULL;
+    h->b = 0x9e3779b97f4a7c15ULL;
+}
+
+
+static void MGSContentHashUpdate(MGSContentHash *h, const unichar *chars, NSUInteger n)
+{
+    uint64_t a = h->a, b = h->b;
+    NSUInteger i;
+    
+    for (i = 0; i < n; i++) {
+        a = (a ^ chars[i]) * 0x100000001b3ULL;
+        b = (b + chars[i]) * 0xff51afd7ed558ccdULL;
+        b = (b << 31) | (b >> 33);
+    }
+    h->a = a;
+    h->b = b;
+}
+
+
+static NSString *MGSHexStringOfString(NSString *string)
+{
+    __block MGSContentHash h;
+    
+    MGSContentHashInit(&h);
+    [string mgs_enumerateCharacterChunksInRange:NSMakeRange(0, string.length) usingBlock:^(const unichar *chars, NSRange chunkRange, BOOL *stop) {
+        MGSContentHashUpdate(&h, chars, chunkRange.length);
+    }];
+    return [NSString stringWithFormat:@"%016llx%016llx%llx", h.a, h.b, (unsigned long long)string.length];
+}
+
+
+static void MGSContentHashUpdateString(MGSContentHash *h, NSString *string)
+{
+    [string mgs_enumerateCharacterChunksInRange:NSMakeRange(0, string.length) usingBlock:^(const unichar *chars, NSRange chunkRange, BOOL *stop) {
+        MGSContentHashUpdate(h, chars, chunkRange.length);
+    }];
+}
+
+
+/* Hashes a property list in a canonical form. Each object is prefixed by
+ * its type and its length, and the entries of the dictionaries are hashed
+ * in the order of their keys, thus the hash only depends on the contents of
+ * the property list. */
+static void MGSContentHashUpdatePropertyList(MGSContentHash *h, id plist)
+{
+    NSArray *keys;
+    
+    if ([plist isKindOfClass:[NSString class]]) {
+        MGSContentHashUpdateString(h, [NSString stringWithFormat:@"s%lu:", (unsigned long)[plist length]]);
+        MGSContentHashUpdateString(h, plist);
+    } else if ([plist isKindOfClass:[NSNumber class]]) {
+        MGSContentHashUpdateString(h, [NSString stringWithFormat:@"n%s:%@;", [plist objCType], [plist stringValue]]);
+    } else if ([plist isKindOfClass:[NSDate class]]) {
+        MGSContentHashUpdateString(h, [NSString stringWithFormat:@"t%.17g;", [plist timeIntervalSinceReferenceDate]]);
+    } else if ([plist isKindOfClass:[NSData class]]) {
+        MGSContentHashUpdateString(h, [NSString stringWithFormat:@"d%lu:", (unsigned long)[plist length]]);
+        MGSContentHashUpdateString(h, [plist base64EncodedStringWithOptions:0]);
+    } else if ([plist isKindOfClass:[NSArray class]]) {
+        MGSContentHashUpdateString(h, [NSString stringWithFormat:@"a%lu:", (unsigned long)[plist count]]);
+        for (id item in plist)
+            MGSContentHashUpdatePropertyList(h, item);
+    } else if ([plist isKindOfClass:[NSDictionary class]]) {
+        MGSContentHashUpdateString(h, [NSString stringWithFormat:@"o%lu:", (unsigned long)[plist count]]);
+        keys = [[plist allKeys] sortedArrayUsingComparator:^NSComparisonResult(id k1, id k2) {
+            return [[k1 description] compare:[k2 description] options:NSLiteralSearch];
+        }];
+        for (id key in keys) {
+            MGSContentHashUpdatePropertyList(h, key);
+            MGSContentHashUpdatePropertyList(h, plist[key]);
+        }
+    } else {
+        MGSContentHashUpdateString(h, [NSString stringWithFormat:@"?%@;", plist]);
+    }
+}
+
+
+@implementation MGSHighlightCache
+{
+    dispatch_queue_t ioQueue;
+}
+
+
+- (instancetype)initWithDirectoryURL:(NSURL *)url maximumSize:(unsigned long long)size
+{
+    self = [super init];
+    
+    _directoryURL = url;
+    _maximumSize = size;
+    ioQueue = dispatch_queue_create("com.mugginsoft.Fragaria.MGSHighlightCache", DISPATCH_QUEUE_SERIAL);
+    [[NSFileManager defaultManager] createDirectoryAtURL:url withIntermediateDirectories:YES attributes:nil error:nil];
+    
+    return self;
+}
+
+
+#pragma mark - Keys
+
+
++ (NSString *)contentHashOfString:(NSString *)string
+{
+    return MGSHexStringOfString(string);
+}
+
+
++ (NSString *)contentHashOfPropertyList:(id)plist
+{
+    MGSContentHash h;
+    
+    MGSContentHashInit(&h);
+    MGSContentHashUpdatePropertyList(&h, plist);
+    return [NSString stringWithFormat:@"%016llx%016llx", h.a, h.b];
+}
+
+
+- (NSString *)keyForString:(NSString *)string descriptor:(NSString *)descriptor
+{
+    return [NSString stringWithFormat:@"%@-%@", MGSHexStringOfString(string), MGSHexStringOfString(descriptor)];
+}
+
+
+- (NSURL *)fileURLForKey:(NSString *)key
+{
+    return [[self.directoryURL URLByAppendingPathComponent:key] URLByAppendingPathExtension:MGSHighlightCacheExtension];
+}
+
+
+#pragma mark - Entries
+
+
+- (NSData *)dataForKey:(NSString *)key
+{
+    NSURL *url = [self fileURLForKey:key];
+    __block NSData *data;
+    
+    dispatch_sync(ioQueue, ^{
+        data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:nil];
+        if (data)
+            [url setResourceValue:[NSDate date] forKey:NSURLContentModificationDateKey error:nil];
+    });
+    return data;
+}
+
+
+- (void)setData:(NSData *)data forKey:(NSString *)key
+{
+    NSURL *url = [self fileURLForKey:key];
+    
+    dispatch_async(ioQueue, ^{
+        [data writeToURL:url atomically:YES];
+        [self evictEntries];
+    });
+}
+
+
+- (void)setData:(NSData *)data forString:(NSString *)string descriptor:(NSString *)descriptor
+{
+    dispatch_async(ioQueue, ^{
+        NSString *key = [self keyForString:string descriptor:descriptor];
+        
+        [data writeToURL:[self fileURLForKey:key] atomically:YES];
+        [self evictEntries];
+    });
+}
+
+
+- (void)removeAllData
+{
+    dispatch_async(ioQueue, ^{
+        for (NSURL *url in [self entryURLsWithKeys:@[]])
+            [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+    });
+}
+
+
+- (NSArray<NSURL *> *)entryURLsWithKeys:(NSArray<NSURLResourceKey> *)keys
+{
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSArray<NSURL *> *urls;
+    NSIndexSet *entries;
+    
+    urls = [fm contentsOfDirectoryAtURL:self.directoryURL includingPropertiesForKeys:keys options:NSDirectoryEnumerationSkipsHiddenFiles error:nil];
+    entries = [urls indexesOfObjectsPassingTest:^BOOL(NSURL *url, NSUInteger idx, BOOL *stop) {
+        return [url.pathExtension isEqual:MGSHighlightCacheExtension];
+    }];
+    return [urls objectsAtIndexes:entries];
+}
+
+
+/* Removes the least recently used entries until the cache fits in its
+ * maximum size. Must be called on ioQueue. */
+- (void)evictEntries
+{
+    NSArray<NSURLResourceKey> *keys = @[NSURLContentModificationDateKey, NSURLTotalFileAllocatedSizeKey];
+    NSMutableArray<NSURL *> *urls;
+    unsigned long long total = 0, max = self.maximumSize;
+    NSNumber *size;
+    
+    urls = [[self entryURLsWithKeys:keys] mutableCopy];
+    for (NSURL *url in urls) {
+        [url getResourceValue:&size forKey:NSURLTotalFileAllocatedSizeKey error:nil];
+        total += size.unsignedLongLongValue;
+    }
+    if (total <= max)
+        return;
+    
+    [urls sortUsingComparator:^NSComparisonResult(NSURL *u1, NSURL *u2) {
+        NSDate *d1, *d2;
+        [u1 getResourceValue:&d1 forKey:NSURLContentModificationDateKey error:nil];
+        [u2 getResourceValue:&d2 forKey:NSURLContentModificationDateKey error:nil];
+        return [d1 compare:d2];
+    }];
+    for (NSURL *url in urls) {
+        if (total <= max)
+            break;
+        [url getResourceValue:&size forKey:NSURLTotalFileAllocatedSizeKey error:nil];
+        if ([[NSFileManager defaultManager] removeItemAtURL:url error:nil])
+            total -= MIN(total, size.unsignedLongLongValue);
+    }
+}
+
+
+@end
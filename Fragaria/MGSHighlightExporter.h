@@ -0,0 +1,70 @@
+//
+//  MGSHighlightExporter.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class MGSAbstractSyntaxColouring;
+
+
+/** The formats supported by MGSHighlightExporter. */
+typedef NS_ENUM(NSUInteger, MGSHighlightExportFormat) {
+    /** A HTML fragment made of a single pre element, encoded in UTF-8. */
+    MGSHighlightExportFormatHTML,
+    /** A RTF document. */
+    MGSHighlightExportFormatRTF,
+    /** Text for terminals supporting 24-bit colour escape sequences,
+     *  encoded in UTF-8. */
+    MGSHighlightExportFormatANSI
+};
+
+
+/** Exports a range of syntax highlighted text.
+ *
+ *  The exporter walks the tokens of the text and the colour scheme of a
+ *  syntax colourer directly, and streams the output in chunks as it is
+ *  produced. Only the colouring of the range exported is updated, and no
+ *  copy of the text or of its attributes is made; the exporter does not
+ *  need a text view or a layout manager. */
+@interface MGSHighlightExporter : NSObject
+
+
+/** Returns an exporter of the text coloured by the specified syntax
+ *  colourer.
+ *  @param colouring The syntax colourer. Its colour scheme and font are
+ *    used for the output. */
+- (instancetype)initWithSyntaxColouring:(MGSAbstractSyntaxColouring *)colouring;
+
+/** The syntax colourer of the text to export. */
+@property (nonatomic, readonly) MGSAbstractSyntaxColouring *syntaxColouring;
+
+
+/** Exports a range of the text, passing the output to a block in chunks.
+ *  @param range The range of characters to export.
+ *  @param format The output format.
+ *  @param block The block to call with each chunk of output, in order. */
+- (void)exportRange:(NSRange)range format:(MGSHighlightExportFormat)format usingBlock:(void (^)(NSData *chunk))block;
+
+/** Exports a range of the text to a file handle.
+ *  @param range The range of characters to export.
+ *  @param format The output format.
+ *  @param fh The file handle where the output is written. */
+- (void)exportRange:(NSRange)range format:(MGSHighlightExportFormat)format toFileHandle:(NSFileHandle *)fh;
+
+/** Exports a range of the text to a buffer.
+ *  @param range The range of characters to export.
+ *  @param format The output format.
+ *  @returns The output. */
+- (NSData *)dataForRange:(NSRange)range format:(MGSHighlightExportFormat)format;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,400 @@
+//
+//  MGSHighlightExporter.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Cocoa/Cocoa.h>
+#import "MGSHighlightExporter.h"
+#import "MGSAbstractSyntaxColouring.h"
+#import "MGSColourScheme.h"
+#import "NSString+Fragaria.h"
+
+
+/* The size above which the output is passed to the block */
+#define MGSExportChunkLength    (65536)
+/* The number of characters converted at a time */
+#define MGSExportPieceLength    (16384)
+
+
+/* The markup which starts and ends a run of characters of a syntax group. */
+@interface MGSExportStyle : NSObject
+
+@property (nonatomic) NSData *prefix;
+@property (nonatomic) NSData *suffix;
+
+@end
+
+
+@implementation MGSExportStyle
+
+@end
+
+
+@implementation MGSHighlightExporter
+{
+    MGSHighlightExportFormat format;
+    NSMutableData *output;
+    void (^sink)(NSData *chunk);
+    NSMutableDictionary<id, MGSExportStyle *> *styles;
+    NSMutableArray<NSString *> *rtfColours;
+}
+
+
+- (instancetype)initWithSyntaxColouring:(MGSAbstractSyntaxColouring *)colouring
+{
+    self = [super init];
+    _syntaxColouring = colouring;
+    return self;
+}
+
+
+#pragma mark - Exporting
+
+
+- (void)exportRange:(NSRange)range format:(MGSHighlightExportFormat)fmt usingBlock:(void (^)(NSData *chunk))block
+{
+    MGSAbstractSyntaxColouring *sc = self.syntaxColouring;
+    NSString *string = sc.textStorage.string;
+    
+    if (NSMaxRange(range) > string.length)
+        [NSException raise:NSRangeException format:@"Range %@ out of bounds", NSStringFromRange(range)];
+    
+    /* The parser expands the range as much as needed to find the context
+     * of the tokens at its boundaries */
+    [sc recolourRange:range];
+    
+    format = fmt;
+    sink = block;
+    output = [NSMutableData dataWithCapacity:MGSExportChunkLength + 1024];
+    styles = [NSMutableDictionary dictionary];
+    
+    [self writeHeader];
+    [sc enumerateTokenGroupsInRange:range usingBlock:^(NSRange runRange, MGSSyntaxGroup group, BOOL *stop) {
+        MGSExportStyle *style = [self styleForGroup:group];
+        
+        [self->output appendData:style.prefix];
+        [self writeCharactersInRange:runRange ofString:string];
+        [self->output appendData:style.suffix];
+        if (self->output.length >= MGSExportChunkLength)
+            [self flush];
+    }];
+    [self writeFooter];
+    [self flush];
+    
+    sink = nil;
+    output = nil;
+    styles = nil;
+    rtfColours = nil;
+}
+
+
+- (void)exportRange:(NSRange)range format:(MGSHighlightExportFormat)fmt toFileHandle:(NSFileHandle *)fh
+{
+    [self exportRange:range format:fmt usingBlock:^(NSData *chunk) {
+        [fh writeData:chunk];
+    }];
+}
+
+
+- (NSData *)dataForRange:(NSRange)range format:(MGSHighlightExportFormat)fmt
+{
+    NSMutableData *res = [NSMutableData data];
+    
+    [self exportRange:range format:fmt usingBlock:^(NSData *chunk) {
+        [res appendData:chunk];
+    }];
+    return [res copy];
+}
+
+
+- (void)flush
+{
+    if (!output.length)
+        return;
+    sink([output copy]);
+    output.length = 0;
+}
+
+
+- (void)writeString:(NSString *)str
+{
+    [output appendData:[str dataUsingEncoding:NSUTF8StringEncoding]];
+}
+
+
+#pragma mark - Styles
+
+
+/* Returns the sRGB components of a colour, or of the text colour if it
+ * cannot be converted. */
+- (void)getComponentsOfColour:(NSColor *)colour red:(int *)r green:(int *)g blue:(int *)b
+{
+    NSColor *rgb = [colour colorUsingColorSpace:[NSColorSpace sRGBColorSpace]];
+    
+    if (!rgb)
+        rgb = [self.syntaxColouring.colourScheme.textColor colorUsingColorSpace:[NSColorSpace sRGBColorSpace]];
+    *r = (int)round(MAX(0.0, MIN(1.0, rgb.redComponent)) * 255.0);
+    *g = (int)round(MAX(0.0, MIN(1.0, rgb.greenComponent)) * 255.0);
+    *b = (int)round(MAX(0.0, MIN(1.0, rgb.blueComponent)) * 255.0);
+}
+
+
+- (NSString *)hexStringOfColour:(NSColor *)colour
+{
+    int r, g, b;
+    
+    [self getComponentsOfColour:colour red:&r green:&g blue:&b];
+    return [NSString stringWithFormat:@"#%02x%02x%02x", r, g, b];
+}
+
+
+- (NSString *)rtfColourOfColour:(NSColor *)colour
+{
+    int r, g, b;
+    
+    [self getComponentsOfColour:colour red:&r green:&g blue:&b];
+    return [NSString stringWithFormat:@"\\red%d\\green%d\\blue%d;", r, g, b];
+}
+
+
+- (MGSExportStyle *)styleForGroup:(nullable MGSSyntaxGroup)group
+{
+    MGSColourScheme *scheme = self.syntaxColouring.colourScheme;
+    MGSExportStyle *style;
+    MGSSyntaxGroup resolved;
+    NSMutableString *prefix, *suffix;
+    NSColor *colour;
+    MGSFontVariant variant;
+    NSUInteger index;
+    int r, g, b;
+    
+    style = styles[group ?: [NSNull null]];
+    if (style)
+        return style;
+    style = [[MGSExportStyle alloc] init];
+    styles[group ?: [NSNull null]] = style;
+    
+    resolved = group ? [scheme resolveSyntaxGroup:group] : nil;
+    if (!resolved || ![scheme coloursSyntaxGroup:resolved]) {
+        style.prefix = style.suffix = [NSData data];
+        return style;
+    }
+    colour = [scheme colourForSyntaxGroup:resolved] ?: scheme.textColor;
+    variant = [scheme fontVariantForSyntaxGroup:resolved];
+    
+    prefix = [NSMutableString string];
+    suffix = [NSMutableString string];
+    switch (format) {
+        case MGSHighlightExportFormatHTML:
+            [prefix appendFormat:@"<span style=\"color: %@;", [self hexStringOfColour:colour]];
+            if (variant & MGSFontVariantBold)
+                [prefix appendString:@" font-weight: bold;"];
+            if (variant & MGSFontVariantItalic)
+                [prefix appendString:@" font-style: italic;"];
+            if (variant & MGSFontVariantUnderline)
+                [prefix appendString:@" text-decoration: underline;"];
+            [prefix appendString:@"\">"];
+            [suffix appendString:@"</span>"];
+            break;
+        
+        case MGSHighlightExportFormatRTF:
+            index = [rtfColours indexOfObject:[self rtfColourOfColour:colour]];
+            if (index == NSNotFound)
+                index = 0;
+            [prefix appendFormat:@"{\\cf%lu", (unsigned long)index + 1];
+            if (variant & MGSFontVariantBold)
+                [prefix appendString:@"\\b"];
+            if (variant & MGSFontVariantItalic)
+                [prefix appendString:@"\\i"];
+            if (variant & MGSFontVariantUnderline)
+                [prefix appendString:@"\\ul"];
+            [prefix appendString:@" "];
+            [suffix appendString:@"}"];
+            break;
+        
+        case MGSHighlightExportFormatANSI:
+            [self getComponentsOfColour:colour red:&r green:&g blue:&b];
+            [prefix appendString:@"\x1b["];
+            if (variant & MGSFontVariantBold)
+                [prefix appendString:@"1;"];
+            if (variant & MGSFontVariantItalic)
+                [prefix appendString:@"3;"];
+            if (variant & MGSFontVariantUnderline)
+                [prefix appendString:@"4;"];
+            [prefix appendFormat:@"38;2;%d;%d;%dm", r, g, b];
+            [suffix appendString:@"\x1b[0m"];
+            break;
+    }
+    style.prefix = [prefix dataUsingEncoding:NSUTF8StringEncoding];
+    style.suffix = [suffix dataUsingEncoding:NSUTF8StringEncoding];
+    return style;
+}
+
+
+#pragma mark - Header and Footer
+
+
+- (void)writeHeader
+{
+    MGSColourScheme *scheme = self.syntaxColouring.colourScheme;
+    NSFont *font = self.syntaxColouring.textFont;
+    NSCharacterSet *unsafe;
+    NSString *family, *colour;
+    
+    switch (format) {
+        case MGSHighlightExportFormatHTML:
+            unsafe = [NSCharacterSet characterSetWithCharactersInString:@"'\"<>&;\\"];
+            family = [[font.familyName componentsSeparatedByCharactersInSet:unsafe] componentsJoinedByString:@""];
+            [self writeString:[NSString stringWithFormat:@"<pre style=\"font-family: '%@', monospace; font-size: %gpt; color: %@; background-color: %@;\">",
+                family, font.pointSize, [self hexStringOfColour:scheme.textColor], [self hexStringOfColour:scheme.backgroundColor]]];
+            break;
+        
+        case MGSHighlightExportFormatRTF:
+            /* The colour table must come first, thus it contains the colours
+             * of all the groups in the scheme, used or not */
+            rtfColours = [NSMutableArray arrayWithObject:[self rtfColourOfColour:scheme.textColor]];
+            for (MGSSyntaxGroup group in scheme.syntaxGroupOptions) {
+                colour = [self rtfColourOfColour:[scheme colourForSyntaxGroup:group] ?: scheme.textColor];
+                if (![rtfColours containsObject:colour])
+                    [rtfColours addObject:colour];
+            }
+            unsafe = [NSCharacterSet characterSetWithCharactersInString:@"\\{};"];
+            family = [[font.familyName componentsSeparatedByCharactersInSet:unsafe] componentsJoinedByString:@""];
+            [self writeString:[NSString stringWithFormat:@"{\\rtf1\\ansi\\ansicpg1252\\deff0\n{\\fonttbl{\\f0\\fmodern %@;}}\n{\\colortbl;%@}\n\\f0\\fs%ld\\cf1 ",
+                family, [rtfColours componentsJoinedByString:@""], (long)round(font.pointSize * 2.0)]];
+            break;
+        
+        case MGSHighlightExportFormatANSI:
+            break;
+    }
+}
+
+
+- (void)writeFooter
+{
+    switch (format) {
+        case MGSHighlightExportFormatHTML:
+            [self writeString:@"</pre>\n"];
+            break;
+        case MGSHighlightExportFormatRTF:
+            [self writeString:@"}\n"];
+            break;
+        case MGSHighlightExportFormatANSI:
+            break;
+    }
+}
+
+
+#pragma mark - Text
+
+
+- (void)writeCharactersInRange:(NSRange)range ofString:(NSString *)string
+{
+    if (format == MGSHighlightExportFormatRTF)
+        [self writeRTFCharactersInRange:range ofString:string];
+    else if (format == MGSHighlightExportFormatHTML)
+        [self writeHTMLCharactersInRange:range ofString:string];
+    else
+        [self writeUTF8CharactersInRange:range ofString:string];
+}
+
+
+- (void)writeUTF8CharactersInRange:(NSRange)range ofString:(NSString *)string
+{
+    NSUInteger used, oldLength;
+    NSRange piece;
+    
+    while (range.length > 0) {
+        /* Convert long runs a piece at a time, so that the output can be
+         * passed on before the run ends, without splitting surrogate pairs */
+        piece = NSMakeRange(range.location, MIN(range.length, MGSExportPieceLength));
+        if (piece.length < range.length && CFStringIsSurrogateHighCharacter([string characterAtIndex:NSMaxRange(piece) - 1]))
+            piece.length--;
+        
+        oldLength = output.length;
+        [output increaseLengthBy:piece.length * 3];
+        [string getBytes:(uint8_t *)output.mutableBytes + oldLength maxLength:piece.length * 3 usedLength:&used encoding:NSUTF8StringEncoding options:NSStringEncodingConversionAllowLossy range:piece remainingRange:NULL];
+        output.length = oldLength + used;
+        
+        range = NSMakeRange(NSMaxRange(piece), NSMaxRange(range) - NSMaxRange(piece));
+        if (output.length >= MGSExportChunkLength)
+            [self flush];
+    }
+}
+
+
+- (void)writeHTMLCharactersInRange:(NSRange)range ofString:(NSString *)string
+{
+    static NSCharacterSet *special;
+    static dispatch_once_t onceToken;
+    NSRange found;
+    unichar c;
+    
+    dispatch_once(&onceToken, ^{
+        special = [NSCharacterSet characterSetWithCharactersInString:@"&<>\""];
+    });
+    
+    while (range.length > 0) {
+        found = [string rangeOfCharacterFromSet:special options:NSLiteralSearch range:range];
+        if (found.location == NSNotFound) {
+            [self writeUTF8CharactersInRange:range ofString:string];
+            return;
+        }
+        [self writeUTF8CharactersInRange:NSMakeRange(range.location, found.location - range.location) ofString:string];
+        c = [string characterAtIndex:found.location];
+        if (c == '&')
+            [output appendBytes:"&amp;" length:5];
+        else if (c == '<')
+            [output appendBytes:"&lt;" length:4];
+        else if (c == '>')
+            [output appendBytes:"&gt;" length:4];
+        else
+            [output appendBytes:"&quot;" length:6];
+        range = NSMakeRange(NSMaxRange(found), NSMaxRange(range) - NSMaxRange(found));
+    }
+}
+
+
+- (void)writeRTFCharactersInRange:(NSRange)range ofString:(NSString *)string
+{
+    NSMutableData *out = output;
+    __block unichar prev = 0;
+    
+    [string mgs_enumerateCharacterChunksInRange:range usingBlock:^(const unichar *chars, NSRange chunkRange, BOOL *stop) {
+        char buf[16];
+        NSUInteger i;
+        unichar c;
+        int n;
+        
+        for (i = 0; i < chunkRange.length; i++) {
+            c = chars[i];
+            if (c == '\n' && prev == '\r') {
+                /* CRLF was already written as a single paragraph break */
+            } else if (c == '\n' || c == '\r' || c == 0x2029) {
+                [out appendBytes:"\\par\n" length:5];
+            } else if (c == 0x2028) {
+                [out appendBytes:"\\line " length:6];
+            } else if (c == '\t') {
+                [out appendBytes:"\\tab " length:5];
+            } else if (c == '\\' || c == '{' || c == '}') {
+                buf[0] = '\\';
+                buf[1] = (char)c;
+                [out appendBytes:buf length:2];
+            } else if (c >= 0x20 && c < 0x80) {
+                buf[0] = (char)c;
+                [out appendBytes:buf length:1];
+            } else {
+                n = snprintf(buf, sizeof(buf), "\\u%d?", (int)(short)c);
+                [out appendBytes:buf length:n];
+            }
+            prev = c;
+        }
+        if (out.length >= MGSExportChunkLength)
+            [self flush];
+    }];
+}
+
+
+@end
@@ -0,0 +1,65 @@
+//
+//  MGSIncrementalSyntaxParser.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/** Describes an edit of the text being parsed.
+ *  @discussion When several changes are made to the text at once (for
+ *    example between a -beginEditing and an -endEditing message sent to the
+ *    text storage) they are described by a single delta spanning all of
+ *    them. */
+typedef struct {
+    NSRange oldRange;           ///< The range of the replaced characters, before the edit.
+    NSRange newRange;           ///< The range of the replacement characters, after the edit.
+    NSInteger changeInLength;   ///< The difference between the lengths of the text after and before the edit.
+    NSUInteger generation;      ///< The generation of the text after the edit.
+} MGSTextEditDelta;
+
+
+/** MGSIncrementalSyntaxParser is an optional protocol which can be
+ *  implemented by a MGSSyntaxParser to be told precisely how the text
+ *  changes.
+ *
+ *  A parser which conforms to this protocol can maintain its own syntax
+ *  tree and update it incrementally, instead of scanning again the text
+ *  around each edit. It is also responsible for deciding which parts of the
+ *  text must be coloured again after an edit.
+ *
+ *  Every version of the text is identified by a generation number, which
+ *  increases with each edit. The parser is sent a
+ *  -resetIncrementalParsingWithString:generation: message before the first
+ *  delta, and whenever the parser client cannot describe the change of the
+ *  text as a delta. Then, an -applyEditDelta:toString: message is sent for
+ *  every change, always before any -parseForClient: message which refers to
+ *  the changed text. */
+@protocol MGSIncrementalSyntaxParser <NSObject>
+
+
+/** Discards any state derived from previous versions of the text.
+ *  @param string The current text.
+ *  @param generation The generation of the current text. */
+- (void)resetIncrementalParsingWithString:(NSString *)string generation:(NSUInteger)generation;
+
+/** Updates the state of the parser after an edit of the text.
+ *  @param delta The edit.
+ *  @param string The text after the edit.
+ *  @returns The character ranges, relative to the text after the edit,
+ *    where the tokens may have changed and must be parsed again, or nil to
+ *    let Fragaria decide which ranges are invalid as it does for parsers
+ *    which do not implement this protocol. The range of the replacement
+ *    characters (delta.newRange) is always parsed again, even if it is not
+ *    included in the returned set. */
+- (nullable NSIndexSet *)applyEditDelta:(MGSTextEditDelta)delta toString:(NSString *)string;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -25,11 +25,21 @@
 #import <Cocoa/Cocoa.h>
 
 
+@class MGSFoldingController;
+
+
 enum {
     MGSUnderlineStyleSquiggly = 0x0F
 };
 
 
+/** A temporary attribute whose value is a NSColor, filled behind the
+ *  glyphs over the colour set with NSBackgroundColorAttributeName. Unlike
+ *  the latter, it can be set without disturbing the other users of the
+ *  background colour. */
+extern NSString * const MGSHighlightColourAttributeName;
+
+
 /**
  *  MGSLayoutManager handles the layout of all of the glyphs in the text editor.
  **/
@@ -72,4 +82,11 @@ enum {
  **/
 - (void)addSubstitute:(NSString*)substitute forInvisibleCharacter:(unichar)character;
 
+/**
+ *  The object which decides which characters are folded. The folded
+ *  characters get null glyphs, and the first one is replaced by a
+ *  placeholder.
+ **/
+@property (nonatomic, weak) MGSFoldingController *foldingController;
+
 @end
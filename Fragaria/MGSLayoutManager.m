@@ -22,6 +22,7 @@
 */
 
 #import "MGSLayoutManager.h"
+#import "MGSFoldingController.h"
 
 
 #if __MAC_OS_X_VERSION_MAX_ALLOWED < 101100
@@ -29,11 +30,21 @@ typedef NSInteger NSUnderlineStyle;
 #endif
 
 
+#define kSMLInvisibleCharacterBufferLength (512)
+
+
 #define kSMLSquiggleAmplitude (3.0)
 #define kSMLSquigglePeriod    (6.0)
 #define kSMLSquigglePhase     (-1.5)
 
 
+#define kSMLFoldPlaceholder         @"\u22EF"
+#define kSMLFoldPlaceholderPadding  (4.0)
+
+
+NSString * const MGSHighlightColourAttributeName = @"MGSHighlightColour";
+
+
 static CGFloat SquiggleFunction(CGFloat x) {
     CGFloat px, ix;
     CGFloat y;
@@ -44,6 +55,11 @@ static CGFloat SquiggleFunction(CGFloat x) {
 }
 
 
+static inline uint8_t BitmapContainsCharacter(const uint8_t *bitmap, unichar c) {
+    return (bitmap[c >> 3] >> (c & 7)) & 1;
+}
+
+
 @interface NSLayoutManager ()
 
 - (void *)_validatedStoredUsageForTextContainerAtIndex:(NSUInteger)idx;
@@ -52,10 +68,91 @@ static CGFloat SquiggleFunction(CGFloat x) {
 @end
 
 
+@interface MGSLayoutManager ()
+
+- (CGFloat)widthOfFoldPlaceholderAtCharacterIndex:(NSUInteger)i;
+
+@end
+
+
+/* Lays out the folded characters in the line where their fold begins: the
+ * first one takes the width of the placeholder, and the line terminators
+ * which follow it do not break the line, except the one which ends the
+ * fold, so that the line after the fold begins a new line fragment. */
+@interface MGSFoldingTypesetter : NSATSTypesetter
+
+@end
+
+
+@implementation MGSFoldingTypesetter
+
+
+- (NSTypesetterControlCharacterAction)actionForControlCharacterAtIndex:(NSUInteger)charIndex
+{
+    MGSLayoutManager *lm = (MGSLayoutManager *)self.layoutManager;
+    NSRange fold = [lm.foldingController foldedRangeContainingCharacterIndex:charIndex];
+    NSString *string = lm.textStorage.string;
+    
+    if (fold.location == NSNotFound)
+        return [super actionForControlCharacterAtIndex:charIndex];
+    if (charIndex == fold.location)
+        return NSTypesetterWhitespaceAction;
+    if (charIndex + 1 == NSMaxRange(fold) || (charIndex + 2 == NSMaxRange(fold) && [string characterAtIndex:charIndex] == '\r'))
+        return [super actionForControlCharacterAtIndex:charIndex];
+    return NSTypesetterZeroAdvancementAction;
+}
+
+
+- (NSRect)boundingBoxForControlGlyphAtIndex:(NSUInteger)glyphIndex forTextContainer:(NSTextContainer *)textContainer proposedLineFragment:(NSRect)proposedRect glyphPosition:(NSPoint)glyphPosition characterIndex:(NSUInteger)charIndex
+{
+    MGSLayoutManager *lm = (MGSLayoutManager *)self.layoutManager;
+    NSRange fold = [lm.foldingController foldedRangeContainingCharacterIndex:charIndex];
+    
+    if (fold.location != charIndex)
+        return [super boundingBoxForControlGlyphAtIndex:glyphIndex forTextContainer:textContainer proposedLineFragment:proposedRect glyphPosition:glyphPosition characterIndex:charIndex];
+    return NSMakeRect(glyphPosition.x, glyphPosition.y, [lm widthOfFoldPlaceholderAtCharacterIndex:charIndex], 0);
+}
+
+
+- (void)getLineFragmentRect:(NSRectPointer)lineFragmentRect usedRect:(NSRectPointer)lineFragmentUsedRect remainingRect:(NSRectPointer)remainingRect forStartingGlyphAtIndex:(NSUInteger)startingGlyphIndex proposedRect:(NSRect)proposedRect lineSpacing:(CGFloat)lineSpacing paragraphSpacingBefore:(CGFloat)paragraphSpacingBefore paragraphSpacingAfter:(CGFloat)paragraphSpacingAfter
+{
+    MGSLayoutManager *lm = (MGSLayoutManager *)self.layoutManager;
+    NSUInteger charIndex;
+    NSRange fold;
+    CGFloat height;
+    
+    [super getLineFragmentRect:lineFragmentRect usedRect:lineFragmentUsedRect remainingRect:remainingRect forStartingGlyphAtIndex:startingGlyphIndex proposedRect:proposedRect lineSpacing:lineSpacing paragraphSpacingBefore:paragraphSpacingBefore paragraphSpacingAfter:paragraphSpacingAfter];
+    if (lm.foldingController.numberOfFolds == 0)
+        return;
+    
+    /* In case the typesetter lays out each paragraph in its own line
+     * fragment anyway, move the lines made only of folded characters up
+     * onto the row above, so that the next line fragment begins where this
+     * one would have. Their height is kept, since an empty line fragment
+     * rect would end the layout in the text container. */
+    charIndex = [lm characterIndexForGlyphAtIndex:startingGlyphIndex];
+    fold = [lm.foldingController foldedRangeContainingCharacterIndex:charIndex];
+    if (fold.location == NSNotFound || fold.location == charIndex)
+        return;
+    height = NSHeight(*lineFragmentRect);
+    lineFragmentRect->origin.y -= height;
+    lineFragmentUsedRect->origin.y -= height;
+}
+
+
+@end
+
+
 
 @implementation MGSLayoutManager {
     NSMutableDictionary *invisibleCharacterSubstitutes;
-    NSMutableDictionary *lineRefCacheCharactersSubstitute;
+    /* One bit for every UTF-16 code unit, set if the code unit has a
+     * substitute. */
+    uint8_t substituteBitmap[0x10000 / 8];
+    /* The characters with a substitute, and the CTLineRef of each
+     * substitute at the same index. */
+    NSMutableData *substituteCharacters;
+    NSMutableArray *substituteLines;
 }
 
 
@@ -82,6 +179,7 @@ static CGFloat SquiggleFunction(CGFloat x) {
     	invisibleCharacterSubstitutes[@(' ')] = @"\u22C5";
 
         [self resetAttributesAndGlyphs];
+        [self setTypesetter:[[MGSFoldingTypesetter alloc] init]];
         
 		[self setAllowsNonContiguousLayout:YES]; // Setting this to YES sometimes causes "an extra toolbar" and other graphical glitches to sometimes appear in the text view when one sets a temporary attribute, reported as ID #5832329 to Apple
 	}
@@ -96,12 +194,12 @@ static CGFloat SquiggleFunction(CGFloat x) {
  */
 - (void)drawGlyphsForGlyphRange:(NSRange)glyphRange atPoint:(NSPoint)containerOrigin
 {
-    if (self.showsInvisibleCharacters) {
+    if (self.showsInvisibleCharacters && substituteLines.count > 0) {
         
-		NSPoint pointToDrawAt;
-		NSRect glyphFragment;
 		NSString *completeString = [[self textStorage] string];
-		NSInteger lengthToRedraw = NSMaxRange(glyphRange);
+		NSRange charRange = [self characterRangeForGlyphRange:glyphRange actualGlyphRange:NULL];
+		unichar buffer[kSMLInvisibleCharacterBufferLength];
+		NSUInteger chunkStart, chunkLength, i;
         
         void *gcContext = [[NSGraphicsContext currentContext] graphicsPort];
         
@@ -114,45 +212,211 @@ static CGFloat SquiggleFunction(CGFloat x) {
         }
         CGContextSetTextMatrix (gcContext, t);
     
-        // we may not have any glyphs generated at this stage
-		for (NSInteger idx = glyphRange.location; idx < lengthToRedraw; idx++) {
-			unichar characterToCheck = [completeString characterAtIndex:idx];
-
-    	    CTLineRef line = (__bridge CTLineRef)lineRefCacheCharactersSubstitute[@(characterToCheck)];
-    	    if (line == nil)
-    	    	continue;
-
-            // http://lists.apple.com/archives/cocoa-dev/2012/Sep/msg00531.html
-            //
-            // Draw profiling indicated that the CoreText approach on 10.8 is an order of magnitude
-            // faster that using the NSStringDrawing methods.
-        
-            pointToDrawAt = [self locationForGlyphAtIndex:idx];
-            glyphFragment = [self lineFragmentRectForGlyphAtIndex:idx effectiveRange:NULL];
-
-            pointToDrawAt.x += glyphFragment.origin.x;
+        /* Fetch the characters in chunks, and skip the ones without a
+         * substitute with bitmap lookups; only the characters which have a
+         * substitute are looked up in the layout. */
+        for (chunkStart = charRange.location; chunkStart < NSMaxRange(charRange); chunkStart += chunkLength) {
+            chunkLength = MIN(kSMLInvisibleCharacterBufferLength, NSMaxRange(charRange) - chunkStart);
+            [completeString getCharacters:buffer range:NSMakeRange(chunkStart, chunkLength)];
             
-            /* Some control glyphs have zero size (newlines), and if they are
-             * not placed before a non-zero-sized glyph the typesetter simply
-             * sticks them at the bottom of the line fragment rect. In these
-             * cases we have to correct the location where we draw, otherwise
-             * the visible character will be placed too low on the line. */
-            if (pointToDrawAt.y >= glyphFragment.size.height) {
-                CGFloat descent, leading;
-                CTLineGetTypographicBounds(line, NULL, &descent, &leading);
-                pointToDrawAt.y = NSMaxY(glyphFragment) - floor(descent+0.5) - floor(leading+0.5);
-            } else {
-                pointToDrawAt.y += glyphFragment.origin.y;
+            i = 0;
+            while (i < chunkLength) {
+                /* Skip runs of ordinary text four characters at a time */
+                while (i + 4 <= chunkLength && !(BitmapContainsCharacter(substituteBitmap, buffer[i]) |
+                        BitmapContainsCharacter(substituteBitmap, buffer[i+1]) |
+                        BitmapContainsCharacter(substituteBitmap, buffer[i+2]) |
+                        BitmapContainsCharacter(substituteBitmap, buffer[i+3])))
+                    i += 4;
+                while (i < chunkLength && !BitmapContainsCharacter(substituteBitmap, buffer[i]))
+                    i++;
+                if (i >= chunkLength)
+                    break;
+                [self drawSubstituteForCharacter:buffer[i] atIndex:chunkStart + i inGlyphRange:glyphRange context:gcContext];
+                i++;
             }
-            
-            // draw with cached core text line ref
-            CGContextSetTextPosition(gcContext, pointToDrawAt.x, pointToDrawAt.y);
-            CTLineDraw(line, gcContext);
 		}
     }
     
     // the following causes glyph generation to occur if required
     [super drawGlyphsForGlyphRange:glyphRange atPoint:containerOrigin];
+    
+    if (self.foldingController.numberOfFolds > 0)
+        [self drawFoldPlaceholdersForGlyphRange:glyphRange atPoint:containerOrigin];
+}
+
+
+- (void)drawBackgroundForGlyphRange:(NSRange)glyphsToShow atPoint:(NSPoint)origin
+{
+    NSRange charRange;
+    
+    [super drawBackgroundForGlyphRange:glyphsToShow atPoint:origin];
+    
+    charRange = [self characterRangeForGlyphRange:glyphsToShow actualGlyphRange:NULL];
+    [self enumerateTemporaryAttribute:MGSHighlightColourAttributeName inCharacterRange:charRange usingBlock:^(id value, NSRange range, BOOL *stop) {
+        NSRange glyphRange;
+        NSTextContainer *tc;
+        
+        if (!value)
+            return;
+        glyphRange = [self glyphRangeForCharacterRange:range actualCharacterRange:NULL];
+        tc = [self textContainerForGlyphAtIndex:glyphRange.location effectiveRange:NULL];
+        [(NSColor *)value setFill];
+        [self enumerateEnclosingRectsForGlyphRange:glyphRange withinSelectedGlyphRange:NSMakeRange(NSNotFound, 0) inTextContainer:tc usingBlock:^(NSRect rect, BOOL *stop2) {
+            NSRectFillUsingOperation(NSOffsetRect(rect, origin.x, origin.y), NSCompositeSourceOver);
+        }];
+    }];
+}
+
+
+- (void)drawSubstituteForCharacter:(unichar)c atIndex:(NSUInteger)charIndex inGlyphRange:(NSRange)glyphRange context:(void *)gcContext
+{
+    const unichar *chars = substituteCharacters.bytes;
+    NSUInteger n = substituteCharacters.length / sizeof(unichar), k;
+    NSUInteger glyphIndex;
+    NSPoint pointToDrawAt;
+    NSRect glyphFragment;
+    CTLineRef line;
+    
+    for (k = 0; k < n && chars[k] != c; k++);
+    if (k >= n)
+        return;
+    line = (__bridge CTLineRef)substituteLines[k];
+    
+    glyphIndex = [self glyphIndexForCharacterAtIndex:charIndex];
+    if (!NSLocationInRange(glyphIndex, glyphRange))
+        return;
+    /* Folded characters are laid out over the row where their fold begins */
+    if (self.foldingController.numberOfFolds > 0 && [self.foldingController foldedRangeContainingCharacterIndex:charIndex].location != NSNotFound)
+        return;
+
+    // http://lists.apple.com/archives/cocoa-dev/2012/Sep/msg00531.html
+    //
+    // Draw profiling indicated that the CoreText approach on 10.8 is an order of magnitude
+    // faster that using the NSStringDrawing methods.
+
+    pointToDrawAt = [self locationForGlyphAtIndex:glyphIndex];
+    glyphFragment = [self lineFragmentRectForGlyphAtIndex:glyphIndex effectiveRange:NULL];
+
+    pointToDrawAt.x += glyphFragment.origin.x;
+    
+    /* Some control glyphs have zero size (newlines), and if they are
+     * not placed before a non-zero-sized glyph the typesetter simply
+     * sticks them at the bottom of the line fragment rect. In these
+     * cases we have to correct the location where we draw, otherwise
+     * the visible character will be placed too low on the line. */
+    if (pointToDrawAt.y >= glyphFragment.size.height) {
+        CGFloat descent, leading;
+        CTLineGetTypographicBounds(line, NULL, &descent, &leading);
+        pointToDrawAt.y = NSMaxY(glyphFragment) - floor(descent+0.5) - floor(leading+0.5);
+    } else {
+        pointToDrawAt.y += glyphFragment.origin.y;
+    }
+    
+    // draw with cached core text line ref
+    CGContextSetTextPosition(gcContext, pointToDrawAt.x, pointToDrawAt.y);
+    CTLineDraw(line, gcContext);
+}
+
+
+#pragma mark - Folding
+
+
+- (void)processEditingForTextStorage:(NSTextStorage *)textStorage edited:(NSTextStorageEditActions)editMask range:(NSRange)newCharRange changeInLength:(NSInteger)delta invalidatedRange:(NSRange)invalidatedCharRange
+{
+    [super processEditingForTextStorage:textStorage edited:editMask range:newCharRange changeInLength:delta invalidatedRange:invalidatedCharRange];
+    [self.foldingController layoutManagerDidProcessEditing];
+}
+
+
+- (void)setGlyphs:(const CGGlyph *)glyphs properties:(const NSGlyphProperty *)props characterIndexes:(const NSUInteger *)charIndexes font:(NSFont *)aFont forGlyphRange:(NSRange)glyphRange
+{
+    MGSFoldingController *fc = self.foldingController;
+    NSGlyphProperty *folded;
+    NSRange chars, fold;
+    NSUInteger i;
+    __block BOOL hasFolds = NO;
+    
+    if (fc.numberOfFolds > 0 && glyphRange.length > 0) {
+        chars = NSMakeRange(charIndexes[0], charIndexes[glyphRange.length - 1] - charIndexes[0] + 1);
+        [fc enumerateFoldsInRange:chars usingBlock:^(NSRange f, BOOL *stop) {
+            hasFolds = YES;
+            *stop = YES;
+        }];
+    }
+    if (!hasFolds) {
+        [super setGlyphs:glyphs properties:props characterIndexes:charIndexes font:aFont forGlyphRange:glyphRange];
+        return;
+    }
+    
+    /* Folded characters get null glyphs, which are not typeset; the line
+     * terminators and the first folded character are left to the
+     * typesetter as control characters. */
+    folded = malloc(glyphRange.length * sizeof(NSGlyphProperty));
+    for (i = 0; i < glyphRange.length; i++) {
+        fold = [fc foldedRangeContainingCharacterIndex:charIndexes[i]];
+        if (fold.location == NSNotFound)
+            folded[i] = props[i];
+        else if (charIndexes[i] == fold.location || (props[i] & NSGlyphPropertyControlCharacter))
+            folded[i] = NSGlyphPropertyControlCharacter;
+        else
+            folded[i] = NSGlyphPropertyNull;
+    }
+    [super setGlyphs:glyphs properties:folded characterIndexes:charIndexes font:aFont forGlyphRange:glyphRange];
+    free(folded);
+}
+
+
+- (NSFont *)fontOfFoldPlaceholderAtCharacterIndex:(NSUInteger)i
+{
+    NSFont *font = nil;
+    
+    if (i < self.textStorage.length)
+        font = [self.textStorage attribute:NSFontAttributeName atIndex:i effectiveRange:NULL];
+    return font ? font : self.invisibleCharactersFont;
+}
+
+
+- (CGFloat)widthOfFoldPlaceholderAtCharacterIndex:(NSUInteger)i
+{
+    NSDictionary *attr = @{NSFontAttributeName: [self fontOfFoldPlaceholderAtCharacterIndex:i]};
+    
+    return ceil([kSMLFoldPlaceholder sizeWithAttributes:attr].width) + 2.0 * kSMLFoldPlaceholderPadding;
+}
+
+
+- (void)drawFoldPlaceholdersForGlyphRange:(NSRange)glyphRange atPoint:(NSPoint)containerOrigin
+{
+    NSRange charRange = [self characterRangeForGlyphRange:glyphRange actualGlyphRange:NULL];
+    NSColor *colour = [NSColor colorWithCalibratedWhite:0.5 alpha:1.0];
+    
+    [self.foldingController enumerateFoldsInRange:charRange usingBlock:^(NSRange fold, BOOL *stop) {
+        NSUInteger glyph;
+        NSRect fragment, box;
+        NSPoint location;
+        NSBezierPath *bp;
+        NSDictionary *attr;
+        NSSize size;
+        
+        if (fold.location < charRange.location)
+            return;
+        glyph = [self glyphIndexForCharacterAtIndex:fold.location];
+        fragment = [self lineFragmentRectForGlyphAtIndex:glyph effectiveRange:NULL];
+        location = [self locationForGlyphAtIndex:glyph];
+        
+        box = NSMakeRect(NSMinX(fragment) + location.x, NSMinY(fragment), [self widthOfFoldPlaceholderAtCharacterIndex:fold.location], NSHeight(fragment));
+        box = NSOffsetRect(NSInsetRect(box, 1.0, 1.0), containerOrigin.x, containerOrigin.y);
+        
+        bp = [NSBezierPath bezierPathWithRoundedRect:box xRadius:3.0 yRadius:3.0];
+        [[colour colorWithAlphaComponent:0.15] setFill];
+        [bp fill];
+        [[colour colorWithAlphaComponent:0.6] setStroke];
+        [bp stroke];
+        
+        attr = @{NSFontAttributeName: [self fontOfFoldPlaceholderAtCharacterIndex:fold.location],
+          NSForegroundColorAttributeName: colour};
+        size = [kSMLFoldPlaceholder sizeWithAttributes:attr];
+        [kSMLFoldPlaceholder drawAtPoint:NSMakePoint(NSMidX(box) - size.width / 2.0, NSMidY(box) - size.height / 2.0) withAttributes:attr];
+    }];
 }
 
 
@@ -328,7 +592,9 @@ static CGFloat SquiggleFunction(CGFloat x) {
 
     NSAttributedString *attrString = [[NSAttributedString alloc] initWithString:substitute attributes:defAttributes];
     CTLineRef textLine = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)attrString);
-    lineRefCacheCharactersSubstitute[@(character)] = (__bridge id)textLine;
+    [substituteCharacters appendBytes:&character length:sizeof(unichar)];
+    [substituteLines addObject:(__bridge id)textLine];
+    substituteBitmap[character >> 3] |= 1 << (character & 7);
     CFRelease(textLine);
 }
 
@@ -337,7 +603,9 @@ static CGFloat SquiggleFunction(CGFloat x) {
  */
 - (void)resetAttributesAndGlyphs
 {
-    lineRefCacheCharactersSubstitute = [NSMutableDictionary dictionary];
+    memset(substituteBitmap, 0, sizeof(substituteBitmap));
+    substituteCharacters = [NSMutableData data];
+    substituteLines = [NSMutableArray array];
     [invisibleCharacterSubstitutes enumerateKeysAndObjectsUsingBlock:^(NSNumber* key, NSString* obj, BOOL* stop) {
     	[self _addLineRefSubstitute:obj forCharacter:key.unsignedShortValue];
     }];
@@ -0,0 +1,67 @@
+//
+//  MGSLayoutScheduler.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class MGSTextView;
+
+
+/** Lays out the text of a MGSTextView ahead of the visible part while it is
+ *  being scrolled, so that the text does not have to be laid out in the
+ *  middle of drawing a frame.
+ *
+ *  The direction and the velocity of the scroll are estimated from the
+ *  position of the visible rect each time the text view is drawn. The
+ *  region ahead of the visible rect in the scroll direction is laid out,
+ *  beginning from its nearest part, in small slices performed when the run
+ *  loop is idle; each idle period spends at most a few milliseconds on
+ *  layout, and the slices shrink when laying out one of them takes longer
+ *  than that. The faster the scroll, the larger the region.
+ *
+ *  The pending layout is cancelled when the scroll reverses its direction,
+ *  and when the text view has not been scrolled for a short delay. */
+@interface MGSLayoutScheduler : NSObject
+
+
+/** Initializes a layout scheduler for a text view.
+ *  @param textView The text view. */
+- (instancetype)initWithTextView:(MGSTextView *)textView;
+
+/** The text view whose text is laid out. */
+@property (nonatomic, weak, readonly) MGSTextView *textView;
+
+
+/** The direction of the last scroll: 1 when the text was scrolled towards
+ *  its end, -1 when it was scrolled towards its beginning, and 0 when there
+ *  is no scroll in progress. */
+@property (nonatomic, readonly) NSInteger direction;
+
+/** The estimated vertical velocity of the scroll, in points per second. */
+@property (nonatomic, readonly) CGFloat velocity;
+
+/** The part of the text view which remains to be laid out, or NSZeroRect
+ *  if there is none. */
+@property (nonatomic, readonly) NSRect pendingRect;
+
+
+/** Informs the layout scheduler that a part of the text view has been
+ *  drawn. If the text view has been scrolled since the last time it was
+ *  drawn, the region to lay out is updated.
+ *  @param rect The rectangle which has been drawn. */
+- (void)textViewDidDrawRect:(NSRect)rect;
+
+/** Cancels the pending layout. */
+- (void)cancel;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
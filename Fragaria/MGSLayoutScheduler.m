@@ -0,0 +1,278 @@
+//
+//  MGSLayoutScheduler.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSLayoutScheduler.h"
+#import "MGSTextView.h"
+#import "MGSTextViewPrivate.h"
+#import "MGSLineGeometry.h"
+
+
+/* Maximum time spent laying out the text each time the run loop is idle,
+ * in seconds. */
+#define MGSLayoutSchedulerSliceDuration     (0.004)
+
+/* Maximum height of the slices of the text view laid out at a time, as a
+ * fraction of the height of the visible rect, and minimum height of the
+ * slices in points. */
+#define MGSLayoutSchedulerSliceFraction     (0.25)
+#define MGSLayoutSchedulerMinimumSliceHeight    (16.0)
+
+/* How far ahead the text is laid out, in seconds of scrolling at the
+ * current velocity. */
+#define MGSLayoutSchedulerLookahead         (0.5)
+
+/* Minimum and maximum height of the region laid out ahead of the visible
+ * rect, in multiples of the height of the visible rect. */
+#define MGSLayoutSchedulerMinimumScreens    (1.0)
+#define MGSLayoutSchedulerMaximumScreens    (4.0)
+
+/* Time after the last scroll after which the scroll is considered to be
+ * over, in seconds. */
+#define MGSLayoutSchedulerStopDelay         (0.25)
+
+
+static NSString * const MGSLayoutSchedulerIdleNotification = @"MGSLayoutSchedulerIdleNotification";
+
+
+@implementation MGSLayoutScheduler
+{
+    CGFloat _lastOrigin;
+    CFAbsoluteTime _lastScrollTime;
+    BOOL _hasLastOrigin;
+    /* The region left to lay out spans from _next to _end, in the
+     * direction of the scroll. */
+    CGFloat _next;
+    CGFloat _end;
+    CGFloat _sliceHeight;
+    BOOL _sliceScheduled;
+    NSTimer *_stopTimer;
+}
+
+
+#pragma mark - Initialization
+
+
+- (instancetype)initWithTextView:(MGSTextView *)textView
+{
+    self = [super init];
+    
+    _textView = textView;
+    
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(runLoopIsIdle:) name:MGSLayoutSchedulerIdleNotification object:self];
+    
+    return self;
+}
+
+
+- (void)dealloc
+{
+    [_stopTimer invalidate];
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+
+#pragma mark - Properties
+
+
+- (NSRect)pendingRect
+{
+    NSRect bounds = self.textView.bounds;
+    CGFloat top, bottom;
+    
+    if (_direction > 0) {
+        top = _next;
+        bottom = MIN(_end, NSMaxY(bounds));
+    } else if (_direction < 0) {
+        top = MAX(_end, NSMinY(bounds));
+        bottom = _next;
+    } else {
+        return NSZeroRect;
+    }
+    if (bottom <= top)
+        return NSZeroRect;
+    return NSMakeRect(NSMinX(bounds), top, NSWidth(bounds), bottom - top);
+}
+
+
+#pragma mark - Tracking the Scroll
+
+
+- (void)textViewDidDrawRect:(NSRect)rect
+{
+    NSRect visible = self.textView.visibleRect;
+    CGFloat origin = NSMinY(visible);
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    CFAbsoluteTime elapsed;
+    CGFloat delta;
+    NSInteger direction;
+    
+    if (!_hasLastOrigin) {
+        _hasLastOrigin = YES;
+        _lastOrigin = origin;
+        _lastScrollTime = now;
+        return;
+    }
+    
+    /* Redrawing without scrolling, for example after an edit, does not
+     * tell anything about the scroll */
+    delta = origin - _lastOrigin;
+    if (delta == 0)
+        return;
+    
+    elapsed = MAX(now - _lastScrollTime, 0.001);
+    direction = delta > 0 ? 1 : -1;
+    _lastOrigin = origin;
+    _lastScrollTime = now;
+    
+    if (direction != _direction || elapsed > MGSLayoutSchedulerStopDelay) {
+        /* A new scroll begins; the layout ahead in the other direction is
+         * not needed anymore */
+        [self cancel];
+        _direction = direction;
+        _velocity = delta / elapsed;
+        _next = direction > 0 ? NSMaxY(visible) : NSMinY(visible);
+    } else {
+        _velocity = (_velocity + delta / elapsed) / 2.0;
+    }
+    
+    if (!_stopTimer) {
+        /* The timer must also fire while the scroller is being dragged,
+         * since the slices keep running in the event tracking mode */
+        _stopTimer = [NSTimer timerWithTimeInterval:MGSLayoutSchedulerStopDelay
+          target:self selector:@selector(stopTimerSelector:)
+          userInfo:nil repeats:NO];
+        [[NSRunLoop currentRunLoop] addTimer:_stopTimer forMode:NSRunLoopCommonModes];
+    }
+    [_stopTimer setFireDate:[NSDate dateWithTimeIntervalSinceNow:MGSLayoutSchedulerStopDelay]];
+    
+    [self updatePendingRegion];
+    [self scheduleSlice];
+}
+
+
+/* The user stopped scrolling */
+- (void)stopTimerSelector:(NSTimer *)timer
+{
+    _stopTimer = nil;
+    [self cancel];
+}
+
+
+/* Extends the region to lay out according to the position of the visible
+ * rect and to the velocity of the scroll. The part of the region which has
+ * already been laid out is kept. */
+- (void)updatePendingRegion
+{
+    NSRect visible = self.textView.visibleRect;
+    CGFloat height = NSHeight(visible);
+    CGFloat distance;
+    
+    distance = fabs(_velocity) * MGSLayoutSchedulerLookahead;
+    distance = MIN(MAX(distance, height * MGSLayoutSchedulerMinimumScreens), height * MGSLayoutSchedulerMaximumScreens);
+    
+    if (_direction > 0) {
+        _next = MAX(_next, NSMaxY(visible));
+        _end = NSMaxY(visible) + distance;
+    } else {
+        _next = MIN(_next, NSMinY(visible));
+        _end = NSMinY(visible) - distance;
+    }
+}
+
+
+- (void)cancel
+{
+    NSNotification *note;
+    
+    if (_sliceScheduled) {
+        note = [NSNotification notificationWithName:MGSLayoutSchedulerIdleNotification object:self];
+        [[NSNotificationQueue defaultQueue] dequeueNotificationsMatching:note coalesceMask:NSNotificationCoalescingOnName | NSNotificationCoalescingOnSender];
+        _sliceScheduled = NO;
+    }
+    [_stopTimer invalidate];
+    _stopTimer = nil;
+    _direction = 0;
+    _velocity = 0;
+}
+
+
+#pragma mark - Laying Out
+
+
+/* Asks to be notified the next time the run loop is about to wait for
+ * events. */
+- (void)scheduleSlice
+{
+    NSNotification *note;
+    
+    if (_sliceScheduled || NSIsEmptyRect(self.pendingRect))
+        return;
+    _sliceScheduled = YES;
+    
+    note = [NSNotification notificationWithName:MGSLayoutSchedulerIdleNotification object:self];
+    [[NSNotificationQueue defaultQueue] enqueueNotification:note
+      postingStyle:NSPostWhenIdle
+      coalesceMask:NSNotificationCoalescingOnName | NSNotificationCoalescingOnSender
+      forModes:@[NSDefaultRunLoopMode, NSEventTrackingRunLoopMode]];
+}
+
+
+- (void)runLoopIsIdle:(NSNotification *)note
+{
+    _sliceScheduled = NO;
+    [self layOutNextSlices];
+}
+
+
+/* Lays out the pending region a slice at a time, beginning from the part
+ * nearest to the visible rect, until the time available for this idle
+ * period is over. */
+- (void)layOutNextSlices
+{
+    MGSTextView *tv = self.textView;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent(), sliceStart, now;
+    CGFloat maxHeight = MAX(MGSLayoutSchedulerMinimumSliceHeight, NSHeight(tv.visibleRect) * MGSLayoutSchedulerSliceFraction);
+    NSRect pending, slice;
+    NSRange range;
+    
+    if (_sliceHeight <= 0)
+        _sliceHeight = maxHeight;
+    
+    for (;;) {
+        pending = self.pendingRect;
+        if (NSIsEmptyRect(pending))
+            return;
+        
+        slice = pending;
+        slice.size.height = MIN(MIN(_sliceHeight, maxHeight), NSHeight(pending));
+        if (_direction < 0)
+            slice.origin.y = NSMaxY(pending) - NSHeight(slice);
+        
+        sliceStart = CFAbsoluteTimeGetCurrent();
+        range = [tv.lineGeometry characterRangeForRect:slice];
+        [tv.layoutManager ensureLayoutForCharacterRange:range];
+        _next = _direction > 0 ? NSMaxY(slice) : NSMinY(slice);
+        now = CFAbsoluteTimeGetCurrent();
+        
+        /* The time needed to lay out a slice depends on the text, for
+         * example on the length of the lines being wrapped. Halve the
+         * slices which overrun the time available, and let them grow back
+         * while they are fast. */
+        if (now - sliceStart > MGSLayoutSchedulerSliceDuration)
+            _sliceHeight = MAX(MGSLayoutSchedulerMinimumSliceHeight, _sliceHeight / 2.0);
+        else if (now - sliceStart < MGSLayoutSchedulerSliceDuration / 4.0)
+            _sliceHeight = MIN(maxHeight, _sliceHeight * 2.0);
+        
+        /* Stop if the next slice would not fit in the time left */
+        if (now - start + (now - sliceStart) >= MGSLayoutSchedulerSliceDuration)
+            break;
+    }
+    [self scheduleSlice];
+}
+
+
+@end
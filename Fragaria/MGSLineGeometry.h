@@ -0,0 +1,71 @@
+//
+//  MGSLineGeometry.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@class MGSTextView;
+
+
+/** MGSLineGeometry answers questions about the position of the lines of
+ *  a text view, for the text view itself and for the gutter.
+ *
+ *  When line wrapping is disabled and the text font is fixed pitch, all the
+ *  lines have the same height, so their positions are computed arithmetically
+ *  from the line index of the text storage, without asking the layout manager
+ *  to lay out the text. Otherwise, the layout manager is used.
+ *
+ *  When some lines are folded, the lines are placed in the rows where they
+ *  are displayed, as mapped by the folding controller of the text view.
+ *
+ *  All rectangles and points are in the coordinate system of the text
+ *  container, like the ones returned by NSLayoutManager. */
+@interface MGSLineGeometry : NSObject
+
+
+/** Initializes a new line geometry object for the specified text view.
+ *  @param textView The text view. */
+- (instancetype)initWithTextView:(MGSTextView *)textView;
+
+/** The text view whose lines are measured by this object. */
+@property (nonatomic, weak, readonly) MGSTextView *textView;
+
+
+/** YES if the geometry of the lines is currently computed without involving
+ *  the layout manager.
+ *  @discussion If some line which was already laid out is found not to
+ *    have the expected height, this property becomes NO until the font, the
+ *    line height multiple or the text storage change. */
+@property (nonatomic, readonly) BOOL hasFixedLineHeight;
+
+
+/** Returns the range of the zero-based lines which intersect a rectangle.
+ *  @param rect A rectangle in the text container. */
+- (NSRange)lineRangeForRect:(NSRect)rect;
+
+/** Returns the range of the characters which lie in the lines intersecting
+ *  a rectangle.
+ *  @param rect A rectangle in the text container. */
+- (NSRange)characterRangeForRect:(NSRect)rect;
+
+/** Returns the rectangle of the first line fragment of a line.
+ *  @param line A zero-based line number. */
+- (NSRect)lineFragmentRectForLine:(NSUInteger)line;
+
+/** Returns the zero-based line number located at a vertical position.
+ *  @param y A vertical position in the text container.
+ *  @returns A valid line number (never NSNotFound). */
+- (NSUInteger)lineAtVerticalPosition:(CGFloat)y;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,210 @@
+//
+//  MGSLineGeometry.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#define FRAGARIA_PRIVATE
+#import "MGSLineGeometry.h"
+#import "MGSTextView.h"
+#import "MGSTextViewPrivate.h"
+#import "MGSLayoutManager.h"
+#import "MGSFoldingController.h"
+#import "NSTextStorage+Fragaria.h"
+
+
+@implementation MGSLineGeometry
+{
+    NSFont *cachedFont;
+    CGFloat cachedLineHeightMultiple;
+    NSTextStorage * __weak cachedTextStorage;
+    CGFloat lineHeight;
+    BOOL mixedLineHeights;
+}
+
+
+- (instancetype)initWithTextView:(MGSTextView *)textView
+{
+    self = [super init];
+    _textView = textView;
+    return self;
+}
+
+
+#pragma mark - Line height
+
+
+- (BOOL)hasFixedLineHeight
+{
+    MGSTextView *tv = self.textView;
+    NSFont *font = tv.textFont;
+    
+    if (!tv || tv.lineWrap || !font.isFixedPitch)
+        return NO;
+    
+    if (font != cachedFont || tv.lineHeightMultiple != cachedLineHeightMultiple || tv.textStorage != cachedTextStorage) {
+        cachedFont = font;
+        cachedLineHeightMultiple = tv.lineHeightMultiple;
+        cachedTextStorage = tv.textStorage;
+        mixedLineHeights = NO;
+        lineHeight = [self computeLineHeight];
+    }
+    return !mixedLineHeights && lineHeight > 0;
+}
+
+
+- (CGFloat)computeLineHeight
+{
+    MGSTextView *tv = self.textView;
+    NSLayoutManager *lm = tv.layoutManager;
+    CGFloat h;
+    NSRect rect;
+    
+    /* Prefer the height of the first line if it has already been laid out,
+     * because it includes any adjustment made by the typesetter. */
+    if (tv.textStorage.length > 0) {
+        rect = [lm lineFragmentRectForGlyphAtIndex:0 effectiveRange:NULL withoutAdditionalLayout:YES];
+        if (!NSIsEmptyRect(rect))
+            return rect.size.height;
+    }
+    
+    h = [lm defaultLineHeightForFont:cachedFont];
+    if (cachedLineHeightMultiple > 0)
+        h *= cachedLineHeightMultiple;
+    return h;
+}
+
+
+/* Compares the position of a row which was already laid out with the
+ * position computed arithmetically. When they differ, some line has a
+ * different height (for example, because of a fallback font) and the layout
+ * manager must be used instead. */
+- (void)verifyRow:(NSUInteger)row
+{
+    MGSTextView *tv = self.textView;
+    NSLayoutManager *lm = tv.layoutManager;
+    NSTextStorage *ts = lm.textStorage;
+    NSUInteger index, glyph;
+    NSRect rect;
+    
+    index = [ts mgs_firstCharacterInRow:[tv.foldingController lineOfVisibleRow:row]];
+    if (index == NSNotFound || index >= ts.length)
+        return;
+    glyph = [lm glyphIndexForCharacterAtIndex:index];
+    rect = [lm lineFragmentRectForGlyphAtIndex:glyph effectiveRange:NULL withoutAdditionalLayout:YES];
+    if (NSIsEmptyRect(rect))
+        return;
+    if (fabs(NSMinY(rect) - row * lineHeight) > 0.5 || fabs(NSHeight(rect) - lineHeight) > 0.5)
+        mixedLineHeights = YES;
+}
+
+
+#pragma mark - Geometry queries
+
+
+- (NSRange)lineRangeForRect:(NSRect)rect
+{
+    NSTextStorage *ts = self.textView.textStorage;
+    MGSFoldingController *folds = self.textView.foldingController;
+    NSRange charRange;
+    NSUInteger first, last, maxLine, maxRow;
+    
+    if ([self hasFixedLineHeight]) {
+        /* While a mapped file is being indexed, its line count is an
+         * estimate which may be past the end of the text; only the lines
+         * indexed so far are returned */
+        maxLine = [ts mgs_indexedLineCount] - 1;
+        maxRow = [folds visibleRowOfLine:maxLine];
+        first = (NSUInteger)MAX(0.0, floor(NSMinY(rect) / lineHeight));
+        last = (NSUInteger)MAX(0.0, ceil(NSMaxY(rect) / lineHeight) - 1.0);
+        first = MIN(first, maxRow);
+        last = MAX(first, MIN(last, maxRow));
+    
+        [self verifyRow:first];
+        [self verifyRow:last];
+        if (!mixedLineHeights) {
+            first = [folds lineOfVisibleRow:first];
+            last = last < maxRow ? [folds lineOfVisibleRow:last + 1] - 1 : maxLine;
+            return NSMakeRange(first, last - first + 1);
+        }
+    }
+    
+    charRange = [self characterRangeForRect:rect];
+    first = [ts mgs_rowOfCharacter:charRange.location];
+    last = [ts mgs_rowOfCharacter:NSMaxRange(charRange)];
+    return NSMakeRange(first, last - first + 1);
+}
+
+
+- (NSRange)characterRangeForRect:(NSRect)rect
+{
+    MGSTextView *tv = self.textView;
+    NSLayoutManager *lm = tv.layoutManager;
+    NSTextStorage *ts = lm.textStorage;
+    NSRange lines, glyphRange;
+    NSUInteger start, end;
+    
+    if ([self hasFixedLineHeight]) {
+        lines = [self lineRangeForRect:rect];
+        if (!mixedLineHeights) {
+            start = [ts mgs_firstCharacterInRow:lines.location];
+            end = [ts mgs_firstCharacterInRow:NSMaxRange(lines)];
+            if (end == NSNotFound)
+                end = ts.length;
+            return NSMakeRange(start, end - start);
+        }
+    }
+    
+    glyphRange = [lm glyphRangeForBoundingRect:rect inTextContainer:tv.textContainer];
+    return [lm characterRangeForGlyphRange:glyphRange actualGlyphRange:NULL];
+}
+
+
+- (NSRect)lineFragmentRectForLine:(NSUInteger)line
+{
+    MGSTextView *tv = self.textView;
+    NSLayoutManager *lm = tv.layoutManager;
+    NSUInteger index, glyphIdx;
+    
+    if ([self hasFixedLineHeight])
+        return NSMakeRect(0, [tv.foldingController visibleRowOfLine:line] * lineHeight, tv.textContainer.containerSize.width, lineHeight);
+    
+    index = [lm.textStorage mgs_firstCharacterInRow:line];
+    glyphIdx = [lm glyphIndexForCharacterAtIndex:index];
+    if (index < lm.textStorage.length)
+        return [lm lineFragmentRectForGlyphAtIndex:glyphIdx effectiveRange:NULL];
+    /* Last line */
+    return [lm boundingRectForGlyphRange:NSMakeRange(glyphIdx, 0) inTextContainer:tv.textContainer];
+}
+
+
+- (NSUInteger)lineAtVerticalPosition:(CGFloat)y
+{
+    MGSTextView *tv = self.textView;
+    NSTextStorage *ts = tv.textStorage;
+    MGSFoldingController *folds = tv.foldingController;
+    NSUInteger i, maxRow;
+    CGFloat insptdist;
+    
+    if ([self hasFixedLineHeight]) {
+        maxRow = [folds visibleRowOfLine:[ts mgs_indexedLineCount] - 1];
+        return [folds lineOfVisibleRow:MIN((NSUInteger)MAX(0.0, floor(y / lineHeight)), maxRow)];
+    }
+    
+    i = [tv.layoutManager characterIndexForPoint:NSMakePoint(0, y)
+          inTextContainer:tv.textContainer
+          fractionOfDistanceBetweenInsertionPoints:&insptdist];
+    /* insptdist is how far the returned character's insertion point is from
+     * the insertion point that would appear when clicking on the specified
+     * point. 0 means that the user clicked before the character i, and
+     * 1 means the user clicked after the character i.*/
+    if (insptdist >= 1.0)
+        /* Adjust the character index to become the insertion point's index */
+        i++;
+    /* The character may be folded; return the line where its row begins */
+    return [folds lineOfVisibleRow:[folds visibleRowOfLine:[ts mgs_rowOfCharacter:i]]];
+}
+
+
+@end
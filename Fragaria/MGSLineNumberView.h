@@ -40,6 +40,7 @@
 
 
 @class MGSFragariaView;
+@class MGSChangeTracker;
 @protocol MGSBreakpointDelegate;
 
 
@@ -70,6 +71,11 @@
 /** Minimum width of the gutter. */
 @property (nonatomic) CGFloat minimumWidth;
 
+/** Indicates whether the lines where a block of text can be folded, or is
+ * folded, are marked with a triangle which folds or unfolds the block when
+ * clicked. */
+@property (nonatomic) BOOL showsFoldingMarkers;
+
 /** The starting line number in the editor. */
 @property (nonatomic) NSUInteger startingLineNumber;
 /** A dictionary of objects conforming to MGSLineNumberViewDecoration, keyed by
@@ -86,6 +92,10 @@
  * by decorationActionTarget to determine which decoration was clicked. */
 @property (readonly) NSUInteger selectedLineNumber;
 
+/** The change tracker whose changes are shown as markers along the right
+ * edge of the gutter, or nil to show no change markers. */
+@property (nonatomic) MGSChangeTracker *changeTracker;
+
 /** Indicates whether or not line numbers should be drawn. */
 @property (nonatomic, assign) BOOL showsLineNumbers;
 
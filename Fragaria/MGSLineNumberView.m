@@ -40,19 +40,25 @@
 #import "MGSLineNumberView.h"
 #import "MGSLayoutManager.h"
 #import "MGSTextViewPrivate.h"
+#import "MGSLineGeometry.h"
 #import "MGSBreakpointDelegate.h"
 #import "NSTextStorage+Fragaria.h"
 #import "NSSet+Fragaria.h"
 #import "MGSLineNumberViewDecoration.h"
+#import "MGSChangeTracker.h"
+#import "MGSFoldingController.h"
 
 
 #define RULER_MARGIN		5.0
+#define CHANGE_MARKER_WIDTH	3.0
+#define FOLDING_MARKER_WIDTH	9.0
 
 
 typedef enum {
     MGSGutterHitTypeOutside = -1,
     MGSGutterHitTypeBreakpoint,
-    MGSGutterHitTypeDecoration
+    MGSGutterHitTypeDecoration,
+    MGSGutterHitTypeFoldingMarker
 } MGSGutterHitType;
 
 
@@ -64,6 +70,7 @@ typedef enum {
     
     NSDictionary *_breakpointData;
     NSUInteger _lastLineCount;
+    BOOL _redrawAfterIndexingScheduled;
 }
 
 
@@ -120,6 +127,19 @@ typedef enum {
 }
 
 
+- (void)setChangeTracker:(MGSChangeTracker *)changeTracker
+{
+    NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
+    
+    if (_changeTracker)
+        [nc removeObserver:self name:MGSChangeTrackerDidUpdateChangesNotification object:_changeTracker];
+    _changeTracker = changeTracker;
+    if (_changeTracker)
+        [nc addObserver:self selector:@selector(changeTrackerDidUpdateChanges:) name:MGSChangeTrackerDidUpdateChangesNotification object:_changeTracker];
+    [self setNeedsDisplay:YES];
+}
+
+
 - (void)setMinimumWidth:(CGFloat)minimumWidth
 {
     _minimumWidth = minimumWidth;
@@ -143,6 +163,13 @@ typedef enum {
     [self setNeedsDisplay:YES];
 }
 
+- (void)setShowsFoldingMarkers:(BOOL)showsFoldingMarkers
+{
+    _showsFoldingMarkers = showsFoldingMarkers;
+    [self setRuleThickness:[self requiredThickness]];
+    [self setNeedsDisplay:YES];
+}
+
 - (void)setShowsSeparator:(BOOL)showsSeparator
 {
     _showsSeparator = showsSeparator;
@@ -303,7 +330,13 @@ typedef enum {
 
 	// Round up the value. There is a bug on 10.4 where the display gets all
     // wonky when scrolling if you don't return an integral value here.
-    return ceil(MAX(_minimumWidth, decorationsWidth + stringWidth + RULER_MARGIN));
+    return ceil(MAX(_minimumWidth, decorationsWidth + stringWidth + [self foldingColumnWidth] + RULER_MARGIN));
+}
+
+
+- (CGFloat)foldingColumnWidth
+{
+    return _showsFoldingMarkers ? FOLDING_MARKER_WIDTH : 0;
 }
 
 
@@ -376,6 +409,12 @@ typedef enum {
 #pragma mark - Main draw methods
 
 
+- (void)changeTrackerDidUpdateChanges:(NSNotification *)notification
+{
+    [self setNeedsDisplay:YES];
+}
+
+
 - (void)textViewFrameDidChange:(NSNotification *)notification
 {
     /* Delay the call because otherwise, when drawRect is called, the text
@@ -387,13 +426,33 @@ typedef enum {
 }
 
 
+/* Schedules a redraw, to show the lines which are indexed in the
+ * meantime. */
+- (void)setNeedsDisplayAfterIndexing
+{
+    MGSLineNumberView * __weak weakSelf = self;
+    
+    if (_redrawAfterIndexingScheduled)
+        return;
+    _redrawAfterIndexingScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.1 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        MGSLineNumberView *lnv = weakSelf;
+        if (!lnv)
+            return;
+        lnv->_redrawAfterIndexingScheduled = NO;
+        [lnv setNeedsDisplay:YES];
+    });
+}
+
+
 - (void)drawRect:(NSRect)dirtyRect
 {
     MGSTextView	*view;
     NSRect visibleRect;
     NSLayoutManager	*layoutManager;
     NSTextStorage *ts;
-    NSRange range, glyphRange;
+    MGSFoldingController *folding;
+    NSRange range;
     NSUInteger index, line;
     NSRect wholeLineRect;
     CGContextRef drawingContext;
@@ -405,6 +464,7 @@ typedef enum {
     visibleRect = [[[self scrollView] contentView] bounds];
     layoutManager = [view layoutManager];
     ts = [layoutManager textStorage];
+    folding = view.foldingController;
 
     drawingContext = [[NSGraphicsContext currentContext] graphicsPort];
     CGAffineTransform flipTransform = {1, 0, 0, -1, 0, 0};
@@ -412,11 +472,21 @@ typedef enum {
 
     // Find the characters that are currently visible, make a range,  then fudge the range a tad in case
     // there is an extra new line at end. It doesn't show up in the glyphs so would not be accounted for.
-    glyphRange = [layoutManager glyphRangeForBoundingRect:visibleRect inTextContainer:[view textContainer]];
-    range = [layoutManager characterRangeForGlyphRange:glyphRange actualGlyphRange:NULL];
+    range = [view.lineGeometry characterRangeForRect:visibleRect];
     range.length++;
 
-    for (line = [ts mgs_rowOfCharacter:range.location]; ; line++)
+    /* Do not wait for the line index of a mapped file to reach the visible
+     * text; draw again when it has advanced. */
+    if ([ts mgs_lineCountIsEstimate])
+        [self setNeedsDisplayAfterIndexing];
+    line = [ts mgs_rowOfCharacterIfIndexed:range.location];
+    if (line == NSNotFound)
+        return;
+    
+    /* Skip the lines hidden by folds: they share the row of the line where
+     * their fold begins. */
+    line = [folding lineOfVisibleRow:[folding visibleRowOfLine:line]];
+    for (; ; line = [folding nextVisibleLineAfterLine:line])
     {
         index = [ts mgs_firstCharacterInRow:line];
         
@@ -440,6 +510,10 @@ typedef enum {
             }
 
             [self drawDecorationOfLine:line];
+            if (_changeTracker)
+                [self drawChangeMarkerOfLine:line inRect:wholeLineRect];
+            if (_showsFoldingMarkers)
+                [self drawFoldingMarkerOfLine:line inRect:wholeLineRect];
         }
     }
 }
@@ -504,7 +578,7 @@ typedef enum {
     textline = CTLineCreateWithAttributedString((__bridge CFAttributedStringRef)drawingAttributedString);
     CGFloat width = CTLineGetTypographicBounds(textline, NULL, &descent, &leading);
     
-    CGFloat xpos = NSWidth(bounds) - width - RULER_MARGIN;
+    CGFloat xpos = NSWidth(bounds) - width - RULER_MARGIN - [self foldingColumnWidth];
     CGFloat baselinepos = ypos + NSHeight(wholeLineRect) - floor(descent + 0.5) - floor(leading+0.5);
     CGContextSetTextPosition(drawingContext, xpos, baselinepos);
     CTLineDraw(textline, drawingContext);
@@ -515,28 +589,14 @@ typedef enum {
 /// @param line uses zero-based indexing.
 - (NSRect)wholeLineRectForLine:(NSUInteger)line
 {
-    id			      view;
+    MGSTextView       *view;
     NSRect            visibleRect;
-    NSLayoutManager	  *layoutManager;
-    NSTextContainer	  *container;
-    NSUInteger        index, stringLength;
     NSRect            rect;
     NSRect            wholeLineRect = NSZeroRect;
 
     view = [self clientView];
-    layoutManager = [view layoutManager];
-    container = [view textContainer];
-
     visibleRect = [[[self scrollView] contentView] bounds];
-    stringLength = [[view string] length];
-
-    index = [layoutManager.textStorage mgs_firstCharacterInRow:line];
-
-    NSUInteger glyphIdx = [layoutManager glyphIndexForCharacterAtIndex:index];
-    if (index < stringLength)
-        rect = [layoutManager lineFragmentRectForGlyphAtIndex:glyphIdx effectiveRange:NULL];
-    else /* Last line */
-        rect = [layoutManager boundingRectForGlyphRange:NSMakeRange(glyphIdx, 0) inTextContainer:container];
+    rect = [view.lineGeometry lineFragmentRectForLine:line];
 
     // Note that the ruler view is only as tall as the visible
     // portion. Need to compensate for the clipview's coordinates.
@@ -554,26 +614,14 @@ typedef enum {
 /// @returns zero-based indexing. Never returns NSNotFound
 - (NSUInteger)lineNumberForLocation:(CGFloat)location
 {
-	NSUInteger i;
 	NSRect visibleRect;
     MGSTextView *view;
-    CGFloat insptdist;
     
 	view = [self clientView];
 	visibleRect = [[[self scrollView] contentView] bounds];
 	location += NSMinY(visibleRect);
     
-    i = [view.layoutManager characterIndexForPoint:NSMakePoint(0, location)
-          inTextContainer:view.textContainer
-          fractionOfDistanceBetweenInsertionPoints:&insptdist];
-    /* insptdist is how far the returned character's insertion point is from
-     * the insertion point that would appear when clicking on the specified
-     * point. 0 means that the user clicked before the character i, and
-     * 1 means the user clicked after the character i.*/
-    if (insptdist >= 1.0)
-        /* Adjust the character index to become the insertion point's index */
-        i++;
-	return [view.textStorage mgs_rowOfCharacter:i];
+    return [view.lineGeometry lineAtVerticalPosition:location];
 }
 
 
@@ -597,6 +645,97 @@ typedef enum {
 }
 
 
+/// @param line uses zero-based indexing.
+- (void)drawChangeMarkerOfLine:(NSUInteger)line inRect:(NSRect)wholeLineRect
+{
+    MGSLineChanges changes;
+    NSRect bar;
+    NSBezierPath *triangle;
+    CGFloat x, y, size;
+    
+    changes = [_changeTracker changesOfLine:line];
+    if (changes == MGSLineChangeNone)
+        return;
+    
+    bar = wholeLineRect;
+    bar.origin.x = NSMaxX(wholeLineRect) - CHANGE_MARKER_WIDTH - 1.0;
+    bar.size.width = CHANGE_MARKER_WIDTH;
+    
+    if (changes & MGSLineChangeAdded)
+        [[NSColor colorWithCalibratedRed:0.35 green:0.70 blue:0.35 alpha:1.0] set];
+    else if (changes & MGSLineChangeModified)
+        [[NSColor colorWithCalibratedRed:0.30 green:0.50 blue:0.85 alpha:1.0] set];
+    if (changes & (MGSLineChangeAdded | MGSLineChangeModified))
+        NSRectFill([self backingAlignedRect:bar options:NSAlignAllEdgesOutward]);
+    
+    /* Deleted lines are marked by a triangle pointing at the boundary
+     * between the lines where they were */
+    if (!(changes & (MGSLineChangeDeletedBefore | MGSLineChangeDeletedAfter)))
+        return;
+    [[NSColor colorWithCalibratedRed:0.85 green:0.30 blue:0.30 alpha:1.0] set];
+    size = MIN(CHANGE_MARKER_WIDTH * 2.0, NSHeight(wholeLineRect) / 2.0);
+    x = NSMaxX(bar);
+    triangle = [NSBezierPath bezierPath];
+    if (changes & MGSLineChangeDeletedBefore) {
+        y = NSMinY(wholeLineRect);
+        [triangle moveToPoint:NSMakePoint(x, y)];
+        [triangle lineToPoint:NSMakePoint(x - size, y)];
+        [triangle lineToPoint:NSMakePoint(x, y + size)];
+        [triangle closePath];
+    }
+    if (changes & MGSLineChangeDeletedAfter) {
+        y = NSMaxY(wholeLineRect);
+        [triangle moveToPoint:NSMakePoint(x, y)];
+        [triangle lineToPoint:NSMakePoint(x - size, y)];
+        [triangle lineToPoint:NSMakePoint(x, y - size)];
+        [triangle closePath];
+    }
+    [triangle fill];
+}
+
+
+- (NSRect)foldingMarkerRectInRect:(NSRect)wholeLineRect
+{
+    NSRect rect = wholeLineRect;
+    
+    rect.origin.x = NSMaxX(wholeLineRect) - RULER_MARGIN - FOLDING_MARKER_WIDTH;
+    rect.size.width = FOLDING_MARKER_WIDTH;
+    return rect;
+}
+
+
+/// @param line uses zero-based indexing.
+- (void)drawFoldingMarkerOfLine:(NSUInteger)line inRect:(NSRect)wholeLineRect
+{
+    MGSFoldingController *folding = self.clientView.foldingController;
+    NSBezierPath *triangle;
+    NSRect rect;
+    CGFloat x, y, size;
+    
+    /* A triangle pointing right for folded lines, down for foldable ones */
+    rect = [self foldingMarkerRectInRect:wholeLineRect];
+    size = floor(MIN(NSWidth(rect), NSHeight(rect)) * 0.6);
+    x = NSMidX(rect);
+    y = NSMidY(rect);
+    
+    triangle = [NSBezierPath bezierPath];
+    if ([folding isLineFolded:line]) {
+        [triangle moveToPoint:NSMakePoint(x - size / 3.0, y - size / 2.0)];
+        [triangle lineToPoint:NSMakePoint(x + size * 2.0 / 3.0, y)];
+        [triangle lineToPoint:NSMakePoint(x - size / 3.0, y + size / 2.0)];
+    } else if ([folding isLineFoldable:line]) {
+        [triangle moveToPoint:NSMakePoint(x - size / 2.0, y - size / 3.0)];
+        [triangle lineToPoint:NSMakePoint(x + size / 2.0, y - size / 3.0)];
+        [triangle lineToPoint:NSMakePoint(x, y + size * 2.0 / 3.0)];
+    } else {
+        return;
+    }
+    [triangle closePath];
+    [[self.textColor colorWithAlphaComponent:0.6] set];
+    [triangle fill];
+}
+
+
 /// @param line uses zero-based indexing.
 - (void)drawDecorationOfLine:(NSUInteger)line
 {
@@ -745,6 +884,11 @@ typedef enum {
             if (CGRectContainsPoint(trackRect, location))
                 where = MGSGutterHitTypeDecoration;
         }
+        if (where == MGSGutterHitTypeBreakpoint && _showsFoldingMarkers) {
+            trackRect = [self foldingMarkerRectInRect:[self wholeLineRectForLine:line]];
+            if (CGRectContainsPoint(trackRect, location) && ([self.clientView isLineFolded:line] || [self.clientView.foldingController isLineFoldable:line]))
+                where = MGSGutterHitTypeFoldingMarker;
+        }
         if (where == MGSGutterHitTypeBreakpoint)
             trackRect = [self wholeLineRectForLine:line];
     }
@@ -776,6 +920,8 @@ typedef enum {
         if (where == MGSGutterHitTypeDecoration && inside) {
             self->_selectedLineNumber = line;
             [NSApp sendAction:self->_decorationActionSelector to:self->_decorationActionTarget from:self];
+        } else if (where == MGSGutterHitTypeFoldingMarker && inside) {
+            [self foldingMarkerClickedOnLine:line];
         }
     }];
 }
@@ -896,6 +1042,16 @@ typedef enum {
 }
 
 
+/// @param line uses zero-based indexing.
+- (void)foldingMarkerClickedOnLine:(NSUInteger)line
+{
+    MGSTextView *view = self.clientView;
+    
+    if (![view unfoldLine:line])
+        [view foldLine:line];
+}
+
+
 - (void)breakpointClickedOnLine:(NSUInteger)line
 {
     _selectedLineNumber = line;
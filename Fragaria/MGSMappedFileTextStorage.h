@@ -0,0 +1,56 @@
+//
+//  MGSMappedFileTextStorage.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/** Posted on the main thread by a MGSMappedFileTextStorage when its line
+ *  index has been completely built. The object of the notification is the
+ *  text storage. */
+extern NSNotificationName const MGSMappedFileTextStorageDidFinishIndexingNotification;
+
+
+/** A read-only text storage which displays the contents of a file without
+ *  loading it in memory.
+ *
+ *  The file is memory-mapped and decoded as UTF-8 lazily, a page at a time.
+ *  Only a small amount of decoded pages is kept in memory, thus the memory
+ *  used does not depend on the size of the file. Invalid UTF-8 sequences are
+ *  decoded as U+FFFD REPLACEMENT CHARACTER.
+ *
+ *  The line index used by Fragaria is built on a background thread. Until it
+ *  is complete, the line count is an estimate, and looking up a line number
+ *  which has not been indexed yet makes the line index advance up to that
+ *  point on the calling thread. Only LF, CR and CRLF are recognized as line
+ *  terminators.
+ *
+ *  Any attempt at modifying the characters raises an exception. The
+ *  attributes can be modified.
+ *
+ *  Use -[MGSFragariaView openFileForViewingAtURL:error:] to display a file
+ *  using a MGSMappedFileTextStorage. */
+@interface MGSMappedFileTextStorage : NSTextStorage
+
+
+/** Initializes a text storage with the contents of a file.
+ *  @param url The URL of the file. It must be encoded in UTF-8.
+ *  @param err Upon return, if the initialization failed, contains an NSError
+ *         object that describes the problem.
+ *  @returns A new text storage, or nil if the file could not be mapped. */
+- (nullable instancetype)initWithContentsOfURL:(NSURL *)url error:(out NSError **)err;
+
+
+/** YES when the line index has been completely built. */
+@property (readonly, getter=isLineIndexComplete) BOOL lineIndexComplete;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,597 @@
+//
+//  MGSMappedFileTextStorage.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSMappedFileTextStorage.h"
+#import "MGSRangeEntries.h"
+#import "NSString+Fragaria.h"
+#import "NSTextStorage+Fragaria.h"
+
+
+NSNotificationName const MGSMappedFileTextStorageDidFinishIndexingNotification = @"MGSMappedFileTextStorageDidFinishIndexingNotification";
+
+
+/* Approximate length of a page of the file, in bytes */
+#define MGSMappedPageLength     (65536)
+/* Number of decoded pages kept in memory */
+#define MGSMappedPageCacheSize  (16)
+/* The line index stores the position of one line every MGSLineIndexStride
+ * lines */
+#define MGSLineIndexStride      (256)
+
+
+/* Counts the line starts at positions in (start, end], stopping after
+ * maxCount line starts have been found. On return, last points to the
+ * position of the last line start found, or to start if none was found. */
+static NSUInteger MGSCountLineStarts(NSString *s, NSUInteger start, NSUInteger end, NSUInteger maxCount, NSUInteger *last)
+{
+    __block NSUInteger count = 0, found = start;
+    __block BOOL prevCR = NO;
+    NSUInteger len = s.length;
+    
+    if (maxCount == 0 || start >= end) {
+        *last = start;
+        return 0;
+    }
+    
+    /* Also look at the character at end, to know if a CR before it is
+     * part of a CRLF */
+    [s mgs_enumerateCharacterChunksInRange:NSMakeRange(start, MIN(end + 1, len) - start) usingBlock:^(const unichar *chars, NSRange range, BOOL *stop) {
+        NSUInteger j, i;
+        unichar c;
+    
+        for (j = 0; j < range.length; j++) {
+            i = range.location + j;
+            c = chars[j];
+            if (prevCR) {
+                prevCR = NO;
+                if (c != '\n') {
+                    count++;
+                    found = i;
+                    if (count == maxCount) {
+                        *stop = YES;
+                        return;
+                    }
+                }
+            }
+            if (i >= end) {
+                *stop = YES;
+                return;
+            }
+            if (c == '\n') {
+                count++;
+                found = i + 1;
+                if (count == maxCount) {
+                    *stop = YES;
+                    return;
+                }
+            } else if (c == '\r') {
+                prevCR = YES;
+            }
+        }
+    }];
+    if (prevCR && end >= len && count < maxCount) {
+        count++;
+        found = len;
+    }
+    
+    *last = found;
+    return count;
+}
+
+
+#pragma mark - Mapped string
+
+
+/* An immutable string which decodes the pages of a mapped UTF-8 file on
+ * demand. */
+@interface MGSMappedFileString : NSString
+
+- (instancetype)initWithData:(NSData *)data;
+
+@property (nonatomic, readonly) NSUInteger pageCount;
+
+- (NSUInteger)firstCharacterOfPage:(NSUInteger)page;
+- (NSUInteger)decodePage:(NSUInteger)page intoBuffer:(unichar *)buffer;
+
+@end
+
+
+@implementation MGSMappedFileString
+{
+    NSData *data;
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger *pageByteStart;
+    NSUInteger *pageCharStart;
+    
+    unichar *cacheChars[MGSMappedPageCacheSize];
+    NSUInteger cachePage[MGSMappedPageCacheSize];
+    NSUInteger cacheStamp[MGSMappedPageCacheSize];
+    NSUInteger cachePins[MGSMappedPageCacheSize];
+    NSUInteger stamp;
+}
+
+
+- (instancetype)initWithData:(NSData *)d
+{
+    NSUInteger n, start, p, e, k, chars;
+    
+    self = [super init];
+    
+    data = d;
+    bytes = d.bytes;
+    n = d.length;
+    
+    /* Skip the byte order mark */
+    start = 0;
+    if (n >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF)
+        start = 3;
+    
+    _pageCount = (n - start + MGSMappedPageLength - 1) / MGSMappedPageLength;
+    pageByteStart = malloc((_pageCount + 1) * sizeof(NSUInteger));
+    pageCharStart = malloc((_pageCount + 1) * sizeof(NSUInteger));
+    
+    /* Pages never split a UTF-8 sequence, thus they can be decoded
+     * independently. */
+    p = start;
+    chars = 0;
+    for (k = 0; k < _pageCount; k++) {
+        e = MIN(n, start + (k + 1) * MGSMappedPageLength);
+        while (e < n && e - (start + (k + 1) * MGSMappedPageLength) < 3 && (bytes[e] & 0xC0) == 0x80)
+            e++;
+        pageByteStart[k] = p;
+        pageCharStart[k] = chars;
+        chars += MGSDecodeUTF8(bytes + p, e - p, NULL);
+        p = e;
+    }
+    pageByteStart[_pageCount] = n;
+    pageCharStart[_pageCount] = chars;
+    length = chars;
+    
+    for (k = 0; k < MGSMappedPageCacheSize; k++)
+        cachePage[k] = NSNotFound;
+    
+    return self;
+}
+
+
+- (void)dealloc
+{
+    for (NSUInteger k = 0; k < MGSMappedPageCacheSize; k++)
+        free(cacheChars[k]);
+    free(pageByteStart);
+    free(pageCharStart);
+}
+
+
+- (NSUInteger)firstCharacterOfPage:(NSUInteger)page
+{
+    return pageCharStart[page];
+}
+
+
+- (NSUInteger)decodePage:(NSUInteger)page intoBuffer:(unichar *)buffer
+{
+    return MGSDecodeUTF8(bytes + pageByteStart[page], pageByteStart[page + 1] - pageByteStart[page], buffer);
+}
+
+
+- (NSUInteger)pageOfCharacter:(NSUInteger)i
+{
+    NSUInteger lo = 0, hi = _pageCount - 1, mid;
+    
+    while (lo < hi) {
+        mid = (lo + hi + 1) / 2;
+        if (pageCharStart[mid] <= i)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+
+/* Returns the slot of the page cache containing the specified page, decoding
+ * it if needed. Must be called while synchronized on self. */
+- (NSUInteger)cacheSlotOfPage:(NSUInteger)page
+{
+    NSUInteger k, victim = NSNotFound;
+    
+    for (k = 0; k < MGSMappedPageCacheSize; k++) {
+        if (cachePage[k] == page) {
+            cacheStamp[k] = ++stamp;
+            return k;
+        }
+        if (cachePins[k] == 0 && (victim == NSNotFound || cacheStamp[k] < cacheStamp[victim]))
+            victim = k;
+    }
+    if (victim == NSNotFound)
+        [NSException raise:NSInternalInconsistencyException format:@"All the pages of the cache are in use"];
+    
+    if (!cacheChars[victim])
+        cacheChars[victim] = malloc((MGSMappedPageLength + 4) * sizeof(unichar));
+    [self decodePage:page intoBuffer:cacheChars[victim]];
+    cachePage[victim] = page;
+    cacheStamp[victim] = ++stamp;
+    return victim;
+}
+
+
+#pragma mark - NSString primitives
+
+
+- (NSUInteger)length
+{
+    return length;
+}
+
+
+- (unichar)characterAtIndex:(NSUInteger)index
+{
+    NSUInteger page, slot;
+    
+    if (index >= length)
+        [NSException raise:NSRangeException format:@"Index %lu out of bounds", (unsigned long)index];
+    @synchronized (self) {
+        page = [self pageOfCharacter:index];
+        slot = [self cacheSlotOfPage:page];
+        return cacheChars[slot][index - pageCharStart[page]];
+    }
+}
+
+
+- (void)getCharacters:(unichar *)buffer range:(NSRange)range
+{
+    [self mgs_enumerateCharacterChunksInRange:range usingBlock:^(const unichar *chars, NSRange chunkRange, BOOL *stop) {
+        memcpy(buffer + (chunkRange.location - range.location), chars, chunkRange.length * sizeof(unichar));
+    }];
+}
+
+
+- (void)mgs_enumerateCharacterChunksInRange:(NSRange)range usingBlock:(void (^)(const unichar *chars, NSRange chunkRange, BOOL *stop))block
+{
+    NSUInteger page, slot, i;
+    NSRange chunk;
+    BOOL stop = NO;
+    
+    if (NSMaxRange(range) > length)
+        [NSException raise:NSRangeException format:@"Range %@ out of bounds", NSStringFromRange(range)];
+    if (range.length == 0)
+        return;
+    
+    i = range.location;
+    page = [self pageOfCharacter:i];
+    while (i < NSMaxRange(range) && !stop) {
+        chunk = NSIntersectionRange(range, NSMakeRange(pageCharStart[page], pageCharStart[page + 1] - pageCharStart[page]));
+        if (chunk.length > 0) {
+            /* The page is pinned so that it stays in the cache even if the
+             * block accesses other parts of the string. */
+            @synchronized (self) {
+                slot = [self cacheSlotOfPage:page];
+                cachePins[slot]++;
+            }
+            block(cacheChars[slot] + (chunk.location - pageCharStart[page]), chunk, &stop);
+            @synchronized (self) {
+                cachePins[slot]--;
+            }
+            i = NSMaxRange(chunk);
+        }
+        page++;
+    }
+}
+
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    return self;
+}
+
+
+@end
+
+
+#pragma mark - Text storage
+
+
+@implementation MGSMappedFileTextStorage
+{
+    MGSMappedFileString *mappedString;
+    MGSRangeEntries *attributeRanges;
+    
+    /* The line index. All these variables are protected by synchronizing
+     * on self. */
+    NSMutableData *sparseLineStarts;
+    NSUInteger indexedLines;
+    NSUInteger indexedPages;
+    BOOL pendingCR;
+    BOOL indexComplete;
+    unichar *indexBuffer;
+}
+
+
+- (instancetype)initWithContentsOfURL:(NSURL *)url error:(out NSError **)err
+{
+    NSData *data;
+    
+    data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedAlways error:err];
+    if (!data)
+        return nil;
+    
+    self = [super init];
+    
+    mappedString = [[MGSMappedFileString alloc] initWithData:data];
+    attributeRanges = MGSCreateRangeToCopiedObjectEntries(0);
+    MGSRangeEntryInsert(attributeRanges, NSMakeRange(0, mappedString.length), @{});
+    
+    sparseLineStarts = [[NSMutableData alloc] init];
+    indexBuffer = malloc((MGSMappedPageLength + 4) * sizeof(unichar));
+    [self addLineStart:0];
+    if (mappedString.pageCount == 0)
+        indexComplete = YES;
+    else
+        [self startIndexing];
+    
+    return self;
+}
+
+
+- (void)dealloc
+{
+    MGSFreeRangeEntries(attributeRanges);
+    free(indexBuffer);
+}
+
+
+#pragma mark - Primitive methods
+
+
+- (NSString *)string
+{
+    return mappedString;
+}
+
+
+- (NSDictionary *)attributesAtIndex:(NSUInteger)location effectiveRange:(NSRangePointer)range
+{
+    NSRange myRange;
+    NSDictionary *attrib = MGSRangeEntryAtIndex(attributeRanges, location, &myRange);
+    
+    if (!attrib)
+        attrib = @{};
+    if (range) {
+        if (myRange.length == NSNotFound)
+            myRange.length = self.length - myRange.location;
+        *range = myRange;
+    }
+    return attrib;
+}
+
+
+- (void)replaceCharactersInRange:(NSRange)range withString:(NSString *)str
+{
+    [NSException raise:NSInternalInconsistencyException format:@"The characters of a MGSMappedFileTextStorage cannot be modified"];
+}
+
+
+- (void)setAttributes:(NSDictionary *)attrs range:(NSRange)range
+{
+    if (!attrs)
+        attrs = @{};
+    
+    if (range.length > 0) {
+        MGSRangeEntriesDivideAndConquer(attributeRanges, range);
+        MGSRangeEntryInsert(attributeRanges, range, attrs);
+    }
+    
+    [self edited:NSTextStorageEditedAttributes range:range changeInLength:0];
+}
+
+
+#pragma mark - Line index construction
+
+
+- (void)startIndexing
+{
+    MGSMappedFileTextStorage * __weak weakSelf = self;
+    
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^{
+        MGSMappedFileTextStorage *ts;
+        BOOL done = NO;
+    
+        while (!done) {
+            ts = weakSelf;
+            if (!ts)
+                return;
+            @synchronized (ts) {
+                [ts indexNextPage];
+                done = [ts isLineIndexComplete];
+            }
+            ts = nil;
+        }
+    
+        dispatch_async(dispatch_get_main_queue(), ^{
+            MGSMappedFileTextStorage *ts = weakSelf;
+            if (ts)
+                [[NSNotificationCenter defaultCenter] postNotificationName:MGSMappedFileTextStorageDidFinishIndexingNotification object:ts];
+        });
+    });
+}
+
+
+- (BOOL)isLineIndexComplete
+{
+    @synchronized (self) {
+        return indexComplete;
+    }
+}
+
+
+/* Must be called while synchronized on self */
+- (void)addLineStart:(NSUInteger)p
+{
+    if (indexedLines % MGSLineIndexStride == 0)
+        [sparseLineStarts appendBytes:&p length:sizeof(NSUInteger)];
+    indexedLines++;
+}
+
+
+/* Must be called while synchronized on self */
+- (void)indexNextPage
+{
+    NSUInteger base, n, j;
+    unichar c;
+    
+    if (indexComplete)
+        return;
+    
+    base = [mappedString firstCharacterOfPage:indexedPages];
+    n = [mappedString decodePage:indexedPages intoBuffer:indexBuffer];
+    for (j = 0; j < n; j++) {
+        c = indexBuffer[j];
+        if (pendingCR) {
+            pendingCR = NO;
+            if (c == '\n') {
+                [self addLineStart:base + j + 1];
+                continue;
+            }
+            [self addLineStart:base + j];
+        }
+        if (c == '\n')
+            [self addLineStart:base + j + 1];
+        else if (c == '\r')
+            pendingCR = YES;
+    }
+    
+    indexedPages++;
+    if (indexedPages == mappedString.pageCount) {
+        if (pendingCR)
+            [self addLineStart:mappedString.length];
+        indexComplete = YES;
+    }
+}
+
+
+#pragma mark - Line index queries
+
+
+/* Returns the index in sparseLineStarts of the last indexed line start not
+ * after the specified character. Must be called while synchronized on self,
+ * after the index has reached that character. */
+- (NSUInteger)sparseIndexOfCharacter:(NSUInteger)c
+{
+    const NSUInteger *starts = sparseLineStarts.bytes;
+    NSUInteger lo = 0, hi = sparseLineStarts.length / sizeof(NSUInteger) - 1, mid;
+    
+    while (lo < hi) {
+        mid = (lo + hi + 1) / 2;
+        if (starts[mid] <= c)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+
+- (NSUInteger)mgs_lineCount
+{
+    NSUInteger scanned;
+    
+    @synchronized (self) {
+        if (indexComplete)
+            return indexedLines;
+        /* Extrapolate from the part of the file indexed so far */
+        scanned = [mappedString firstCharacterOfPage:indexedPages];
+        if (scanned == 0)
+            return indexedLines;
+        return MAX(indexedLines, (NSUInteger)((double)indexedLines / scanned * mappedString.length));
+    }
+}
+
+
+- (BOOL)mgs_lineCountIsEstimate
+{
+    return ![self isLineIndexComplete];
+}
+
+
+- (NSUInteger)mgs_indexedLineCount
+{
+    @synchronized (self) {
+        return indexedLines;
+    }
+}
+
+
+- (NSUInteger)mgs_rowOfCharacterIfIndexed:(NSUInteger)c
+{
+    @synchronized (self) {
+        if (!indexComplete && (c >= mappedString.length || [mappedString firstCharacterOfPage:indexedPages] <= c))
+            return NSNotFound;
+    }
+    return [self mgs_rowOfCharacter:c];
+}
+
+
+- (NSUInteger)mgs_rowOfCharacter:(NSUInteger)c
+{
+    NSUInteger len = mappedString.length;
+    NSUInteger j, start, last;
+    
+    if (c > len)
+        return NSNotFound;
+    
+    @synchronized (self) {
+        if (c == len) {
+            while (!indexComplete)
+                [self indexNextPage];
+            return indexedLines - 1;
+        }
+        while (!indexComplete && [mappedString firstCharacterOfPage:indexedPages] <= c)
+            [self indexNextPage];
+        j = [self sparseIndexOfCharacter:c];
+        start = ((const NSUInteger *)sparseLineStarts.bytes)[j];
+    }
+    return j * MGSLineIndexStride + MGSCountLineStarts(mappedString, start, c, NSUIntegerMax, &last);
+}
+
+
+- (NSUInteger)mgs_firstCharacterInRow:(NSUInteger)l
+{
+    NSUInteger start, last;
+    
+    @synchronized (self) {
+        while (!indexComplete && indexedLines <= l)
+            [self indexNextPage];
+        if (l >= indexedLines)
+            return NSNotFound;
+        start = ((const NSUInteger *)sparseLineStarts.bytes)[l / MGSLineIndexStride];
+    }
+    MGSCountLineStarts(mappedString, start, mappedString.length, l % MGSLineIndexStride, &last);
+    return last;
+}
+
+
+- (NSUInteger)mgs_characterAtIndex:(NSUInteger)i withinRow:(NSUInteger)l
+{
+    NSCharacterSet *nl = [NSCharacterSet characterSetWithCharactersInString:@"\r\n"];
+    NSUInteger c, max;
+    NSRange found;
+    
+    c = [self mgs_firstCharacterInRow:l];
+    if (c == NSNotFound || c == mappedString.length)
+        return c;
+    
+    max = (c + i < c) ? mappedString.length : MIN(c + i, mappedString.length);
+    found = [mappedString rangeOfCharacterFromSet:nl options:0 range:NSMakeRange(c, max - c)];
+    if (found.location != NSNotFound)
+        return found.location;
+    return max;
+}
+
+
+@end
@@ -46,6 +46,20 @@
 @end
 
 
+/** Options for the enumerations of mutable substrings. */
+typedef NS_OPTIONS(NSUInteger, MGSMutableSubstringEnumerationOptions) {
+    /** The edits to the substrings are not applied to the superstring
+     *  immediately, but are recorded and applied all at once, in a single
+     *  pass over the superstring, when the enumeration ends. While the
+     *  enumeration is in progress, each substring shows its own edits, but
+     *  the superstring is left unchanged, and the ranges of the substrings
+     *  in the superstring refer to its original contents. The substrings
+     *  must not be used after the enumeration has ended, and the block
+     *  must not edit the superstring by any other means. */
+    MGSMutableSubstringEnumerationDeferEdits = 1 << 0
+};
+
+
 /** 
  *  This category implements utility methods for working with 
  *  MGSMutableSubstring.
@@ -65,6 +79,19 @@
 - (NSArray *)enumerateMutableSubstringsFromRangeArray:(NSArray*)a usingBlock:
   (void (^)(MGSMutableSubstring *substring, BOOL *stop))b;
 
+/** Enumerates with the given block the ranges contained in an array.
+ *  @param a An array of NSRanges, sorted by location and not overlapping.
+ *  @param opts The enumeration options.
+ *  @param b The block to be used for enumerating.
+ *  @returns The ranges of the input array, shifted to take in account the
+ *           edits to the substrings.
+ *  @discussion This method is the same as
+ *              -enumerateMutableSubstringsFromRangeArray:usingBlock:, but it
+ *              allows deferring the edits to the end of the enumeration. */
+- (NSArray *)enumerateMutableSubstringsFromRangeArray:(NSArray*)a
+  options:(MGSMutableSubstringEnumerationOptions)opts usingBlock:
+  (void (^)(MGSMutableSubstring *substring, BOOL *stop))b;
+
 /** Enumerates with the given block every line in the string.
  *  @param b The block to be used for enumerating.
  *
@@ -81,6 +108,19 @@
 - (void)enumerateMutableSubstringsOfLinesUsingBlock:(void (^)
   (MGSMutableSubstring *substring, BOOL *stop))b;
 
+/** Enumerates with the given block every line in the string.
+ *  @param opts The enumeration options.
+ *  @param b The block to be used for enumerating.
+ *  @discussion This method is the same as
+ *              -enumerateMutableSubstringsOfLinesUsingBlock:, but it allows
+ *              deferring the edits to the end of the enumeration. With
+ *              deferred edits, an enumeration which edits many lines moves
+ *              the contents of the superstring only once, instead of once
+ *              per edit. The lines enumerated are the same in both cases. */
+- (void)enumerateMutableSubstringsOfLinesWithOptions:
+  (MGSMutableSubstringEnumerationOptions)opts usingBlock:(void (^)
+  (MGSMutableSubstring *substring, BOOL *stop))b;
+
 /** Returns a mutable substring mapped to the substring trailing the characters
  *  from the given character set.
  *  @param cs A character set. */
@@ -9,18 +9,46 @@
 #import "MGSMutableSubstring.h"
 
 
+@interface MGSMutableSubstring ()
+
+/** Returns a substring which, if defer is YES, does not apply its edits to
+ *  the superstring, but keeps them in a private copy of its contents. */
+- (instancetype)initWithRange:(NSRange)r ofSuperstring:(NSMutableString *)s
+  deferringEdits:(BOOL)defer;
+
+/** The range in the superstring this string was created with. */
+@property (readonly) NSRange originalRange;
+
+/** The contents of this string including its deferred edits, or nil if it
+ *  does not have deferred edits. */
+@property (readonly) NSString *deferredString;
+
+@end
+
+
 @implementation MGSMutableSubstring {
     NSMutableString *storage;
     NSRange range;
+    NSRange originalRange;
+    BOOL defer;
+    NSMutableString *pending;
+}
+
+
+- (instancetype)initWithRange:(NSRange)r ofSuperstring:(NSMutableString *)s
+{
+    return [self initWithRange:r ofSuperstring:s deferringEdits:NO];
 }
 
 
 - (instancetype)initWithRange:(NSRange)r ofSuperstring:(NSMutableString *)s
+  deferringEdits:(BOOL)d
 {
     self = [super init];
     
     storage = s;
-    range = r;
+    range = originalRange = r;
+    defer = d;
     
     if (NSMaxRange(range) > [storage length])
         [NSException raise:NSRangeException format:@"Attempted to create a "
@@ -47,6 +75,8 @@
     if (index >= range.length)
         [NSException raise:NSRangeException format:@"MGSMutableSubstring "
          " character at index %ld is out of bounds!", index];
+    if (pending)
+        return [pending characterAtIndex:index];
     return [storage characterAtIndex:range.location + index];
 }
 
@@ -70,6 +100,18 @@
 }
 
 
+- (NSRange)originalRange
+{
+    return originalRange;
+}
+
+
+- (NSString *)deferredString
+{
+    return pending;
+}
+
+
 - (void)getCharacters:(unichar *)buffer range:(NSRange)aRange
 {
     NSRange newRange;
@@ -79,7 +121,10 @@
         [NSException raise:NSRangeException format:@"Range %@ is out of "
          "bounds!", NSStringFromRange(aRange)];
     
-    [storage getCharacters:buffer range:newRange];
+    if (pending)
+        [pending getCharacters:buffer range:aRange];
+    else
+        [storage getCharacters:buffer range:newRange];
 }
 
 
@@ -94,7 +139,13 @@
          "bounds!", NSStringFromRange(aRange)];
     
     lengthDiff = aString.length - myRange.length;
-    [storage replaceCharactersInRange:myRange withString:aString];
+    if (defer) {
+        if (!pending)
+            pending = [[storage substringWithRange:range] mutableCopy];
+        [pending replaceCharactersInRange:aRange withString:aString];
+    } else {
+        [storage replaceCharactersInRange:myRange withString:aString];
+    }
     range.length += lengthDiff;
 }
 
@@ -108,33 +159,93 @@
 @end
 
 
+/* Applies the deferred edits of the substrings in the journal, which are
+ * sorted by location, in a single pass. */
+static void MGSApplySubstringJournal(NSMutableString *string, NSArray <MGSMutableSubstring *> *journal)
+{
+    NSMutableString *res;
+    NSUInteger pos, newLength;
+    NSRange orig;
+    
+    if (![journal count])
+        return;
+    if ([journal count] == 1) {
+        [string replaceCharactersInRange:[journal[0] originalRange] withString:[journal[0] deferredString]];
+        return;
+    }
+    
+    newLength = [string length];
+    for (MGSMutableSubstring *substr in journal)
+        newLength += [substr length] - [substr originalRange].length;
+    
+    res = [NSMutableString stringWithCapacity:newLength];
+    pos = 0;
+    for (MGSMutableSubstring *substr in journal) {
+        orig = [substr originalRange];
+        [res appendString:[string substringWithRange:NSMakeRange(pos, orig.location - pos)]];
+        [res appendString:[substr deferredString]];
+        pos = NSMaxRange(orig);
+    }
+    [res appendString:[string substringFromIndex:pos]];
+    [string setString:res];
+}
+
+
 @implementation NSMutableString (MutableSubstring)
 
 
 - (NSArray *)enumerateMutableSubstringsFromRangeArray:(NSArray*)a usingBlock:
   (void (^)(MGSMutableSubstring *substring, BOOL *stop))b
 {
+    return [self enumerateMutableSubstringsFromRangeArray:a options:0 usingBlock:b];
+}
+
+
+- (NSArray *)enumerateMutableSubstringsFromRangeArray:(NSArray*)a
+  options:(MGSMutableSubstringEnumerationOptions)opts usingBlock:
+  (void (^)(MGSMutableSubstring *substring, BOOL *stop))b
+{
+    BOOL defer = !!(opts & MGSMutableSubstringEnumerationDeferEdits);
+    NSMutableArray *journal;
     NSInteger offset;
+    NSUInteger lastEnd;
     NSMutableArray *output;
     NSValue *rangeval;
-    NSRange range;
+    NSRange range, outRange;
     MGSMutableSubstring *tmp;
     BOOL stop;
     
     output = [NSMutableArray array];
+    journal = [NSMutableArray array];
     offset = stop = 0;
+    lastEnd = 0;
     
     for (rangeval in a) {
         range = [rangeval rangeValue];
-        range.location += offset;
-        tmp = [MGSMutableSubstring substringInRange:range ofString:self];
+        if (defer) {
+            if (range.location < lastEnd)
+                [NSException raise:NSInvalidArgumentException format:@"Ranges "
+                 "must be sorted and not overlapping to defer the edits!"];
+            lastEnd = NSMaxRange(range);
+        } else {
+            range.location += offset;
+        }
+        tmp = [[MGSMutableSubstring alloc] initWithRange:range ofSuperstring:self deferringEdits:defer];
         b(tmp, &stop);
         
+        outRange = [tmp superstringRange];
+        if (defer) {
+            outRange.location += offset;
+            if ([tmp deferredString])
+                [journal addObject:tmp];
+        }
         offset += tmp.length - range.length;
-        [output addObject:[NSValue valueWithRange:[tmp superstringRange]]];
+        [output addObject:[NSValue valueWithRange:outRange]];
         
         if (stop) break;
     }
+    
+    MGSApplySubstringJournal(self, journal);
     return [output copy];
 }
 
@@ -142,6 +253,16 @@
 - (void)enumerateMutableSubstringsOfLinesUsingBlock:(void (^)
   (MGSMutableSubstring *substring, BOOL *stop))b
 {
+    [self enumerateMutableSubstringsOfLinesWithOptions:0 usingBlock:b];
+}
+
+
+- (void)enumerateMutableSubstringsOfLinesWithOptions:
+  (MGSMutableSubstringEnumerationOptions)opts usingBlock:(void (^)
+  (MGSMutableSubstring *substring, BOOL *stop))b
+{
+    BOOL defer = !!(opts & MGSMutableSubstringEnumerationDeferEdits);
+    NSMutableArray *journal;
     NSRange line;
     NSUInteger lineEnd;
     MGSMutableSubstring *tmp;
@@ -149,18 +270,31 @@
     
     stop = 0;
     line = NSMakeRange(0, 0);
+    journal = [NSMutableArray array];
     
     while (NSMaxRange(line) < [self length]) {
         [self getLineStart:NULL end:&lineEnd contentsEnd:NULL forRange:line];
         line.length = lineEnd - line.location;
         
-        tmp = [MGSMutableSubstring substringInRange:line ofString:self];
+        tmp = [[MGSMutableSubstring alloc] initWithRange:line ofSuperstring:self deferringEdits:defer];
         b(tmp, &stop);
-        if (stop) break;
         
-        line.location = NSMaxRange([tmp superstringRange]);
+        /* With deferred edits the superstring does not change, thus the next
+         * line starts where this line ended originally; this is the same
+         * place where the edited line ends when edits are not deferred. */
+        if (defer) {
+            if ([tmp deferredString])
+                [journal addObject:tmp];
+            line.location = lineEnd;
+        } else {
+            line.location = NSMaxRange([tmp superstringRange]);
+        }
         line.length = 0;
+        
+        if (stop) break;
     }
+    
+    MGSApplySubstringJournal(self, journal);
 }
 
 
@@ -0,0 +1,57 @@
+//
+//  MGSNumberLexer.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Foundation/Foundation.h>
+
+
+/** The syntax features of the number literals of a language. */
+typedef NS_OPTIONS(NSUInteger, MGSNumberDialect) {
+    /** Plain decimal numbers, like 12 and 1.5. Always enabled. */
+    MGSNumberDialectDecimal = 1 << 0,
+    /** Hexadecimal numbers with the 0x prefix, like 0x1F. */
+    MGSNumberDialectHexadecimal = 1 << 1,
+    /** Binary numbers with the 0b prefix, like 0b101. */
+    MGSNumberDialectBinary = 1 << 2,
+    /** Octal numbers with the 0o prefix, like 0o17. */
+    MGSNumberDialectOctal = 1 << 3,
+    /** Exponents, like 1e10 and 1.5E-3 (and 0x1p4, if hexadecimal numbers
+     *  are enabled). */
+    MGSNumberDialectExponent = 1 << 4,
+    /** Underscores between digits, like 1_000. */
+    MGSNumberDialectUnderscoreSeparator = 1 << 5,
+    /** Single quotes between digits, like 1'000. */
+    MGSNumberDialectQuoteSeparator = 1 << 6,
+    /** Alphanumeric suffixes, like 10UL, 1.5f or 10n. */
+    MGSNumberDialectSuffixes = 1 << 7,
+    /** Numbers starting with a decimal point, like .5 */
+    MGSNumberDialectLeadingDecimalPoint = 1 << 8
+};
+
+
+/** Returns the dialect described by a list of feature names, as found in
+ *  the numberDialect key of a classic syntax definition.
+ *  @param names An array of feature names; valid names are "hexadecimal",
+ *     "binary", "octal", "exponent", "underscoreSeparator",
+ *     "quoteSeparator", "suffixes" and "leadingDecimalPoint".
+ *  @param error Set to the first invalid name, if any.
+ *  @returns The dialect, or zero if a name is invalid. */
+MGSNumberDialect MGSNumberDialectFromNames(NSArray<NSString *> *names, NSString **error);
+
+/** Returns the length of the number literal which starts at the specified
+ *  index of a buffer of characters.
+ *  @discussion A decimal point is part of a number only when it is followed
+ *     by a digit; thus range operators like 1..5 and method calls like
+ *     1.description are never lexed as part of the number before them.
+ *     The sign of a number is not considered part of it.
+ *  @param chars The characters to scan.
+ *  @param i The index where the number literal starts.
+ *  @param len The number of characters in the buffer.
+ *  @param dialect The syntax of the number literals.
+ *  @returns The length of the number, or zero if there is no number at
+ *     index i. */
+NSUInteger MGSNumberLexerScan(const unichar *chars, NSUInteger i, NSUInteger len, MGSNumberDialect dialect);
@@ -0,0 +1,140 @@
+//
+//  MGSNumberLexer.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSNumberLexer.h"
+
+
+static BOOL MGSIsDigitOfRadix(unichar c, unsigned radix)
+{
+    if (c >= '0' && c <= '9')
+        return (unsigned)(c - '0') < radix;
+    c |= 0x20;
+    return radix == 16 && c >= 'a' && c <= 'f';
+}
+
+
+static BOOL MGSIsWordCharacter(unichar c)
+{
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || c == '_';
+}
+
+
+/* Returns the index of the first character after the run of digits which
+ * starts at i, including the separators found between two digits. */
+static NSUInteger MGSScanDigits(const unichar *s, NSUInteger i, NSUInteger len, unsigned radix, MGSNumberDialect d)
+{
+    unichar c;
+    
+    while (i < len) {
+        c = s[i];
+        if (MGSIsDigitOfRadix(c, radix)) {
+            i++;
+        } else if (((c == '_' && (d & MGSNumberDialectUnderscoreSeparator)) || (c == '\'' && (d & MGSNumberDialectQuoteSeparator)))
+            && i > 0 && MGSIsDigitOfRadix(s[i-1], radix) && i + 1 < len && MGSIsDigitOfRadix(s[i+1], radix)) {
+            i += 2;
+        } else {
+            break;
+        }
+    }
+    return i;
+}
+
+
+/* Returns the index of the first character after the exponent which starts
+ * at i, or i if there is no exponent. */
+static NSUInteger MGSScanExponent(const unichar *s, NSUInteger i, NSUInteger len, unichar marker, MGSNumberDialect d)
+{
+    NSUInteger j = i + 1;
+    
+    if (!(d & MGSNumberDialectExponent) || i >= len || (s[i] | 0x20) != marker)
+        return i;
+    if (j < len && (s[j] == '+' || s[j] == '-'))
+        j++;
+    if (j >= len || !MGSIsDigitOfRadix(s[j], 10))
+        return i;
+    return MGSScanDigits(s, j, len, 10, d);
+}
+
+
+MGSNumberDialect MGSNumberDialectFromNames(NSArray<NSString *> *names, NSString **error)
+{
+    static NSDictionary<NSString *, NSNumber *> *features;
+    static dispatch_once_t onceToken;
+    MGSNumberDialect res = MGSNumberDialectDecimal;
+    NSNumber *f;
+    
+    dispatch_once(&onceToken, ^{
+        features = @{
+            @"hexadecimal": @(MGSNumberDialectHexadecimal),
+            @"binary": @(MGSNumberDialectBinary),
+            @"octal": @(MGSNumberDialectOctal),
+            @"exponent": @(MGSNumberDialectExponent),
+            @"underscoreSeparator": @(MGSNumberDialectUnderscoreSeparator),
+            @"quoteSeparator": @(MGSNumberDialectQuoteSeparator),
+            @"suffixes": @(MGSNumberDialectSuffixes),
+            @"leadingDecimalPoint": @(MGSNumberDialectLeadingDecimalPoint)};
+    });
+    
+    for (NSString *name in names) {
+        f = [name isKindOfClass:[NSString class]] ? features[name] : nil;
+        if (!f) {
+            if (error)
+                *error = [name description];
+            return 0;
+        }
+        res |= f.unsignedIntegerValue;
+    }
+    return res;
+}
+
+
+NSUInteger MGSNumberLexerScan(const unichar *s, NSUInteger i, NSUInteger len, MGSNumberDialect d)
+{
+    NSUInteger start = i, j;
+    unsigned radix = 10;
+    unichar c;
+    
+    if (i >= len)
+        return 0;
+    
+    /* Prefixed integers */
+    if (s[i] == '0' && i + 1 < len) {
+        c = s[i+1] | 0x20;
+        if (c == 'x' && (d & MGSNumberDialectHexadecimal))
+            radix = 16;
+        else if (c == 'b' && (d & MGSNumberDialectBinary))
+            radix = 2;
+        else if (c == 'o' && (d & MGSNumberDialectOctal))
+            radix = 8;
+        if (radix != 10) {
+            j = MGSScanDigits(s, i + 2, len, radix, d);
+            if (j > i + 2) {
+                i = j;
+                if (radix == 16)
+                    i = MGSScanExponent(s, i, len, 'p', d);
+                goto suffix;
+            }
+        }
+    }
+    
+    /* Decimal numbers */
+    i = MGSScanDigits(s, i, len, 10, d);
+    if (i == start && !(d & MGSNumberDialectLeadingDecimalPoint))
+        return 0;
+    if (i < len && s[i] == '.' && i + 1 < len && MGSIsDigitOfRadix(s[i+1], 10))
+        i = MGSScanDigits(s, i + 1, len, 10, d);
+    if (i == start)
+        return 0;
+    i = MGSScanExponent(s, i, len, 'e', d);
+    
+suffix:
+    if (d & MGSNumberDialectSuffixes) {
+        while (i < len && MGSIsWordCharacter(s[i]))
+            i++;
+    }
+    return i - start;
+}
@@ -0,0 +1,72 @@
+//
+//  MGSOccurrenceHighlighter.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class MGSTextView;
+
+
+/** Highlights all the occurrences of the word which is selected, or which
+ *  contains the insertion point, in a MGSTextView.
+ *
+ *  The occurrences are looked for only in the visible part of the text plus
+ *  a margin, after the selection has stopped changing for a short delay.
+ *  The parts of the text which have been searched and the occurrences found
+ *  are cached for each word, and the search is extended to the parts of
+ *  the text which become visible when the text view is scrolled.
+ *
+ *  The occurrences are highlighted with a colour set as the
+ *  MGSHighlightColourAttributeName temporary attribute of the layout
+ *  manager of the text view, so that they do not replace the background
+ *  colour of the lines with syntax errors. */
+@interface MGSOccurrenceHighlighter : NSObject
+
+
+/** Initializes an occurrence highlighter for a text view.
+ *  @param textView The text view. */
+- (instancetype)initWithTextView:(MGSTextView *)textView;
+
+/** The text view where the occurrences are highlighted. */
+@property (nonatomic, weak, readonly) MGSTextView *textView;
+
+
+/** Set to YES to highlight the occurrences of the selected word. */
+@property (nonatomic) BOOL enabled;
+
+/** The background colour of the occurrences. */
+@property (nonatomic, strong) NSColor *highlightColour;
+
+/** How long the selection must stay the same before the occurrences of the
+ *  selected word are highlighted, in seconds. */
+@property (nonatomic) NSTimeInterval delay;
+
+/** The word whose occurrences are highlighted, or nil if there is none. */
+@property (nonatomic, readonly, nullable) NSString *word;
+
+
+/** Informs the occurrence highlighter that the selection of the text view
+ *  has changed. The highlighted word is updated after the delay. */
+- (void)selectionDidChange;
+
+/** Informs the occurrence highlighter that a part of the text view has
+ *  been drawn. If the visible part of the text has not been searched yet,
+ *  the search is extended to it as soon as the drawing ends.
+ *  @param rect The rectangle which has been drawn. */
+- (void)textViewDidDrawRect:(NSRect)rect;
+
+/** Updates the highlighted word immediately, without waiting for the
+ *  delay. */
+- (void)updateWord;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,361 @@
+//
+//  MGSOccurrenceHighlighter.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSOccurrenceHighlighter.h"
+#import "MGSTextView.h"
+#import "MGSTextViewPrivate.h"
+#import "MGSLineGeometry.h"
+#import "MGSLayoutManager.h"
+
+
+/* Maximum number of words whose occurrences are cached. */
+#define MGSOccurrenceCacheSize  (8)
+
+
+/* The parts of the text searched for a word, and the locations of the
+ * occurrences found there. */
+@interface MGSOccurrenceCacheEntry : NSObject
+
+@property (nonatomic, readonly) NSMutableIndexSet *searched;
+@property (nonatomic, readonly) NSMutableIndexSet *locations;
+
+@end
+
+
+@implementation MGSOccurrenceCacheEntry
+
+
+- (instancetype)init
+{
+    self = [super init];
+    _searched = [NSMutableIndexSet indexSet];
+    _locations = [NSMutableIndexSet indexSet];
+    return self;
+}
+
+
+@end
+
+
+@implementation MGSOccurrenceHighlighter
+{
+    NSTimer *_updateTimer;
+    NSCharacterSet *_wordCharacters;
+    NSMutableDictionary<NSString *, MGSOccurrenceCacheEntry *> *_cache;
+    BOOL _extensionIsPending;
+}
+
+
+#pragma mark - Initialization
+
+
+- (instancetype)initWithTextView:(MGSTextView *)textView
+{
+    NSMutableCharacterSet *wc;
+    
+    self = [super init];
+    
+    _textView = textView;
+    _delay = 0.25;
+    _highlightColour = [[NSColor yellowColor] colorWithAlphaComponent:0.35];
+    _cache = [NSMutableDictionary dictionary];
+    
+    wc = [[NSCharacterSet alphanumericCharacterSet] mutableCopy];
+    [wc addCharactersInString:@"_"];
+    _wordCharacters = [wc copy];
+    
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(textStorageDidProcessEditing:) name:NSTextStorageDidProcessEditingNotification object:nil];
+    
+    return self;
+}
+
+
+- (void)dealloc
+{
+    [_updateTimer invalidate];
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+
+#pragma mark - Properties
+
+
+- (void)setEnabled:(BOOL)enabled
+{
+    _enabled = enabled;
+    [self updateWord];
+}
+
+
+- (void)setHighlightColour:(NSColor *)highlightColour
+{
+    _highlightColour = highlightColour;
+    if (_word) {
+        [self removeHighlights];
+        [self addHighlightsOfLocations:_cache[_word].locations];
+    }
+}
+
+
+#pragma mark - Tracking the Selection
+
+
+- (void)selectionDidChange
+{
+    if (!_enabled)
+        return;
+    if (!_updateTimer) {
+        _updateTimer = [NSTimer scheduledTimerWithTimeInterval:self.delay
+          target:self selector:@selector(updateTimerSelector:)
+          userInfo:nil repeats:NO];
+    }
+    [_updateTimer setFireDate:[NSDate dateWithTimeIntervalSinceNow:self.delay]];
+}
+
+
+- (void)updateTimerSelector:(NSTimer *)timer
+{
+    _updateTimer = nil;
+    [self updateWord];
+}
+
+
+- (void)updateWord
+{
+    NSString *word = _enabled ? [self selectedWord] : nil;
+    
+    [_updateTimer invalidate];
+    _updateTimer = nil;
+    
+    if (word == _word || [word isEqual:_word]) {
+        [self extendSearch];
+        return;
+    }
+    
+    [self removeHighlights];
+    _word = word;
+    if (!word)
+        return;
+    
+    if (!_cache[word]) {
+        if (_cache.count >= MGSOccurrenceCacheSize)
+            [_cache removeAllObjects];
+        _cache[word] = [[MGSOccurrenceCacheEntry alloc] init];
+    } else {
+        [self addHighlightsOfLocations:_cache[word].locations];
+    }
+    [self extendSearch];
+}
+
+
+/* Returns the word which is selected, or which contains the insertion
+ * point. */
+- (NSString *)selectedWord
+{
+    NSString *string = self.textView.string;
+    NSArray *sel = self.textView.selectedRanges;
+    NSRange range;
+    NSUInteger i;
+    
+    if (sel.count != 1)
+        return nil;
+    range = [sel[0] rangeValue];
+    
+    if (range.length > 0) {
+        for (i = range.location; i < NSMaxRange(range); i++) {
+            if (![_wordCharacters characterIsMember:[string characterAtIndex:i]])
+                return nil;
+        }
+    } else {
+        while (range.location > 0 && [_wordCharacters characterIsMember:[string characterAtIndex:range.location - 1]]) {
+            range.location--;
+            range.length++;
+        }
+        while (NSMaxRange(range) < string.length && [_wordCharacters characterIsMember:[string characterAtIndex:NSMaxRange(range)]])
+            range.length++;
+        if (range.length == 0)
+            return nil;
+    }
+    return [string substringWithRange:range];
+}
+
+
+#pragma mark - Searching
+
+
+- (void)textViewDidDrawRect:(NSRect)rect
+{
+    MGSOccurrenceHighlighter * __weak weakSelf = self;
+    
+    if (!_word || _extensionIsPending)
+        return;
+    if ([_cache[_word].searched containsIndexesInRange:[self searchRange]])
+        return;
+    
+    /* Temporary attributes cannot be changed while drawing */
+    _extensionIsPending = YES;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        MGSOccurrenceHighlighter *oh = weakSelf;
+        if (!oh)
+            return;
+        oh->_extensionIsPending = NO;
+        [oh extendSearch];
+    });
+}
+
+
+/* Returns the range of the lines which are visible, plus the lines in the
+ * height of a screenful above and below them. */
+- (NSRange)searchRange
+{
+    MGSTextView *tv = self.textView;
+    NSRect rect = tv.visibleRect;
+    
+    rect = NSInsetRect(rect, 0, -NSHeight(rect));
+    return [tv.lineGeometry characterRangeForRect:rect];
+}
+
+
+/* Searches the occurrences of the word in the part of the search range
+ * which has not been searched yet, and highlights them. */
+- (void)extendSearch
+{
+    NSString *string = self.textView.string;
+    MGSOccurrenceCacheEntry *entry = _cache[_word];
+    NSRange range = [self searchRange];
+    NSMutableIndexSet *todo, *found;
+    NSString *word = _word;
+    NSUInteger wlen = word.length, len = string.length;
+    NSCharacterSet *wc = _wordCharacters;
+    
+    if (!entry)
+        return;
+    
+    todo = [NSMutableIndexSet indexSetWithIndexesInRange:range];
+    [todo removeIndexes:entry.searched];
+    found = [NSMutableIndexSet indexSet];
+    
+    [todo enumerateRangesUsingBlock:^(NSRange r, BOOL *stop) {
+        /* Occurrences must start in r, but they can end after it */
+        NSRange scan = NSMakeRange(r.location, MIN(NSMaxRange(r) + wlen, len) - r.location);
+        NSRange occ;
+        
+        while (scan.length >= wlen) {
+            occ = [string rangeOfString:word options:NSLiteralSearch range:scan];
+            if (occ.location == NSNotFound || occ.location >= NSMaxRange(r))
+                break;
+            
+            /* Only whole words are occurrences */
+            if ((occ.location == 0 || ![wc characterIsMember:[string characterAtIndex:occ.location - 1]]) &&
+                (NSMaxRange(occ) == len || ![wc characterIsMember:[string characterAtIndex:NSMaxRange(occ)]]))
+                [found addIndex:occ.location];
+            
+            scan = NSMakeRange(NSMaxRange(occ), NSMaxRange(scan) - NSMaxRange(occ));
+        }
+    }];
+    
+    [entry.searched addIndexesInRange:range];
+    [entry.locations addIndexes:found];
+    [self addHighlightsOfLocations:found];
+}
+
+
+#pragma mark - Highlighting
+
+
+- (void)addHighlightsOfLocations:(NSIndexSet *)locations
+{
+    NSLayoutManager *lm = self.textView.layoutManager;
+    NSUInteger wlen = _word.length, len = lm.textStorage.length;
+    NSColor *colour = self.highlightColour;
+    
+    [locations enumerateIndexesUsingBlock:^(NSUInteger i, BOOL *stop) {
+        if (i + wlen > len) {
+            *stop = YES;
+            return;
+        }
+        [lm addTemporaryAttribute:MGSHighlightColourAttributeName value:colour forCharacterRange:NSMakeRange(i, wlen)];
+    }];
+}
+
+
+- (void)removeHighlights
+{
+    NSLayoutManager *lm = self.textView.layoutManager;
+    NSUInteger wlen = _word.length, len = lm.textStorage.length;
+    
+    if (!_word)
+        return;
+    [_cache[_word].locations enumerateIndexesUsingBlock:^(NSUInteger i, BOOL *stop) {
+        if (i >= len) {
+            *stop = YES;
+            return;
+        }
+        [lm removeTemporaryAttribute:MGSHighlightColourAttributeName forCharacterRange:NSMakeRange(i, MIN(wlen, len - i))];
+    }];
+}
+
+
+#pragma mark - Tracking Edits
+
+
+- (void)textStorageDidProcessEditing:(NSNotification *)notification
+{
+    NSTextStorage *ts = notification.object;
+    MGSOccurrenceCacheEntry *entry;
+    NSRange edited, lines, oldLines;
+    NSInteger delta;
+    
+    if (ts != self.textView.textStorage || !(ts.editedMask & NSTextStorageEditedCharacters))
+        return;
+    
+    /* Only the occurrences of the current word are kept up to date */
+    entry = _word ? _cache[_word] : nil;
+    [_cache removeAllObjects];
+    if (!entry)
+        return;
+    _cache[_word] = entry;
+    
+    edited = ts.editedRange;
+    delta = ts.changeInLength;
+    lines = [ts.string lineRangeForRange:edited];
+    oldLines = NSMakeRange(lines.location, lines.length - delta);
+    
+    /* Forget the edited lines, and move what follows them */
+    [entry.searched removeIndexesInRange:oldLines];
+    [entry.searched shiftIndexesStartingAtIndex:NSMaxRange(oldLines) by:delta];
+    [entry.locations removeIndexesInRange:oldLines];
+    [entry.locations shiftIndexesStartingAtIndex:NSMaxRange(oldLines) by:delta];
+    
+    /* The layout manager moves the temporary attributes with the text, but
+     * the highlights of an edited occurrence are now wrong. The layout
+     * manager has not processed the edit yet, so wait until it has. */
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [self refreshHighlightsInRange:lines];
+    });
+    
+    [self selectionDidChange];
+}
+
+
+- (void)refreshHighlightsInRange:(NSRange)range
+{
+    NSLayoutManager *lm = self.textView.layoutManager;
+    NSIndexSet *locations = _word ? _cache[_word].locations : nil;
+    NSMutableIndexSet *keep = [NSMutableIndexSet indexSet];
+    
+    range = NSIntersectionRange(range, NSMakeRange(0, lm.textStorage.length));
+    [lm removeTemporaryAttribute:MGSHighlightColourAttributeName forCharacterRange:range];
+    
+    [locations enumerateIndexesInRange:range options:0 usingBlock:^(NSUInteger i, BOOL *stop) {
+        [keep addIndex:i];
+    }];
+    [self addHighlightsOfLocations:keep];
+}
+
+
+@end
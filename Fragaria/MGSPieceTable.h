@@ -0,0 +1,55 @@
+//
+//  MGSPieceTable.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/** A mutable sequence of characters stored as a piece table.
+ *
+ *  The text is represented as a sequence of pieces, each referencing a part
+ *  of a buffer of characters which is never modified after being written.
+ *  The pieces are kept in a persistent balanced tree (a treap), so that
+ *  replacing characters at any position takes O(log n) time, and the state
+ *  of the text at any point in time can be kept around for free. */
+@interface MGSPieceTable : NSObject
+
+
+/** Initializes a piece table containing the specified text.
+ *  @param string The initial text. */
+- (instancetype)initWithString:(NSString *)string NS_DESIGNATED_INITIALIZER;
+
+
+/** The number of characters in the piece table. */
+@property (nonatomic, readonly) NSUInteger length;
+
+/** Replaces a range of characters.
+ *  @param range The range of characters to replace.
+ *  @param str The replacement string. */
+- (void)replaceCharactersInRange:(NSRange)range withString:(NSString *)str;
+
+
+/** Returns a string which always reflects the current contents of this
+ *  piece table.
+ *  @discussion Like the string of a NSTextStorage, the returned object
+ *     changes when the piece table is modified. Copying it returns a
+ *     snapshot. */
+- (NSString *)string;
+
+/** Returns an immutable string containing the current contents of this piece
+ *  table.
+ *  @discussion This method runs in constant time, and the returned string
+ *     can be read from any thread. */
+- (NSString *)snapshot;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,421 @@
+//
+//  MGSPieceTable.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSPieceTable.h"
+#import "NSString+Fragaria.h"
+
+
+/* Minimum capacity (in characters) of the buffers holding inserted text */
+#define MGSPieceBufferMinimumCapacity   (65536)
+
+
+/* A buffer of characters referenced by the pieces. Characters are only
+ * appended past the used part of a buffer, thus the characters referenced
+ * by a piece never change and pieces can be shared by different versions of
+ * the text, even across threads. */
+@interface MGSPieceBuffer : NSObject
+{
+    @public
+    unichar *chars;
+    NSUInteger capacity;
+    NSUInteger used;
+}
+
+@end
+
+
+@implementation MGSPieceBuffer
+
+
+- (instancetype)initWithCapacity:(NSUInteger)c
+{
+    self = [super init];
+    chars = malloc(MAX(c, 1) * sizeof(unichar));
+    if (!chars)
+        [NSException raise:NSMallocException format:@"Cannot allocate a buffer of %lu characters", (unsigned long)c];
+    capacity = c;
+    used = 0;
+    return self;
+}
+
+
+- (void)dealloc
+{
+    free(chars);
+}
+
+
+@end
+
+
+/* A node of the treap of pieces. Nodes are never modified after they are
+ * created: every edit creates new copies of the nodes along the paths it
+ * touches, so that the old root is still a valid version of the text. */
+@interface MGSPieceNode : NSObject
+{
+    @public
+    MGSPieceBuffer *buffer;
+    NSUInteger offset;
+    NSUInteger length;
+    /* Length of the text in the subtree rooted at this node */
+    NSUInteger total;
+    uint32_t priority;
+    MGSPieceNode *left;
+    MGSPieceNode *right;
+}
+
+@end
+
+
+@implementation MGSPieceNode
+
+@end
+
+
+static NSUInteger MGSPieceTotal(MGSPieceNode *n)
+{
+    return n ? n->total : 0;
+}
+
+
+static MGSPieceNode *MGSPieceNodeMake(MGSPieceBuffer *buffer, NSUInteger offset, NSUInteger length, uint32_t priority, MGSPieceNode *left, MGSPieceNode *right)
+{
+    MGSPieceNode *n = [[MGSPieceNode alloc] init];
+    
+    n->buffer = buffer;
+    n->offset = offset;
+    n->length = length;
+    n->priority = priority;
+    n->left = left;
+    n->right = right;
+    n->total = length + MGSPieceTotal(left) + MGSPieceTotal(right);
+    return n;
+}
+
+
+static MGSPieceNode *MGSPieceNodeWithChildren(MGSPieceNode *n, MGSPieceNode *left, MGSPieceNode *right)
+{
+    return MGSPieceNodeMake(n->buffer, n->offset, n->length, n->priority, left, right);
+}
+
+
+/* Splits a tree in the trees containing the text before and after the
+ * specified position. */
+static void MGSPieceSplit(MGSPieceNode *n, NSUInteger pos, MGSPieceNode * __strong *l, MGSPieceNode * __strong *r)
+{
+    MGSPieceNode *a, *b;
+    NSUInteger lt, k;
+    
+    if (!n || pos == 0) {
+        *l = nil;
+        *r = n;
+        return;
+    }
+    if (pos >= n->total) {
+        *l = n;
+        *r = nil;
+        return;
+    }
+    
+    lt = MGSPieceTotal(n->left);
+    if (pos <= lt) {
+        MGSPieceSplit(n->left, pos, &a, &b);
+        *l = a;
+        *r = MGSPieceNodeWithChildren(n, b, n->right);
+    } else if (pos >= lt + n->length) {
+        MGSPieceSplit(n->right, pos - lt - n->length, &a, &b);
+        *l = MGSPieceNodeWithChildren(n, n->left, a);
+        *r = b;
+    } else {
+        k = pos - lt;
+        *l = MGSPieceNodeMake(n->buffer, n->offset, k, n->priority, n->left, nil);
+        *r = MGSPieceNodeMake(n->buffer, n->offset + k, n->length - k, n->priority, nil, n->right);
+    }
+}
+
+
+/* Concatenates two trees. */
+static MGSPieceNode *MGSPieceMerge(MGSPieceNode *a, MGSPieceNode *b)
+{
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+    if (a->priority >= b->priority)
+        return MGSPieceNodeWithChildren(a, a->left, MGSPieceMerge(a->right, b));
+    return MGSPieceNodeWithChildren(b, MGSPieceMerge(a, b->left), b->right);
+}
+
+
+/* Returns a copy of the tree where the piece ending at the specified position
+ * is longer by count characters, or nil if that piece does not end exactly
+ * where the used part of the buffer ends. This keeps the amount of pieces
+ * low while typing. */
+static MGSPieceNode *MGSPieceExtend(MGSPieceNode *n, NSUInteger pos, MGSPieceBuffer *buffer, NSUInteger count)
+{
+    MGSPieceNode *sub;
+    NSUInteger lt, end;
+    
+    if (!n)
+        return nil;
+    
+    lt = MGSPieceTotal(n->left);
+    end = lt + n->length;
+    if (pos <= lt) {
+        sub = MGSPieceExtend(n->left, pos, buffer, count);
+        return sub ? MGSPieceNodeWithChildren(n, sub, n->right) : nil;
+    } else if (pos > end) {
+        sub = MGSPieceExtend(n->right, pos - end, buffer, count);
+        return sub ? MGSPieceNodeWithChildren(n, n->left, sub) : nil;
+    } else if (pos == end && n->buffer == buffer && n->offset + n->length == buffer->used) {
+        return MGSPieceNodeMake(n->buffer, n->offset, n->length + count, n->priority, n->left, n->right);
+    }
+    return nil;
+}
+
+
+/* Returns the node containing the character at index i, and the index of its
+ * first character in the text. */
+static MGSPieceNode *MGSPieceAtIndex(MGSPieceNode *n, NSUInteger i, NSUInteger *start)
+{
+    NSUInteger base = 0, lt;
+    
+    while (n) {
+        lt = MGSPieceTotal(n->left);
+        if (i < base + lt) {
+            n = n->left;
+        } else if (i < base + lt + n->length) {
+            *start = base + lt;
+            return n;
+        } else {
+            base += lt + n->length;
+            n = n->right;
+        }
+    }
+    return nil;
+}
+
+
+/* Calls the block for each piece intersecting the specified range, in
+ * order. Returns NO if the enumeration was stopped by the block. */
+static BOOL MGSPieceEnumerate(MGSPieceNode *n, NSUInteger base, NSRange range, void (^block)(const unichar *chars, NSRange chunkRange, BOOL *stop))
+{
+    NSUInteger start, lt;
+    NSRange isect;
+    BOOL stop = NO;
+    
+    if (!n)
+        return YES;
+    
+    lt = MGSPieceTotal(n->left);
+    start = base + lt;
+    if (range.location < start)
+        if (!MGSPieceEnumerate(n->left, base, range, block))
+            return NO;
+    
+    isect = NSIntersectionRange(range, NSMakeRange(start, n->length));
+    if (isect.length > 0) {
+        block(n->buffer->chars + n->offset + (isect.location - start), isect, &stop);
+        if (stop)
+            return NO;
+    }
+    
+    if (NSMaxRange(range) > start + n->length)
+        return MGSPieceEnumerate(n->right, start + n->length, range, block);
+    return YES;
+}
+
+
+#pragma mark - Strings
+
+
+@interface MGSPieceTable ()
+
+@property (nonatomic, readonly) MGSPieceNode *root;
+
+@end
+
+
+/* An immutable string backed by a tree of pieces, or a string reflecting the
+ * current contents of a piece table. */
+@interface MGSPieceTableString : NSString
+
+- (instancetype)initWithPieceTable:(MGSPieceTable *)table;
+- (instancetype)initWithRoot:(MGSPieceNode *)root;
+
+@end
+
+
+@implementation MGSPieceTableString
+{
+    MGSPieceTable *table;
+    MGSPieceNode *frozenRoot;
+}
+
+
+- (instancetype)initWithPieceTable:(MGSPieceTable *)t
+{
+    self = [super init];
+    table = t;
+    return self;
+}
+
+
+- (instancetype)initWithRoot:(MGSPieceNode *)root
+{
+    self = [super init];
+    frozenRoot = root;
+    return self;
+}
+
+
+- (MGSPieceNode *)root
+{
+    return table ? table.root : frozenRoot;
+}
+
+
+- (NSUInteger)length
+{
+    return MGSPieceTotal([self root]);
+}
+
+
+- (unichar)characterAtIndex:(NSUInteger)index
+{
+    MGSPieceNode *n;
+    NSUInteger start;
+    
+    n = MGSPieceAtIndex([self root], index, &start);
+    if (!n)
+        [NSException raise:NSRangeException format:@"Index %lu out of bounds", (unsigned long)index];
+    return n->buffer->chars[n->offset + (index - start)];
+}
+
+
+- (void)getCharacters:(unichar *)buffer range:(NSRange)range
+{
+    MGSPieceNode *root = [self root];
+    
+    if (NSMaxRange(range) > MGSPieceTotal(root))
+        [NSException raise:NSRangeException format:@"Range %@ out of bounds", NSStringFromRange(range)];
+    MGSPieceEnumerate(root, 0, range, ^(const unichar *chars, NSRange chunkRange, BOOL *stop) {
+        memcpy(buffer + (chunkRange.location - range.location), chars, chunkRange.length * sizeof(unichar));
+    });
+}
+
+
+- (void)mgs_enumerateCharacterChunksInRange:(NSRange)range usingBlock:(void (^)(const unichar *chars, NSRange chunkRange, BOOL *stop))block
+{
+    MGSPieceNode *root = [self root];
+    
+    if (NSMaxRange(range) > MGSPieceTotal(root))
+        [NSException raise:NSRangeException format:@"Range %@ out of bounds", NSStringFromRange(range)];
+    MGSPieceEnumerate(root, 0, range, block);
+}
+
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    if (!table)
+        return self;
+    return [[MGSPieceTableString alloc] initWithRoot:table.root];
+}
+
+
+@end
+
+
+#pragma mark - Piece table
+
+
+@implementation MGSPieceTable
+{
+    MGSPieceBuffer *addBuffer;
+}
+
+
+- (instancetype)init
+{
+    return [self initWithString:@""];
+}
+
+
+- (instancetype)initWithString:(NSString *)string
+{
+    MGSPieceBuffer *original;
+    NSUInteger len = string.length;
+    
+    self = [super init];
+    
+    if (len > 0) {
+        original = [[MGSPieceBuffer alloc] initWithCapacity:len];
+        [string getCharacters:original->chars range:NSMakeRange(0, len)];
+        original->used = len;
+        _root = MGSPieceNodeMake(original, 0, len, arc4random(), nil, nil);
+    }
+    
+    return self;
+}
+
+
+- (NSUInteger)length
+{
+    return MGSPieceTotal(_root);
+}
+
+
+- (void)replaceCharactersInRange:(NSRange)range withString:(NSString *)str
+{
+    MGSPieceNode *l, *m, *r, *ext;
+    NSUInteger len = str.length;
+    NSUInteger offset;
+    
+    if (NSMaxRange(range) > self.length)
+        [NSException raise:NSRangeException format:@"Range %@ out of bounds", NSStringFromRange(range)];
+    
+    /* Remove the replaced characters */
+    if (range.length > 0) {
+        MGSPieceSplit(_root, range.location, &l, &r);
+        MGSPieceSplit(r, range.length, &m, &r);
+        _root = MGSPieceMerge(l, r);
+    }
+    if (len == 0)
+        return;
+    
+    /* Append the new characters to the current buffer if they fit, otherwise
+     * start a new one. */
+    if (!addBuffer || addBuffer->capacity - addBuffer->used < len)
+        addBuffer = [[MGSPieceBuffer alloc] initWithCapacity:MAX(len, MGSPieceBufferMinimumCapacity)];
+    offset = addBuffer->used;
+    [str getCharacters:addBuffer->chars + offset range:NSMakeRange(0, len)];
+    
+    ext = MGSPieceExtend(_root, range.location, addBuffer, len);
+    if (ext) {
+        _root = ext;
+    } else {
+        MGSPieceSplit(_root, range.location, &l, &r);
+        m = MGSPieceNodeMake(addBuffer, offset, len, arc4random(), nil, nil);
+        _root = MGSPieceMerge(MGSPieceMerge(l, m), r);
+    }
+    addBuffer->used += len;
+}
+
+
+- (NSString *)string
+{
+    return [[MGSPieceTableString alloc] initWithPieceTable:self];
+}
+
+
+- (NSString *)snapshot
+{
+    return [[MGSPieceTableString alloc] initWithRoot:_root];
+}
+
+
+@end
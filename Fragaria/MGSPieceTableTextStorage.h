@@ -0,0 +1,45 @@
+//
+//  MGSPieceTableTextStorage.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/** A text storage optimized for very large documents.
+ *
+ *  The text of a MGSPieceTableTextStorage is kept in a piece table instead
+ *  of a contiguous buffer, thus inserting or deleting characters anywhere
+ *  in the text takes O(log n) time instead of moving all the following
+ *  characters in memory.
+ *
+ *  To use a MGSPieceTableTextStorage in a MGSFragariaView, pass it to
+ *  -[MGSFragariaView replaceTextStorage:].
+ *
+ *  Fragaria's line index reads the text of a MGSPieceTableTextStorage
+ *  directly from the pieces, without copying it. */
+@interface MGSPieceTableTextStorage : NSTextStorage
+
+
+/** Initializes a text storage with the specified text and attributes.
+ *  @param str The initial text.
+ *  @param attrs The attributes of the initial text. */
+- (instancetype)initWithString:(NSString *)str attributes:(nullable NSDictionary<NSAttributedStringKey, id> *)attrs;
+
+
+/** Returns an immutable copy of the text of this text storage.
+ *  @discussion This method takes constant time, regardless of the length of
+ *     the text. The returned string does not change when the text storage is
+ *     edited, and it can be read from any thread. Copying the string
+ *     returned by the string property has the same effect. */
+- (NSString *)stringSnapshot;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
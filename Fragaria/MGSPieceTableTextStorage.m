@@ -0,0 +1,128 @@
+//
+//  MGSPieceTableTextStorage.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSPieceTableTextStorage.h"
+#import "MGSPieceTable.h"
+#import "MGSRangeEntries.h"
+
+
+@implementation MGSPieceTableTextStorage
+{
+    MGSPieceTable *pieceTable;
+    NSString *liveString;
+    /* Attributes are stored as runs. The backing text storage of a Fragaria
+     * view does not contain the syntax colouring (which is stored in the
+     * overlay text storage), thus the runs are usually very few. */
+    MGSRangeEntries *attributeRanges;
+}
+
+
+- (instancetype)init
+{
+    return [self initWithString:@"" attributes:nil];
+}
+
+
+- (instancetype)initWithString:(NSString *)str
+{
+    return [self initWithString:str attributes:nil];
+}
+
+
+- (instancetype)initWithString:(NSString *)str attributes:(NSDictionary<NSAttributedStringKey, id> *)attrs
+{
+    self = [super init];
+    
+    pieceTable = [[MGSPieceTable alloc] initWithString:str];
+    liveString = [pieceTable string];
+    attributeRanges = MGSCreateRangeToCopiedObjectEntries(0);
+    MGSRangeEntryInsert(attributeRanges, NSMakeRange(0, str.length), attrs ? attrs : @{});
+    
+    return self;
+}
+
+
+- (instancetype)initWithAttributedString:(NSAttributedString *)attrStr
+{
+    self = [self initWithString:attrStr.string attributes:nil];
+    
+    [attrStr enumerateAttributesInRange:NSMakeRange(0, attrStr.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey, id> *attrs, NSRange range, BOOL *stop) {
+        MGSRangeEntriesDivideAndConquer(self->attributeRanges, range);
+        MGSRangeEntryInsert(self->attributeRanges, range, attrs);
+    }];
+    
+    return self;
+}
+
+
+- (void)dealloc
+{
+    MGSFreeRangeEntries(attributeRanges);
+}
+
+
+#pragma mark - Primitive methods
+
+
+- (NSString *)string
+{
+    return liveString;
+}
+
+
+- (NSString *)stringSnapshot
+{
+    return [pieceTable snapshot];
+}
+
+
+- (NSDictionary *)attributesAtIndex:(NSUInteger)location effectiveRange:(NSRangePointer)range
+{
+    NSRange myRange;
+    NSDictionary *attrib = MGSRangeEntryAtIndex(attributeRanges, location, &myRange);
+    
+    if (!attrib)
+        attrib = @{};
+    if (range) {
+        if (myRange.length == NSNotFound)
+            myRange.length = self.length - myRange.location;
+        *range = myRange;
+    }
+    return attrib;
+}
+
+
+- (void)replaceCharactersInRange:(NSRange)range withString:(NSString *)str
+{
+    NSInteger delta = (NSInteger)str.length - (NSInteger)range.length;
+    
+    [pieceTable replaceCharactersInRange:range withString:str];
+    MGSRangeEntriesExpandAndWipe(attributeRanges, range, delta);
+    if (MGSCountRangeEntries(attributeRanges) == 0)
+        MGSRangeEntryInsert(attributeRanges, NSMakeRange(0, pieceTable.length), @{});
+    [self edited:NSTextStorageEditedCharacters range:range changeInLength:delta];
+}
+
+
+- (void)setAttributes:(NSDictionary *)attrs range:(NSRange)range
+{
+    if (!attrs)
+        attrs = @{};
+    
+    if (pieceTable.length == 0) {
+        MGSResetRangeEntries(attributeRanges);
+        MGSRangeEntryInsert(attributeRanges, range, attrs);
+    } else if (range.length > 0) {
+        MGSRangeEntriesDivideAndConquer(attributeRanges, range);
+        MGSRangeEntryInsert(attributeRanges, range, attrs);
+    }
+    
+    [self edited:NSTextStorageEditedAttributes range:range changeInLength:0];
+}
+
+
+@end
@@ -0,0 +1,119 @@
+//
+//  MGSSearchEngine.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class MGSSearchEngine;
+
+
+/** The MGSSearchEngineDelegate protocol is used to notify an object when
+ *  the matches found by a search engine change. */
+@protocol MGSSearchEngineDelegate <NSObject>
+
+@optional
+
+/** Called on the main thread when matches have been added to or removed
+ *  from the match index.
+ *  @param engine The search engine.
+ *  @param range The range of characters where the matches have changed. */
+- (void)searchEngine:(MGSSearchEngine *)engine didUpdateMatchesInRange:(NSRange)range;
+
+/** Called on the main thread when the whole text has been searched.
+ *  @param engine The search engine. */
+- (void)searchEngineDidFinishSearching:(MGSSearchEngine *)engine;
+
+@end
+
+
+/** Searches the text of a text view for the matches of a regular
+ *  expression in the background.
+ *
+ *  The text is copied and scanned in chunks of whole lines on background
+ *  threads; the matches found are added to the match index on the main
+ *  thread as each group of chunks is completed, so that the first matches
+ *  are available before the search of a large text ends.
+ *
+ *  The match index is kept up to date when the text is edited: the matches
+ *  following the edit are moved, and only the lines affected by the edit
+ *  are searched again. If the text is edited while the search is running,
+ *  the search resumes from the first character which has not been searched
+ *  yet.
+ *
+ *  A match never extends past the end of the chunk of lines where it
+ *  begins, or past the end of the edited lines when they are searched
+ *  again; thus a regular expression which matches across lines may miss
+ *  some matches. */
+@interface MGSSearchEngine : NSObject
+
+
+/** Initializes a search engine for the text of a text view.
+ *  @param textView The text view. */
+- (instancetype)initWithTextView:(NSTextView *)textView;
+
+/** The text view whose text is searched. */
+@property (nonatomic, weak, readonly) NSTextView *textView;
+
+/** The delegate of the search engine. */
+@property (nonatomic, weak, nullable) id<MGSSearchEngineDelegate> delegate;
+
+
+/** The regular expression being searched, or nil if there is no search. */
+@property (nonatomic, readonly, nullable) NSRegularExpression *regularExpression;
+
+/** Starts searching for a regular expression, discarding the results of
+ *  the previous search.
+ *  @param regex The regular expression.
+ *  @returns The progress of the search, measured in characters. */
+- (NSProgress *)beginSearchingForRegularExpression:(NSRegularExpression *)regex;
+
+/** Stops searching. The matches found until now are kept, and they are
+ *  still updated when the text is edited. */
+- (void)cancelSearch;
+
+/** Stops searching and removes all the matches. */
+- (void)endSearch;
+
+/** YES while the text is being searched in the background. */
+@property (nonatomic, readonly, getter=isSearching) BOOL searching;
+
+
+/** The number of matches found until now. */
+@property (nonatomic, readonly) NSUInteger numberOfMatches;
+
+/** Returns the range of a match.
+ *  @param i The index of the match, in the order in which the matches
+ *    appear in the text. */
+- (NSRange)rangeOfMatchAtIndex:(NSUInteger)i;
+
+/** Returns the index of the first match starting at or after a character.
+ *  @param i A character index.
+ *  @returns The index of the match, or NSNotFound if there is no such
+ *    match. */
+- (NSUInteger)indexOfFirstMatchAtOrAfterCharacterIndex:(NSUInteger)i;
+
+/** Returns the ranges of the matches which intersect a range of
+ *  characters.
+ *  @param range The range of characters. */
+- (NSArray<NSValue *> *)rangesOfMatchesInRange:(NSRange)range;
+
+
+/** Replaces all the matches of the regular expression in the text.
+ *  @param templ The template used for the replacement strings, as in
+ *    -[NSRegularExpression replacementStringForResult:inString:offset:template:].
+ *  @returns The number of replacements made.
+ *  @discussion If the search has not been completed, the rest of the text
+ *    is searched before replacing. All the replacements are made as a
+ *    single edit of the text view, which is undone as a whole. */
+- (NSUInteger)replaceAllMatchesWithTemplate:(NSString *)templ;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,403 @@
+//
+//  MGSSearchEngine.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSSearchEngine.h"
+
+
+/* Approximate length of each chunk of lines searched by a background
+ * thread. */
+#define MGSSearchChunkLength    (262144)
+
+
+#define MGSMatchCount(d)        ((d).length / sizeof(NSRange))
+
+
+/* Appends to buf the ranges of the matches of regex which begin in range.
+ * The characters outside the range are visible to lookarounds and line
+ * anchors, but the matches never extend past the end of the range. */
+static void MGSFindMatchesInRange(NSRegularExpression *regex, NSString *string, NSRange range, NSMutableData *buf)
+{
+    NSMatchingOptions opts = NSMatchingWithTransparentBounds | NSMatchingWithoutAnchoringBounds;
+    NSUInteger end = NSMaxRange(range);
+    BOOL atEnd = end == string.length;
+    
+    [regex enumerateMatchesInString:string options:opts range:range usingBlock:^(NSTextCheckingResult *res, NSMatchingFlags flags, BOOL *stop) {
+        NSRange r = res.range;
+        
+        /* An empty match at the end of the range belongs to the next
+         * range, unless this is the end of the string */
+        if (r.location == end && !atEnd)
+            return;
+        [buf appendBytes:&r length:sizeof(NSRange)];
+    }];
+}
+
+
+/* Returns the index of the first match which ends after i or starts at i. */
+static NSUInteger MGSIndexOfFirstMatchEndingAfter(const NSRange *m, NSUInteger count, NSUInteger i)
+{
+    NSUInteger lo = 0, hi = count, mid;
+    
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (NSMaxRange(m[mid]) > i || m[mid].location >= i)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+
+/* Returns the index of the first match which starts at or after i. */
+static NSUInteger MGSIndexOfFirstMatchStartingAt(const NSRange *m, NSUInteger count, NSUInteger i)
+{
+    NSUInteger lo = 0, hi = count, mid;
+    
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (m[mid].location >= i)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+
+@implementation MGSSearchEngine
+{
+    NSMutableData *_matches;
+    NSUInteger _scannedEnd;
+    NSProgress *_progress;
+    NSProgress *_scan;
+}
+
+
+#pragma mark - Initialization
+
+
+- (instancetype)initWithTextView:(NSTextView *)textView
+{
+    self = [super init];
+    
+    _textView = textView;
+    _matches = [NSMutableData data];
+    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(textStorageDidProcessEditing:) name:NSTextStorageDidProcessEditingNotification object:nil];
+    
+    return self;
+}
+
+
+- (void)dealloc
+{
+    [_scan cancel];
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+
+#pragma mark - Searching
+
+
+- (NSProgress *)beginSearchingForRegularExpression:(NSRegularExpression *)regex
+{
+    MGSSearchEngine * __weak weakSelf = self;
+    NSProgress *progress;
+    
+    [self endSearch];
+    
+    _regularExpression = regex;
+    progress = [NSProgress progressWithTotalUnitCount:self.textView.textStorage.length];
+    progress.cancellationHandler = ^{
+        dispatch_async(dispatch_get_main_queue(), ^{
+            MGSSearchEngine *se = weakSelf;
+            if (se && se->_progress == progress)
+                [se cancelSearch];
+        });
+    };
+    _progress = progress;
+    [self searchFromCharacterIndex:0];
+    
+    return progress;
+}
+
+
+- (void)cancelSearch
+{
+    [_scan cancel];
+    _scan = nil;
+}
+
+
+- (void)endSearch
+{
+    NSRange all = NSMakeRange(0, _scannedEnd);
+    BOOL hadMatches = _matches.length > 0;
+    
+    [self cancelSearch];
+    _regularExpression = nil;
+    _progress = nil;
+    _matches.length = 0;
+    _scannedEnd = 0;
+    
+    if (hadMatches && [self.delegate respondsToSelector:@selector(searchEngine:didUpdateMatchesInRange:)])
+        [self.delegate searchEngine:self didUpdateMatchesInRange:all];
+}
+
+
+- (BOOL)isSearching
+{
+    return _scan != nil;
+}
+
+
+/* Starts a background search of the text which follows a character, on a
+ * copy of the current text. The text before the character must have been
+ * searched already. */
+- (void)searchFromCharacterIndex:(NSUInteger)start
+{
+    MGSSearchEngine * __weak weakSelf = self;
+    NSRegularExpression *regex = _regularExpression;
+    NSString *string = [self.textView.textStorage.string copy];
+    NSProgress *scan;
+    
+    [_scan cancel];
+    scan = [NSProgress discreteProgressWithTotalUnitCount:string.length];
+    _scan = scan;
+    _progress.totalUnitCount = string.length;
+    _progress.completedUnitCount = start;
+    
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        NSUInteger nchunks = [[NSProcessInfo processInfo] activeProcessorCount];
+        NSUInteger len = string.length, batchStart = start, batchEnd, e, i;
+        NSUInteger *bounds = malloc((nchunks + 1) * sizeof(NSUInteger));
+        NSMutableArray<NSMutableData *> *found = [NSMutableArray array];
+        NSMutableData *batch;
+        
+        for (i = 0; i < nchunks; i++)
+            [found addObject:[NSMutableData data]];
+        
+        while (batchStart < len && !scan.isCancelled) {
+            /* Split the next part of the text in a chunk for each
+             * processor, at line boundaries */
+            bounds[0] = batchStart;
+            for (i = 1; i <= nchunks; i++) {
+                e = MIN(bounds[i-1] + MGSSearchChunkLength, len);
+                if (e < len)
+                    [string getLineStart:NULL end:&e contentsEnd:NULL forRange:NSMakeRange(e, 0)];
+                bounds[i] = e;
+            }
+            
+            dispatch_apply(nchunks, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t j) {
+                found[j].length = 0;
+                if (bounds[j+1] > bounds[j] && !scan.isCancelled)
+                    MGSFindMatchesInRange(regex, string, NSMakeRange(bounds[j], bounds[j+1] - bounds[j]), found[j]);
+            });
+            if (scan.isCancelled)
+                break;
+            
+            batch = [NSMutableData data];
+            batchEnd = bounds[nchunks];
+            for (NSMutableData *d in found)
+                [batch appendData:d];
+            
+            dispatch_async(dispatch_get_main_queue(), ^{
+                MGSSearchEngine *se = weakSelf;
+                if (se && se->_scan == scan)
+                    [se appendMatches:batch searchedUpTo:batchEnd];
+            });
+            batchStart = batchEnd;
+        }
+        free(bounds);
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            MGSSearchEngine *se = weakSelf;
+            if (se && se->_scan == scan)
+                [se finishSearch];
+        });
+    });
+}
+
+
+/* Adds the matches found by the background search to the index. */
+- (void)appendMatches:(NSData *)batch searchedUpTo:(NSUInteger)end
+{
+    NSRange changed = NSMakeRange(_scannedEnd, end - _scannedEnd);
+    
+    [_matches appendData:batch];
+    _scannedEnd = end;
+    _progress.completedUnitCount = end;
+    
+    if (batch.length && [self.delegate respondsToSelector:@selector(searchEngine:didUpdateMatchesInRange:)])
+        [self.delegate searchEngine:self didUpdateMatchesInRange:changed];
+}
+
+
+- (void)finishSearch
+{
+    _scan = nil;
+    _progress.completedUnitCount = _progress.totalUnitCount;
+    
+    if ([self.delegate respondsToSelector:@selector(searchEngineDidFinishSearching:)])
+        [self.delegate searchEngineDidFinishSearching:self];
+}
+
+
+#pragma mark - Accessing the Matches
+
+
+- (NSUInteger)numberOfMatches
+{
+    return MGSMatchCount(_matches);
+}
+
+
+- (NSRange)rangeOfMatchAtIndex:(NSUInteger)i
+{
+    if (i >= MGSMatchCount(_matches))
+        [NSException raise:NSRangeException format:@"Match index %lu out of bounds", (unsigned long)i];
+    return ((const NSRange *)_matches.bytes)[i];
+}
+
+
+- (NSUInteger)indexOfFirstMatchAtOrAfterCharacterIndex:(NSUInteger)i
+{
+    NSUInteger count = MGSMatchCount(_matches);
+    NSUInteger res = MGSIndexOfFirstMatchStartingAt(_matches.bytes, count, i);
+    
+    return res < count ? res : NSNotFound;
+}
+
+
+- (NSArray<NSValue *> *)rangesOfMatchesInRange:(NSRange)range
+{
+    const NSRange *m = _matches.bytes;
+    NSUInteger count = MGSMatchCount(_matches);
+    NSUInteger i = MGSIndexOfFirstMatchEndingAfter(m, count, range.location);
+    NSMutableArray *res = [NSMutableArray array];
+    
+    for (; i < count && m[i].location < NSMaxRange(range); i++)
+        [res addObject:[NSValue valueWithRange:m[i]]];
+    return res;
+}
+
+
+#pragma mark - Updating the Matches
+
+
+- (void)textStorageDidProcessEditing:(NSNotification *)notification
+{
+    NSTextStorage *ts = notification.object;
+    NSString *string = ts.string;
+    NSRange edited, lines, *m;
+    NSInteger delta;
+    NSUInteger count, first, last, oldEnd, oldLength, i;
+    NSMutableData *found;
+    
+    if (ts != self.textView.textStorage || !_regularExpression || !(ts.editedMask & NSTextStorageEditedCharacters))
+        return;
+    
+    edited = ts.editedRange;
+    delta = ts.changeInLength;
+    oldLength = string.length - delta;
+    lines = [string lineRangeForRange:edited];
+    
+    /* A match which starts before the edited lines and overlaps with them
+     * is searched again as well */
+    m = _matches.mutableBytes;
+    count = MGSMatchCount(_matches);
+    first = MGSIndexOfFirstMatchEndingAfter(m, count, lines.location);
+    if (first < count && m[first].location < lines.location) {
+        lines = NSUnionRange(lines, [string lineRangeForRange:NSMakeRange(m[first].location, 0)]);
+        first = MGSIndexOfFirstMatchEndingAfter(m, count, lines.location);
+    }
+    
+    /* Move the matches which follow the edited lines */
+    oldEnd = NSMaxRange(lines) - delta;
+    last = oldEnd < oldLength ? MGSIndexOfFirstMatchStartingAt(m, count, oldEnd) : count;
+    for (i = last; i < count; i++)
+        m[i].location += delta;
+    
+    /* Search the edited lines again if they have been searched already, or
+     * if they are at the end of a text which has been searched completely */
+    if (lines.location < _scannedEnd || _scannedEnd == oldLength) {
+        found = [NSMutableData data];
+        MGSFindMatchesInRange(_regularExpression, string, lines, found);
+        [_matches replaceBytesInRange:NSMakeRange(first * sizeof(NSRange), (last - first) * sizeof(NSRange)) withBytes:found.bytes length:found.length];
+        _scannedEnd = _scannedEnd >= oldEnd ? _scannedEnd + delta : NSMaxRange(lines);
+        
+        if ([self.delegate respondsToSelector:@selector(searchEngine:didUpdateMatchesInRange:)])
+            [self.delegate searchEngine:self didUpdateMatchesInRange:lines];
+    }
+    
+    /* The copy of the text used by the background search is not valid
+     * anymore; resume the search on the new text */
+    if (_scan)
+        [self searchFromCharacterIndex:_scannedEnd];
+}
+
+
+#pragma mark - Replacing
+
+
+- (NSUInteger)replaceAllMatchesWithTemplate:(NSString *)templ
+{
+    NSTextView *tv = self.textView;
+    NSTextStorage *ts = tv.textStorage;
+    NSString *string = ts.string;
+    NSMatchingOptions opts = NSMatchingAnchored | NSMatchingWithTransparentBounds | NSMatchingWithoutAnchoringBounds;
+    NSMutableArray *ranges, *replacements;
+    NSTextCheckingResult *res;
+    const NSRange *m;
+    NSUInteger count, i;
+    NSInteger j;
+    
+    if (!_regularExpression || !tv)
+        return 0;
+    
+    if (_scan || _scannedEnd < string.length) {
+        [self cancelSearch];
+        if (_scannedEnd < string.length)
+            MGSFindMatchesInRange(_regularExpression, string, NSMakeRange(_scannedEnd, string.length - _scannedEnd), _matches);
+        _scannedEnd = string.length;
+        [self finishSearch];
+    }
+    
+    count = MGSMatchCount(_matches);
+    if (count == 0)
+        return 0;
+    
+    /* Replace only the matches, so that the text between them keeps its
+     * colouring, layout and folds, and the undo manager does not have to
+     * remember it */
+    m = _matches.bytes;
+    ranges = [NSMutableArray arrayWithCapacity:count];
+    replacements = [NSMutableArray arrayWithCapacity:count];
+    for (i = 0; i < count; i++) {
+        res = [_regularExpression firstMatchInString:string options:opts range:m[i]];
+        [ranges addObject:[NSValue valueWithRange:m[i]]];
+        if (res)
+            [replacements addObject:[_regularExpression replacementStringForResult:res inString:string offset:0 template:templ]];
+        else
+            [replacements addObject:[string substringWithRange:m[i]]];
+    }
+    
+    if (![tv shouldChangeTextInRanges:ranges replacementStrings:replacements])
+        return 0;
+    /* Back to front, so that the ranges still to be replaced are not moved
+     * by the replacements; as a single edit, so that the text is coloured
+     * and indexed only once */
+    [ts beginEditing];
+    for (j = (NSInteger)count - 1; j >= 0; j--)
+        [ts replaceCharactersInRange:[ranges[j] rangeValue] withString:replacements[j]];
+    [ts endEditing];
+    [tv didChangeText];
+    
+    return count;
+}
+
+@end
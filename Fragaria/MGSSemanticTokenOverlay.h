@@ -0,0 +1,100 @@
+//
+//  MGSSemanticTokenOverlay.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Cocoa/Cocoa.h>
+#import "MGSSyntaxParserClient.h"
+#import "MGSSemanticTokensEdit.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/** MGSSemanticTokenOverlay stores the semantic tokens produced by an
+ *  external analyzer, in the delta-encoded format used by the Language
+ *  Server Protocol, and converts them to character ranges.
+ *
+ *  Each token is encoded as 5 integers: the line of the token relative to
+ *  the line of the previous token, its start column (relative to the start
+ *  column of the previous token if they are on the same line), its length,
+ *  its type and a bit set of modifiers. The type and the modifiers are
+ *  indexes in the tokenTypes and tokenModifiers arrays (the legend).
+ *
+ *  The character ranges of the tokens are updated when the text is edited,
+ *  while the encoded tokens are kept as they were received, so that later
+ *  edits of the encoded tokens can be applied to them.
+ *
+ *  The methods which change the tokens return the character ranges where the
+ *  tokens have changed, so that only the colouring of those ranges is
+ *  invalidated. */
+@interface MGSSemanticTokenOverlay : NSObject
+
+
+/** The syntax groups corresponding to each token type. */
+@property (nonatomic, copy, readonly) NSArray<MGSSyntaxGroup> *tokenTypes;
+
+/** The names of the token modifiers, in order of bit index. */
+@property (nonatomic, copy, readonly) NSArray<NSString *> *tokenModifiers;
+
+/** The number of tokens which have a character range. */
+@property (nonatomic, readonly) NSUInteger count;
+
+/** YES if tokens were set and they can be edited with
+ *  -applyEdits:count:textStorage:. */
+@property (nonatomic, readonly) BOOL hasTokenData;
+
+
+/** Replaces the legend, and updates the groups of the tokens.
+ *  @param types The syntax groups corresponding to each token type.
+ *  @param modifiers The names of the token modifiers. For tokens with
+ *    modifiers, the modifier name corresponding to the lowest bit set is
+ *    appended to the group of the token type, separated by a dot.
+ *  @returns The character ranges where the tokens have changed.
+ *  @discussion The tokens keep their character ranges, which have followed
+ *    the edits of the text since they were decoded. */
+- (NSIndexSet *)setTokenTypes:(NSArray<MGSSyntaxGroup> *)types modifiers:(NSArray<NSString *> *)modifiers;
+
+/** Replaces all the tokens.
+ *  @param data The encoded tokens. Any integer following the last complete
+ *    token is ignored.
+ *  @param count The number of integers in data.
+ *  @param ts The text the tokens refer to.
+ *  @returns The character ranges where the tokens have changed. */
+- (NSIndexSet *)setTokenData:(const uint32_t *)data count:(NSUInteger)count textStorage:(NSTextStorage *)ts;
+
+/** Edits the encoded tokens last set.
+ *  @param edits The edits. All edits refer to the encoded tokens as they
+ *    were before any of them is applied, and they must not overlap.
+ *  @param count The number of edits.
+ *  @param ts The text the tokens refer to.
+ *  @returns The character ranges where the tokens have changed, or nil if
+ *    no tokens were set or the edits are out of bounds. In this case the
+ *    tokens are not modified. */
+- (nullable NSIndexSet *)applyEdits:(const MGSSemanticTokensEdit *)edits count:(NSUInteger)count textStorage:(NSTextStorage *)ts;
+
+/** Removes all the tokens.
+ *  @returns The character ranges where there were tokens. */
+- (NSIndexSet *)removeAllTokens;
+
+
+/** Updates the character ranges of the tokens after an edit of the text.
+ *  @discussion The tokens which overlap with the replaced characters are
+ *    removed, and the tokens which follow them are moved.
+ *  @param oldRange The range of the replaced characters, before the edit.
+ *  @param changeInLength The difference between the lengths of the text
+ *    after and before the edit. */
+- (void)shiftTokensForEditedRange:(NSRange)oldRange changeInLength:(NSInteger)changeInLength;
+
+/** Enumerates the tokens which intersect with a character range, in order.
+ *  @param range A character range.
+ *  @param block The block to invoke for each token. */
+- (void)enumerateTokensInRange:(NSRange)range usingBlock:(void (^)(NSRange tokenRange, MGSSyntaxGroup group, BOOL *stop))block;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,309 @@
+//
+//  MGSSemanticTokenOverlay.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSSemanticTokenOverlay.h"
+#import "NSTextStorage+Fragaria.h"
+
+
+/* Number of integers used to encode a token */
+#define MGSSemanticTokenStride  (5)
+
+
+/* A decoded token. The type and the modifiers are kept, so that the group
+ * can be looked up again when the legend changes; the group is NSNotFound
+ * if the type is not in the legend. */
+typedef struct {
+    NSUInteger location;
+    NSUInteger length;
+    NSUInteger group;
+    uint32_t type;
+    uint32_t modifiers;
+} MGSSemanticToken;
+
+
+static BOOL MGSSemanticTokenEqual(const MGSSemanticToken *a, const MGSSemanticToken *b)
+{
+    return a->location == b->location && a->length == b->length && a->type == b->type && a->modifiers == b->modifiers;
+}
+
+
+@implementation MGSSemanticTokenOverlay
+{
+    NSMutableData *tokenData;
+    NSMutableData *tokens;
+    NSMutableArray<MGSSyntaxGroup> *groups;
+    NSMutableDictionary<NSNumber *, NSNumber *> *groupIndexes;
+}
+
+
+- (instancetype)init
+{
+    self = [super init];
+    
+    _tokenTypes = @[];
+    _tokenModifiers = @[];
+    tokens = [NSMutableData data];
+    groups = [NSMutableArray array];
+    groupIndexes = [NSMutableDictionary dictionary];
+    
+    return self;
+}
+
+
+- (NSUInteger)count
+{
+    return tokens.length / sizeof(MGSSemanticToken);
+}
+
+
+- (BOOL)hasTokenData
+{
+    return tokenData != nil;
+}
+
+
+#pragma mark - Setting Tokens
+
+
+- (NSIndexSet *)setTokenTypes:(NSArray<MGSSyntaxGroup> *)types modifiers:(NSArray<NSString *> *)modifiers
+{
+    NSMutableIndexSet *changed = [NSMutableIndexSet indexSet];
+    NSArray<MGSSyntaxGroup> *oldGroups = [groups copy];
+    MGSSemanticToken *t = tokens.mutableBytes;
+    NSUInteger n = self.count, i;
+    MGSSyntaxGroup old, new;
+    
+    _tokenTypes = [types copy];
+    _tokenModifiers = [modifiers copy];
+    [groups removeAllObjects];
+    [groupIndexes removeAllObjects];
+    
+    /* The encoded tokens may not match the text anymore if it was edited
+     * since they were decoded, so only the groups of the decoded tokens
+     * are looked up again. */
+    for (i = 0; i < n; i++) {
+        old = t[i].group != NSNotFound ? oldGroups[t[i].group] : nil;
+        t[i].group = [self groupIndexForType:t[i].type modifiers:t[i].modifiers];
+        new = t[i].group != NSNotFound ? groups[t[i].group] : nil;
+        if (old != new && ![old isEqual:new])
+            [changed addIndexesInRange:NSMakeRange(t[i].location, t[i].length)];
+    }
+    return changed;
+}
+
+
+- (NSIndexSet *)setTokenData:(const uint32_t *)data count:(NSUInteger)count textStorage:(NSTextStorage *)ts
+{
+    count -= count % MGSSemanticTokenStride;
+    tokenData = [NSMutableData dataWithBytes:data length:count * sizeof(uint32_t)];
+    return [self decodeTokenDataWithTextStorage:ts];
+}
+
+
+- (NSIndexSet *)applyEdits:(const MGSSemanticTokensEdit *)edits count:(NSUInteger)count textStorage:(NSTextStorage *)ts
+{
+    NSUInteger n = tokenData.length / sizeof(uint32_t);
+    NSMutableData *sorted;
+    MGSSemanticTokensEdit *e;
+    NSUInteger i;
+    
+    if (!tokenData)
+        return nil;
+    
+    /* Apply the edits from the last one, so that the start of each edit is
+     * still valid when it is applied. */
+    sorted = [NSMutableData dataWithBytes:edits length:count * sizeof(MGSSemanticTokensEdit)];
+    e = sorted.mutableBytes;
+    qsort_b(e, count, sizeof(MGSSemanticTokensEdit), ^int(const void *a, const void *b) {
+        NSUInteger sa = ((const MGSSemanticTokensEdit *)a)->start;
+        NSUInteger sb = ((const MGSSemanticTokensEdit *)b)->start;
+        return sa < sb ? 1 : (sa > sb ? -1 : 0);
+    });
+    for (i = 0; i < count; i++) {
+        if (e[i].start > n || e[i].deleteCount > n - e[i].start)
+            return nil;
+        if (i > 0 && e[i].start + e[i].deleteCount > e[i-1].start)
+            return nil;
+    }
+    
+    for (i = 0; i < count; i++) {
+        [tokenData replaceBytesInRange:NSMakeRange(e[i].start * sizeof(uint32_t), e[i].deleteCount * sizeof(uint32_t))
+          withBytes:e[i].data length:e[i].dataCount * sizeof(uint32_t)];
+    }
+    n = tokenData.length / sizeof(uint32_t);
+    tokenData.length = (n - n % MGSSemanticTokenStride) * sizeof(uint32_t);
+    
+    return [self decodeTokenDataWithTextStorage:ts];
+}
+
+
+- (NSIndexSet *)removeAllTokens
+{
+    NSMutableIndexSet *changed = [NSMutableIndexSet indexSet];
+    
+    [self enumerateTokensInRange:NSMakeRange(0, NSUIntegerMax) usingBlock:^(NSRange tokenRange, MGSSyntaxGroup group, BOOL *stop) {
+        [changed addIndexesInRange:tokenRange];
+    }];
+    tokenData = nil;
+    tokens.length = 0;
+    return changed;
+}
+
+
+#pragma mark - Decoding
+
+
+- (NSUInteger)groupIndexForType:(uint32_t)type modifiers:(uint32_t)mods
+{
+    NSNumber *key = @(((uint64_t)type << 32) | mods);
+    NSNumber *gi = groupIndexes[key];
+    NSString *group;
+    uint32_t bit;
+    
+    if (gi)
+        return gi.unsignedIntegerValue;
+    
+    if (type >= self.tokenTypes.count) {
+        gi = @(NSNotFound);
+    } else {
+        group = self.tokenTypes[type];
+        for (bit = 0; bit < 32 && bit < self.tokenModifiers.count; bit++) {
+            if (mods & (1U << bit)) {
+                group = [NSString stringWithFormat:@"%@.%@", group, self.tokenModifiers[bit]];
+                break;
+            }
+        }
+        gi = @(groups.count);
+        [groups addObject:group];
+    }
+    groupIndexes[key] = gi;
+    return gi.unsignedIntegerValue;
+}
+
+
+/* Converts the encoded tokens to character ranges, and returns the ranges
+ * where they differ from the previous ones. */
+- (NSIndexSet *)decodeTokenDataWithTextStorage:(NSTextStorage *)ts
+{
+    const uint32_t *d = tokenData.bytes;
+    NSUInteger n = tokenData.length / sizeof(uint32_t) / MGSSemanticTokenStride;
+    NSMutableData *newTokens = [NSMutableData dataWithCapacity:n * sizeof(MGSSemanticToken)];
+    NSUInteger i, line = 0, column = 0, prevEnd = 0, start, end, gi;
+    NSIndexSet *changed;
+    MGSSemanticToken t;
+    
+    for (i = 0; i < n; i++, d += MGSSemanticTokenStride) {
+        if (d[0]) {
+            line += d[0];
+            column = d[1];
+        } else {
+            column += d[1];
+        }
+    
+        /* Tokens cannot span more than one line; those which go past the end
+         * of their line are truncated. */
+        start = [ts mgs_characterAtIndex:column withinRow:line];
+        if (start == NSNotFound)
+            break;
+        end = [ts mgs_characterAtIndex:column + d[2] withinRow:line];
+        gi = [self groupIndexForType:d[3] modifiers:d[4]];
+        if (end <= start || start < prevEnd)
+            continue;
+    
+        t.location = start;
+        t.length = end - start;
+        t.group = gi;
+        t.type = d[3];
+        t.modifiers = d[4];
+        [newTokens appendBytes:&t length:sizeof(t)];
+        prevEnd = end;
+    }
+    
+    changed = [self differenceBetweenTokens:tokens andTokens:newTokens];
+    tokens = newTokens;
+    return changed;
+}
+
+
+- (NSIndexSet *)differenceBetweenTokens:(NSData *)a andTokens:(NSData *)b
+{
+    const MGSSemanticToken *ta = a.bytes, *tb = b.bytes;
+    NSUInteger na = a.length / sizeof(MGSSemanticToken), nb = b.length / sizeof(MGSSemanticToken);
+    NSUInteger i = 0, j = 0;
+    NSMutableIndexSet *changed = [NSMutableIndexSet indexSet];
+    
+    while (i < na || j < nb) {
+        if (i < na && j < nb && MGSSemanticTokenEqual(&ta[i], &tb[j])) {
+            i++;
+            j++;
+        } else if (j >= nb || (i < na && ta[i].location <= tb[j].location)) {
+            [changed addIndexesInRange:NSMakeRange(ta[i].location, ta[i].length)];
+            i++;
+        } else {
+            [changed addIndexesInRange:NSMakeRange(tb[j].location, tb[j].length)];
+            j++;
+        }
+    }
+    return changed;
+}
+
+
+#pragma mark - Text Changes
+
+
+/* Returns the index of the first token which ends after the specified
+ * character index. */
+- (NSUInteger)indexOfFirstTokenEndingAfter:(NSUInteger)c
+{
+    const MGSSemanticToken *t = tokens.bytes;
+    NSUInteger lo = 0, hi = self.count, mid;
+    
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (t[mid].location + t[mid].length > c)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+
+- (void)shiftTokensForEditedRange:(NSRange)oldRange changeInLength:(NSInteger)changeInLength
+{
+    MGSSemanticToken *t = tokens.mutableBytes;
+    NSUInteger n = self.count, i, j, oldEnd = NSMaxRange(oldRange);
+    
+    i = j = [self indexOfFirstTokenEndingAfter:oldRange.location];
+    for (; i < n; i++) {
+        if (t[i].location < oldEnd)
+            continue;
+        t[j] = t[i];
+        t[j].location += changeInLength;
+        j++;
+    }
+    tokens.length = j * sizeof(MGSSemanticToken);
+}
+
+
+- (void)enumerateTokensInRange:(NSRange)range usingBlock:(void (^)(NSRange, MGSSyntaxGroup, BOOL *))block
+{
+    const MGSSemanticToken *t = tokens.bytes;
+    NSUInteger n = self.count, i;
+    BOOL stop = NO;
+    
+    for (i = [self indexOfFirstTokenEndingAfter:range.location]; i < n && !stop; i++) {
+        if (t[i].location >= NSMaxRange(range))
+            break;
+        if (t[i].group == NSNotFound)
+            continue;
+        block(NSMakeRange(t[i].location, t[i].length), groups[t[i].group], &stop);
+    }
+}
+
+
+@end
@@ -0,0 +1,19 @@
+//
+//  MGSSemanticTokensEdit.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Foundation/Foundation.h>
+
+
+/** Describes an edit of an array of semantic tokens, in the format of the
+ *  semantic token deltas of the Language Server Protocol.
+ *  @see MGSFragariaView -applySemanticTokensEdits:count: */
+typedef struct {
+    NSUInteger start;           ///< The index of the first integer to replace.
+    NSUInteger deleteCount;     ///< The number of integers to replace.
+    const uint32_t *data;       ///< The integers to insert.
+    NSUInteger dataCount;       ///< The number of integers to insert.
+} MGSSemanticTokensEdit;
@@ -0,0 +1,167 @@
+//
+//  MGSSymbolIndex.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Cocoa/Cocoa.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class MGSSymbolIndex;
+@class MGSTextView;
+
+
+/** Symbol kinds are tags which tell what a symbol declares. Some kinds are
+ *  pre-defined by Fragaria, but syntax definitions can make up new kinds if
+ *  they wish. */
+typedef NSString *MGSSymbolKind NS_EXTENSIBLE_STRING_ENUM;
+/** Symbol kind for functions */
+extern MGSSymbolKind const MGSSymbolKindFunction;
+/** Symbol kind for methods */
+extern MGSSymbolKind const MGSSymbolKindMethod;
+/** Symbol kind for classes, interfaces and protocols */
+extern MGSSymbolKind const MGSSymbolKindClass;
+/** Symbol kind for the other type declarations, like structures and
+ *  enumerations */
+extern MGSSymbolKind const MGSSymbolKindType;
+/** Symbol kind for macros */
+extern MGSSymbolKind const MGSSymbolKindMacro;
+
+
+/** A regular expression which matches the declarations of a kind of
+ *  symbol. */
+@interface MGSSymbolPattern : NSObject
+
+
+/** Initializes a symbol pattern.
+ *  @param kind The kind of the symbols declared by the matches.
+ *  @param regex The regular expression. */
+- (instancetype)initWithKind:(MGSSymbolKind)kind regularExpression:(NSRegularExpression *)regex;
+
+/** The kind of the symbols declared by the matches of the pattern. */
+@property (nonatomic, readonly) MGSSymbolKind kind;
+
+/** The regular expression. The name of the symbol is the range of its
+ *  first capture group, or the whole match if it has no capture groups.
+ *  @discussion The matches whose name begins in a comment or in a string
+ *    are ignored. */
+@property (nonatomic, readonly) NSRegularExpression *regularExpression;
+
+
+@end
+
+
+/** A symbol declared in the text. */
+@interface MGSSymbol : NSObject
+
+
+/** The name of the symbol. */
+@property (nonatomic, readonly) NSString *name;
+
+/** The kind of the symbol. */
+@property (nonatomic, readonly) MGSSymbolKind kind;
+
+/** The range of the name of the symbol in the text, at the time this
+ *  object was returned by the symbol index. */
+@property (nonatomic, readonly) NSRange range;
+
+
+@end
+
+
+/** The MGSSymbolIndexDelegate protocol is used to notify an object when
+ *  the symbols of a symbol index change. */
+@protocol MGSSymbolIndexDelegate <NSObject>
+
+@optional
+
+/** Called on the main thread when symbols have been added to or removed
+ *  from the index.
+ *  @param index The symbol index.
+ *  @param range The range of characters where the symbols have changed. */
+- (void)symbolIndex:(MGSSymbolIndex *)index didUpdateSymbolsInRange:(NSRange)range;
+
+/** Called on the main thread when the whole text has been indexed.
+ *  @param index The symbol index. */
+- (void)symbolIndexDidFinishIndexing:(MGSSymbolIndex *)index;
+
+@end
+
+
+/** Indexes the symbols declared in the text of a text view, such as
+ *  functions and classes, for showing an outline of the text or for
+ *  navigating to a symbol.
+ *
+ *  Symbols are found by matching the symbol patterns of the current parser
+ *  against the text, as a by-product of syntax colouring: whenever a range
+ *  of lines is parsed, its symbols are found again, ignoring the matches
+ *  in comments and strings. The patterns are matched in the background, on
+ *  a copy of the parsed lines, and the symbols found are merged into the
+ *  index on the main thread.
+ *
+ *  When the text is edited, the symbols which follow the edit are moved,
+ *  and only the edited lines are indexed again. The text which has not
+ *  been parsed yet is parsed in short time slices on the main thread, until
+ *  the whole text is indexed. This is not done for texts longer than 4
+ *  million characters, nor for the text of a MGSMappedFileTextStorage or of
+ *  a MGSPieceTableTextStorage: these texts are only indexed as they are
+ *  parsed for display, and isIndexing becomes NO as soon as the parsed
+ *  lines have been indexed.
+ *
+ *  The symbols are kept sorted by position, so that the symbols in a range
+ *  can be found quickly. */
+@interface MGSSymbolIndex : NSObject
+
+
+/** Initializes a symbol index for the text of a text view, and starts
+ *  indexing the text.
+ *  @param textView The text view.
+ *  @discussion There can only be one symbol index per text view; the
+ *    previous symbol index of the text view stops being updated. */
+- (instancetype)initWithTextView:(MGSTextView *)textView;
+
+/** The text view whose text is indexed. */
+@property (nonatomic, weak, readonly) MGSTextView *textView;
+
+/** The delegate of the symbol index. */
+@property (nonatomic, weak, nullable) id<MGSSymbolIndexDelegate> delegate;
+
+/** YES while some of the text has not been indexed yet. */
+@property (nonatomic, readonly, getter=isIndexing) BOOL indexing;
+
+
+/// @name Querying the Symbols
+
+
+/** The number of symbols in the index. */
+@property (nonatomic, readonly) NSUInteger numberOfSymbols;
+
+/** Returns a symbol.
+ *  @param i The index of the symbol, in the order in which the symbols
+ *    appear in the text. */
+- (MGSSymbol *)symbolAtIndex:(NSUInteger)i;
+
+/** Returns the symbols whose name begins in a range of characters, in the
+ *  order in which they appear in the text.
+ *  @param range The range of characters. */
+- (NSArray<MGSSymbol *> *)symbolsInRange:(NSRange)range;
+
+/** Returns the index of the last symbol whose name begins at or before a
+ *  character; for example, the symbol which encloses the insertion point.
+ *  @param i A character index.
+ *  @returns The index of the symbol, or NSNotFound if there is no such
+ *    symbol. */
+- (NSUInteger)indexOfLastSymbolAtOrBeforeCharacterIndex:(NSUInteger)i;
+
+/** Returns the symbols whose name begins with a string, ignoring case, in
+ *  alphabetical order.
+ *  @param prefix The beginning of the names. */
+- (NSArray<MGSSymbol *> *)symbolsWithNamePrefix:(NSString *)prefix;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
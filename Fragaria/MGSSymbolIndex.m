@@ -0,0 +1,710 @@
+//
+//  MGSSymbolIndex.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSSymbolIndex.h"
+#import "MGSSymbolIndexPrivate.h"
+#import "MGSTextView.h"
+#import "MGSTextViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSSyntaxParser.h"
+#import "MGSAttributeOverlayTextStorage.h"
+#import "MGSMappedFileTextStorage.h"
+#import "MGSPieceTableTextStorage.h"
+
+
+/* Approximate number of characters parsed at a time while indexing the
+ * text which has not been parsed yet. The length of the slices adapts to
+ * the speed of the parser, within these bounds. */
+#define MGSSymbolIndexSliceLength           (65536)
+#define MGSSymbolIndexMinimumSliceLength    (4096)
+#define MGSSymbolIndexMaximumSliceLength    (1048576)
+
+/* Maximum time spent on the main thread by each run of indexing, in
+ * seconds. */
+#define MGSSymbolIndexSliceDuration     (0.008)
+
+/* Texts longer than this are only indexed as they are parsed for display */
+#define MGSSymbolIndexMaximumWholeTextLength    (4194304)
+
+
+MGSSymbolKind const MGSSymbolKindFunction = @"function";
+MGSSymbolKind const MGSSymbolKindMethod = @"method";
+MGSSymbolKind const MGSSymbolKindClass = @"class";
+MGSSymbolKind const MGSSymbolKindType = @"type";
+MGSSymbolKind const MGSSymbolKindMacro = @"macro";
+
+
+/* An edit of the text made while some lines were being indexed in the
+ * background. */
+typedef struct {
+    NSRange oldLines;           /* The edited lines, before the edit */
+    NSInteger changeInLength;
+    NSUInteger generation;      /* The generation of the text after the edit */
+} MGSSymbolIndexEdit;
+
+
+/* Removes the edited lines from a set of character indexes, and moves the
+ * indexes which follow them. */
+static void MGSShiftIndexesForEdit(NSMutableIndexSet *set, NSRange oldLines, NSInteger delta)
+{
+    [set removeIndexesInRange:oldLines];
+    [set shiftIndexesStartingAtIndex:NSMaxRange(oldLines) by:delta];
+}
+
+
+/* Returns the end of the run of indexes of a set which starts at an index,
+ * or the index itself if it is not in the set. */
+static NSUInteger MGSEndOfRunAtIndex(NSIndexSet *set, NSUInteger i)
+{
+    __block NSUInteger res = i;
+    
+    if (![set containsIndex:i])
+        return i;
+    [set enumerateRangesInRange:NSMakeRange(i, NSNotFound - i) options:0 usingBlock:^(NSRange range, BOOL *stop) {
+        res = NSMaxRange(range);
+        *stop = YES;
+    }];
+    return res;
+}
+
+
+#pragma mark - Patterns and Symbols
+
+
+@implementation MGSSymbolPattern
+
+
+- (instancetype)initWithKind:(MGSSymbolKind)kind regularExpression:(NSRegularExpression *)regex
+{
+    self = [super init];
+    _kind = kind;
+    _regularExpression = regex;
+    return self;
+}
+
+
+@end
+
+
+@interface MGSSymbol ()
+
+- (instancetype)initWithName:(NSString *)name kind:(MGSSymbolKind)kind range:(NSRange)range;
+
+@end
+
+
+@implementation MGSSymbol
+
+
+- (instancetype)initWithName:(NSString *)name kind:(MGSSymbolKind)kind range:(NSRange)range
+{
+    self = [super init];
+    _name = name;
+    _kind = kind;
+    _range = range;
+    return self;
+}
+
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@ %@ %@ %@>", NSStringFromClass([self class]), self.kind, self.name, NSStringFromRange(self.range)];
+}
+
+
+@end
+
+
+#pragma mark - Symbol Lists
+
+
+/* A list of symbols sorted by the position of their names. */
+@interface MGSSymbolList : NSObject
+{
+    @public
+    NSMutableData *_ranges;                 /* NSRange, the name of each symbol */
+    NSMutableArray<NSString *> *_names;
+    NSMutableArray<MGSSymbolKind> *_kinds;
+}
+
+@end
+
+
+@implementation MGSSymbolList
+
+
+- (instancetype)init
+{
+    self = [super init];
+    _ranges = [NSMutableData data];
+    _names = [NSMutableArray array];
+    _kinds = [NSMutableArray array];
+    return self;
+}
+
+
+- (NSUInteger)count
+{
+    return _names.count;
+}
+
+
+- (void)addSymbolNamed:(NSString *)name kind:(MGSSymbolKind)kind range:(NSRange)range
+{
+    [_ranges appendBytes:&range length:sizeof(NSRange)];
+    [_names addObject:name];
+    [_kinds addObject:kind];
+}
+
+
+- (MGSSymbol *)symbolAtIndex:(NSUInteger)i
+{
+    const NSRange *r = _ranges.bytes;
+    
+    return [[MGSSymbol alloc] initWithName:_names[i] kind:_kinds[i] range:r[i]];
+}
+
+
+/* Returns the index of the first symbol whose name begins at or after a
+ * character. */
+- (NSUInteger)indexOfFirstSymbolAtOrAfterCharacterIndex:(NSUInteger)c
+{
+    const NSRange *r = _ranges.bytes;
+    NSUInteger lo = 0, hi = _names.count, mid;
+    
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (r[mid].location >= c)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+
+- (void)removeSymbolsInRange:(NSRange)indexes
+{
+    [_ranges replaceBytesInRange:NSMakeRange(indexes.location * sizeof(NSRange), indexes.length * sizeof(NSRange)) withBytes:NULL length:0];
+    [_names removeObjectsInRange:indexes];
+    [_kinds removeObjectsInRange:indexes];
+}
+
+
+/* Replaces the symbols whose name begins in a range of characters with the
+ * symbols of another list which begin in the same range. */
+- (void)replaceSymbolsInCharacterRange:(NSRange)range withSymbolsOfList:(MGSSymbolList *)list
+{
+    const NSRange *r = list->_ranges.bytes;
+    NSUInteger i, j, k, l;
+    
+    i = [self indexOfFirstSymbolAtOrAfterCharacterIndex:range.location];
+    j = [self indexOfFirstSymbolAtOrAfterCharacterIndex:NSMaxRange(range)];
+    k = [list indexOfFirstSymbolAtOrAfterCharacterIndex:range.location];
+    l = [list indexOfFirstSymbolAtOrAfterCharacterIndex:NSMaxRange(range)];
+    
+    [_ranges replaceBytesInRange:NSMakeRange(i * sizeof(NSRange), (j - i) * sizeof(NSRange)) withBytes:r + k length:(l - k) * sizeof(NSRange)];
+    [_names replaceObjectsInRange:NSMakeRange(i, j - i) withObjectsFromArray:list->_names range:NSMakeRange(k, l - k)];
+    [_kinds replaceObjectsInRange:NSMakeRange(i, j - i) withObjectsFromArray:list->_kinds range:NSMakeRange(k, l - k)];
+}
+
+
+/* Removes the symbols in the edited lines, and moves the symbols which
+ * follow them. */
+- (void)shiftSymbolsForEditedLines:(NSRange)oldLines changeInLength:(NSInteger)delta
+{
+    NSUInteger i, j, n;
+    NSRange *r;
+    
+    i = [self indexOfFirstSymbolAtOrAfterCharacterIndex:oldLines.location];
+    j = [self indexOfFirstSymbolAtOrAfterCharacterIndex:NSMaxRange(oldLines)];
+    [self removeSymbolsInRange:NSMakeRange(i, j - i)];
+    
+    r = _ranges.mutableBytes;
+    n = _names.count;
+    for (; i < n; i++)
+        r[i].location += delta;
+}
+
+
+@end
+
+
+/* Appends to a list the symbols declared in a string, which is a copy of
+ * the text starting at a character offset. The matches whose name begins
+ * at one of the excluded character indexes are ignored. */
+static void MGSFindSymbols(NSArray<MGSSymbolPattern *> *patterns, NSString *string, NSUInteger offset, NSIndexSet *excluded, MGSSymbolList *list)
+{
+    NSMutableArray<MGSSymbol *> *found = [NSMutableArray array];
+    MGSSymbol *prev = nil;
+    
+    for (MGSSymbolPattern *pattern in patterns) {
+        NSRegularExpression *regex = pattern.regularExpression;
+        
+        [regex enumerateMatchesInString:string options:0 range:NSMakeRange(0, string.length) usingBlock:^(NSTextCheckingResult *res, NSMatchingFlags flags, BOOL *stop) {
+            NSRange name = regex.numberOfCaptureGroups ? [res rangeAtIndex:1] : res.range;
+            
+            if (name.location == NSNotFound || name.length == 0 || [excluded containsIndex:name.location + offset])
+                return;
+            [found addObject:[[MGSSymbol alloc] initWithName:[string substringWithRange:name] kind:pattern.kind range:NSMakeRange(name.location + offset, name.length)]];
+        }];
+    }
+    
+    [found sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(MGSSymbol *a, MGSSymbol *b) {
+        if (a.range.location == b.range.location)
+            return NSOrderedSame;
+        return a.range.location < b.range.location ? NSOrderedAscending : NSOrderedDescending;
+    }];
+    for (MGSSymbol *sym in found) {
+        /* When several patterns match the same name, the first one wins */
+        if (prev && prev.range.location == sym.range.location)
+            continue;
+        [list addSymbolNamed:sym.name kind:sym.kind range:sym.range];
+        prev = sym;
+    }
+}
+
+
+#pragma mark - Symbol Index
+
+
+@implementation MGSSymbolIndex
+{
+    MGSSymbolList *_symbols;
+    NSMutableData *_nameOrder;          /* NSUInteger, the symbols sorted by name */
+    NSMutableIndexSet *_indexed;        /* The characters whose symbols are in the index */
+    NSMutableIndexSet *_pending;        /* The characters to index at the next flush */
+    NSMutableIndexSet *_inFlight;       /* The characters being indexed in the background */
+    NSMutableData *_edits;              /* MGSSymbolIndexEdit, made while indexing in the background */
+    NSUInteger _unindexedCursor;        /* No character before this one is missing from the index */
+    NSUInteger _sliceLength;
+    NSUInteger _jobsInFlight;
+    NSUInteger _generation;
+    NSUInteger _resetGeneration;
+    BOOL _flushScheduled;
+    BOOL _sliceScheduled;
+    BOOL _flushing;
+    dispatch_queue_t _queue;
+}
+
+
+#pragma mark - Initialization
+
+
+- (instancetype)initWithTextView:(MGSTextView *)textView
+{
+    self = [super init];
+    
+    _textView = textView;
+    _symbols = [[MGSSymbolList alloc] init];
+    _indexed = [NSMutableIndexSet indexSet];
+    _pending = [NSMutableIndexSet indexSet];
+    _inFlight = [NSMutableIndexSet indexSet];
+    _edits = [NSMutableData data];
+    _sliceLength = MGSSymbolIndexSliceLength;
+    _queue = dispatch_queue_create("com.mugginsoft.Fragaria.MGSSymbolIndex", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+    
+    textView.syntaxColouring.symbolIndex = self;
+    _indexing = YES;
+    [self scheduleSlice];
+    
+    return self;
+}
+
+
+#pragma mark - Querying the Symbols
+
+
+- (NSUInteger)numberOfSymbols
+{
+    return _symbols.count;
+}
+
+
+- (MGSSymbol *)symbolAtIndex:(NSUInteger)i
+{
+    if (i >= _symbols.count)
+        [NSException raise:NSRangeException format:@"Symbol index %lu out of bounds", (unsigned long)i];
+    return [_symbols symbolAtIndex:i];
+}
+
+
+- (NSArray<MGSSymbol *> *)symbolsInRange:(NSRange)range
+{
+    NSUInteger i = [_symbols indexOfFirstSymbolAtOrAfterCharacterIndex:range.location];
+    NSUInteger j = [_symbols indexOfFirstSymbolAtOrAfterCharacterIndex:NSMaxRange(range)];
+    NSMutableArray *res = [NSMutableArray arrayWithCapacity:j - i];
+    
+    for (; i < j; i++)
+        [res addObject:[_symbols symbolAtIndex:i]];
+    return res;
+}
+
+
+- (NSUInteger)indexOfLastSymbolAtOrBeforeCharacterIndex:(NSUInteger)i
+{
+    NSUInteger j = [_symbols indexOfFirstSymbolAtOrAfterCharacterIndex:i + 1];
+    
+    return j > 0 ? j - 1 : NSNotFound;
+}
+
+
+- (NSArray<MGSSymbol *> *)symbolsWithNamePrefix:(NSString *)prefix
+{
+    NSArray<NSString *> *names = _symbols->_names;
+    const NSUInteger *order;
+    NSUInteger lo = 0, hi, mid, n = names.count;
+    NSMutableArray *res = [NSMutableArray array];
+    
+    [self validateNameOrder];
+    order = _nameOrder.bytes;
+    
+    /* Find the first name which is not before the prefix */
+    hi = n;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if ([names[order[mid]] caseInsensitiveCompare:prefix] == NSOrderedAscending)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    for (; lo < n; lo++) {
+        if (prefix.length && [names[order[lo]] rangeOfString:prefix options:NSCaseInsensitiveSearch | NSAnchoredSearch].location == NSNotFound)
+            break;
+        [res addObject:[_symbols symbolAtIndex:order[lo]]];
+    }
+    return res;
+}
+
+
+/* Sorts the indexes of the symbols by name, if the symbols have changed
+ * since they were last sorted. */
+- (void)validateNameOrder
+{
+    NSArray<NSString *> *names = _symbols->_names;
+    NSUInteger i, n = names.count, *order;
+    
+    if (_nameOrder)
+        return;
+    
+    _nameOrder = [NSMutableData dataWithLength:n * sizeof(NSUInteger)];
+    order = _nameOrder.mutableBytes;
+    for (i = 0; i < n; i++)
+        order[i] = i;
+    qsort_b(order, n, sizeof(NSUInteger), ^int(const void *a, const void *b) {
+        NSUInteger ia = *(const NSUInteger *)a, ib = *(const NSUInteger *)b;
+        NSComparisonResult c = [names[ia] caseInsensitiveCompare:names[ib]];
+        
+        if (c == NSOrderedSame)
+            return ia < ib ? -1 : (ia > ib);
+        return c == NSOrderedAscending ? -1 : 1;
+    });
+}
+
+
+#pragma mark - Indexing
+
+
+- (void)scheduleFlush
+{
+    MGSSymbolIndex * __weak weakSelf = self;
+    
+    if (_flushScheduled)
+        return;
+    _flushScheduled = YES;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [weakSelf flushPendingRanges];
+    });
+}
+
+
+- (void)scheduleSlice
+{
+    MGSSymbolIndex * __weak weakSelf = self;
+    
+    if (_sliceScheduled)
+        return;
+    _sliceScheduled = YES;
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [weakSelf indexNextSlices];
+    });
+}
+
+
+/* Returns NO if the text which has not been parsed for display must be
+ * left alone. The text storages made for huge texts read the text lazily,
+ * and parsing all of it would defeat them. */
+- (BOOL)indexesWholeText
+{
+    NSTextStorage *ts = self.textView.textStorage;
+    
+    if ([ts isKindOfClass:[MGSAttributeOverlayTextStorage class]])
+        ts = [(MGSAttributeOverlayTextStorage *)ts parentTextStorage];
+    if ([ts isKindOfClass:[MGSMappedFileTextStorage class]] || [ts isKindOfClass:[MGSPieceTableTextStorage class]])
+        return NO;
+    return ts.length <= MGSSymbolIndexMaximumWholeTextLength;
+}
+
+
+/* Returns the first range of characters which has not been indexed and is
+ * not going to be, or {NSNotFound, 0}. */
+- (NSRange)firstUnindexedRange
+{
+    NSUInteger len = self.textView.textStorage.length;
+    NSUInteger i = _unindexedCursor, prev, end;
+    
+    /* Skip the characters which are indexed or about to be, starting from
+     * where the last search stopped */
+    do {
+        prev = i;
+        i = MGSEndOfRunAtIndex(_indexed, i);
+        i = MGSEndOfRunAtIndex(_pending, i);
+        i = MGSEndOfRunAtIndex(_inFlight, i);
+    } while (i != prev);
+    _unindexedCursor = i;
+    if (i >= len)
+        return NSMakeRange(NSNotFound, 0);
+    
+    end = MIN([_indexed indexGreaterThanIndex:i], [_pending indexGreaterThanIndex:i]);
+    end = MIN(end, [_inFlight indexGreaterThanIndex:i]);
+    end = MIN(end, len);
+    return NSMakeRange(i, end - i);
+}
+
+
+/* Parses and indexes the text which has not been indexed yet, a slice at a
+ * time, until the time available for this run loop iteration is over. */
+- (void)indexNextSlices
+{
+    NSString *string = self.textView.textStorage.string;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent(), sliceStart, now;
+    NSRange range;
+    NSUInteger end;
+    
+    _sliceScheduled = NO;
+    for (;;) {
+        range = [self indexesWholeText] ? [self firstUnindexedRange] : NSMakeRange(NSNotFound, 0);
+        if (range.location == NSNotFound) {
+            [self updateIndexingState];
+            return;
+        }
+        end = MIN(NSMaxRange(range), range.location + _sliceLength);
+        range = [string lineRangeForRange:NSMakeRange(range.location, end - range.location)];
+        sliceStart = CFAbsoluteTimeGetCurrent();
+        [_pending addIndexesInRange:range];
+        [self flushPendingRanges];
+        now = CFAbsoluteTimeGetCurrent();
+        
+        /* The time needed to parse a slice depends on the parser and on the
+         * text; halve the slices which take more than half of the time
+         * available, so that a single slice does not exceed it. */
+        if (now - sliceStart > MGSSymbolIndexSliceDuration / 2)
+            _sliceLength = MAX(MGSSymbolIndexMinimumSliceLength, _sliceLength / 2);
+        else if (now - sliceStart < MGSSymbolIndexSliceDuration / 8)
+            _sliceLength = MIN(MGSSymbolIndexMaximumSliceLength, _sliceLength * 2);
+        
+        if (now - start >= MGSSymbolIndexSliceDuration)
+            break;
+    }
+    [self scheduleSlice];
+}
+
+
+/* Parses the lines which must be indexed, if needed, and finds their
+ * symbols in the background. */
+- (void)flushPendingRanges
+{
+    MGSTextView *tv = self.textView;
+    MGSSyntaxColouring *sc = tv.syntaxColouring;
+    NSString *string = tv.textStorage.string;
+    NSArray<MGSSymbolPattern *> *patterns = sc.parser.symbolPatterns;
+    NSMutableIndexSet *lines = [NSMutableIndexSet indexSet];
+    NSMutableArray<NSString *> *texts = [NSMutableArray array];
+    NSMutableArray<NSIndexSet *> *excluded = [NSMutableArray array];
+    NSMutableData *offsets = [NSMutableData data];
+    MGSSymbolIndex * __weak weakSelf = self;
+    NSUInteger generation = _generation;
+    
+    _flushScheduled = NO;
+    if (_pending.count == 0)
+        return;
+    
+    [_pending enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        if (range.location >= string.length)
+            return;
+        range.length = MIN(range.length, string.length - range.location);
+        [lines addIndexesInRange:[string lineRangeForRange:range]];
+    }];
+    [_pending removeAllIndexes];
+    
+    if (patterns.count == 0) {
+        [self mergeSymbols:[[MGSSymbolList alloc] init] inRanges:lines generation:generation];
+        return;
+    }
+    
+    /* Make sure that the tokens are valid, and copy the lines with the
+     * ranges of their comments and strings */
+    _flushing = YES;
+    [lines enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        NSMutableIndexSet *exc = [NSMutableIndexSet indexSet];
+        
+        if (tv.isSyntaxColoured)
+            [sc recolourRange:range];
+        [sc enumerateTokenGroupsInRange:range usingBlock:^(NSRange run, MGSSyntaxGroup group, BOOL *stop2) {
+            if ([group isEqual:MGSSyntaxGroupComment] || [group isEqual:MGSSyntaxGroupString])
+                [exc addIndexesInRange:run];
+        }];
+        [texts addObject:[string substringWithRange:range]];
+        [excluded addObject:exc];
+        [offsets appendBytes:&range.location length:sizeof(NSUInteger)];
+    }];
+    _flushing = NO;
+    
+    _jobsInFlight++;
+    [_inFlight addIndexes:lines];
+    dispatch_async(_queue, ^{
+        MGSSymbolList *found = [[MGSSymbolList alloc] init];
+        const NSUInteger *off = offsets.bytes;
+        NSUInteger i;
+        
+        for (i = 0; i < texts.count; i++)
+            MGSFindSymbols(patterns, texts[i], off[i], excluded[i], found);
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            MGSSymbolIndex *si = weakSelf;
+            if (!si)
+                return;
+            si->_jobsInFlight--;
+            [si mergeSymbols:found inRanges:lines generation:generation];
+        });
+    });
+}
+
+
+/* Replaces the symbols in some ranges of characters with the symbols found
+ * in the background, after having applied to them the edits made since the
+ * ranges were copied. */
+- (void)mergeSymbols:(MGSSymbolList *)found inRanges:(NSIndexSet *)ranges generation:(NSUInteger)generation
+{
+    NSMutableIndexSet *valid = [ranges mutableCopy];
+    const MGSSymbolIndexEdit *e = _edits.bytes;
+    NSUInteger i, n = _edits.length / sizeof(MGSSymbolIndexEdit);
+    NSRange changed;
+    
+    if (generation >= _resetGeneration) {
+        for (i = 0; i < n; i++) {
+            if (e[i].generation <= generation)
+                continue;
+            MGSShiftIndexesForEdit(valid, e[i].oldLines, e[i].changeInLength);
+            [found shiftSymbolsForEditedLines:e[i].oldLines changeInLength:e[i].changeInLength];
+        }
+    } else {
+        /* The symbols were found before the index was invalidated */
+        [valid removeAllIndexes];
+    }
+    if (_jobsInFlight == 0)
+        _edits.length = 0;
+    
+    [_inFlight removeIndexes:valid];
+    [valid enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+        [self->_symbols replaceSymbolsInCharacterRange:range withSymbolsOfList:found];
+    }];
+    [_indexed addIndexes:valid];
+    _nameOrder = nil;
+    
+    if (valid.count && [self.delegate respondsToSelector:@selector(symbolIndex:didUpdateSymbolsInRange:)]) {
+        changed = NSMakeRange(valid.firstIndex, valid.lastIndex + 1 - valid.firstIndex);
+        [self.delegate symbolIndex:self didUpdateSymbolsInRange:changed];
+    }
+    [self updateIndexingState];
+}
+
+
+- (void)updateIndexingState
+{
+    if ([self indexesWholeText] && [self firstUnindexedRange].location != NSNotFound) {
+        _indexing = YES;
+        [self scheduleSlice];
+        return;
+    }
+    if (_jobsInFlight > 0 || _pending.count > 0) {
+        _indexing = YES;
+        return;
+    }
+    if (!_indexing)
+        return;
+    
+    _indexing = NO;
+    if ([self.delegate respondsToSelector:@selector(symbolIndexDidFinishIndexing:)])
+        [self.delegate symbolIndexDidFinishIndexing:self];
+}
+
+
+#pragma mark - Updating the Index
+
+
+- (void)tokensDidChangeInRange:(NSRange)range
+{
+    if (_flushing || range.length == 0)
+        return;
+    [_pending addIndexesInRange:range];
+    [self scheduleFlush];
+}
+
+
+- (void)textDidChangeInRange:(NSRange)newRange changeInLength:(NSInteger)changeInLength
+{
+    NSString *string = self.textView.textStorage.string;
+    NSRange lines = [string lineRangeForRange:newRange];
+    MGSSymbolIndexEdit edit;
+    
+    edit.oldLines = NSMakeRange(lines.location, lines.length - changeInLength);
+    edit.changeInLength = changeInLength;
+    edit.generation = ++_generation;
+    
+    [_symbols shiftSymbolsForEditedLines:edit.oldLines changeInLength:changeInLength];
+    MGSShiftIndexesForEdit(_indexed, edit.oldLines, changeInLength);
+    MGSShiftIndexesForEdit(_pending, edit.oldLines, changeInLength);
+    MGSShiftIndexesForEdit(_inFlight, edit.oldLines, changeInLength);
+    _unindexedCursor = MIN(_unindexedCursor, lines.location);
+    _nameOrder = nil;
+    
+    /* The symbols found in the background must be moved like the others
+     * when they are merged */
+    if (_jobsInFlight > 0)
+        [_edits appendBytes:&edit length:sizeof(MGSSymbolIndexEdit)];
+    
+    [_pending addIndexesInRange:lines];
+    [self scheduleFlush];
+    _indexing = YES;
+}
+
+
+- (void)invalidateAllSymbols
+{
+    NSUInteger oldCount = _symbols.count;
+    NSRange all = NSMakeRange(0, self.textView.textStorage.length);
+    
+    _symbols = [[MGSSymbolList alloc] init];
+    _nameOrder = nil;
+    [_indexed removeAllIndexes];
+    [_pending removeAllIndexes];
+    [_inFlight removeAllIndexes];
+    _edits.length = 0;
+    _unindexedCursor = 0;
+    
+    /* Discard the symbols being found in the background */
+    _resetGeneration = ++_generation;
+    
+    if (oldCount && [self.delegate respondsToSelector:@selector(symbolIndex:didUpdateSymbolsInRange:)])
+        [self.delegate symbolIndex:self didUpdateSymbolsInRange:all];
+    _indexing = YES;
+    [self scheduleSlice];
+}
+
+
+@end
@@ -0,0 +1,38 @@
+//
+//  MGSSymbolIndexPrivate.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Foundation/Foundation.h>
+#import "MGSSymbolIndex.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@interface MGSSymbolIndex ()
+
+
+/** Called by the syntax colouring after a range of characters has been
+ *  parsed. The lines in the range are indexed again.
+ *  @param range The range of characters which was parsed. */
+- (void)tokensDidChangeInRange:(NSRange)range;
+
+/** Called by the syntax colouring when the text has been edited.
+ *  @param newRange The range of the edited characters, after the edit.
+ *  @param changeInLength The difference between the lengths of the text
+ *    after and before the edit. */
+- (void)textDidChangeInRange:(NSRange)newRange changeInLength:(NSInteger)changeInLength;
+
+/** Called by the syntax colouring when the parser or the whole text have
+ *  been replaced. All the symbols are removed, and the text is indexed
+ *  again. */
+- (void)invalidateAllSymbols;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -23,6 +23,7 @@
 #import "MGSSyntaxColouring.h"
 #import "MGSLayoutManager.h"
 #import "MGSTextView.h"
+#import "MGSSymbolIndexPrivate.h"
 
 
 @implementation MGSSyntaxColouring
@@ -55,15 +56,7 @@
     if (!(ts.editedMask & NSTextStorageEditedCharacters))
         return;
     
-    NSRange newRange = [ts editedRange];
-    NSRange oldRange = newRange;
-    NSInteger changeInLength = [ts changeInLength];
-    NSMutableIndexSet *insp = self.inspectedCharacterIndexes;
-    
-    oldRange.length -= changeInLength;
-    [insp shiftIndexesStartingAtIndex:NSMaxRange(oldRange) by:changeInLength];
-    newRange = [[ts string] lineRangeForRange:newRange];
-    [insp removeIndexesInRange:newRange];
+    [self invalidateColouringForEditedRange:[ts editedRange] changeInLength:[ts changeInLength]];
 }
 
 
@@ -83,6 +76,8 @@
     NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
     [nc addObserver:self selector:@selector(textStorageDidProcessEditing:)
                name:NSTextStorageDidProcessEditingNotification object:layoutManager.textStorage];
+    [self resetIncrementalParsing];
+    [self.symbolIndex invalidateAllSymbols];
 }
 
 
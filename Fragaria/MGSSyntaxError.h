@@ -30,6 +30,22 @@ extern float const kMGSErrorCategoryDefault;  ///< kMGSErrorCategoryWarning
 /** @} */
 
 
+/** A compact description of a syntax error, used for passing many syntax
+ *  errors at once to Fragaria without creating a MGSSyntaxError for each
+ *  one of them.
+ *  @discussion The fields have the same meaning as the MGSSyntaxError
+ *              properties with the same name. The errorDescription string is
+ *              not retained, thus it must stay alive for the duration of the
+ *              call the record is passed to. */
+typedef struct {
+    NSUInteger line;            ///< One-based line of the error.
+    NSUInteger character;       ///< One-based column of the error.
+    NSUInteger length;          ///< Length of the error, in characters.
+    float warningLevel;         ///< Severity of the error.
+    __unsafe_unretained NSString *errorDescription; ///< Error message.
+} MGSSyntaxErrorRecord;
+
+
 /** 
  *  MGSSyntaxError is a model class that stores the syntax errors to be
  *  shown in Fragaria's text view and gutter.
@@ -75,6 +91,12 @@ extern float const kMGSErrorCategoryDefault;  ///< kMGSErrorCategoryWarning
 + (instancetype)errorWithDescription:(NSString *)desc ofLevel:(float)level
                               atLine:(NSUInteger)line;
 
+/** Return an MGSSyntaxError with the properties specified by a syntax error
+ *  record.
+ *  @discussion The created error will not be hidden.
+ *  @param record The record containing the properties of the error. */
++ (instancetype)errorWithRecord:(MGSSyntaxErrorRecord)record;
+
 /** Returns an MGSSyntaxError initialized as specified by the given dictionary.
  *  @param dictionary A dictionary where each key is a property name. */
 - (instancetype)initWithDictionary:(NSDictionary *)dictionary;
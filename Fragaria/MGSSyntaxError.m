@@ -76,6 +76,20 @@ float const kMGSErrorCategoryDefault  = 450.0;
 }
 
 
++ (instancetype)errorWithRecord:(MGSSyntaxErrorRecord)record
+{
+    MGSSyntaxError *res;
+    
+    res = [[MGSSyntaxError alloc] init];
+    res.errorDescription = record.errorDescription;
+    res.line = record.line;
+    res.character = record.character;
+    res.length = record.length;
+    res.warningLevel = record.warningLevel;
+    return res;
+}
+
+
 #pragma mark - Instance Methods
 
 
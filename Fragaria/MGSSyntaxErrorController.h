@@ -7,11 +7,11 @@
 /// @cond PRIVATE
 
 #import <Cocoa/Cocoa.h>
+#import "MGSSyntaxError.h"
 
 
 @class MGSTextView;
 @class MGSLineNumberView;
-@class MGSSyntaxError;
 
 
 /**
@@ -26,7 +26,12 @@
 
 
 /** The array of MGSSyntaxError objects which determines the syntax errors
- * shown in the line number view and the text view. */
+ * shown in the line number view and the text view.
+ * @discussion When lines are added or removed from the text, the errors
+ *   shown after the edited line are moved accordingly, until a new array of
+ *   syntax errors is set. After the errors are replaced with records, this
+ *   array contains the errors created from the records, followed by the
+ *   hidden errors of the last array which was set. */
 @property (nonatomic, strong) NSArray *syntaxErrors;
 
 /** Set to YES when syntax errors should be visible both in the line number
@@ -93,6 +98,43 @@
  **/
 - (NSDictionary *)errorDecorations;
 
+/**
+ *  Replaces the syntax errors with the errors described by an array of
+ *  syntax error records.
+ *  @discussion Only the lines whose errors differ from the ones currently
+ *    shown are updated in the text view and in the line number view.
+ *    The MGSSyntaxError objects of the errors which did not change are
+ *    kept as they are.
+ *  @param records A C array of syntax error records.
+ *  @param count The number of records in the array.
+ **/
+- (void)setSyntaxErrorRecords:(const MGSSyntaxErrorRecord *)records count:(NSUInteger)count;
+
+/**
+ *  Starts replacing the syntax errors with records passed progressively
+ *  through addSyntaxErrorRecords:count:.
+ *  @discussion Errors on lines that have not received any record yet are
+ *    kept until endSyntaxErrorRecordUpdate is called.
+ **/
+- (void)beginSyntaxErrorRecordUpdate;
+
+/**
+ *  Adds some syntax error records to the update started by
+ *  beginSyntaxErrorRecordUpdate, and updates the display of the lines they
+ *  refer to.
+ *  @discussion The errors of a line are replaced by the first record
+ *    referring to that line; afterwards, records are appended to them.
+ *  @param records A C array of syntax error records.
+ *  @param count The number of records in the array.
+ **/
+- (void)addSyntaxErrorRecords:(const MGSSyntaxErrorRecord *)records count:(NSUInteger)count;
+
+/**
+ *  Ends the update started by beginSyntaxErrorRecordUpdate, removing the
+ *  errors of the lines which did not receive any record.
+ **/
+- (void)endSyntaxErrorRecordUpdate;
+
 /**
  *  Displays an NSPopover indicating the error(s).
  *  @param line indicates the line number from which errors should be shown.
@@ -40,8 +40,52 @@
 
 
 
+@interface MGSSyntaxErrorLineEntry : NSObject
+
+/* The non-hidden errors of a single line, in the same order they had in the
+ * syntaxErrors array, together with the error that wins the decoration of
+ * the line (the first one with the highest warningLevel). */
+
+@property (nonatomic, readonly) NSMutableArray *errors;
+@property (nonatomic, readonly) MGSSyntaxError *topError;
+
+- (void)addError:(MGSSyntaxError *)error;
+
+@end
+
+@implementation MGSSyntaxErrorLineEntry
+
+- (instancetype)init
+{
+    self = [super init];
+    _errors = [[NSMutableArray alloc] init];
+    return self;
+}
+
+- (void)addError:(MGSSyntaxError *)error
+{
+    [_errors addObject:error];
+    if (!_topError || error.warningLevel > _topError.warningLevel)
+        _topError = error;
+}
+
+@end
+
+
+
 @implementation MGSSyntaxErrorController
+{
+    NSArray *_nonHiddenErrors;
+    NSArray *_hiddenErrors;
+    NSMutableIndexSet *_indexedLines;
+    NSMutableDictionary <NSNumber *, MGSSyntaxErrorLineEntry *> *_lineIndex;
+    NSDictionary *_errorDecorations;
+    NSUInteger _lastLineCount;
+    BOOL _syntaxErrorsNeedRebuild;
+    NSMutableDictionary <NSNumber *, id> *_updateBaseEntries;
+}
 
+@synthesize syntaxErrors = _syntaxErrors;
 @synthesize defaultSyntaxErrorHighlightingColour = _defaultSyntaxErrorHighlightingColour;
 
 #pragma mark - Property Accessors
@@ -53,10 +97,25 @@
         return [evaluatedObject isKindOfClass:[MGSSyntaxError class]];
     }];
     _syntaxErrors = [syntaxErrors filteredArrayUsingPredicate:filter];
+    _syntaxErrorsNeedRebuild = NO;
+    _updateBaseEntries = nil;
+    [self rebuildLineIndex];
     [self updateSyntaxErrorsDisplay];
 }
 
 
+- (NSArray *)syntaxErrors
+{
+    if (_syntaxErrorsNeedRebuild) {
+        /* The records cannot describe hidden errors; those which were set
+         * with the array are kept */
+        _syntaxErrors = [[self nonHiddenErrors] arrayByAddingObjectsFromArray:_hiddenErrors];
+        _syntaxErrorsNeedRebuild = NO;
+    }
+    return _syntaxErrors;
+}
+
+
 - (void)setShowsSyntaxErrors:(BOOL)showSyntaxErrors
 {
     _showsSyntaxErrors = showSyntaxErrors;
@@ -109,6 +168,8 @@
 - (void)layoutManagerDidChangeTextStorage
 {
     NSNotificationCenter *nc = [NSNotificationCenter defaultCenter];
+    
+    _lastLineCount = self.textView.textStorage.mgs_lineCount;
     [nc addObserver:self selector:@selector(textStorageDidProcessEditing:)
       name:NSTextStorageDidProcessEditingNotification object:self.textView.textStorage];
     [self updateSyntaxErrorsDisplay];
@@ -139,6 +200,20 @@
 
 - (void)textStorageDidProcessEditing:(NSNotification*)note
 {
+    NSTextStorage *ts = self.textView.textStorage;
+    NSUInteger lineCount;
+    
+    if (ts.changeInLength) {
+        lineCount = ts.mgs_lineCount;
+        if (lineCount != _lastLineCount) {
+            [self shiftLineIndexAfterRow:[ts mgs_rowOfCharacter:ts.editedRange.location]
+              by:(NSInteger)lineCount - (NSInteger)_lastLineCount];
+            _lastLineCount = lineCount;
+            if (_showsSyntaxErrors)
+                [self.lineNumberView setDecorations:[self errorDecorations]];
+        }
+    }
+    
     /* Defer to the end of this run loop because when this notification is
      * received, the layout manager is not yet updated with the new contents
      * of the text storage. */
@@ -163,13 +238,23 @@
     if (!self.showsSyntaxErrors) return;
 	
     // Highlight all lines with errors
-    NSMutableSet* highlightedRows = [NSMutableSet set];
+    [_indexedLines enumerateIndexesUsingBlock:^(NSUInteger line, BOOL *stop) {
+        [self highlightErrorsOfEntry:self->_lineIndex[@(line)] atLine:line];
+    }];
+}
+
+
+- (void)highlightErrorsOfEntry:(MGSSyntaxErrorLineEntry *)entry atLine:(NSUInteger)line
+{
+    NSLayoutManager *layoutManager = [self.textView layoutManager];
+    NSString* text = [layoutManager.textStorage string];
+    NSUInteger zbl = line - (line != 0);
+    BOOL highlightedRow = NO;
     
-    for (MGSSyntaxError* err in self.nonHiddenErrors)
+    for (MGSSyntaxError* err in entry.errors)
     {
         // Highlight an erroneous line
         NSUInteger zbc = err.character - (err.character != 0);
-        NSUInteger zbl = err.line - (err.line != 0);
         NSUInteger location = [layoutManager.textStorage mgs_characterAtIndex:zbc withinRow:zbl];
         
         // Skip lines we cannot identify in the text
@@ -178,10 +263,9 @@
         NSRange lineRange = [text lineRangeForRange:NSMakeRange(location, 0)];
         
         // Highlight row if it is not already highlighted
-        if (![highlightedRows containsObject:[NSNumber numberWithUnsignedInteger:err.line]])
+        if (!highlightedRow)
         {
-            // Remember that we are highlighting this row
-            [highlightedRows addObject:[NSNumber numberWithUnsignedInteger:err.line]];
+            highlightedRow = YES;
             
             // Add highlight for background
             NSColor *highlightColor = err.errorLineHighlightColor ? err.errorLineHighlightColor : self.defaultSyntaxErrorHighlightingColour;
@@ -201,6 +285,282 @@
 }
 
 
+- (void)removeHighlightsOfEntry:(MGSSyntaxErrorLineEntry *)entry atLine:(NSUInteger)line
+{
+    NSLayoutManager *layoutManager = [self.textView layoutManager];
+    NSTextStorage *ts = layoutManager.textStorage;
+    NSUInteger zbl = line - (line != 0);
+    NSUInteger location;
+    NSRange range;
+    
+    location = [ts mgs_firstCharacterInRow:zbl];
+    if (location == NSNotFound) return;
+    range = [ts.string lineRangeForRange:NSMakeRange(location, 0)];
+    
+    /* Errors longer than the line have highlights outside of it */
+    for (MGSSyntaxError* err in entry.errors) {
+        NSUInteger zbc = err.character - (err.character != 0);
+        location = [ts mgs_characterAtIndex:zbc withinRow:zbl];
+        if (location != NSNotFound)
+            range = NSUnionRange(range, NSMakeRange(location, err.length));
+    }
+    range = NSIntersectionRange(range, NSMakeRange(0, ts.length));
+    
+    [layoutManager removeTemporaryAttribute:NSBackgroundColorAttributeName forCharacterRange:range];
+    [layoutManager removeTemporaryAttribute:NSToolTipAttributeName forCharacterRange:range];
+    [layoutManager removeTemporaryAttribute:NSUnderlineStyleAttributeName forCharacterRange:range];
+}
+
+
+#pragma mark - Line index
+
+
+/* The line index maps each one-based line number to the non-hidden errors
+ * which are shown on that line. It is built once every time the syntax
+ * errors are set, and afterwards it is kept in sync with the text by
+ * shifting it when lines are added or removed; thus the line where an error
+ * is displayed may differ from its line property after an edit. */
+
+
+- (void)rebuildLineIndex
+{
+    NSMutableArray *nonHidden = [[NSMutableArray alloc] init];
+    NSMutableArray *hidden = [[NSMutableArray alloc] init];
+    
+    _indexedLines = [[NSMutableIndexSet alloc] init];
+    _lineIndex = [[NSMutableDictionary alloc] init];
+    _errorDecorations = nil;
+    
+    for (MGSSyntaxError *err in _syntaxErrors) {
+        if (err.hidden) {
+            [hidden addObject:err];
+            continue;
+        }
+        [nonHidden addObject:err];
+        [self indexError:err atLine:err.line];
+    }
+    _nonHiddenErrors = [nonHidden copy];
+    _hiddenErrors = [hidden copy];
+}
+
+
+- (void)indexError:(MGSSyntaxError *)err atLine:(NSUInteger)line
+{
+    MGSSyntaxErrorLineEntry *entry = _lineIndex[@(line)];
+    
+    if (!entry) {
+        entry = [[MGSSyntaxErrorLineEntry alloc] init];
+        _lineIndex[@(line)] = entry;
+        [_indexedLines addIndex:line];
+    }
+    [entry addError:err];
+}
+
+
+- (void)shiftLineIndexAfterRow:(NSUInteger)row by:(NSInteger)delta
+{
+    NSUInteger first = row + 2;
+    NSUInteger shiftStart = first;
+    NSMutableIndexSet *movedLines;
+    NSMutableArray *moved;
+    NSRange removed;
+    
+    if (![_indexedLines count] || [_indexedLines lastIndex] < first)
+        return;
+    
+    if (delta < 0) {
+        /* Errors on lines which were deleted end up on the line where the
+         * deletion took place. */
+        removed = NSMakeRange(first, -delta);
+        shiftStart = NSMaxRange(removed);
+        NSIndexSet *removedLines = [_indexedLines indexesInRange:removed options:0 passingTest:^BOOL(NSUInteger idx, BOOL *stop) {
+            return YES;
+        }];
+        [_indexedLines removeIndexesInRange:removed];
+        [removedLines enumerateIndexesUsingBlock:^(NSUInteger line, BOOL *stop) {
+            for (MGSSyntaxError *err in self->_lineIndex[@(line)].errors)
+                [self indexError:err atLine:first - 1];
+            [self->_lineIndex removeObjectForKey:@(line)];
+        }];
+    }
+    
+    movedLines = [_indexedLines mutableCopy];
+    [movedLines removeIndexesInRange:NSMakeRange(0, shiftStart)];
+    moved = [[NSMutableArray alloc] initWithCapacity:[movedLines count]];
+    [movedLines enumerateIndexesUsingBlock:^(NSUInteger line, BOOL *stop) {
+        [moved addObject:self->_lineIndex[@(line)]];
+        [self->_lineIndex removeObjectForKey:@(line)];
+    }];
+    [_indexedLines shiftIndexesStartingAtIndex:shiftStart by:delta];
+    
+    __block NSUInteger i = 0;
+    [movedLines enumerateIndexesUsingBlock:^(NSUInteger line, BOOL *stop) {
+        self->_lineIndex[@(line + delta)] = moved[i++];
+    }];
+    
+    /* Lines already received by a batch update in progress must stay
+     * attached to the same text */
+    if (_updateBaseEntries) {
+        NSMutableDictionary *shifted = [[NSMutableDictionary alloc] init];
+        for (NSNumber *key in [_updateBaseEntries allKeys]) {
+            NSUInteger line = [key unsignedIntegerValue];
+            if (line < first) continue;
+            if (line >= shiftStart)
+                shifted[@(line + delta)] = _updateBaseEntries[key];
+            [_updateBaseEntries removeObjectForKey:key];
+        }
+        [_updateBaseEntries addEntriesFromDictionary:shifted];
+    }
+    
+    _errorDecorations = nil;
+}
+
+
+#pragma mark - Syntax error records
+
+
+static BOOL MGSSyntaxErrorMatchesRecord(MGSSyntaxError *err, const MGSSyntaxErrorRecord *rec)
+{
+    if (err.character != rec->character || err.length != rec->length)
+        return NO;
+    if (err.warningLevel != rec->warningLevel)
+        return NO;
+    if (err.errorDescription == rec->errorDescription)
+        return YES;
+    return [err.errorDescription isEqualToString:rec->errorDescription];
+}
+
+
+- (void)setSyntaxErrorRecords:(const MGSSyntaxErrorRecord *)records count:(NSUInteger)count
+{
+    [self beginSyntaxErrorRecordUpdate];
+    [self addSyntaxErrorRecords:records count:count];
+    [self endSyntaxErrorRecordUpdate];
+}
+
+
+- (void)beginSyntaxErrorRecordUpdate
+{
+    _updateBaseEntries = [[NSMutableDictionary alloc] init];
+}
+
+
+- (void)addSyntaxErrorRecords:(const MGSSyntaxErrorRecord *)records count:(NSUInteger)count
+{
+    NSMutableDictionary *previousEntries = [[NSMutableDictionary alloc] init];
+    NSNull *none = [NSNull null];
+    NSUInteger i;
+    
+    if (!_updateBaseEntries)
+        [NSException raise:NSInternalInconsistencyException format:@"-addSyntaxErrorRecords:count: "
+          "called without calling -beginSyntaxErrorRecordUpdate first"];
+    
+    for (i = 0; i < count; i++) {
+        const MGSSyntaxErrorRecord *rec = &records[i];
+        NSNumber *key = @(rec->line);
+        MGSSyntaxErrorLineEntry *entry = _lineIndex[key];
+        MGSSyntaxErrorLineEntry *base;
+        MGSSyntaxError *err;
+        NSUInteger n;
+        
+        if (!previousEntries[key]) {
+            /* First record of this line since the beginning of this call;
+             * the entry currently displayed is never modified in place, so
+             * that it can be compared with the new one afterwards. */
+            previousEntries[key] = entry ?: (id)none;
+            if (!_updateBaseEntries[key]) {
+                _updateBaseEntries[key] = entry ?: (id)none;
+                entry = [[MGSSyntaxErrorLineEntry alloc] init];
+            } else {
+                MGSSyntaxErrorLineEntry *partial = entry;
+                entry = [[MGSSyntaxErrorLineEntry alloc] init];
+                for (err in partial.errors)
+                    [entry addError:err];
+            }
+            _lineIndex[key] = entry;
+            [_indexedLines addIndex:rec->line];
+        }
+        
+        /* Reuse the existing error object if the record did not change */
+        base = _updateBaseEntries[key];
+        n = [entry.errors count];
+        err = nil;
+        if (base != (id)none && n < [base.errors count]) {
+            err = base.errors[n];
+            if (!MGSSyntaxErrorMatchesRecord(err, rec))
+                err = nil;
+        }
+        if (!err)
+            err = [MGSSyntaxError errorWithRecord:*rec];
+        [entry addError:err];
+    }
+    
+    [self updateSyntaxErrorsDisplayOfLinesWithPreviousEntries:previousEntries];
+}
+
+
+- (void)endSyntaxErrorRecordUpdate
+{
+    NSMutableDictionary *previousEntries = [[NSMutableDictionary alloc] init];
+    NSMutableIndexSet *staleLines;
+    
+    if (!_updateBaseEntries)
+        [NSException raise:NSInternalInconsistencyException format:@"-endSyntaxErrorRecordUpdate "
+          "called without calling -beginSyntaxErrorRecordUpdate first"];
+    
+    /* Lines which did not receive any record are now free of errors */
+    staleLines = [_indexedLines mutableCopy];
+    for (NSNumber *key in _updateBaseEntries)
+        [staleLines removeIndex:[key unsignedIntegerValue]];
+    [staleLines enumerateIndexesUsingBlock:^(NSUInteger line, BOOL *stop) {
+        previousEntries[@(line)] = self->_lineIndex[@(line)];
+        [self->_lineIndex removeObjectForKey:@(line)];
+    }];
+    [_indexedLines removeIndexes:staleLines];
+    _updateBaseEntries = nil;
+    
+    [self updateSyntaxErrorsDisplayOfLinesWithPreviousEntries:previousEntries];
+}
+
+
+- (void)updateSyntaxErrorsDisplayOfLinesWithPreviousEntries:(NSDictionary *)previousEntries
+{
+    NSMutableDictionary *decorations = nil;
+    NSNull *none = [NSNull null];
+    BOOL highlight = _textView && _showsSyntaxErrors;
+    
+    for (NSNumber *key in previousEntries) {
+        NSUInteger line = [key unsignedIntegerValue];
+        MGSSyntaxErrorLineEntry *oldEntry = previousEntries[key];
+        MGSSyntaxErrorLineEntry *newEntry = _lineIndex[key];
+        
+        if (oldEntry == (id)none) oldEntry = nil;
+        if ([oldEntry.errors isEqualToArray:newEntry.errors] || (!oldEntry && !newEntry))
+            continue;
+        
+        if (highlight) {
+            [self removeHighlightsOfEntry:oldEntry atLine:line];
+            [self highlightErrorsOfEntry:newEntry atLine:line];
+        }
+        
+        if (!decorations)
+            decorations = [[self errorDecorations] mutableCopy];
+        if (newEntry)
+            decorations[key] = newEntry.topError;
+        else
+            [decorations removeObjectForKey:key];
+    }
+    
+    if (!decorations)
+        return;
+    _errorDecorations = [decorations copy];
+    _nonHiddenErrors = nil;
+    _syntaxErrorsNeedRebuild = YES;
+    if (_showsSyntaxErrors)
+        [self.lineNumberView setDecorations:_errorDecorations];
+}
+
+
 #pragma mark - Instance Methods
 
 
@@ -212,47 +572,68 @@
 
 - (NSArray *)linesWithErrors
 {
-    return [[self.syntaxErrors filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"hidden == %@", @(NO)]] valueForKeyPath:@"@distinctUnionOfObjects.line"];
+    NSMutableArray *res = [[NSMutableArray alloc] initWithCapacity:[_indexedLines count]];
+    
+    [_indexedLines enumerateIndexesUsingBlock:^(NSUInteger line, BOOL *stop) {
+        [res addObject:@(line)];
+    }];
+    return res;
 }
 
 
 - (NSUInteger)errorCountForLine:(NSInteger)line
 {
-    return [[[self.syntaxErrors filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"(line == %@) AND (hidden == %@)", @(line), @(NO)]] valueForKeyPath:@"@count"] integerValue];
+    if (line < 0) return 0;
+    return [_lineIndex[@(line)].errors count];
 }
 
 
 - (MGSSyntaxError *)errorForLine:(NSInteger)line
 {
-    float highestErrorLevel = [[[self errorsForLine:line] valueForKeyPath:@"@max.warningLevel"] floatValue];
-    NSArray* errors = [[self errorsForLine:line] filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"warningLevel = %@", @(highestErrorLevel)]];
-
-    return errors.firstObject;
+    if (line < 0) return nil;
+    return _lineIndex[@(line)].topError;
 }
 
 
 - (NSArray*)errorsForLine:(NSInteger)line
 {
-    return [self.syntaxErrors filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"(line == %@) AND (hidden == %@)", @(line), @(NO)]];
+    NSArray *errors;
+    
+    if (line >= 0 && (errors = _lineIndex[@(line)].errors))
+        return [errors copy];
+    return @[];
 }
 
 
 - (NSArray *)nonHiddenErrors
 {
-    return [self.syntaxErrors filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"hidden == %@", @(NO)]];
+    NSMutableArray *res;
+    
+    if (_nonHiddenErrors)
+        return _nonHiddenErrors;
+    
+    res = [[NSMutableArray alloc] init];
+    [_indexedLines enumerateIndexesUsingBlock:^(NSUInteger line, BOOL *stop) {
+        [res addObjectsFromArray:self->_lineIndex[@(line)].errors];
+    }];
+    _nonHiddenErrors = [res copy];
+    return _nonHiddenErrors;
 }
 
 
 - (NSDictionary *)errorDecorations
 {
-    NSMutableDictionary *result = [[NSMutableDictionary alloc] init];
+    NSMutableDictionary *result;
     
-    for (NSNumber *line in [self linesWithErrors]) {
-        id decoration = [self errorForLine:[line integerValue]];
-        [result setObject:decoration forKey:line];
-    }
+    if (_errorDecorations)
+        return _errorDecorations;
     
-    return result;
+    result = [[NSMutableDictionary alloc] initWithCapacity:[_lineIndex count]];
+    [_lineIndex enumerateKeysAndObjectsUsingBlock:^(NSNumber *line, MGSSyntaxErrorLineEntry *entry, BOOL *stop) {
+        [result setObject:entry.topError forKey:line];
+    }];
+    _errorDecorations = [result copy];
+    return _errorDecorations;
 }
 
 
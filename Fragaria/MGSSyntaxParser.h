@@ -12,6 +12,8 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class MGSSymbolPattern;
+
 
 /** Syntax Parsers are objects that perform several language-related services
  *  for Fragaria: syntax-aware editing, language-specific autocompletion, but
@@ -108,6 +110,32 @@ NS_ASSUME_NONNULL_BEGIN
 @property (nonatomic, readonly) NSArray <NSString *> *autocompletionKeywords;
 
 
+#pragma mark - Indexing Symbols
+/// @name Indexing Symbols
+
+
+/** The patterns which match the declarations of symbols, used by
+ *  MGSSymbolIndex to find the symbols in the lines parsed by this parser.
+ *  @discussion The default implementation returns nil; in this case no
+ *    symbols are indexed. */
+@property (nonatomic, readonly, nullable) NSArray<MGSSymbolPattern *> *symbolPatterns;
+
+
+#pragma mark - Caching Parse Results
+/// @name Caching Parse Results
+
+
+/** A string which identifies the behavior of this parser, used for deciding
+ *  if tokens cached by a MGSHighlightCache can be reused.
+ *  @discussion Tokens are cached only if this property is not nil. The default
+ *    implementation returns the name of the class of the parser followed by
+ *    the version of the bundle containing it. Parsers whose output can change
+ *    without changing bundle version (for example because it depends on
+ *    external configuration) must override this property to include
+ *    everything that affects the tokens, or return nil. */
+@property (nonatomic, readonly, nullable) NSString *tokenCacheVersion;
+
+
 @end
 
 
@@ -49,4 +49,25 @@
 }
 
 
+#pragma mark - Indexing Symbols
+
+
+- (NSArray<MGSSymbolPattern *> *)symbolPatterns
+{
+    return nil;
+}
+
+
+#pragma mark - Caching
+
+
+- (NSString *)tokenCacheVersion
+{
+    NSBundle *bundle = [NSBundle bundleForClass:[self class]];
+    NSString *version = [bundle objectForInfoDictionaryKey:@"CFBundleVersion"];
+    
+    return [NSString stringWithFormat:@"%@ %@", NSStringFromClass([self class]), version ?: @"0"];
+}
+
+
 @end
@@ -73,6 +73,12 @@ extern MGSSyntaxGroup const MGSSyntaxGroupAttribute;
 /** The string range to parse */
 @property (nonatomic, readonly) NSRange rangeToParse;
 
+/** The generation of the string currently being parsed.
+ *  @discussion The generation increases every time the string is edited. It
+ *    is the same number passed to parsers conforming to the
+ *    MGSIncrementalSyntaxParser protocol. */
+@property (nonatomic, readonly) NSUInteger textGeneration;
+
 
 #pragma mark - Creating Tokens
 /// @name Creating Tokens
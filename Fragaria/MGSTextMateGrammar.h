@@ -0,0 +1,149 @@
+//
+//  MGSTextMateGrammar.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import <Foundation/Foundation.h>
+#import "MGSSyntaxParserClient.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@class MGSTextMateGrammar;
+@class MGSTextMateScanner;
+
+
+/** A rule of a TextMate grammar.
+ *
+ *  A rule is either a match rule (a single regular expression), a begin/end
+ *  rule (a context which starts where a regular expression matches and ends
+ *  where another one matches), an include rule (a reference to another rule)
+ *  or a plain list of rules. */
+@interface MGSTextMateRule : NSObject
+
+
+/** The grammar which contains the rule. */
+@property (nonatomic, readonly, weak) MGSTextMateGrammar *grammar;
+
+/** The syntax group of the text matched by the rule, or nil. */
+@property (nonatomic, readonly, nullable) MGSSyntaxGroup group;
+/** The syntax group of the text between the begin and the end matches of a
+ *  begin/end rule, or nil. */
+@property (nonatomic, readonly, nullable) MGSSyntaxGroup contentGroup;
+
+/** The match or begin regular expression, or nil if the rule has none or
+ *  if it could not be compiled. */
+@property (nonatomic, readonly, nullable) NSRegularExpression *expression;
+/** YES if this is a begin/end rule. */
+@property (nonatomic, readonly) BOOL isBeginEndRule;
+/** YES if, when the end expression matches at the same position as an
+ *  expression of the rules inside the context, the latter wins. */
+@property (nonatomic, readonly) BOOL appliesEndPatternLast;
+
+/** The syntax groups of the capture groups of the match or begin
+ *  expression, keyed by capture group index. */
+@property (nonatomic, readonly) NSDictionary<NSNumber *, MGSSyntaxGroup> *captureGroups;
+/** The syntax groups of the capture groups of the end expression, keyed by
+ *  capture group index. */
+@property (nonatomic, readonly) NSDictionary<NSNumber *, MGSSyntaxGroup> *endCaptureGroups;
+
+/** The scanner for the rules inside this rule. */
+@property (nonatomic, readonly) MGSTextMateScanner *scanner;
+
+
+/** Returns the end expression of a begin/end rule.
+ *  @param match The match of the begin expression.
+ *  @param base The index of the capture group of the match corresponding
+ *    to the whole begin expression.
+ *  @param string The string where the begin expression matched.
+ *  @returns The end expression, where the back references to the capture
+ *    groups of the begin expression are replaced by the text they
+ *    captured, or nil if the expression could not be compiled. */
+- (nullable NSRegularExpression *)endExpressionForBeginMatch:(NSTextCheckingResult *)match captureBase:(NSUInteger)base inString:(NSString *)string;
+
+
+@end
+
+
+/** A set of sibling rules, compiled for finding the first match of any of
+ *  them with as few regular expression searches as possible.
+ *
+ *  The expressions of the rules are combined in a single alternation, so
+ *  that a single search finds the leftmost match of all of them. Since the
+ *  alternatives of a regular expression are tried in order, in case of a
+ *  tie the rule which comes first wins, as in TextMate. Expressions which
+ *  cannot be combined (because they contain back references or named
+ *  groups) are searched separately. */
+@interface MGSTextMateScanner : NSObject
+
+
+/** Finds the first match of the rules, or of an end expression.
+ *  @param string The string to search.
+ *  @param range The range of the string to search. Anchors and look-around
+ *    assertions can see the text outside of this range.
+ *  @param end An end expression to search together with the rules, or nil.
+ *  @param endLast If the end expression loses when it matches at the same
+ *    position of a rule.
+ *  @param rule On output, the rule which matched, or nil if the end
+ *    expression matched.
+ *  @param base On output, the index of the capture group of the match
+ *    corresponding to the whole match of the rule.
+ *  @returns The match, or nil if nothing matched. */
+- (nullable NSTextCheckingResult *)firstMatchInString:(NSString *)string range:(NSRange)range endExpression:(nullable NSRegularExpression *)end endLast:(BOOL)endLast rule:(MGSTextMateRule * _Nullable * _Nonnull)rule captureBase:(NSUInteger *)base;
+
+
+@end
+
+
+/** A TextMate grammar, loaded from a dictionary with the structure of a
+ *  .tmLanguage file.
+ *
+ *  The scopes of the grammar are converted to syntax groups by replacing
+ *  the longest known prefix of each scope with the corresponding Fragaria
+ *  syntax group; the rest of the scope is kept, so that colour schemes can
+ *  define specialized colours (for example "comment.line.double-slash"
+ *  becomes "comments.line.double-slash", which falls back to "comments").
+ *  Scopes without a known prefix are not coloured. */
+@interface MGSTextMateGrammar : NSObject
+
+
+/** Loads a grammar.
+ *  @param dict The grammar.
+ *  @returns A grammar, or nil if the dictionary does not contain a scope
+ *    name and a list of patterns. */
+- (nullable instancetype)initWithDictionary:(NSDictionary *)dict;
+
+/** The name of the language. */
+@property (nonatomic, readonly) NSString *name;
+/** The scope name of the grammar. */
+@property (nonatomic, readonly) NSString *scopeName;
+/** The file extensions of the language. */
+@property (nonatomic, readonly) NSArray<NSString *> *fileTypes;
+/** An expression matching the first line of the files of this language. */
+@property (nonatomic, readonly, nullable) NSRegularExpression *firstLineMatch;
+/** A hash of the contents of the grammar. */
+@property (nonatomic, readonly) NSString *contentHash;
+
+/** The rule containing the top level patterns of the grammar. */
+@property (nonatomic, readonly) MGSTextMateRule *rootRule;
+
+/** Used for resolving the includes of other grammars, by scope name. */
+@property (nonatomic, copy, nullable) MGSTextMateGrammar * _Nullable (^grammarResolver)(NSString *scopeName);
+
+/** The base syntax groups which the scopes of TextMate grammars are
+ *  converted to. */
++ (NSArray<MGSSyntaxGroup> *)syntaxGroups;
+
+/** Returns the syntax group corresponding to a scope.
+ *  @param scope A scope, or a space separated list of scopes. Only the first
+ *    one is considered. */
+- (nullable MGSSyntaxGroup)syntaxGroupForScope:(nullable NSString *)scope;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,559 @@
+//
+//  MGSTextMateGrammar.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSTextMateGrammar.h"
+#import "MGSHighlightCache.h"
+
+
+/* Options used for all searches: anchors and look-around assertions see
+ * the whole string, not only the searched range. */
+#define MGSTextMateMatchingOptions  (NSMatchingWithTransparentBounds | NSMatchingWithoutAnchoringBounds)
+
+/* Maximum depth of includes which only refer to another include */
+#define MGSTextMateMaxIncludeChain  (16)
+
+
+/* Returns YES if the pattern contains numbered back references. */
+static BOOL MGSTextMatePatternHasBackReferences(NSString *pattern)
+{
+    NSUInteger i, n = pattern.length;
+    unichar c;
+
+    for (i = 0; i + 1 < n; i++) {
+        if ([pattern characterAtIndex:i] != '\\')
+            continue;
+        c = [pattern characterAtIndex:++i];
+        if (c >= '1' && c <= '9')
+            return YES;
+    }
+    return NO;
+}
+
+
+/* Returns YES if the pattern can be made an alternative of a combined
+ * expression without changing its meaning. Back references and named groups
+ * depend on the numbering of the capture groups, and comments of the
+ * extended syntax would swallow the parenthesis closing the alternative. */
+static BOOL MGSTextMatePatternIsCombinable(NSString *pattern)
+{
+    static NSRegularExpression *uncombinable;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        uncombinable = [NSRegularExpression regularExpressionWithPattern:@"\\\\[1-9kg]|\\(\\?(?:P?<[A-Za-z]|'|[a-wyz-]*x)" options:0 error:nil];
+    });
+    return ![uncombinable firstMatchInString:pattern options:0 range:NSMakeRange(0, pattern.length)];
+}
+
+
+/* Converts the escapes of the Oniguruma syntax which have a different
+ * meaning in ICU regular expressions. */
+static NSString *MGSTextMateTranslatePattern(NSString *pattern)
+{
+    NSMutableString *res;
+    NSUInteger i, n = pattern.length;
+    unichar c;
+
+    if ([pattern rangeOfString:@"\\h" options:NSCaseInsensitiveSearch].location == NSNotFound)
+        return pattern;
+
+    res = [NSMutableString stringWithCapacity:n];
+    for (i = 0; i < n; i++) {
+        c = [pattern characterAtIndex:i];
+        if (c != '\\' || i + 1 == n) {
+            [res appendFormat:@"%C", c];
+            continue;
+        }
+        c = [pattern characterAtIndex:++i];
+        if (c == 'h')
+            [res appendString:@"[0-9A-Fa-f]"];
+        else if (c == 'H')
+            [res appendString:@"[^0-9A-Fa-f]"];
+        else
+            [res appendFormat:@"\\%C", c];
+    }
+    return res;
+}
+
+
+static NSDictionary<NSString *, MGSSyntaxGroup> *MGSTextMateScopeGroups(void)
+{
+    static NSDictionary<NSString *, MGSSyntaxGroup> *groups;
+    static dispatch_once_t onceToken;
+
+    dispatch_once(&onceToken, ^{
+        groups = @{
+            @"comment": MGSSyntaxGroupComment,
+            @"string": MGSSyntaxGroupString,
+            @"constant.numeric": MGSSyntaxGroupNumber,
+            @"constant.language": MGSSyntaxGroupKeyword,
+            @"keyword": MGSSyntaxGroupKeyword,
+            @"storage": MGSSyntaxGroupKeyword,
+            @"variable": MGSSyntaxGroupVariable,
+            @"support.function": MGSSyntaxGroupInstruction,
+            @"entity.name.tag": MGSSyntaxGroupCommand,
+            @"entity.other.attribute-name": MGSSyntaxGroupAttribute};
+    });
+    return groups;
+}
+
+
+@interface MGSTextMateGrammar ()
+
+- (nullable NSRegularExpression *)expressionWithPattern:(NSString *)pattern;
+
+@end
+
+
+@interface MGSTextMateScanner ()
+
+- (instancetype)initWithRules:(NSArray<MGSTextMateRule *> *)rules;
+
+@end
+
+
+#pragma mark - Rules
+
+
+@interface MGSTextMateRule ()
+
+- (instancetype)initWithDictionary:(NSDictionary *)dict grammar:(MGSTextMateGrammar *)grammar parent:(nullable MGSTextMateRule *)parent;
+
+- (nullable MGSTextMateRule *)ruleForRepositoryKey:(NSString *)key;
+
+@end
+
+
+@implementation MGSTextMateRule
+{
+    MGSTextMateRule __weak *parent;
+    NSString *include;
+    BOOL isContainer;
+    NSString *endPattern;
+    NSRegularExpression *endExpression;
+    BOOL endHasBackReferences;
+    NSArray<MGSTextMateRule *> *patterns;
+    NSDictionary<NSString *, NSDictionary *> *repository;
+    NSMutableDictionary<NSString *, MGSTextMateRule *> *repositoryRules;
+    MGSTextMateScanner *_scanner;
+}
+
+
+- (instancetype)initWithDictionary:(NSDictionary *)dict grammar:(MGSTextMateGrammar *)grammar parent:(MGSTextMateRule *)p
+{
+    NSString *match = dict[@"match"], *begin = dict[@"begin"], *end = dict[@"end"];
+    NSMutableArray<MGSTextMateRule *> *rules = [NSMutableArray array];
+    NSArray *pats = dict[@"patterns"];
+
+    self = [super init];
+
+    _grammar = grammar;
+    parent = p;
+    _captureGroups = @{};
+    _endCaptureGroups = @{};
+    if ([dict[@"include"] isKindOfClass:[NSString class]])
+        include = dict[@"include"];
+    _group = [grammar syntaxGroupForScope:dict[@"name"]];
+    _contentGroup = [grammar syntaxGroupForScope:dict[@"contentName"]];
+
+    if ([match isKindOfClass:[NSString class]]) {
+        _expression = [self compilePattern:match];
+        _captureGroups = [self captureGroupsFromDictionary:dict[@"captures"]];
+    } else if ([begin isKindOfClass:[NSString class]] && [end isKindOfClass:[NSString class]]) {
+        _isBeginEndRule = YES;
+        _appliesEndPatternLast = [dict[@"applyEndPatternLast"] respondsToSelector:@selector(boolValue)] && [dict[@"applyEndPatternLast"] boolValue];
+        _captureGroups = [self captureGroupsFromDictionary:dict[@"beginCaptures"] ?: dict[@"captures"]];
+        _endCaptureGroups = [self captureGroupsFromDictionary:dict[@"endCaptures"] ?: dict[@"captures"]];
+        endPattern = MGSTextMateTranslatePattern(end);
+        endHasBackReferences = MGSTextMatePatternHasBackReferences(endPattern);
+        if (!endHasBackReferences)
+            endExpression = [self compilePattern:end];
+        if (endHasBackReferences || endExpression)
+            _expression = [self compilePattern:begin];
+    } else {
+        isContainer = (include == nil);
+    }
+
+    if ([pats isKindOfClass:[NSArray class]]) {
+        for (NSDictionary *pat in pats) {
+            if ([pat isKindOfClass:[NSDictionary class]])
+                [rules addObject:[[MGSTextMateRule alloc] initWithDictionary:pat grammar:grammar parent:self]];
+        }
+    }
+    patterns = [rules copy];
+    if ([dict[@"repository"] isKindOfClass:[NSDictionary class]])
+        repository = dict[@"repository"];
+    repositoryRules = [NSMutableDictionary dictionary];
+
+    return self;
+}
+
+
+- (NSRegularExpression *)compilePattern:(NSString *)pattern
+{
+    NSRegularExpression *res = [self.grammar expressionWithPattern:MGSTextMateTranslatePattern(pattern)];
+    if (!res)
+        NSLog(@"Ignoring rule of grammar %@ with invalid regular expression %@", self.grammar.scopeName, pattern);
+    return res;
+}
+
+
+- (NSDictionary<NSNumber *, MGSSyntaxGroup> *)captureGroupsFromDictionary:(NSDictionary *)captures
+{
+    NSMutableDictionary<NSNumber *, MGSSyntaxGroup> *res = [NSMutableDictionary dictionary];
+    MGSSyntaxGroup group;
+
+    if (![captures isKindOfClass:[NSDictionary class]])
+        return @{};
+    for (NSString *key in captures) {
+        if (![key isKindOfClass:[NSString class]] || ![captures[key] isKindOfClass:[NSDictionary class]])
+            continue;
+        if ((group = [self.grammar syntaxGroupForScope:captures[key][@"name"]]))
+            res[@(key.integerValue)] = group;
+    }
+    return [res copy];
+}
+
+
+#pragma mark - Includes
+
+
+- (MGSTextMateRule *)ruleForRepositoryKey:(NSString *)key
+{
+    MGSTextMateRule *r, *res;
+    NSDictionary *dict;
+
+    for (r = self; r; r = r->parent) {
+        dict = r->repository[key];
+        if (![dict isKindOfClass:[NSDictionary class]])
+            continue;
+        res = r->repositoryRules[key];
+        if (!res) {
+            res = [[MGSTextMateRule alloc] initWithDictionary:dict grammar:self.grammar parent:r];
+            r->repositoryRules[key] = res;
+        }
+        return res;
+    }
+    return nil;
+}
+
+
+/* Returns the rule referred to by an include rule. */
+- (MGSTextMateRule *)resolveInclude
+{
+    MGSTextMateGrammar *other;
+    NSString *scope;
+    NSRange hash;
+
+    if ([include isEqual:@"$self"] || [include isEqual:@"$base"])
+        return self.grammar.rootRule;
+    if ([include hasPrefix:@"#"])
+        return [self ruleForRepositoryKey:[include substringFromIndex:1]];
+
+    hash = [include rangeOfString:@"#"];
+    scope = hash.location == NSNotFound ? include : [include substringToIndex:hash.location];
+    if ([scope isEqual:self.grammar.scopeName])
+        other = self.grammar;
+    else if (self.grammar.grammarResolver)
+        other = self.grammar.grammarResolver(scope);
+    if (!other)
+        return nil;
+    if (hash.location == NSNotFound)
+        return other.rootRule;
+    return [other.rootRule ruleForRepositoryKey:[include substringFromIndex:NSMaxRange(hash)]];
+}
+
+
+/* Appends the rules with an expression found in the patterns of this rule,
+ * following includes and nested lists of rules. */
+- (void)addRulesWithExpressionToArray:(NSMutableArray<MGSTextMateRule *> *)rules visited:(NSHashTable *)visited
+{
+    MGSTextMateRule *target;
+    NSInteger i;
+
+    for (MGSTextMateRule *r in patterns) {
+        target = r;
+        for (i = 0; target && target->include && i < MGSTextMateMaxIncludeChain; i++)
+            target = [target resolveInclude];
+        if (!target || target->include)
+            continue;
+
+        if (target.expression) {
+            [rules addObject:target];
+        } else if (target->isContainer && ![visited containsObject:target]) {
+            [visited addObject:target];
+            [target addRulesWithExpressionToArray:rules visited:visited];
+        }
+    }
+}
+
+
+- (MGSTextMateScanner *)scanner
+{
+    NSMutableArray<MGSTextMateRule *> *rules;
+    NSHashTable *visited;
+
+    if (!_scanner) {
+        rules = [NSMutableArray array];
+        visited = [NSHashTable hashTableWithOptions:NSPointerFunctionsObjectPointerPersonality];
+        [visited addObject:self];
+        [self addRulesWithExpressionToArray:rules visited:visited];
+        _scanner = [[MGSTextMateScanner alloc] initWithRules:rules];
+    }
+    return _scanner;
+}
+
+
+#pragma mark - End Expressions
+
+
+- (NSRegularExpression *)endExpressionForBeginMatch:(NSTextCheckingResult *)match captureBase:(NSUInteger)base inString:(NSString *)string
+{
+    NSMutableString *pattern;
+    NSUInteger i, n, group;
+    NSRange r;
+    unichar c;
+
+    if (!endHasBackReferences)
+        return endExpression;
+
+    n = endPattern.length;
+    pattern = [NSMutableString stringWithCapacity:n];
+    for (i = 0; i < n; i++) {
+        c = [endPattern characterAtIndex:i];
+        if (c != '\\' || i + 1 == n) {
+            [pattern appendFormat:@"%C", c];
+            continue;
+        }
+        c = [endPattern characterAtIndex:++i];
+        if (c < '1' || c > '9') {
+            [pattern appendFormat:@"\\%C", c];
+            continue;
+        }
+        group = base + (c - '0');
+        r = group < match.numberOfRanges ? [match rangeAtIndex:group] : NSMakeRange(NSNotFound, 0);
+        if (r.location != NSNotFound)
+            [pattern appendString:[NSRegularExpression escapedPatternForString:[string substringWithRange:r]]];
+    }
+    return [self.grammar expressionWithPattern:pattern];
+}
+
+
+@end
+
+
+#pragma mark - Scanners
+
+
+@implementation MGSTextMateScanner
+{
+    NSArray<MGSTextMateRule *> *rules;
+    NSRegularExpression *combined;
+    NSMutableData *alternativeRules;
+    NSMutableData *alternativeBases;
+    NSMutableIndexSet *separateRules;
+}
+
+
+- (instancetype)initWithRules:(NSArray<MGSTextMateRule *> *)r
+{
+    NSMutableString *pattern = [NSMutableString string];
+    NSUInteger i, base = 1;
+    NSRegularExpression *exp;
+
+    self = [super init];
+
+    rules = [r copy];
+    alternativeRules = [NSMutableData data];
+    alternativeBases = [NSMutableData data];
+    separateRules = [NSMutableIndexSet indexSet];
+
+    for (i = 0; i < rules.count; i++) {
+        exp = rules[i].expression;
+        if (!MGSTextMatePatternIsCombinable(exp.pattern)) {
+            [separateRules addIndex:i];
+            continue;
+        }
+        if (pattern.length)
+            [pattern appendString:@"|"];
+        [pattern appendFormat:@"(%@)", exp.pattern];
+        [alternativeRules appendBytes:&i length:sizeof(NSUInteger)];
+        [alternativeBases appendBytes:&base length:sizeof(NSUInteger)];
+        base += 1 + exp.numberOfCaptureGroups;
+    }
+
+    if (pattern.length) {
+        combined = [NSRegularExpression regularExpressionWithPattern:pattern options:NSRegularExpressionAnchorsMatchLines error:nil];
+        if (!combined) {
+            [separateRules addIndexesInRange:NSMakeRange(0, rules.count)];
+            alternativeRules.length = 0;
+            alternativeBases.length = 0;
+        }
+    }
+
+    return self;
+}
+
+
+- (NSTextCheckingResult *)firstMatchInString:(NSString *)string range:(NSRange)range endExpression:(NSRegularExpression *)end endLast:(BOOL)endLast rule:(MGSTextMateRule **)rule captureBase:(NSUInteger *)base
+{
+    const NSUInteger *altRules = alternativeRules.bytes, *altBases = alternativeBases.bytes;
+    NSUInteger nalt = alternativeRules.length / sizeof(NSUInteger);
+    __block NSTextCheckingResult *best = nil;
+    __block NSUInteger bestOrder = 0;
+    NSTextCheckingResult *m;
+    NSUInteger i;
+
+    /* Candidates are ordered by position, then by the order of the rules;
+     * the end expression comes before all rules unless endLast is set. */
+    BOOL (^better)(NSTextCheckingResult *, NSUInteger) = ^BOOL(NSTextCheckingResult *res, NSUInteger order) {
+        if (!res)
+            return NO;
+        if (best && (res.range.location > best.range.location || (res.range.location == best.range.location && order > bestOrder)))
+            return NO;
+        best = res;
+        bestOrder = order;
+        return YES;
+    };
+
+    *rule = nil;
+    *base = 0;
+
+    if (end)
+        better([end firstMatchInString:string options:MGSTextMateMatchingOptions range:range], endLast ? NSUIntegerMax : 0);
+
+    if (combined && (m = [combined firstMatchInString:string options:MGSTextMateMatchingOptions range:range])) {
+        for (i = 0; i < nalt; i++) {
+            if ([m rangeAtIndex:altBases[i]].location == NSNotFound)
+                continue;
+            if (better(m, altRules[i] + 1)) {
+                *rule = rules[altRules[i]];
+                *base = altBases[i];
+            }
+            break;
+        }
+    }
+
+    for (i = separateRules.firstIndex; i != NSNotFound; i = [separateRules indexGreaterThanIndex:i]) {
+        m = [rules[i].expression firstMatchInString:string options:MGSTextMateMatchingOptions range:range];
+        if (better(m, i + 1)) {
+            *rule = rules[i];
+            *base = 0;
+        }
+    }
+
+    return best;
+}
+
+
+@end
+
+
+#pragma mark - Grammars
+
+
+@implementation MGSTextMateGrammar
+{
+    NSMutableDictionary<NSString *, id> *scopeGroups;
+    NSCache<NSString *, NSRegularExpression *> *expressionCache;
+}
+
+
+- (instancetype)initWithDictionary:(NSDictionary *)dict
+{
+    NSMutableDictionary *root = [NSMutableDictionary dictionary];
+    NSMutableArray<NSString *> *fileTypes = [NSMutableArray array];
+    NSString *firstLine = dict[@"firstLineMatch"];
+
+    if (![dict[@"scopeName"] isKindOfClass:[NSString class]] || ![dict[@"patterns"] isKindOfClass:[NSArray class]])
+        return nil;
+
+    self = [super init];
+
+    scopeGroups = [NSMutableDictionary dictionary];
+    expressionCache = [[NSCache alloc] init];
+
+    _scopeName = dict[@"scopeName"];
+    _name = [dict[@"name"] isKindOfClass:[NSString class]] ? dict[@"name"] : _scopeName;
+    if ([dict[@"fileTypes"] isKindOfClass:[NSArray class]]) {
+        for (NSString *ext in dict[@"fileTypes"]) {
+            if ([ext isKindOfClass:[NSString class]])
+                [fileTypes addObject:[[ext stringByReplacingOccurrencesOfString:@"." withString:@""] lowercaseString]];
+        }
+    }
+    _fileTypes = [fileTypes copy];
+    if ([firstLine isKindOfClass:[NSString class]])
+        _firstLineMatch = [self expressionWithPattern:MGSTextMateTranslatePattern(firstLine)];
+    _contentHash = [MGSHighlightCache contentHashOfPropertyList:dict];
+
+    /* The name of the grammar is not a scope, so the root rule only gets
+     * the patterns and the repository */
+    root[@"patterns"] = dict[@"patterns"];
+    if (dict[@"repository"])
+        root[@"repository"] = dict[@"repository"];
+    _rootRule = [[MGSTextMateRule alloc] initWithDictionary:root grammar:self parent:nil];
+
+    return self;
+}
+
+
+- (NSRegularExpression *)expressionWithPattern:(NSString *)pattern
+{
+    NSRegularExpression *res = [expressionCache objectForKey:pattern];
+
+    if (!res) {
+        res = [NSRegularExpression regularExpressionWithPattern:pattern options:NSRegularExpressionAnchorsMatchLines error:nil];
+        if (res)
+            [expressionCache setObject:res forKey:pattern];
+    }
+    return res;
+}
+
+
+#pragma mark - Scopes
+
+
++ (NSArray<MGSSyntaxGroup> *)syntaxGroups
+{
+    return [[NSSet setWithArray:[MGSTextMateScopeGroups() allValues]] allObjects];
+}
+
+
+- (MGSSyntaxGroup)syntaxGroupForScope:(NSString *)scope
+{
+    NSDictionary<NSString *, MGSSyntaxGroup> *table = MGSTextMateScopeGroups();
+    NSString *prefix;
+    MGSSyntaxGroup group;
+    id cached;
+    NSRange r;
+
+    if (![scope isKindOfClass:[NSString class]])
+        return nil;
+    scope = [scope stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    r = [scope rangeOfString:@" "];
+    if (r.location != NSNotFound)
+        scope = [scope substringToIndex:r.location];
+
+    if ((cached = scopeGroups[scope]))
+        return cached == [NSNull null] ? nil : cached;
+
+    prefix = scope;
+    group = nil;
+    while (prefix.length) {
+        if ((group = table[prefix])) {
+            group = [group stringByAppendingString:[scope substringFromIndex:prefix.length]];
+            break;
+        }
+        r = [prefix rangeOfString:@"." options:NSBackwardsSearch];
+        prefix = r.location == NSNotFound ? nil : [prefix substringToIndex:r.location];
+    }
+    scopeGroups[scope] = group ?: [NSNull null];
+    return group;
+}
+
+
+@end
@@ -0,0 +1,62 @@
+//
+//  MGSTextMateParserFactory.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import <Foundation/Foundation.h>
+#import "MGSParserFactory.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+/** A parser factory class used to load TextMate grammars.
+ *
+ *  TextMate grammars (the format also used by Sublime Text's .tmLanguage
+ *  files and by Visual Studio Code) can express nested contexts, which are
+ *  not supported by classic Fragaria syntax definitions. Grammars can be
+ *  loaded from property list files (with the .tmLanguage or .plist
+ *  extension) or from JSON files (with the .json extension).
+ *
+ *  The parsers created by this factory support match rules, begin/end
+ *  rules (including back references to the begin match in the end
+ *  expression), captures, repositories and includes, also of the other
+ *  grammars loaded by the same factory. The regular expressions are
+ *  interpreted with the ICU syntax, which is largely compatible with the
+ *  Oniguruma syntax used by TextMate.
+ *
+ *  The scopes of the grammar are mapped to Fragaria's syntax groups by their
+ *  prefix: for example, "comment.line" tokens are coloured as
+ *  "comments.line", a subgroup of MGSSyntaxGroupComment, and
+ *  "constant.numeric.hex" tokens are coloured as "number.hex". Scopes
+ *  without a corresponding syntax group (such as "meta" or "punctuation"
+ *  scopes) are not coloured.
+ *
+ *  No instance of this class is registered by default; to use it, create
+ *  an instance and register it via MGSSyntaxController. */
+@interface MGSTextMateParserFactory : NSObject <MGSParserFactory>
+
+
+/** Returns a parser factory which loads all the grammar files in the
+ *  specified directories.
+ *  @param searchPaths An array of directories where to search grammars. */
+- (instancetype)initWithGrammarDirectories:(NSArray <NSURL *> *)searchPaths;
+
+/** Returns a parser factory which loads the specified grammar files.
+ *  @param files An array of grammar file URLs.
+ *  @note Files which cannot be loaded are ignored. */
+- (instancetype)initWithGrammarFiles:(NSArray <NSURL *> *)files;
+
+/** Returns a parser factory which loads the specified grammars.
+ *  @param grammars An array of grammars, each in the form of the root
+ *    dictionary of a grammar file.
+ *  @note Grammars without a scope name or a list of patterns are
+ *    ignored. */
+- (instancetype)initWithGrammarDictionaries:(NSArray <NSDictionary *> *)grammars NS_DESIGNATED_INITIALIZER;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
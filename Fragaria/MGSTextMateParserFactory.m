@@ -0,0 +1,176 @@
+//
+//  MGSTextMateParserFactory.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSTextMateParserFactory.h"
+#import "MGSTextMateGrammar.h"
+#import "MGSTextMateSyntaxParser.h"
+
+
+@implementation MGSTextMateParserFactory
+{
+    NSDictionary<NSString *, MGSTextMateGrammar *> *grammarsByName;
+    NSDictionary<NSString *, MGSTextMateGrammar *> *grammarsByScope;
+}
+
+
+@synthesize syntaxDefinitionNames = _syntaxDefinitionNames;
+
+
+- (instancetype)init
+{
+    return [self initWithGrammarDictionaries:@[]];
+}
+
+
+- (instancetype)initWithGrammarDirectories:(NSArray <NSURL *> *)searchPaths
+{
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSArray<NSString *> *extensions = @[@"tmlanguage", @"plist", @"json"];
+    NSMutableArray<NSURL *> *files = [NSMutableArray array];
+    NSArray<NSURL *> *contents;
+    
+    for (NSURL *dir in searchPaths) {
+        contents = [fm contentsOfDirectoryAtURL:[dir URLByResolvingSymlinksInPath] includingPropertiesForKeys:nil options:NSDirectoryEnumerationSkipsHiddenFiles error:nil];
+        for (NSURL *f in contents) {
+            if ([extensions containsObject:f.pathExtension.lowercaseString])
+                [files addObject:f];
+        }
+    }
+    return [self initWithGrammarFiles:files];
+}
+
+
+- (instancetype)initWithGrammarFiles:(NSArray <NSURL *> *)files
+{
+    NSMutableArray<NSDictionary *> *grammars = [NSMutableArray array];
+    NSData *data;
+    id root;
+    
+    for (NSURL *file in files) {
+        data = [NSData dataWithContentsOfURL:file];
+        if (!data)
+            continue;
+        if ([file.pathExtension.lowercaseString isEqual:@"json"])
+            root = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+        else
+            root = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:nil];
+        if (![root isKindOfClass:[NSDictionary class]]) {
+            NSLog(@"Grammar file %@ cannot be loaded; not a dictionary", file);
+            continue;
+        }
+        [grammars addObject:root];
+    }
+    return [self initWithGrammarDictionaries:grammars];
+}
+
+
+- (instancetype)initWithGrammarDictionaries:(NSArray <NSDictionary *> *)grammars
+{
+    NSMutableDictionary<NSString *, MGSTextMateGrammar *> *byName = [NSMutableDictionary dictionary];
+    NSMutableDictionary<NSString *, MGSTextMateGrammar *> *byScope = [NSMutableDictionary dictionary];
+    NSMutableArray<NSString *> *names = [NSMutableArray array];
+    MGSTextMateGrammar *grammar;
+    __weak MGSTextMateParserFactory *weakSelf;
+    
+    self = [super init];
+    weakSelf = self;
+    
+    for (NSDictionary *dict in grammars) {
+        grammar = [[MGSTextMateGrammar alloc] initWithDictionary:dict];
+        if (!grammar) {
+            NSLog(@"Ignoring grammar %@; no scope name or patterns", dict[@"name"]);
+            continue;
+        }
+        if (byName[grammar.name.lowercaseString]) {
+            NSLog(@"Ignoring grammar %@ as it defines language %@ already loaded", grammar.scopeName, grammar.name);
+            continue;
+        }
+        grammar.grammarResolver = ^MGSTextMateGrammar *(NSString *scopeName) {
+            MGSTextMateParserFactory *factory = weakSelf;
+            return factory ? factory->grammarsByScope[scopeName] : nil;
+        };
+        byName[grammar.name.lowercaseString] = grammar;
+        byScope[grammar.scopeName] = grammar;
+        [names addObject:grammar.name];
+    }
+    
+    grammarsByName = [byName copy];
+    grammarsByScope = [byScope copy];
+    _syntaxDefinitionNames = [names copy];
+    
+    return self;
+}
+
+
+#pragma mark - Parser Factory Methods
+
+
+- (MGSSyntaxParser *)parserForSyntaxDefinitionName:(NSString *)syndef
+{
+    MGSTextMateGrammar *grammar = grammarsByName[syndef.lowercaseString];
+    
+    if (!grammar)
+        return nil;
+    return [[MGSTextMateSyntaxParser alloc] initWithGrammar:grammar];
+}
+
+
+- (NSArray<NSString *> *)syntaxDefinitionNamesWithExtension:(NSString *)extension
+{
+    NSMutableArray<NSString *> *res = [NSMutableArray array];
+    
+    extension = extension.lowercaseString;
+    for (NSString *name in self.syntaxDefinitionNames) {
+        if ([grammarsByName[name.lowercaseString].fileTypes containsObject:extension])
+            [res addObject:name];
+    }
+    return [res copy];
+}
+
+
+- (NSArray<NSString *> *)extensionsForSyntaxDefinitionName:(NSString *)sdname
+{
+    return grammarsByName[sdname.lowercaseString].fileTypes ?: @[];
+}
+
+
+- (NSArray<NSString *> *)syntaxDefinitionNamesWithUTI:(NSString *)uti
+{
+    NSArray <NSString *> *exts = CFBridgingRelease(UTTypeCopyAllTagsWithClass((__bridge CFStringRef)uti, kUTTagClassFilenameExtension));
+    NSMutableArray<NSString *> *res = [NSMutableArray array];
+    
+    for (NSString *ext in exts) {
+        for (NSString *name in [self syntaxDefinitionNamesWithExtension:ext]) {
+            if (![res containsObject:name])
+                [res addObject:name];
+        }
+    }
+    return [res copy];
+}
+
+
+- (NSArray<NSString *> *)guessSyntaxDefinitionNamesFromFirstLine:(NSString *)firstLine
+{
+    NSMutableArray<NSString *> *res = [NSMutableArray array];
+    NSRegularExpression *exp;
+    
+    for (NSString *name in self.syntaxDefinitionNames) {
+        exp = grammarsByName[name.lowercaseString].firstLineMatch;
+        if ([exp firstMatchInString:firstLine options:0 range:NSMakeRange(0, firstLine.length)])
+            [res addObject:name];
+    }
+    return [res copy];
+}
+
+
+- (NSArray<MGSSyntaxGroup> *)syntaxGroupsForParsers
+{
+    return [MGSTextMateGrammar syntaxGroups];
+}
+
+
+@end
@@ -0,0 +1,37 @@
+//
+//  MGSTextMateSyntaxParser.h
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+/// @cond PRIVATE
+
+#import "MGSSyntaxParser.h"
+#import "MGSIncrementalSyntaxParser.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+
+@class MGSTextMateGrammar;
+
+
+/** A parser which colours the text using a TextMate grammar.
+ *
+ *  The text is parsed one line at a time; the stack of the begin/end
+ *  contexts open at the start of each line is remembered, so that parsing
+ *  can start at any line which was already parsed. After an edit, parsing
+ *  resumes at the first changed line, and continues past the requested range
+ *  only until the context stack becomes the same as it was before the
+ *  edit. */
+@interface MGSTextMateSyntaxParser : MGSSyntaxParser <MGSIncrementalSyntaxParser>
+
+
+- (instancetype)initWithGrammar:(MGSTextMateGrammar *)grammar;
+
+@property (nonatomic, readonly) MGSTextMateGrammar *grammar;
+
+
+@end
+
+
+NS_ASSUME_NONNULL_END
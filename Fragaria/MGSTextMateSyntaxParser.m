@@ -0,0 +1,372 @@
+//
+//  MGSTextMateSyntaxParser.m
+//  Fragaria
+//
+//  Created on 19/10/2026.
+//
+
+#import "MGSTextMateSyntaxParser.h"
+#import "MGSTextMateGrammar.h"
+
+
+/* Maximum number of nested begin/end contexts */
+#define MGSTextMateMaxStackDepth    (100)
+
+
+/* Returns the index where the line containing the character at i ends,
+ * including the line terminator. */
+static NSUInteger MGSLineEnd(NSString *string, NSUInteger i, BOOL *terminated)
+{
+    NSUInteger end, contentsEnd;
+
+    [string getLineStart:NULL end:&end contentsEnd:&contentsEnd forRange:NSMakeRange(i, 0)];
+    *terminated = end > contentsEnd;
+    return end;
+}
+
+
+/* A node of the stack of the begin/end contexts open at some point of the
+ * text. Nodes are immutable, so that they can be shared between lines. */
+@interface MGSTextMateState : NSObject
+
+- (instancetype)initWithRule:(MGSTextMateRule *)rule endExpression:(nullable NSRegularExpression *)end parent:(nullable MGSTextMateState *)parent;
+
+@property (nonatomic, readonly, nullable) MGSTextMateState *parent;
+@property (nonatomic, readonly) MGSTextMateRule *rule;
+@property (nonatomic, readonly, nullable) NSRegularExpression *endExpression;
+@property (nonatomic, readonly, nullable) MGSSyntaxGroup group;
+@property (nonatomic, readonly, nullable) MGSSyntaxGroup contentGroup;
+@property (nonatomic, readonly) NSUInteger depth;
+
+@end
+
+
+@implementation MGSTextMateState
+
+
+- (instancetype)initWithRule:(MGSTextMateRule *)rule endExpression:(NSRegularExpression *)end parent:(MGSTextMateState *)parent
+{
+    self = [super init];
+
+    _rule = rule;
+    _endExpression = end;
+    _parent = parent;
+    _depth = parent ? parent.depth + 1 : 0;
+    _group = rule.group ?: parent.contentGroup;
+    _contentGroup = rule.contentGroup ?: _group;
+
+    return self;
+}
+
+
+- (BOOL)isEqual:(id)object
+{
+    MGSTextMateState *other = object;
+
+    if (self == other)
+        return YES;
+    if (![other isKindOfClass:[MGSTextMateState class]])
+        return NO;
+    if (other.rule != self.rule || other.depth != self.depth)
+        return NO;
+    if (other.endExpression != self.endExpression && ![other.endExpression.pattern isEqual:self.endExpression.pattern])
+        return NO;
+    return self.parent == other.parent || [self.parent isEqual:other.parent];
+}
+
+
+- (NSUInteger)hash
+{
+    return (NSUInteger)(__bridge void *)self.rule ^ self.depth;
+}
+
+
+@end
+
+
+@implementation MGSTextMateSyntaxParser
+{
+    NSMutableData *lineStarts;
+    NSMutableArray *lineStates;
+    NSMutableIndexSet *suspectLines;
+    NSUInteger generation;
+}
+
+
+- (instancetype)initWithGrammar:(MGSTextMateGrammar *)grammar
+{
+    self = [super init];
+    _grammar = grammar;
+    return self;
+}
+
+
+- (NSString *)tokenCacheVersion
+{
+    return [NSString stringWithFormat:@"%@ %@ %@", [super tokenCacheVersion], self.grammar.scopeName, self.grammar.contentHash];
+}
+
+
+#pragma mark - Line States
+
+
+/* The state of each line is the stack of contexts open at its start.
+ *
+ * The states of the lines which follow an edit are kept as they were; they
+ * are correct only if the state at the end of the edit does not change.
+ * The first line whose state is not known to be correct is added to
+ * suspectLines; the states of the lines which precede the first suspect
+ * line are correct (or null, if they were never parsed). */
+
+
+- (void)resetLinesWithString:(NSString *)string generation:(NSUInteger)gen
+{
+    NSUInteger i = 0, len = string.length, n;
+    BOOL terminated;
+
+    lineStarts = [NSMutableData data];
+    [lineStarts appendBytes:&i length:sizeof(NSUInteger)];
+    while (i < len) {
+        i = MGSLineEnd(string, i, &terminated);
+        if (i < len || terminated)
+            [lineStarts appendBytes:&i length:sizeof(NSUInteger)];
+    }
+
+    n = lineStarts.length / sizeof(NSUInteger);
+    lineStates = [NSMutableArray arrayWithCapacity:n];
+    [lineStates addObject:[[MGSTextMateState alloc] initWithRule:self.grammar.rootRule endExpression:nil parent:nil]];
+    for (i = 1; i < n; i++)
+        [lineStates addObject:[NSNull null]];
+    suspectLines = [NSMutableIndexSet indexSet];
+    generation = gen;
+}
+
+
+- (NSUInteger)lineCount
+{
+    return lineStarts.length / sizeof(NSUInteger);
+}
+
+
+- (NSUInteger)lineOfCharacter:(NSUInteger)c
+{
+    const NSUInteger *starts = lineStarts.bytes;
+    NSUInteger lo = 0, hi = self.lineCount, mid;
+
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (starts[mid] <= c)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+
+- (void)resetIncrementalParsingWithString:(NSString *)string generation:(NSUInteger)gen
+{
+    [self resetLinesWithString:string generation:gen];
+}
+
+
+- (NSIndexSet *)applyEditDelta:(MGSTextEditDelta)delta toString:(NSString *)string
+{
+    NSUInteger *starts, n, a, stop, i, len = string.length, newCount, oldCount;
+    NSMutableData *newStarts;
+    NSMutableArray *nulls;
+    BOOL terminated, aligned = NO;
+
+    if (!lineStarts || delta.generation != generation + 1) {
+        [self resetLinesWithString:string generation:delta.generation];
+        return nil;
+    }
+    generation = delta.generation;
+
+    /* Find the lines of the new text between the line preceding the edit
+     * (where a CR may have been joined to a LF) and the first old line
+     * which starts at the same place after the edit. */
+    starts = lineStarts.mutableBytes;
+    n = self.lineCount;
+    a = [self lineOfCharacter:delta.oldRange.location];
+    if (a > 0)
+        a--;
+    stop = [self lineOfCharacter:NSMaxRange(delta.oldRange)] + 1;
+
+    newStarts = [NSMutableData data];
+    i = starts[a];
+    [newStarts appendBytes:&i length:sizeof(NSUInteger)];
+    while (i < len) {
+        i = MGSLineEnd(string, i, &terminated);
+        while (stop < n && starts[stop] + delta.changeInLength < i)
+            stop++;
+        if (stop < n && starts[stop] + delta.changeInLength == i) {
+            aligned = YES;
+            break;
+        }
+        if (i < len || terminated)
+            [newStarts appendBytes:&i length:sizeof(NSUInteger)];
+    }
+    if (!aligned)
+        stop = n;
+
+    newCount = newStarts.length / sizeof(NSUInteger);
+    oldCount = stop - a;
+    [lineStarts replaceBytesInRange:NSMakeRange(a * sizeof(NSUInteger), oldCount * sizeof(NSUInteger)) withBytes:newStarts.bytes length:newStarts.length];
+    starts = lineStarts.mutableBytes;
+    for (i = a + newCount; i < self.lineCount; i++)
+        starts[i] += delta.changeInLength;
+
+    nulls = [NSMutableArray arrayWithCapacity:newCount];
+    for (i = 1; i < newCount; i++)
+        [nulls addObject:[NSNull null]];
+    [lineStates replaceObjectsInRange:NSMakeRange(a + 1, oldCount - 1) withObjectsFromArray:nulls];
+
+    [suspectLines removeIndexesInRange:NSMakeRange(a + 1, oldCount - 1)];
+    [suspectLines shiftIndexesStartingAtIndex:stop by:(NSInteger)newCount - (NSInteger)oldCount];
+    if (a + newCount < self.lineCount)
+        [suspectLines addIndex:a + newCount];
+
+    /* Let Fragaria invalidate the edited lines; the lines whose context
+     * changes are coloured again when the edited lines are parsed. */
+    return nil;
+}
+
+
+#pragma mark - Parsing
+
+
+- (NSRange)parseForClient:(id<MGSSyntaxParserClient>)client
+{
+    NSString *string = client.stringToParse;
+    NSRange range = client.rangeToParse;
+    const NSUInteger *starts;
+    NSUInteger n, first, last, j, k, end, lineEnd;
+    MGSTextMateState *state;
+    id old;
+    BOOL changed;
+
+    starts = lineStarts.bytes;
+    n = self.lineCount;
+    if (!lineStarts || client.textGeneration != generation || starts[n - 1] > string.length) {
+        [self resetLinesWithString:string generation:client.textGeneration];
+        starts = lineStarts.bytes;
+        n = self.lineCount;
+    }
+
+    first = [self lineOfCharacter:range.location];
+    last = range.length ? [self lineOfCharacter:NSMaxRange(range) - 1] : first;
+
+    /* Start from the closest line whose state is known */
+    k = first;
+    if (suspectLines.count && suspectLines.firstIndex <= k)
+        k = suspectLines.firstIndex - 1;
+    while (lineStates[k] == [NSNull null])
+        k--;
+    state = lineStates[k];
+
+    end = starts[k];
+    for (j = k; j < n; j++) {
+        lineEnd = j + 1 < n ? starts[j + 1] : string.length;
+        state = [self parseLineInRange:NSMakeRange(starts[j], lineEnd - starts[j]) ofString:string state:state client:client];
+        end = lineEnd;
+        if (j + 1 >= n)
+            break;
+
+        old = lineStates[j + 1];
+        lineStates[j + 1] = state;
+        [suspectLines removeIndex:j + 1];
+        changed = ![old isEqual:state];
+
+        /* Past the requested range, continue only while the state of lines
+         * which were already coloured changes */
+        if (j + 1 > last && !(changed && old != [NSNull null])) {
+            if (changed && j + 2 < n)
+                [suspectLines addIndex:j + 2];
+            break;
+        }
+    }
+
+    return NSMakeRange(starts[k], end - starts[k]);
+}
+
+
+/* Colours a line, and returns the state at the start of the next line. */
+- (MGSTextMateState *)parseLineInRange:(NSRange)line ofString:(NSString *)string state:(MGSTextMateState *)state client:(id<MGSSyntaxParserClient>)client
+{
+    NSUInteger pos = line.location, end = NSMaxRange(line), base, iterations = 0;
+    NSUInteger maxIterations = line.length * 2 + 16;
+    MGSTextMateRule *rule;
+    NSTextCheckingResult *m;
+    NSRegularExpression *endExp;
+    NSRange mr;
+
+    [client resetTokenGroupsInRange:line];
+
+    while (pos < end && iterations++ < maxIterations) {
+        m = [state.rule.scanner firstMatchInString:string range:NSMakeRange(pos, end - pos)
+          endExpression:state.endExpression endLast:state.rule.appliesEndPatternLast rule:&rule captureBase:&base];
+        if (!m)
+            break;
+        mr = [m rangeAtIndex:base];
+        [self setGroup:state.contentGroup range:NSMakeRange(pos, mr.location - pos) client:client];
+
+        if (!rule) {
+            [self setGroup:state.group range:mr client:client];
+            [self setCaptureGroups:state.rule.endCaptureGroups match:m base:base client:client];
+            state = state.parent;
+        } else if (rule.isBeginEndRule && state.depth < MGSTextMateMaxStackDepth) {
+            endExp = [rule endExpressionForBeginMatch:m captureBase:base inString:string];
+            state = [[MGSTextMateState alloc] initWithRule:rule endExpression:endExp parent:state];
+            [self setGroup:state.group range:mr client:client];
+            [self setCaptureGroups:rule.captureGroups match:m base:base client:client];
+        } else {
+            [self setGroup:rule.group ?: state.contentGroup range:mr client:client];
+            [self setCaptureGroups:rule.captureGroups match:m base:base client:client];
+            if (mr.length == 0) {
+                /* Skip a character, otherwise the same match would be
+                 * found again */
+                if (mr.location >= end)
+                    break;
+                [self setGroup:state.contentGroup range:NSMakeRange(mr.location, 1) client:client];
+                pos = mr.location + 1;
+                continue;
+            }
+        }
+        pos = NSMaxRange(mr);
+    }
+
+    if (pos < end)
+        [self setGroup:state.contentGroup range:NSMakeRange(pos, end - pos) client:client];
+    return state;
+}
+
+
+- (void)setGroup:(MGSSyntaxGroup)group range:(NSRange)range client:(id<MGSSyntaxParserClient>)client
+{
+    if (group && range.length > 0)
+        [client setGroup:group forTokenInRange:range atomic:NO];
+}
+
+
+- (void)setCaptureGroups:(NSDictionary<NSNumber *, MGSSyntaxGroup> *)groups match:(NSTextCheckingResult *)m base:(NSUInteger)base client:(id<MGSSyntaxParserClient>)client
+{
+    NSUInteger i;
+    NSRange r;
+
+    if (groups.count == 0)
+        return;
+
+    /* Outer capture groups come first, so that inner ones override them */
+    for (NSNumber *key in [groups.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+        i = base + key.unsignedIntegerValue;
+        if (i >= m.numberOfRanges)
+            continue;
+        r = [m rangeAtIndex:i];
+        if (r.location != NSNotFound)
+            [self setGroup:groups[key] range:r client:client];
+    }
+}
+
+
+@end
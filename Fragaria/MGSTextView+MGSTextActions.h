@@ -141,4 +141,22 @@
 - (IBAction)copyWithHighlighting:(id)sender;
 
 
+/** Fold the innermost block of lines which contains the insertion point.
+ *  @discussion The block which begins at the line of the insertion point
+ *              is folded if there is one; otherwise, the closest block
+ *              beginning in a previous line and containing this line is
+ *              folded.
+ *  @param sender The sender of the action. */
+- (IBAction)foldCurrentBlock:(id)sender;
+
+/** Unfold the block of lines which begins at the line of the insertion
+ *  point, or which hides it.
+ *  @param sender The sender of the action. */
+- (IBAction)unfoldCurrentBlock:(id)sender;
+
+/** Unfold all the folded blocks of lines.
+ *  @param sender The sender of the action. */
+- (IBAction)unfoldAllBlocks:(id)sender;
+
+
 @end
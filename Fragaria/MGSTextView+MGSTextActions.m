@@ -16,6 +16,8 @@
 #import "NSString+Fragaria.h"
 #import "NSTextStorage+Fragaria.h"
 #import "MGSSyntaxParser.h"
+#import "MGSHighlightExporter.h"
+#import "MGSFoldingController.h"
 
 
 @implementation MGSTextView (MGSTextActions)
@@ -49,6 +51,8 @@
     } else if (action == @selector(shiftLeft:) || action == @selector(shiftRight:)) {
         if (!self.editable)
             enableItem = NO;
+    } else if (action == @selector(unfoldAllBlocks:)) {
+        enableItem = self.foldingController.numberOfFolds > 0;
     } else if (action == @selector(commentOrUncomment:) ) {
         // Comment Or Uncomment
         if ((![self.syntaxColouring.parser providesCommentOrUncomment]) || (!self.editable)) {
@@ -75,11 +79,38 @@
     
     newselection = [string enumerateMutableSubstringsFromRangeArray: [self selectedRanges]
     usingBlock:^(MGSMutableSubstring *substr, BOOL *stop) {
-        NSMutableString *temp = [NSMutableString stringWithString:substr];
+        NSString *orig = [NSString stringWithString:substr];
+        NSMutableString *temp = [orig mutableCopy];
+        NSMutableArray *ranges = [NSMutableArray array];
+        NSMutableArray *replacements = [NSMutableArray array];
+        NSUInteger base = [substr superstringRange].location;
+        NSRange range;
+        NSInteger i;
+        
         b(temp);
         
-        if ([self shouldChangeTextInRange:[substr superstringRange] replacementString:temp]) {
-            [substr setString:temp];
+        /* Replace only the lines which were changed, so that the other lines
+         * keep their colouring and layout, and the undo manager does not
+         * have to remember the whole selection. */
+        [orig mgs_enumerateLineEditsToString:temp usingBlock:^(NSRange edit, NSRange replacementRange) {
+            [ranges addObject:[NSValue valueWithRange:NSMakeRange(base + edit.location, edit.length)]];
+            [replacements addObject:[temp substringWithRange:replacementRange]];
+        }];
+        if (![ranges count])
+            return;
+        
+        if ([self shouldChangeTextInRanges:ranges replacementStrings:replacements]) {
+            /* Back to front, so that the ranges still to be replaced are
+             * not moved by the replacements. The replacements are processed
+             * as a single edit, otherwise each line would be coloured,
+             * indexed and tracked separately. */
+            [[self textStorage] beginEditing];
+            for (i = [ranges count] - 1; i >= 0; i--) {
+                range = [ranges[i] rangeValue];
+                range.location -= base;
+                [substr replaceCharactersInRange:range withString:replacements[i]];
+            }
+            [[self textStorage] endEditing];
             [self didChangeText];
         }
     }];
@@ -149,7 +180,7 @@
     
     [self alignSelectionToLineBonduaries];
     lchg = [self editSelectionArrayWithBlock:^(NSMutableString *string) {
-        [string enumerateMutableSubstringsOfLinesUsingBlock:^(MGSMutableSubstring *line, BOOL *stop) {
+        [string enumerateMutableSubstringsOfLinesWithOptions:MGSMutableSubstringEnumerationDeferEdits usingBlock:^(MGSMutableSubstring *line, BOOL *stop) {
             NSInteger width, newwidth;
             NSUInteger i;
             NSString *replStr;
@@ -196,24 +227,11 @@
  */
 - (IBAction)removeNeedlessWhitespace:(id)sender
 {
-    NSCharacterSet *whitespace = [NSCharacterSet whitespaceCharacterSet];
     NSInteger lchg;
     
     [self alignSelectionToLineBonduaries];
     lchg = [self editSelectionArrayWithBlock:^(NSMutableString *string) {
-        [string enumerateMutableSubstringsOfLinesUsingBlock:^(MGSMutableSubstring *line, BOOL *stop) {
-            NSUInteger i, e;
-            NSRange whitespaces;
-            
-            [line getLineStart:NULL end:NULL contentsEnd:&e forRange:NSMakeRange(0, line.length)];
-            i = e;
-        
-            while (i > 0 && [whitespace characterIsMember:[line characterAtIndex:i-1]])
-                i--;
-            
-            whitespaces = NSMakeRange(i, e - i);
-            [line replaceCharactersInRange:whitespaces withString:@""];
-        }];
+        [string setString:[string mgs_stringByRemovingTrailingWhitespace]];
     }];
     
     if (!lchg) NSBeep();
@@ -275,38 +293,7 @@
 {
     [self alignSelectionToLineBonduaries];
     [self editSelectionArrayWithBlock:^(NSMutableString *string) {
-        [string enumerateMutableSubstringsOfLinesUsingBlock:^(MGSMutableSubstring *line, BOOL *stop) {
-            NSRange thisSpace, prevSpaces, range;
-            
-            range = NSMakeRange(0, [line length]);
-            prevSpaces = NSMakeRange(NSNotFound, 0);
-            thisSpace = [line rangeOfString:@" " options:NSLiteralSearch range:range];
-            while (thisSpace.length) {
-                NSInteger phase;
-                NSUInteger realLocation;
-                
-                if (NSMaxRange(prevSpaces) == thisSpace.location)
-                    prevSpaces.length++;
-                else
-                    prevSpaces = thisSpace;
-                
-                realLocation = [line mgs_columnOfCharacter:NSMaxRange(prevSpaces) tabWidth:numberOfSpaces];
-                phase = realLocation % numberOfSpaces;
-                if (phase == 0) {
-                    if (prevSpaces.length > 1) {
-                        [line replaceCharactersInRange:prevSpaces withString:@"\t"];
-                        thisSpace.location = prevSpaces.location;
-                        thisSpace.length = 1;
-                    }
-                    prevSpaces = NSMakeRange(NSNotFound, 0);
-                }
-                
-                range.location = NSMaxRange(thisSpace);
-                range.length = [line length] - range.location;
-                
-                thisSpace = [line rangeOfString:@" " options:NSLiteralSearch range:range];
-            }
-        }];
+        [string setString:[string mgs_stringByConvertingSpacesToTabsWithTabWidth:MAX(0, numberOfSpaces)]];
     }];
 }
 
@@ -316,39 +303,9 @@
  */
 - (void)performDetabWithNumberOfSpaces:(NSInteger)numberOfSpaces
 {
-    NSMutableString *spaces;
-    NSInteger i;
-    
-    spaces = [NSMutableString string];
-    for (i=0; i<numberOfSpaces; i++) {
-        [spaces appendString:@" "];
-    }
-    
     [self alignSelectionToLineBonduaries];
     [self editSelectionArrayWithBlock:^(NSMutableString *string) {
-        [string enumerateMutableSubstringsOfLinesUsingBlock:^(MGSMutableSubstring *line, BOOL *stop) {
-            NSRange tempRange, range;
-            
-            range = NSMakeRange(0, [line length]);
-            tempRange = [line rangeOfString:@"\t" options:NSLiteralSearch range:range];
-            while (tempRange.length) {
-                NSInteger phase;
-                NSString *replStr;
-                
-                if (numberOfSpaces) {
-                    phase = [line mgs_columnOfCharacter:tempRange.location tabWidth:numberOfSpaces] % numberOfSpaces;
-                    replStr = [spaces substringFromIndex:phase];
-                } else {
-                    replStr = @"";
-                }
-                [line replaceCharactersInRange:tempRange withString:replStr];
-                
-                range.location = tempRange.location + [replStr length];
-                range.length = [line length] - range.location;
-                
-                tempRange = [line rangeOfString:@"\t" options:NSLiteralSearch range:range];
-            }
-        }];
+        [string setString:[string mgs_stringByConvertingTabsToSpacesWithTabWidth:MAX(0, numberOfSpaces)]];
     }];
 }
 
@@ -621,13 +578,57 @@
 
 - (IBAction)copyWithHighlighting:(id)sender
 {
-    NSAttributedString *tmp = [self attributedStringWithSyntaxColouring];
-    NSAttributedString *sel = [tmp attributedSubstringFromRange:self.selectedRange];
-    NSData *data = [sel RTFFromRange:NSMakeRange(0, sel.length) documentAttributes:@{}];
+    MGSHighlightExporter *exporter = [[MGSHighlightExporter alloc] initWithSyntaxColouring:self.syntaxColouring];
+    NSRange sel = self.selectedRange;
     
     NSPasteboard *pb = [NSPasteboard generalPasteboard];
     [pb clearContents];
-    [pb setData:data forType:NSPasteboardTypeRTF];
+    [pb setData:[exporter dataForRange:sel format:MGSHighlightExportFormatRTF] forType:NSPasteboardTypeRTF];
+    [pb setData:[exporter dataForRange:sel format:MGSHighlightExportFormatHTML] forType:NSPasteboardTypeHTML];
+    [pb setString:[self.string substringWithRange:sel] forType:NSPasteboardTypeString];
+}
+
+
+#pragma mark -
+#pragma mark Folding
+
+
+- (IBAction)foldCurrentBlock:(id)sender
+{
+    MGSFoldingController *fc = self.foldingController;
+    NSTextStorage *ts = self.textStorage;
+    NSUInteger line, l;
+    NSRange range;
+    
+    line = [ts mgs_rowOfCharacter:self.selectedRange.location];
+    if ([fc foldLine:line])
+        return;
+    
+    for (l = line; l > 0; l--) {
+        if ([fc isLineHidden:l - 1] || ![fc isLineFoldable:l - 1])
+            continue;
+        range = [fc foldableRangeOfLine:l - 1];
+        if (range.location != NSNotFound && [ts mgs_rowOfCharacter:NSMaxRange(range)] >= line) {
+            [fc foldCharactersInRange:range];
+            return;
+        }
+    }
+    NSBeep();
+}
+
+
+- (IBAction)unfoldCurrentBlock:(id)sender
+{
+    NSUInteger line = [self.textStorage mgs_rowOfCharacter:self.selectedRange.location];
+    
+    if (![self.foldingController unfoldLine:line])
+        NSBeep();
+}
+
+
+- (IBAction)unfoldAllBlocks:(id)sender
+{
+    [self.foldingController unfoldAll];
 }
 
 
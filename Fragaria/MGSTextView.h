@@ -145,6 +145,51 @@
 @property (nonatomic, assign) BOOL highlightsCurrentLine;
 
 
+#pragma mark - Highlighting Occurrences of the Selected Word
+/// @name Highlighting Occurrences of the Selected Word
+
+
+/** Specifies whether all the occurrences of the selected word, or of the
+ *  word containing the insertion point, should be highlighted.
+ *  @discussion The occurrences are looked for only in the visible part of
+ *    the text, after the selection has not changed for a short time, and
+ *    in the rest of the text as it is scrolled into view. */
+@property (nonatomic, assign) BOOL highlightsOccurrencesOfSelectedWord;
+/** Specifies the background colour of the occurrences of the selected
+ *  word. */
+@property (nonatomic, strong) NSColor *occurrenceHighlightColour;
+
+
+#pragma mark - Folding Code
+/// @name Folding Code
+
+
+/** Folds the block of lines which begins at a line, hiding its lines
+ *  except the first one and, for brackets and block comments, the line
+ *  which closes it.
+ *  @param line A zero-based line number.
+ *  @returns NO if no block begins at the line.
+ *  @discussion A block is delimited by a bracket left open at the end of
+ *    the line, ignoring the brackets in comments and strings; by a block
+ *    comment beginning at the start of the line; or else by the lines
+ *    following the line which are indented more than it. The folded text is
+ *    not laid out nor coloured until it is unfolded, and it is unfolded
+ *    automatically when it is edited. */
+- (BOOL)foldLine:(NSUInteger)line;
+
+/** Unfolds the block which begins at a line, or the block which hides it.
+ *  @param line A zero-based line number.
+ *  @returns NO if the line is not folded nor hidden. */
+- (BOOL)unfoldLine:(NSUInteger)line;
+
+/** Unfolds all the folded blocks. */
+- (void)unfoldAllLines;
+
+/** Returns YES if a folded block begins at a line.
+ *  @param line A zero-based line number. */
+- (BOOL)isLineFolded:(NSUInteger)line;
+
+
 #pragma mark - Tabulation and Indentation
 /// @name Tabulation and Indentation
 
@@ -32,6 +32,10 @@
 #import "NSTextStorage+Fragaria.h"
 #import "MGSMutableColourScheme.h"
 #import "MGSSyntaxParser.h"
+#import "MGSLineGeometry.h"
+#import "MGSOccurrenceHighlighter.h"
+#import "MGSFoldingController.h"
+#import "MGSLayoutScheduler.h"
 
 
 static BOOL CharacterIsBrace(unichar c)
@@ -400,6 +404,12 @@ static unichar ClosingBraceForOpeningBrace(unichar c)
         
         _syntaxColouring = [[MGSSyntaxColouring alloc] initWithLayoutManager:layoutManager];
         _syntaxColoured = YES;
+        
+        _lineGeometry = [[MGSLineGeometry alloc] initWithTextView:self];
+        _occurrenceHighlighter = [[MGSOccurrenceHighlighter alloc] initWithTextView:self];
+        _foldingController = [[MGSFoldingController alloc] initWithTextView:self];
+        layoutManager.foldingController = _foldingController;
+        _layoutScheduler = [[MGSLayoutScheduler alloc] initWithTextView:self];
 
         [self setDefaults];
         
@@ -506,6 +516,27 @@ static unichar ClosingBraceForOpeningBrace(unichar c)
 }
 
 
+/*
+ * - recolourRangeForRect:
+ */
+- (NSRange)recolourRangeForRect:(NSRect)rect
+{
+    NSRange range, visible;
+    NSUInteger a, b;
+    
+    range = [self.lineGeometry characterRangeForRect:rect];
+    if (range.length <= MGSLongLineThreshold)
+        return range;
+    
+    /* The rect intersects a very long line. Only colour the part of the
+     * text between the top-left and bottom-right corners of the rect. */
+    a = [self characterIndexForInsertionAtPoint:NSMakePoint(NSMinX(rect), NSMinY(rect))];
+    b = [self characterIndexForInsertionAtPoint:NSMakePoint(NSMaxX(rect), NSMaxY(rect))];
+    visible = [self.string mgs_highlightingRangeForRange:NSMakeRange(MIN(a, b), MAX(a, b) - MIN(a, b))];
+    return NSIntersectionRange(range, visible);
+}
+
+
 /*
  * - drawRect:
  */
@@ -519,9 +550,11 @@ static unichar ClosingBraceForOpeningBrace(unichar c)
     
     if (self.isSyntaxColoured) {
         for (i=0; i<rectCount; i++) {
-            recolourRange = [[self layoutManager] glyphRangeForBoundingRect:dirtyRects[i] inTextContainer:[self textContainer]];
-            recolourRange = [[self layoutManager] characterRangeForGlyphRange:recolourRange actualGlyphRange:NULL];
-            [self.syntaxColouring recolourRange:recolourRange];
+            recolourRange = [self recolourRangeForRect:dirtyRects[i]];
+            /* Folded text is not drawn, so there is no need to colour it */
+            [[self.foldingController unfoldedCharacterIndexesInRange:recolourRange] enumerateRangesUsingBlock:^(NSRange range, BOOL *stop) {
+                [self.syntaxColouring recolourRange:range];
+            }];
         }
     }
     
@@ -544,36 +577,11 @@ static unichar ClosingBraceForOpeningBrace(unichar c)
         }
     }
     
-    [self prefetchLayoutUnderRect:rect];
-}
-
-
-- (void)prefetchLayoutUnderRect:(NSRect)rect
-{
-    /* Workaround for crappy scrolling on 10.12+ */
-    NSInteger topchar = [self.layoutManager
-        characterIndexForPoint:rect.origin
-        inTextContainer:self.textContainer
-        fractionOfDistanceBetweenInsertionPoints:NULL];
-    
-    NSPoint bottom = rect.origin;
-    bottom.y += rect.size.height;
-    NSInteger btmchar = [self.layoutManager
-        characterIndexForPoint:bottom
-        inTextContainer:self.textContainer
-        fractionOfDistanceBetweenInsertionPoints:NULL];
-    
-    NSInteger prefetchAmount = MAX((NSInteger)100, (btmchar - topchar) * 4);
-    
-    NSInteger top = MAX(0, topchar - prefetchAmount);
-    NSInteger btm = MIN(btmchar + prefetchAmount, (NSInteger)self.string.length);
-    if (top < btm) {
-        [self.layoutManager ensureLayoutForCharacterRange:NSMakeRange(top, btm - top)];
-    }
+    [self.layoutScheduler textViewDidDrawRect:rect];
+    [self.occurrenceHighlighter textViewDidDrawRect:rect];
 }
 
 
-
 #pragma mark - Line Highlighting
 
 
@@ -676,6 +684,7 @@ static unichar ClosingBraceForOpeningBrace(unichar c)
     currentLineRect = [self lineHighlightingRect];
     [self setNeedsDisplayInRect:currentLineRect];
     insertionPointMovementIsPending = YES;
+    [self.occurrenceHighlighter selectionDidChange];
 }
 
 
@@ -689,6 +698,7 @@ static unichar ClosingBraceForOpeningBrace(unichar c)
     currentLineRect = [self lineHighlightingRect];
     [self setNeedsDisplayInRect:currentLineRect];
     insertionPointMovementIsPending = YES;
+    [self.occurrenceHighlighter selectionDidChange];
 }
 
 
@@ -702,6 +712,7 @@ static unichar ClosingBraceForOpeningBrace(unichar c)
     currentLineRect = [self lineHighlightingRect];
     [self setNeedsDisplayInRect:currentLineRect];
     insertionPointMovementIsPending = YES;
+    [self.occurrenceHighlighter selectionDidChange];
 }
 
 
@@ -715,6 +726,7 @@ static unichar ClosingBraceForOpeningBrace(unichar c)
     currentLineRect = [self lineHighlightingRect];
     [self setNeedsDisplayInRect:currentLineRect];
     insertionPointMovementIsPending = YES;
+    [self.occurrenceHighlighter selectionDidChange];
 }
 
 
@@ -730,6 +742,64 @@ static unichar ClosingBraceForOpeningBrace(unichar c)
 }
 
 
+#pragma mark - Occurrence Highlighting
+
+
+/*
+ * @property highlightsOccurrencesOfSelectedWord
+ */
+- (void)setHighlightsOccurrencesOfSelectedWord:(BOOL)highlightsOccurrencesOfSelectedWord
+{
+    self.occurrenceHighlighter.enabled = highlightsOccurrencesOfSelectedWord;
+}
+
+- (BOOL)highlightsOccurrencesOfSelectedWord
+{
+    return self.occurrenceHighlighter.enabled;
+}
+
+
+/*
+ * @property occurrenceHighlightColour
+ */
+- (void)setOccurrenceHighlightColour:(NSColor *)occurrenceHighlightColour
+{
+    self.occurrenceHighlighter.highlightColour = occurrenceHighlightColour;
+}
+
+- (NSColor *)occurrenceHighlightColour
+{
+    return self.occurrenceHighlighter.highlightColour;
+}
+
+
+#pragma mark - Folding Code
+
+
+- (BOOL)foldLine:(NSUInteger)line
+{
+    return [self.foldingController foldLine:line];
+}
+
+
+- (BOOL)unfoldLine:(NSUInteger)line
+{
+    return [self.foldingController unfoldLine:line];
+}
+
+
+- (void)unfoldAllLines
+{
+    [self.foldingController unfoldAll];
+}
+
+
+- (BOOL)isLineFolded:(NSUInteger)line
+{
+    return [self.foldingController isLineFolded:line];
+}
+
+
 #pragma mark - Mouse event handling
 
 
@@ -14,6 +14,10 @@
 @class MGSSyntaxColouring;
 @class MGSLayoutManager;
 @class MGSMutableColourScheme;
+@class MGSLineGeometry;
+@class MGSOccurrenceHighlighter;
+@class MGSFoldingController;
+@class MGSLayoutScheduler;
 
 
 @interface MGSTextView ()
@@ -33,6 +37,21 @@
  * class is not exposed. */
 @property (assign, readonly) MGSLayoutManager *layoutManager;
 
+/** The object which computes the position of the lines of this text view,
+ * shared with the gutter. */
+@property (readonly) MGSLineGeometry *lineGeometry;
+
+/** The object which highlights the occurrences of the selected word. */
+@property (readonly) MGSOccurrenceHighlighter *occurrenceHighlighter;
+
+/** The object which manages the folded blocks of text, shared with the
+ * layout manager and the gutter. */
+@property (readonly) MGSFoldingController *foldingController;
+
+/** The object which lays out the text ahead of the visible part while the
+ * text view is being scrolled. */
+@property (readonly) MGSLayoutScheduler *layoutScheduler;
+
 /** The shared color scheme, set by MGSFragariaView */
 @property (nonatomic, strong) MGSMutableColourScheme *colourScheme;
 
@@ -9,6 +9,32 @@
 #import <Foundation/Foundation.h>
 
 
+/** The length (in characters) above which a line is not highlighted as a
+ *  whole anymore, but in windows. */
+#define MGSLongLineThreshold        (16384)
+/** The approximate length (in characters) of the windows in which lines
+ *  longer than MGSLongLineThreshold are split for highlighting. */
+#define MGSLongLineWindowLength     (4096)
+
+
+/** Decodes UTF-8 bytes to UTF-16.
+ *  @discussion Each byte of an invalid or truncated sequence is decoded as
+ *     U+FFFD REPLACEMENT CHARACTER.
+ *  @param bytes The bytes to decode.
+ *  @param len The number of bytes to decode.
+ *  @param out The buffer where the decoded characters are stored, which must
+ *     be large enough for len characters. If NULL, the characters are only
+ *     counted.
+ *  @returns The number of UTF-16 code units decoded. */
+NSUInteger MGSDecodeUTF8(const uint8_t *bytes, NSUInteger len, unichar *out);
+
+/** Returns the length of the incomplete UTF-8 sequence at the end of a
+ *  buffer, or zero if the buffer ends with a complete sequence.
+ *  @param bytes The buffer.
+ *  @param len The length of the buffer in bytes. */
+NSUInteger MGSIncompleteUTF8SequenceLength(const uint8_t *bytes, NSUInteger len);
+
+
 /**
  *  A private category which adds helper functions to NSString.
  */
@@ -41,5 +67,73 @@
  *     location, and 0 as length. */
 - (NSRange)mgs_lineRangeForCharacterIndex:(NSUInteger)i;
 
+/** Returns the range of characters which must be highlighted when the
+ *  highlighting of the specified range is required.
+ *  @discussion For lines shorter than MGSLongLineThreshold, this range
+ *     is the same as the one returned by -lineRangeForRange:. Long lines are
+ *     instead split in windows of about MGSLongLineWindowLength characters,
+ *     and only the windows which intersect the specified range are included.
+ *     The boundaries of the windows only depend on the characters around
+ *     them, thus any range inside a window is always expanded to the same
+ *     window. The time taken by this method does not depend on the length
+ *     of the lines.
+ *  @param range A range of characters in the string. */
+- (NSRange)mgs_highlightingRangeForRange:(NSRange)range;
+
+
+/** Calls a block with the characters of the specified range, a chunk at a
+ *  time.
+ *  @discussion This method allows fast sequential access to the characters
+ *     of a string. Subclasses which do not store their characters
+ *     contiguously can override this method to pass their internal buffers
+ *     to the block without copying them.
+ *  @param range A range of characters in the string.
+ *  @param block The block to call. Its chars argument points to the
+ *     characters in chunkRange, and is valid only while the block runs.
+ *     Set *stop to YES to stop the enumeration. */
+- (void)mgs_enumerateCharacterChunksInRange:(NSRange)range usingBlock:(void (^)(const unichar *chars, NSRange chunkRange, BOOL *stop))block;
+
+/** Calls a block for each of the edits which transform this string into
+ *  another string, working a line at a time.
+ *  @discussion The lines the two strings have in common at their start and
+ *     at their end are never part of an edit. If the other lines are as many
+ *     in both strings, each line is paired with the line at the same
+ *     position in the other string, and each pair of different lines
+ *     results in an edit, restricted to the characters between the first and
+ *     the last one which changed. Otherwise, all the lines in between are
+ *     replaced by a single edit.
+ *  @param other The string which results from applying the edits.
+ *  @param block The block to call, once per edit, in ascending order. Its
+ *     range argument is the range of characters of this string to be
+ *     replaced, and replacementRange is the range of characters of the other
+ *     string which replaces them. */
+- (void)mgs_enumerateLineEditsToString:(NSString *)other usingBlock:(void (^)(NSRange range, NSRange replacementRange))block;
+
+/** Returns a copy of this string where the runs of spaces which end on a
+ *  tab stop are replaced by tabs.
+ *  @discussion Only runs of two or more spaces are replaced. The string is
+ *     read only once, and the columns are computed while reading it.
+ *  @param tabwidth The width of a tab. If zero, the string is returned
+ *     unchanged. */
+- (NSString *)mgs_stringByConvertingSpacesToTabsWithTabWidth:(NSUInteger)tabwidth;
+
+/** Returns a copy of this string where each tab is replaced by the spaces
+ *  needed to reach the same column.
+ *  @discussion The string is read only once, and the columns are computed
+ *     while reading it.
+ *  @param tabwidth The width of a tab. If zero, tabs are removed. */
+- (NSString *)mgs_stringByConvertingTabsToSpacesWithTabWidth:(NSUInteger)tabwidth;
+
+/** Returns a copy of this string without the whitespace at the end of each
+ *  line. */
+- (NSString *)mgs_stringByRemovingTrailingWhitespace;
+
+/** Returns a string containing the specified UTF-8 bytes.
+ *  @discussion Unlike -initWithBytes:length:encoding:, this method never
+ *     fails; invalid sequences are decoded as in MGSDecodeUTF8().
+ *  @param bytes The bytes to decode.
+ *  @param len The number of bytes to decode. */
++ (NSString *)mgs_stringWithUTF8Bytes:(const uint8_t *)bytes length:(NSUInteger)len;
+
 
 @end
@@ -9,6 +9,305 @@
 #import "NSString+Fragaria.h"
 
 
+/* Length of the chunks used by -mgs_enumerateCharacterChunksInRange: for
+ * strings which do not expose their characters */
+#define MGSCharacterChunkLength     (128)
+
+/* How far a window boundary can be moved to avoid splitting a word */
+#define MGSLongLineBoundarySlack    (256)
+
+
+static NSCharacterSet *MGSWindowBoundaryCharacterSet(void)
+{
+    static NSCharacterSet *set;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableCharacterSet *tmp = [NSMutableCharacterSet whitespaceAndNewlineCharacterSet];
+        [tmp formUnionWithCharacterSet:[NSCharacterSet punctuationCharacterSet]];
+        set = [tmp copy];
+    });
+    return set;
+}
+
+
+/* Returns the location of the k-th window boundary. Window boundaries are
+ * placed at multiples of MGSLongLineWindowLength, but they are moved
+ * forward to the next whitespace or punctuation character if there is one
+ * close enough, to avoid splitting words and numbers. */
+static NSUInteger MGSWindowBoundary(NSString *s, NSUInteger k)
+{
+    NSUInteger b = k * MGSLongLineWindowLength;
+    NSUInteger len = s.length;
+    NSRange found;
+    
+    if (b == 0 || b >= len)
+        return MIN(b, len);
+    found = [s rangeOfCharacterFromSet:MGSWindowBoundaryCharacterSet() options:0
+      range:NSMakeRange(b, MIN(MGSLongLineBoundarySlack, len - b))];
+    if (found.location == NSNotFound)
+        return b;
+    return found.location;
+}
+
+
+/* Returns the index after the line terminator which starts at index i. */
+static NSUInteger MGSEndOfLineTerminator(NSString *s, NSUInteger i)
+{
+    if ([s characterAtIndex:i] == '\r' && i + 1 < s.length && [s characterAtIndex:i + 1] == '\n')
+        return i + 2;
+    return i + 1;
+}
+
+
+/* Returns the range of the line containing the character at index i, or
+ * a range with NSNotFound as location if the line is longer than
+ * MGSLongLineThreshold. Only the characters close to i are examined. */
+static NSRange MGSShortLineRangeForIndex(NSString *s, NSUInteger i)
+{
+    NSCharacterSet *nl = [NSCharacterSet newlineCharacterSet];
+    NSUInteger len = s.length;
+    NSUInteger searchStart, searchEnd, start, end;
+    NSRange found;
+    
+    /* The LF of a CRLF belongs to the same line of the CR */
+    if (i > 0 && i < len && [s characterAtIndex:i] == '\n' && [s characterAtIndex:i - 1] == '\r')
+        i--;
+    
+    searchStart = i > MGSLongLineThreshold ? i - MGSLongLineThreshold : 0;
+    found = [s rangeOfCharacterFromSet:nl options:NSBackwardsSearch range:NSMakeRange(searchStart, i - searchStart)];
+    if (found.location != NSNotFound)
+        start = NSMaxRange(found);
+    else if (searchStart == 0)
+        start = 0;
+    else
+        return NSMakeRange(NSNotFound, 0);
+    
+    searchEnd = MIN(len, start + MGSLongLineThreshold + 1);
+    found = [s rangeOfCharacterFromSet:nl options:0 range:NSMakeRange(i, searchEnd > i ? searchEnd - i : 0)];
+    if (found.location != NSNotFound)
+        end = MGSEndOfLineTerminator(s, found.location);
+    else if (searchEnd == len)
+        end = len;
+    else
+        return NSMakeRange(NSNotFound, 0);
+    
+    if (end - start > MGSLongLineThreshold + 1)
+        return NSMakeRange(NSNotFound, 0);
+    return NSMakeRange(start, end - start);
+}
+
+
+/* Returns the window which contains the character at index i. */
+static NSRange MGSWindowForIndex(NSString *s, NSUInteger i)
+{
+    NSUInteger k = i / MGSLongLineWindowLength;
+    NSUInteger start = MGSWindowBoundary(s, k);
+    
+    if (start > i) {
+        k--;
+        start = MGSWindowBoundary(s, k);
+    }
+    return NSMakeRange(start, MGSWindowBoundary(s, k + 1) - start);
+}
+
+
+/* Returns whether the characters at index ia of a and at index ib of b are
+ * the same for len characters. */
+static BOOL MGSCharactersAreEqual(NSString *a, NSUInteger ia, NSString *b, NSUInteger ib, NSUInteger len)
+{
+    unichar bufa[MGSCharacterChunkLength], bufb[MGSCharacterChunkLength];
+    NSUInteger n;
+    
+    while (len > 0) {
+        n = MIN(len, MGSCharacterChunkLength);
+        [a getCharacters:bufa range:NSMakeRange(ia, n)];
+        [b getCharacters:bufb range:NSMakeRange(ib, n)];
+        if (memcmp(bufa, bufb, n * sizeof(unichar)) != 0)
+            return NO;
+        ia += n;
+        ib += n;
+        len -= n;
+    }
+    return YES;
+}
+
+
+/* Counts the lines in range r of s. */
+static NSUInteger MGSLineCountInRange(NSString *s, NSRange r)
+{
+    NSUInteger i, end, n;
+    
+    n = 0;
+    for (i = r.location; i < NSMaxRange(r); i = end) {
+        [s getLineStart:NULL end:&end contentsEnd:NULL forRange:NSMakeRange(i, 0)];
+        n++;
+    }
+    return n;
+}
+
+
+/* Calls block with range a of s1 and range b of s2, after removing from both
+ * the characters they have in common at the start and at the end. Does
+ * nothing if the two ranges are equal. */
+static void MGSTrimmedEdit(NSString *s1, NSRange a, NSString *s2, NSRange b, void (^block)(NSRange range, NSRange replacementRange))
+{
+    NSUInteger p, q, maxp;
+    
+    maxp = MIN(a.length, b.length);
+    p = 0;
+    while (p < maxp && [s1 characterAtIndex:a.location + p] == [s2 characterAtIndex:b.location + p])
+        p++;
+    if (p == a.length && p == b.length)
+        return;
+    q = 0;
+    while (q < maxp - p && [s1 characterAtIndex:NSMaxRange(a) - q - 1] == [s2 characterAtIndex:NSMaxRange(b) - q - 1])
+        q++;
+    block(NSMakeRange(a.location + p, a.length - p - q), NSMakeRange(b.location + p, b.length - p - q));
+}
+
+
+/* A buffer of characters which grows as needed, where the whitespace
+ * transformations write their result. */
+typedef struct {
+    unichar *chars;
+    NSUInteger length;
+    NSUInteger capacity;
+} MGSCharacterBuffer;
+
+
+static void MGSCharacterBufferReserve(MGSCharacterBuffer *b, NSUInteger n)
+{
+    NSUInteger newcap;
+    
+    if (b->length + n <= b->capacity)
+        return;
+    newcap = MAX(b->capacity * 2, b->length + n);
+    b->chars = reallocf(b->chars, newcap * sizeof(unichar));
+    if (!b->chars)
+        [NSException raise:NSMallocException format:@"Cannot allocate a buffer of %lu characters", (unsigned long)newcap];
+    b->capacity = newcap;
+}
+
+
+static MGSCharacterBuffer MGSCharacterBufferMake(NSUInteger capacity)
+{
+    MGSCharacterBuffer b = {NULL, 0, 0};
+    
+    MGSCharacterBufferReserve(&b, MAX(capacity, 1));
+    return b;
+}
+
+
+/* Returns a string which takes ownership of the characters of the buffer. */
+static NSString *MGSCharacterBufferString(MGSCharacterBuffer *b)
+{
+    NSString *res = [[NSString alloc] initWithCharactersNoCopy:b->chars length:b->length freeWhenDone:YES];
+    
+    b->chars = NULL;
+    b->length = b->capacity = 0;
+    return res;
+}
+
+
+/* Appends count copies of c to the buffer. */
+static inline void MGSCharacterBufferAppendRepeated(MGSCharacterBuffer *b, unichar c, NSUInteger count)
+{
+    MGSCharacterBufferReserve(b, count);
+    while (count--)
+        b->chars[b->length++] = c;
+}
+
+
+/* Returns whether c ends a line, in the same way as -getLineStart:end:... */
+static inline BOOL MGSIsLineTerminator(unichar c)
+{
+    return c == '\n' || c == '\r' || c == 0x85 || c == 0x2028 || c == 0x2029;
+}
+
+
+NSUInteger MGSDecodeUTF8(const uint8_t *bytes, NSUInteger len, unichar *out)
+{
+    NSUInteger i = 0, n = 0, need, k;
+    uint32_t cp, min;
+    uint8_t b, c;
+    
+    while (i < len) {
+        b = bytes[i];
+        if (b < 0x80) {
+            if (out)
+                out[n] = b;
+            n++;
+            i++;
+            continue;
+        }
+    
+        if ((b & 0xE0) == 0xC0) {
+            need = 1; cp = b & 0x1F; min = 0x80;
+        } else if ((b & 0xF0) == 0xE0) {
+            need = 2; cp = b & 0x0F; min = 0x800;
+        } else if ((b & 0xF8) == 0xF0) {
+            need = 3; cp = b & 0x07; min = 0x10000;
+        } else {
+            goto invalid;
+        }
+        if (i + need >= len)
+            goto invalid;
+        for (k = 1; k <= need; k++) {
+            c = bytes[i + k];
+            if ((c & 0xC0) != 0x80)
+                goto invalid;
+            cp = (cp << 6) | (c & 0x3F);
+        }
+        if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+            goto invalid;
+    
+        if (cp >= 0x10000) {
+            if (out) {
+                out[n] = 0xD800 + ((cp - 0x10000) >> 10);
+                out[n + 1] = 0xDC00 + ((cp - 0x10000) & 0x3FF);
+            }
+            n += 2;
+        } else {
+            if (out)
+                out[n] = cp;
+            n++;
+        }
+        i += need + 1;
+        continue;
+    
+    invalid:
+        if (out)
+            out[n] = 0xFFFD;
+        n++;
+        i++;
+    }
+    return n;
+}
+
+
+NSUInteger MGSIncompleteUTF8SequenceLength(const uint8_t *bytes, NSUInteger len)
+{
+    NSUInteger i, need;
+    uint8_t b;
+    
+    for (i = 1; i <= MIN(len, 3); i++) {
+        b = bytes[len - i];
+        if ((b & 0xC0) == 0x80)
+            continue;
+        if ((b & 0xE0) == 0xC0)
+            need = 2;
+        else if ((b & 0xF0) == 0xE0)
+            need = 3;
+        else if ((b & 0xF8) == 0xF0)
+            need = 4;
+        else
+            return 0;
+        return need > i ? i : 0;
+    }
+    return 0;
+}
+
+
 @implementation NSString (Fragaria)
 
 
@@ -75,4 +374,231 @@
 }
 
 
+- (NSRange)mgs_highlightingRangeForRange:(NSRange)range
+{
+    NSCharacterSet *nl = [NSCharacterSet newlineCharacterSet];
+    NSRange first, last, found;
+    NSUInteger lastIndex, start, end;
+    
+    first = MGSShortLineRangeForIndex(self, range.location);
+    if (first.location != NSNotFound) {
+        start = first.location;
+    } else {
+        /* Don't let the window start before the beginning of the line */
+        start = MGSWindowForIndex(self, range.location).location;
+        found = [self rangeOfCharacterFromSet:nl options:NSBackwardsSearch range:NSMakeRange(start, range.location - start)];
+        if (found.location != NSNotFound)
+            start = NSMaxRange(found);
+    }
+    
+    lastIndex = range.length > 0 ? NSMaxRange(range) - 1 : range.location;
+    last = MGSShortLineRangeForIndex(self, lastIndex);
+    if (last.location != NSNotFound) {
+        end = NSMaxRange(last);
+    } else {
+        /* Don't let the window end after the end of the line */
+        end = NSMaxRange(MGSWindowForIndex(self, lastIndex));
+        found = [self rangeOfCharacterFromSet:nl options:0 range:NSMakeRange(lastIndex, end - lastIndex)];
+        if (found.location != NSNotFound)
+            end = MGSEndOfLineTerminator(self, found.location);
+    }
+    
+    return NSMakeRange(start, end - start);
+}
+
+
+- (void)mgs_enumerateCharacterChunksInRange:(NSRange)range usingBlock:(void (^)(const unichar *chars, NSRange chunkRange, BOOL *stop))block
+{
+    const unichar *direct;
+    unichar buffer[MGSCharacterChunkLength];
+    NSRange chunk;
+    BOOL stop = NO;
+    
+    direct = CFStringGetCharactersPtr((__bridge CFStringRef)self);
+    if (direct) {
+        if (NSMaxRange(range) > self.length)
+            [NSException raise:NSRangeException format:@"Range %@ out of bounds", NSStringFromRange(range)];
+        if (range.length > 0)
+            block(direct + range.location, range, &stop);
+        return;
+    }
+    
+    chunk.location = range.location;
+    while (chunk.location < NSMaxRange(range) && !stop) {
+        chunk.length = MIN(MGSCharacterChunkLength, NSMaxRange(range) - chunk.location);
+        [self getCharacters:buffer range:chunk];
+        block(buffer, chunk, &stop);
+        chunk.location += chunk.length;
+    }
+}
+
+
+- (void)mgs_enumerateLineEditsToString:(NSString *)other usingBlock:(void (^)(NSRange range, NSRange replacementRange))block
+{
+    NSUInteger s0, s1, e0, e1, l0, l1, n0, n1;
+    NSRange line0, line1;
+    
+    /* Skip the lines which are the same at the start... */
+    s0 = s1 = 0;
+    e0 = self.length;
+    e1 = other.length;
+    while (s0 < e0 && s1 < e1) {
+        [self getLineStart:NULL end:&l0 contentsEnd:NULL forRange:NSMakeRange(s0, 0)];
+        [other getLineStart:NULL end:&l1 contentsEnd:NULL forRange:NSMakeRange(s1, 0)];
+        if (l0 - s0 != l1 - s1 || !MGSCharactersAreEqual(self, s0, other, s1, l0 - s0))
+            break;
+        s0 = l0;
+        s1 = l1;
+    }
+    
+    /* ...and at the end */
+    while (s0 < e0 && s1 < e1) {
+        [self getLineStart:&l0 end:NULL contentsEnd:NULL forRange:NSMakeRange(e0 - 1, 0)];
+        [other getLineStart:&l1 end:NULL contentsEnd:NULL forRange:NSMakeRange(e1 - 1, 0)];
+        if (l0 < s0 || l1 < s1 || e0 - l0 != e1 - l1 || !MGSCharactersAreEqual(self, l0, other, l1, e0 - l0))
+            break;
+        e0 = l0;
+        e1 = l1;
+    }
+    
+    n0 = MGSLineCountInRange(self, NSMakeRange(s0, e0 - s0));
+    n1 = MGSLineCountInRange(other, NSMakeRange(s1, e1 - s1));
+    if (n0 != n1) {
+        /* Lines were added or removed; don't try to match them */
+        MGSTrimmedEdit(self, NSMakeRange(s0, e0 - s0), other, NSMakeRange(s1, e1 - s1), block);
+        return;
+    }
+    
+    while (s0 < e0) {
+        line0 = [self lineRangeForRange:NSMakeRange(s0, 0)];
+        line1 = [other lineRangeForRange:NSMakeRange(s1, 0)];
+        MGSTrimmedEdit(self, line0, other, line1, block);
+        s0 = NSMaxRange(line0);
+        s1 = NSMaxRange(line1);
+    }
+}
+
+
+- (NSString *)mgs_stringByConvertingSpacesToTabsWithTabWidth:(NSUInteger)tabwidth
+{
+    __block MGSCharacterBuffer out;
+    __block NSUInteger col = 0, spaces = 0;
+    
+    if (tabwidth == 0)
+        return [self copy];
+    
+    out = MGSCharacterBufferMake(self.length);
+    [self mgs_enumerateCharacterChunksInRange:NSMakeRange(0, self.length) usingBlock:^(const unichar *chars, NSRange chunkRange, BOOL *stop) {
+        NSUInteger i;
+        unichar c;
+        
+        for (i = 0; i < chunkRange.length; i++) {
+            c = chars[i];
+            if (c == ' ') {
+                /* Spaces are held back until we know if they reach a tab
+                 * stop; a run of more than one space which does becomes a
+                 * tab. */
+                col++;
+                spaces++;
+                if (col % tabwidth == 0) {
+                    MGSCharacterBufferAppendRepeated(&out, spaces > 1 ? '\t' : ' ', 1);
+                    spaces = 0;
+                }
+                continue;
+            }
+            MGSCharacterBufferAppendRepeated(&out, ' ', spaces);
+            spaces = 0;
+            MGSCharacterBufferAppendRepeated(&out, c, 1);
+            if (c == '\t')
+                col += tabwidth - col % tabwidth;
+            else if (MGSIsLineTerminator(c))
+                col = 0;
+            else
+                col++;
+        }
+    }];
+    MGSCharacterBufferAppendRepeated(&out, ' ', spaces);
+    
+    return MGSCharacterBufferString(&out);
+}
+
+
+- (NSString *)mgs_stringByConvertingTabsToSpacesWithTabWidth:(NSUInteger)tabwidth
+{
+    __block MGSCharacterBuffer out;
+    __block NSUInteger col = 0;
+    
+    out = MGSCharacterBufferMake(self.length);
+    [self mgs_enumerateCharacterChunksInRange:NSMakeRange(0, self.length) usingBlock:^(const unichar *chars, NSRange chunkRange, BOOL *stop) {
+        NSUInteger i, n;
+        unichar c;
+        
+        for (i = 0; i < chunkRange.length; i++) {
+            c = chars[i];
+            if (c == '\t') {
+                n = tabwidth ? tabwidth - col % tabwidth : 0;
+                MGSCharacterBufferAppendRepeated(&out, ' ', n);
+                col += n;
+                continue;
+            }
+            MGSCharacterBufferAppendRepeated(&out, c, 1);
+            if (MGSIsLineTerminator(c))
+                col = 0;
+            else
+                col++;
+        }
+    }];
+    
+    return MGSCharacterBufferString(&out);
+}
+
+
+- (NSString *)mgs_stringByRemovingTrailingWhitespace
+{
+    NSCharacterSet *whitespace = [NSCharacterSet whitespaceCharacterSet];
+    __block MGSCharacterBuffer out;
+    __block NSUInteger contentEnd = 0;
+    
+    out = MGSCharacterBufferMake(self.length);
+    [self mgs_enumerateCharacterChunksInRange:NSMakeRange(0, self.length) usingBlock:^(const unichar *chars, NSRange chunkRange, BOOL *stop) {
+        NSUInteger i;
+        unichar c;
+        BOOL isWhitespace;
+        
+        for (i = 0; i < chunkRange.length; i++) {
+            c = chars[i];
+            if (c < 0x80)
+                isWhitespace = c == ' ' || c == '\t';
+            else
+                isWhitespace = [whitespace characterIsMember:c];
+            
+            /* Whitespace is copied immediately, and dropped again if the
+             * line ends before any other character is found */
+            if (MGSIsLineTerminator(c))
+                out.length = contentEnd;
+            MGSCharacterBufferAppendRepeated(&out, c, 1);
+            if (!isWhitespace)
+                contentEnd = out.length;
+        }
+    }];
+    out.length = contentEnd;
+    
+    return MGSCharacterBufferString(&out);
+}
+
+
++ (NSString *)mgs_stringWithUTF8Bytes:(const uint8_t *)bytes length:(NSUInteger)len
+{
+    NSUInteger n;
+    unichar *chars;
+    
+    n = MGSDecodeUTF8(bytes, len, NULL);
+    chars = malloc(MAX(n, 1) * sizeof(unichar));
+    if (!chars)
+        [NSException raise:NSMallocException format:@"Cannot allocate a buffer of %lu characters", (unsigned long)n];
+    MGSDecodeUTF8(bytes, len, chars);
+    return [[NSString alloc] initWithCharactersNoCopy:chars length:n freeWhenDone:YES];
+}
+
+
 @end
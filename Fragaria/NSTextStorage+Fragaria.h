@@ -48,5 +48,21 @@
 /** Returns the amount of text lines in this storage. */
 - (NSUInteger)mgs_lineCount;
 
+/** YES if mgs_lineCount is an estimate, because the line index of this
+ *  storage is still being built in the background. */
+- (BOOL)mgs_lineCountIsEstimate;
+
+/** The amount of lines which have already been indexed. Looking up these
+ *  lines never waits for the line index to be built.
+ *  @discussion Unless mgs_lineCountIsEstimate is YES, this is the same as
+ *    mgs_lineCount. */
+- (NSUInteger)mgs_indexedLineCount;
+
+/** Like mgs_rowOfCharacter:, but returns NSNotFound instead of waiting
+ *  when the line index being built in the background has not reached the
+ *  specified character yet.
+ *  @param c A character index in the string. */
+- (NSUInteger)mgs_rowOfCharacterIfIndexed:(NSUInteger)c;
+
 
 @end
@@ -98,6 +98,51 @@
 const static void *MGSLineNumberData = &MGSLineNumberData;
 
 
+/* Returns the index of the first character of the line after the one
+ * starting at i, or len if that line is the last one. Equivalent to
+ * NSMaxRange([s lineRangeForRange:NSMakeRange(i, 0)]), but it does not look
+ * backwards for the beginning of the line, and it accesses the characters
+ * a chunk at a time. */
+static NSUInteger MGSStartOfNextLine(NSString *s, NSUInteger i, NSUInteger len)
+{
+    __block NSUInteger res = len;
+    __block BOOL pendingCR = NO;
+    
+    [s mgs_enumerateCharacterChunksInRange:NSMakeRange(i, len - i) usingBlock:^(const unichar *chars, NSRange range, BOOL *stop) {
+        NSUInteger j;
+        unichar c;
+        
+        if (pendingCR) {
+            /* The previous chunk ended with a CR */
+            res = chars[0] == '\n' ? range.location + 1 : range.location;
+            *stop = YES;
+            return;
+        }
+        for (j = 0; j < range.length; j++) {
+            c = chars[j];
+            if (c > '\r' && c != 0x85 && c != 0x2028 && c != 0x2029)
+                continue;
+            if (c == '\r') {
+                if (j + 1 == range.length) {
+                    res = range.location + j + 1;
+                    pendingCR = YES;
+                    return;
+                }
+                res = range.location + j + (chars[j + 1] == '\n' ? 2 : 1);
+                *stop = YES;
+                return;
+            }
+            if (c == '\n' || c > '\r') {
+                res = range.location + j + 1;
+                *stop = YES;
+                return;
+            }
+        }
+    }];
+    return res;
+}
+
+
 @implementation NSTextStorage (Fragaria)
 
 
@@ -156,7 +201,7 @@ const static void *MGSLineNumberData = &MGSLineNumberData;
                     break;
             }
         } else
-            lr = [s lineRangeForRange:NSMakeRange(i, 0)];
+            lr = NSMakeRange(i, MGSStartOfNextLine(s, i, len) - i);
     }
     lnd->previousInvalidCharacter = lnd->firstInvalidCharacter;
     lnd->firstInvalidCharacter = i;
@@ -268,6 +313,33 @@ fallback:
 }
 
 
+/* The line index of a generic text storage is built on demand, on the
+ * calling thread, thus the line count is never an estimate. The text
+ * storages which index their lines in the background override these. */
+- (BOOL)mgs_lineCountIsEstimate
+{
+    if ([self isKindOfClass:[MGSAttributeOverlayTextStorage class]])
+        return [[(MGSAttributeOverlayTextStorage*)self parentTextStorage] mgs_lineCountIsEstimate];
+    return NO;
+}
+
+
+- (NSUInteger)mgs_indexedLineCount
+{
+    if ([self isKindOfClass:[MGSAttributeOverlayTextStorage class]])
+        return [[(MGSAttributeOverlayTextStorage*)self parentTextStorage] mgs_indexedLineCount];
+    return [self mgs_lineCount];
+}
+
+
+- (NSUInteger)mgs_rowOfCharacterIfIndexed:(NSUInteger)c
+{
+    if ([self isKindOfClass:[MGSAttributeOverlayTextStorage class]])
+        return [[(MGSAttributeOverlayTextStorage*)self parentTextStorage] mgs_rowOfCharacterIfIndexed:c];
+    return [self mgs_rowOfCharacter:c];
+}
+
+
 - (NSUInteger)mgs_rowOfMaybeInvalidCharacter:(NSUInteger)c
 {
     MGSTextStorageLineNumberData *lnd = [self mgs_lineNumberData];
@@ -7,6 +7,7 @@
 
 #import <XCTest/XCTest.h>
 #import "MGSAttributeOverlayTextStorage.h"
+#import "MGSAttributeOverlayTextStoragePrivate.h"
 
 
 @interface MGSAttributeOverlayTextStorageTestHelper: NSObject
@@ -244,6 +245,65 @@
 }
 
 
+- (void)testMergedAttributesSharing
+{
+    NSDictionary *attr0 = @{NSFontAttributeName: [NSFont userFontOfSize:12.0]};
+    NSDictionary *attr1 = @{NSFontAttributeName: [NSFont fontWithName:@"Times" size:12.0]};
+    NSDictionary *attr2 = @{NSForegroundColorAttributeName: [NSColor redColor]};
+    NSDictionary *attr0u2 = @{NSFontAttributeName: [NSFont userFontOfSize:12.0], NSForegroundColorAttributeName: [NSColor redColor]};
+    
+    NSTextStorage *parent = [[NSTextStorage alloc] initWithString:@"0123456789" attributes:attr0];
+    MGSAttributeOverlayTextStorage *child = [[MGSAttributeOverlayTextStorage alloc] initWithParentTextStorage:parent];
+    
+    [child setAttributes:attr2 range:NSMakeRange(2, 6)];
+    NSDictionary *a = [child attributesAtIndex:3 effectiveRange:NULL];
+    NSDictionary *b = [child attributesAtIndex:6 effectiveRange:NULL];
+    XCTAssertEqualObjects(a, attr0u2);
+    XCTAssertEqual(a, b);
+    XCTAssertFalse([a isKindOfClass:[NSMutableDictionary class]]);
+    
+    [child setAttributes:attr1 range:NSMakeRange(2, 6)];
+    XCTAssertEqualObjects([child attributesAtIndex:3 effectiveRange:NULL], attr1);
+    [parent addAttributes:attr2 range:NSMakeRange(0, 10)];
+    NSDictionary *attr1u2 = @{NSFontAttributeName: [NSFont fontWithName:@"Times" size:12.0], NSForegroundColorAttributeName: [NSColor redColor]};
+    XCTAssertEqualObjects([child attributesAtIndex:3 effectiveRange:NULL], attr1u2);
+    XCTAssertEqualObjects([child attributesAtIndex:0 effectiveRange:NULL], attr0u2);
+}
+
+
+- (void)testMergedAttributesCacheHits
+{
+    NSDictionary *attr0 = @{NSFontAttributeName: [NSFont userFontOfSize:12.0]};
+    NSDictionary *attr2 = @{NSForegroundColorAttributeName: [NSColor redColor]};
+    NSUInteger length = 4000;
+    NSUInteger merges;
+    
+    NSString *str = [@"" stringByPaddingToLength:length withString:@"abc " startingAtIndex:0];
+    NSTextStorage *parent = [[NSTextStorage alloc] initWithString:str attributes:attr0];
+    MGSAttributeOverlayTextStorage *child = [[MGSAttributeOverlayTextStorage alloc] initWithParentTextStorage:parent];
+    [child setAttributes:attr2 range:NSMakeRange(0, length)];
+    
+    /* The whole text is a single run, merged once */
+    merges = child.numberOfMergedAttributeDictionaries;
+    for (NSUInteger i = 0; i < length; i++)
+        [child attributesAtIndex:i effectiveRange:NULL];
+    XCTAssertEqual(child.numberOfMergedAttributeDictionaries - merges, 1);
+    
+    /* Each run is merged once */
+    [child setAttributes:@{NSBackgroundColorAttributeName: [NSColor blueColor]} range:NSMakeRange(0, length / 2)];
+    merges = child.numberOfMergedAttributeDictionaries;
+    for (NSUInteger i = 0; i < length; i++)
+        [child attributesAtIndex:i effectiveRange:NULL];
+    XCTAssertEqual(child.numberOfMergedAttributeDictionaries - merges, 2);
+    
+    /* Editing the attributes empties the cache */
+    [parent addAttribute:NSForegroundColorAttributeName value:[NSColor greenColor] range:NSMakeRange(0, length)];
+    merges = child.numberOfMergedAttributeDictionaries;
+    [child attributesAtIndex:0 effectiveRange:NULL];
+    XCTAssertEqual(child.numberOfMergedAttributeDictionaries - merges, 1);
+}
+
+
 - (void)testParentNotificationInChildren
 {
     MGSAttributeOverlayTextStorageTestNotificationHelper *parentNotificationState = [[MGSAttributeOverlayTextStorageTestNotificationHelper alloc] init];
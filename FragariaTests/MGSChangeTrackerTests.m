@@ -0,0 +1,132 @@
+//
+//  MGSChangeTrackerTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSTextView.h"
+#import "MGSChangeTracker.h"
+
+
+@interface MGSChangeTrackerTests : XCTestCase
+
+@end
+
+
+@implementation MGSChangeTrackerTests
+{
+    MGSFragariaView *fragaria;
+    MGSChangeTracker *tracker;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    tracker = fragaria.changeTracker;
+}
+
+
+- (NSString *)numberedLines:(NSUInteger)count
+{
+    NSMutableString *res = [NSMutableString string];
+    NSUInteger i;
+    
+    for (i = 0; i < count; i++)
+        [res appendFormat:@"line %lu\n", (unsigned long)i];
+    return res;
+}
+
+
+- (void)testChanges
+{
+    NSTextStorage *ts;
+    
+    fragaria.string = @"a\nb\nc\nd\ne";
+    ts = fragaria.textView.textStorage;
+    [tracker setBaselineToCurrentText];
+    XCTAssertEqual(tracker.numberOfChangedRegions, 0);
+    
+    [ts replaceCharactersInRange:NSMakeRange(2, 1) withString:@"B"];
+    XCTAssertEqual([tracker changesOfLine:0], MGSLineChangeNone);
+    XCTAssertEqual([tracker changesOfLine:1], MGSLineChangeModified);
+    
+    /* "a\nB\nc\nd\ne" -> "a\nB\nc\nx\nd\ne" */
+    [ts replaceCharactersInRange:NSMakeRange(6, 0) withString:@"x\n"];
+    XCTAssertEqual([tracker changesOfLine:2], MGSLineChangeNone);
+    XCTAssertEqual([tracker changesOfLine:3], MGSLineChangeAdded);
+    XCTAssertEqual([tracker changesOfLine:4], MGSLineChangeNone);
+    
+    /* "a\nB\nc\nx\nd\ne" -> "B\nc\nx\nd\ne": "B" replaces "a" and "b" */
+    [ts replaceCharactersInRange:NSMakeRange(0, 2) withString:@""];
+    XCTAssertEqual([tracker changesOfLine:0], MGSLineChangeModified);
+    XCTAssertEqual(tracker.numberOfChangedRegions, 2);
+    
+    /* "B\nc\nx\nd\ne" -> "B\nc\nx\nd" */
+    [ts replaceCharactersInRange:NSMakeRange(7, 2) withString:@""];
+    XCTAssertEqual([tracker changesOfLine:3], MGSLineChangeDeletedAfter);
+    
+    /* Restoring the baseline removes all the changes */
+    fragaria.string = @"a\nb\nc\nd\ne";
+    XCTAssertEqual(tracker.numberOfChangedRegions, 0);
+}
+
+
+- (void)testIncrementalDiffMatchesFullDiff
+{
+    NSTextStorage *ts;
+    MGSChangeTracker *full;
+    NSUInteger i, line, lineCount, loc, len;
+    NSString *repl;
+    
+    srandom(47);
+    fragaria.string = [self numberedLines:500];
+    ts = fragaria.textView.textStorage;
+    [tracker setBaselineToCurrentText];
+    full = [[MGSChangeTracker alloc] initWithTextView:fragaria.textView];
+    [full setBaselineString:fragaria.string];
+    
+    for (i = 0; i < 300; i++) {
+        loc = random() % (ts.length + 1);
+        len = MIN(random() % 30, ts.length - loc);
+        switch (random() % 3) {
+            case 0: repl = @""; break;
+            case 1: repl = [NSString stringWithFormat:@"new %lu", (unsigned long)i]; break;
+            default: repl = [NSString stringWithFormat:@"added %lu\n", (unsigned long)i]; break;
+        }
+        [ts replaceCharactersInRange:NSMakeRange(loc, len) withString:repl];
+        
+        [full updateAllChanges];
+        lineCount = ts.string.length ? [[ts.string componentsSeparatedByString:@"\n"] count] : 1;
+        for (line = 0; line < lineCount; line++)
+            XCTAssertEqual([tracker changesOfLine:line], [full changesOfLine:line], @"edit %lu, line %lu", (unsigned long)i, (unsigned long)line);
+    }
+}
+
+
+- (void)testKeystrokePerformance
+{
+    NSTextStorage *ts;
+    
+    fragaria.string = [self numberedLines:100000];
+    ts = fragaria.textView.textStorage;
+    [tracker setBaselineToCurrentText];
+    
+    [self measureBlock:^{
+        NSUInteger i, loc = ts.length / 2;
+        
+        for (i = 0; i < 200; i++) {
+            [ts replaceCharactersInRange:NSMakeRange(loc, 0) withString:i % 20 ? @"x" : @"\n"];
+            loc++;
+        }
+        [ts replaceCharactersInRange:NSMakeRange(ts.length / 2 - 100, 200) withString:@""];
+    }];
+}
+
+
+@end
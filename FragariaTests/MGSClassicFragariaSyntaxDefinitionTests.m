@@ -0,0 +1,86 @@
+//
+//  MGSClassicFragariaSyntaxDefinitionTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSClassicFragariaSyntaxDefinition.h"
+#import "MGSClassicFragariaSyntaxParser.h"
+
+
+@interface MGSClassicFragariaSyntaxDefinitionTests : XCTestCase
+
+@end
+
+
+@implementation MGSClassicFragariaSyntaxDefinitionTests
+{
+    MGSClassicFragariaSyntaxDefinition *definition;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    definition = [[MGSClassicFragariaSyntaxDefinition alloc] initFromSyntaxDictionary:@{
+        @"keywords": @[@"if"],
+        @"beginVariable": @"$",
+        @"endVariable": @" ;",
+        @"includeInKeywordStartCharacterSet": @"%"} name:@"Test"];
+}
+
+
+- (void)testCharacterClassTable
+{
+    const MGSCharacterClass *table = definition.characterClassTable;
+    NSCharacterSet *sets[] = {
+        definition.keywordStartCharacterSet, definition.keywordEndCharacterSet,
+        definition.nameCharacterSet, definition.numberCharacterSet,
+        definition.beginVariableCharacterSet, definition.endVariableCharacterSet,
+        definition.attributesCharacterSet};
+    MGSCharacterClass classes[] = {
+        MGSCharacterClassKeywordStart, MGSCharacterClassKeywordEnd,
+        MGSCharacterClassName, MGSCharacterClassNumber,
+        MGSCharacterClassBeginVariable, MGSCharacterClassEndVariable,
+        MGSCharacterClassAttribute};
+    
+    for (NSUInteger k = 0; k < sizeof(classes) / sizeof(MGSCharacterClass); k++) {
+        for (NSUInteger c = 0; c < 0x10000; c++) {
+            if ([sets[k] characterIsMember:(unichar)c] != !!(table[c] & classes[k])) {
+                XCTFail(@"Class %lu of character U+%04lX differs from its set", (unsigned long)classes[k], (unsigned long)c);
+                return;
+            }
+        }
+    }
+    XCTAssertTrue(table['%'] & MGSCharacterClassKeywordStart);
+    XCTAssertTrue(table['$'] & MGSCharacterClassBeginVariable);
+}
+
+
+- (void)testColouring
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    MGSSyntaxColouring *sc = fragaria.syntaxColouring;
+    
+    sc.parser = [[MGSClassicFragariaSyntaxParser alloc] initWithSyntaxDefinition:definition];
+    fragaria.string = @"if var_1 12 $foo;\n";
+    [sc recolourRange:NSMakeRange(0, fragaria.string.length)];
+    
+    XCTAssertEqualObjects([sc groupOfTokenAtCharacterIndex:0], MGSSyntaxGroupKeyword);
+    XCTAssertNil([sc groupOfTokenAtCharacterIndex:3]);
+    /* Numbers preceded by a name character are not coloured */
+    XCTAssertNil([sc groupOfTokenAtCharacterIndex:7]);
+    XCTAssertEqualObjects([sc groupOfTokenAtCharacterIndex:9], MGSSyntaxGroupNumber);
+    XCTAssertEqualObjects([sc groupOfTokenAtCharacterIndex:12], MGSSyntaxGroupVariable);
+    XCTAssertEqualObjects([sc groupOfTokenAtCharacterIndex:15], MGSSyntaxGroupVariable);
+    XCTAssertNil([sc groupOfTokenAtCharacterIndex:16]);
+}
+
+
+@end
@@ -0,0 +1,197 @@
+//
+//  MGSFoldingControllerTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSTextView.h"
+#import "MGSTextViewPrivate.h"
+#import "MGSFoldingController.h"
+#import "MGSLineGeometry.h"
+
+
+@interface MGSFoldingControllerTests : XCTestCase
+
+@end
+
+
+@implementation MGSFoldingControllerTests
+{
+    MGSFragariaView *fragaria;
+    MGSFoldingController *folding;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    fragaria.syntaxDefinitionName = @"C";
+    folding = fragaria.textView.foldingController;
+}
+
+
+- (void)testBracketFoldRange
+{
+    NSString *s = @"int f() {\n    a(); /* } */\n    b();\n}\nx\n";
+    NSRange r;
+    
+    fragaria.string = s;
+    r = [folding foldableRangeOfLine:0];
+    XCTAssertEqual(r.location, [s rangeOfString:@"{"].location + 1);
+    XCTAssertEqual(NSMaxRange(r), [s rangeOfString:@"}\n" options:NSBackwardsSearch].location);
+    
+    XCTAssertEqual([folding foldableRangeOfLine:3].location, NSNotFound);
+    XCTAssertEqual([folding foldableRangeOfLine:4].location, NSNotFound);
+}
+
+
+- (void)testBracketSearchIsBounded
+{
+    NSMutableString *s = [NSMutableString stringWithString:@"int f() {\n"];
+    
+    /* The closing bracket is too far to be found; the block is not indented
+     * either */
+    while (s.length < 1100000)
+        [s appendString:@"a();\n"];
+    [s appendString:@"}\n"];
+    fragaria.string = s;
+    XCTAssertTrue([folding isLineFoldable:0]);
+    XCTAssertEqual([folding foldableRangeOfLine:0].location, NSNotFound);
+}
+
+
+- (void)testIndentationFoldRange
+{
+    NSString *s = @"if x:\n    a\n\n    b\nc\n";
+    NSRange r;
+    
+    fragaria.syntaxDefinitionName = @"Python";
+    fragaria.string = s;
+    r = [folding foldableRangeOfLine:0];
+    XCTAssertEqual(r.location, 5);
+    XCTAssertEqual(NSMaxRange(r), [s rangeOfString:@"c"].location);
+    XCTAssertTrue([folding isLineFoldable:0]);
+    XCTAssertFalse([folding isLineFoldable:1]);
+}
+
+
+- (void)testRowMapping
+{
+    fragaria.string = @"a {\nb\nc\n}\nd {\ne\n}\nf\n";
+    
+    XCTAssertTrue([folding foldLine:0]);
+    XCTAssertTrue([folding foldLine:4]);
+    XCTAssertEqual(folding.numberOfFolds, 2);
+    XCTAssertTrue([folding isLineFolded:0]);
+    XCTAssertFalse([folding isLineFolded:1]);
+    
+    /* The lines which close the folds keep their own rows */
+    XCTAssertEqual([folding visibleRowOfLine:0], 0);
+    XCTAssertEqual([folding visibleRowOfLine:2], 0);
+    XCTAssertEqual([folding visibleRowOfLine:3], 1);
+    XCTAssertEqual([folding visibleRowOfLine:4], 2);
+    XCTAssertEqual([folding visibleRowOfLine:5], 2);
+    XCTAssertEqual([folding visibleRowOfLine:6], 3);
+    XCTAssertEqual([folding visibleRowOfLine:7], 4);
+    
+    XCTAssertEqual([folding lineOfVisibleRow:0], 0);
+    XCTAssertEqual([folding lineOfVisibleRow:1], 3);
+    XCTAssertEqual([folding lineOfVisibleRow:2], 4);
+    XCTAssertEqual([folding lineOfVisibleRow:3], 6);
+    XCTAssertEqual([folding lineOfVisibleRow:4], 7);
+    XCTAssertEqual([folding nextVisibleLineAfterLine:0], 3);
+    XCTAssertTrue([folding isLineHidden:2]);
+    XCTAssertFalse([folding isLineHidden:3]);
+    XCTAssertFalse([folding isLineHidden:4]);
+    
+    XCTAssertFalse([folding unfoldLine:3]);
+    XCTAssertTrue([folding unfoldLine:5]);
+    XCTAssertEqual(folding.numberOfFolds, 1);
+    XCTAssertEqual([folding lineOfVisibleRow:2], 4);
+    [folding unfoldAll];
+    XCTAssertEqual(folding.numberOfFolds, 0);
+    XCTAssertEqual([folding visibleRowOfLine:7], 7);
+}
+
+
+- (void)testFoldedLineFragments
+{
+    MGSTextView *tv = fragaria.textView;
+    NSLayoutManager *lm = tv.layoutManager;
+    NSString *s = @"a {\nb\nc\n}\nd\n";
+    NSRect header, hidden, tail, next;
+    
+    fragaria.string = s;
+    XCTAssertTrue([folding foldLine:0]);
+    [lm ensureLayoutForTextContainer:tv.textContainer];
+    
+    header = [lm lineFragmentRectForGlyphAtIndex:[lm glyphIndexForCharacterAtIndex:0] effectiveRange:NULL];
+    hidden = [lm lineFragmentRectForGlyphAtIndex:[lm glyphIndexForCharacterAtIndex:[s rangeOfString:@"c"].location] effectiveRange:NULL];
+    tail = [lm lineFragmentRectForGlyphAtIndex:[lm glyphIndexForCharacterAtIndex:[s rangeOfString:@"}"].location] effectiveRange:NULL];
+    next = [lm lineFragmentRectForGlyphAtIndex:[lm glyphIndexForCharacterAtIndex:[s rangeOfString:@"d"].location] effectiveRange:NULL];
+    
+    /* The hidden lines do not take a row of their own */
+    XCTAssertFalse(NSIsEmptyRect(header));
+    XCTAssertFalse(NSIsEmptyRect(hidden));
+    XCTAssertEqualWithAccuracy(NSMaxY(hidden), NSMaxY(header), 0.5);
+    
+    /* The line which closes the fold is laid out in the next row, as the
+     * row mapping says */
+    XCTAssertFalse(NSIsEmptyRect(tail));
+    XCTAssertEqualWithAccuracy(NSMinY(tail), NSMaxY(header), 0.5);
+    XCTAssertEqualWithAccuracy(NSMinY(next), NSMaxY(tail), 0.5);
+    XCTAssertEqual([folding visibleRowOfLine:3], 1);
+    XCTAssertEqual([folding visibleRowOfLine:4], 2);
+    XCTAssertEqualWithAccuracy(NSMinY([tv.lineGeometry lineFragmentRectForLine:3]), NSMinY(tail), 0.5);
+    XCTAssertEqualWithAccuracy(NSMinY([tv.lineGeometry lineFragmentRectForLine:4]), NSMinY(next), 0.5);
+}
+
+
+- (void)testFoldsFollowEdits
+{
+    NSLayoutManager *lm = fragaria.textView.layoutManager;
+    NSTextStorage *ts;
+    NSRange fold;
+    
+    fragaria.string = @"x\na {\nb\nbb\n}\n";
+    ts = fragaria.textView.textStorage;
+    XCTAssertTrue([folding foldLine:1]);
+    fold = [folding foldedRangeContainingCharacterIndex:6];
+    XCTAssertEqual(fold.location, 5);
+    
+    /* Editing before the fold moves it */
+    [ts replaceCharactersInRange:NSMakeRange(0, 1) withString:@"xyz\n"];
+    XCTAssertEqual([folding foldedRangeContainingCharacterIndex:6].location, NSNotFound);
+    fold = [folding foldedRangeContainingCharacterIndex:9];
+    XCTAssertEqual(fold.location, 8);
+    XCTAssertTrue([folding isLineFolded:2]);
+    
+    /* Editing inside the fold removes it, and the glyphs of the text which
+     * was folded are generated again right away */
+    XCTAssertEqual([lm propertyForGlyphAtIndex:[lm glyphIndexForCharacterAtIndex:fold.location + 3]], NSGlyphPropertyNull);
+    [ts replaceCharactersInRange:NSMakeRange(fold.location + 1, 1) withString:@"c"];
+    XCTAssertEqual(folding.numberOfFolds, 0);
+    XCTAssertNotEqual([lm propertyForGlyphAtIndex:[lm glyphIndexForCharacterAtIndex:fold.location + 3]], NSGlyphPropertyNull);
+}
+
+
+- (void)testUnfoldedCharacterIndexes
+{
+    NSIndexSet *set;
+    
+    fragaria.string = @"a {\nb\n}\nc\n";
+    XCTAssertTrue([folding foldLine:0]);
+    set = [folding unfoldedCharacterIndexesInRange:NSMakeRange(0, fragaria.string.length)];
+    XCTAssertEqual(set.count, fragaria.string.length - 3);
+    XCTAssertTrue([set containsIndexesInRange:NSMakeRange(0, 3)]);
+    XCTAssertFalse([set intersectsIndexesInRange:NSMakeRange(3, 3)]);
+    XCTAssertTrue([set containsIndexesInRange:NSMakeRange(6, fragaria.string.length - 6)]);
+}
+
+
+@end
@@ -0,0 +1,199 @@
+//
+//  MGSHighlightCacheTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSHighlightCache.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSTextView.h"
+#import "MGSClassicFragariaSyntaxDefinition.h"
+#import "MGSClassicFragariaSyntaxParser.h"
+
+
+@interface MGSHighlightCacheTests : XCTestCase
+
+@end
+
+
+@implementation MGSHighlightCacheTests
+{
+    NSURL *cacheURL;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    cacheURL = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]]];
+}
+
+
+- (void)tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtURL:cacheURL error:nil];
+    [super tearDown];
+}
+
+
+- (void)testContentHash
+{
+    NSString *a = @"SELECT * FROM t;\n";
+    NSString *b = @"SELECT * FROM u;\n";
+    NSMutableString *a2 = [@"SELECT * " mutableCopy];
+    
+    [a2 appendString:@"FROM t;\n"];
+    XCTAssertEqualObjects([MGSHighlightCache contentHashOfString:a], [MGSHighlightCache contentHashOfString:a2]);
+    XCTAssertNotEqualObjects([MGSHighlightCache contentHashOfString:a], [MGSHighlightCache contentHashOfString:b]);
+    XCTAssertNotEqualObjects([MGSHighlightCache contentHashOfString:@""], [MGSHighlightCache contentHashOfString:@"\0"]);
+}
+
+
+- (void)testContentHashOfPropertyList
+{
+    NSMutableDictionary *a = [NSMutableDictionary dictionary];
+    NSMutableDictionary *a2 = [NSMutableDictionary dictionary];
+    NSString *k;
+    NSUInteger i;
+    
+    /* The order in which the entries were added does not matter */
+    for (i = 0; i < 100; i++) {
+        k = [NSString stringWithFormat:@"key%lu", (unsigned long)i];
+        a[k] = @[k, @(i)];
+        k = [NSString stringWithFormat:@"key%lu", (unsigned long)(99 - i)];
+        a2[k] = @[k, @(99 - i)];
+    }
+    XCTAssertEqualObjects([MGSHighlightCache contentHashOfPropertyList:a], [MGSHighlightCache contentHashOfPropertyList:a2]);
+    
+    a2[@"key0"] = @[@"key0", @"0"];
+    XCTAssertNotEqualObjects([MGSHighlightCache contentHashOfPropertyList:a], [MGSHighlightCache contentHashOfPropertyList:a2]);
+    XCTAssertNotEqualObjects([MGSHighlightCache contentHashOfPropertyList:@[@"ab", @"c"]], [MGSHighlightCache contentHashOfPropertyList:@[@"a", @"bc"]]);
+}
+
+
+- (void)testEntries
+{
+    MGSHighlightCache *cache = [[MGSHighlightCache alloc] initWithDirectoryURL:cacheURL maximumSize:1000000];
+    NSData *d = [@"tokens" dataUsingEncoding:NSUTF8StringEncoding];
+    NSString *k1 = [cache keyForString:@"text" descriptor:@"sql"];
+    NSString *k2 = [cache keyForString:@"text" descriptor:@"c"];
+    
+    XCTAssertNotEqualObjects(k1, k2);
+    XCTAssertNil([cache dataForKey:k1]);
+    [cache setData:d forKey:k1];
+    XCTAssertEqualObjects([cache dataForKey:k1], d);
+    XCTAssertNil([cache dataForKey:k2]);
+    
+    [cache removeAllData];
+    XCTAssertNil([cache dataForKey:k1]);
+}
+
+
+- (void)testEviction
+{
+    MGSHighlightCache *cache = [[MGSHighlightCache alloc] initWithDirectoryURL:cacheURL maximumSize:40000];
+    NSMutableData *d = [NSMutableData dataWithLength:10000];
+    NSInteger i, present = 0;
+    
+    for (i = 0; i < 10; i++) {
+        [cache setData:d forKey:[NSString stringWithFormat:@"%ld", (long)i]];
+        /* Make sure the modification dates are different */
+        [NSThread sleepForTimeInterval:0.01];
+        [cache dataForKey:[NSString stringWithFormat:@"%ld", (long)i]];
+    }
+    for (i = 0; i < 10; i++)
+        if ([cache dataForKey:[NSString stringWithFormat:@"%ld", (long)i]])
+            present++;
+    XCTAssertLessThan(present, 10);
+    XCTAssertGreaterThan(present, 0);
+    XCTAssertNotNil([cache dataForKey:@"9"]);
+}
+
+
+- (void)testRestoreColouring
+{
+    MGSHighlightCache *cache = [[MGSHighlightCache alloc] initWithDirectoryURL:cacheURL maximumSize:1000000];
+    MGSFragariaView *f1 = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    MGSFragariaView *f2 = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    NSString *text = @"int main(void)\n{\n  /* comment */\n  return 42; // \"str\"\n}\n";
+    NSRange whole = NSMakeRange(0, text.length);
+    NSAttributedString *expect;
+    
+    f1.syntaxDefinitionName = @"C";
+    f2.syntaxDefinitionName = @"C";
+    f1.highlightCache = cache;
+    f2.highlightCache = cache;
+    
+    f1.string = text;
+    [f1.syntaxColouring recolourRange:whole];
+    expect = [f1.textView.textStorage attributedSubstringFromRange:whole];
+    [f1 saveColouringToHighlightCache];
+    
+    f2.string = text;
+    XCTAssertTrue([f2.syntaxColouring.inspectedCharacterIndexes containsIndexesInRange:whole]);
+    XCTAssertEqualObjects([f2.textView.textStorage attributedSubstringFromRange:whole], expect);
+    
+    /* A different syntax definition does not use the same entry */
+    f2.syntaxDefinitionName = @"Python";
+    XCTAssertFalse([f2 restoreColouringFromHighlightCache]);
+}
+
+
+- (void)testSaveBeforeReplacingText
+{
+    MGSHighlightCache *cache = [[MGSHighlightCache alloc] initWithDirectoryURL:cacheURL maximumSize:1000000];
+    MGSFragariaView *f1 = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    MGSFragariaView *f2 = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    NSString *text = @"int main(void)\n{\n  return 42;\n}\n";
+    NSRange whole = NSMakeRange(0, text.length);
+    
+    f1.syntaxDefinitionName = @"C";
+    f2.syntaxDefinitionName = @"C";
+    f1.highlightCache = cache;
+    f2.highlightCache = cache;
+    
+    f1.string = text;
+    [f1.syntaxColouring recolourRange:whole];
+    f1.string = @"something else";
+    
+    f2.string = text;
+    XCTAssertTrue([f2.syntaxColouring.inspectedCharacterIndexes containsIndexesInRange:whole]);
+}
+
+
+- (void)testDefinitionContentsInKey
+{
+    NSDictionary *dict = @{@"keywords": @[@"if"]};
+    NSDictionary *edited = @{@"keywords": @[@"if", @"else"]};
+    MGSClassicFragariaSyntaxParser *a, *b, *c;
+    
+    a = [[MGSClassicFragariaSyntaxParser alloc] initWithSyntaxDefinition:[[MGSClassicFragariaSyntaxDefinition alloc] initFromSyntaxDictionary:dict name:@"Custom"]];
+    b = [[MGSClassicFragariaSyntaxParser alloc] initWithSyntaxDefinition:[[MGSClassicFragariaSyntaxDefinition alloc] initFromSyntaxDictionary:[dict copy] name:@"Custom"]];
+    c = [[MGSClassicFragariaSyntaxParser alloc] initWithSyntaxDefinition:[[MGSClassicFragariaSyntaxDefinition alloc] initFromSyntaxDictionary:edited name:@"Custom"]];
+    
+    XCTAssertEqualObjects(a.tokenCacheVersion, b.tokenCacheVersion);
+    XCTAssertNotEqualObjects(a.tokenCacheVersion, c.tokenCacheVersion);
+}
+
+
+- (void)testMalformedArchive
+{
+    MGSFragariaView *f = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    NSData *archive;
+    
+    f.string = @"abc def";
+    [f.syntaxColouring recolourRange:NSMakeRange(0, 7)];
+    archive = [f.syntaxColouring tokenArchive];
+    
+    XCTAssertFalse([f.syntaxColouring restoreTokenArchive:[archive subdataWithRange:NSMakeRange(0, archive.length / 2)]]);
+    f.string = @"abc";
+    XCTAssertFalse([f.syntaxColouring restoreTokenArchive:archive]);
+}
+
+
+@end
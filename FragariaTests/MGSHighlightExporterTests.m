@@ -0,0 +1,140 @@
+//
+//  MGSHighlightExporterTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSHighlightExporter.h"
+
+
+@interface MGSHighlightExporterTests : XCTestCase
+
+@end
+
+
+@implementation MGSHighlightExporterTests
+{
+    MGSFragariaView *fragaria;
+    MGSHighlightExporter *exporter;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    fragaria.syntaxDefinitionName = @"C";
+    exporter = [[MGSHighlightExporter alloc] initWithSyntaxColouring:fragaria.syntaxColouring];
+}
+
+
+- (NSString *)stringForRange:(NSRange)range format:(MGSHighlightExportFormat)format
+{
+    NSData *data = [exporter dataForRange:range format:format];
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+}
+
+
+- (void)testHTML
+{
+    NSString *res;
+    
+    fragaria.string = @"int x = 1; // a<b & \"c\"\n";
+    res = [self stringForRange:NSMakeRange(0, fragaria.string.length) format:MGSHighlightExportFormatHTML];
+    
+    XCTAssertTrue([res hasPrefix:@"<pre style=\""]);
+    XCTAssertTrue([res hasSuffix:@"</pre>\n"]);
+    XCTAssertTrue([res containsString:@"<span style=\"color: #"]);
+    XCTAssertTrue([res containsString:@"a&lt;b &amp; &quot;c&quot;"]);
+}
+
+
+- (void)testRTF
+{
+    NSString *text = @"int x = 1; /* è {x} \\ */\r\n\treturn;\n";
+    NSData *data;
+    NSAttributedString *back;
+    
+    fragaria.string = text;
+    data = [exporter dataForRange:NSMakeRange(0, text.length) format:MGSHighlightExportFormatRTF];
+    back = [[NSAttributedString alloc] initWithRTF:data documentAttributes:NULL];
+    
+    XCTAssertNotNil(back);
+    XCTAssertEqualObjects(back.string, [text stringByReplacingOccurrencesOfString:@"\r\n" withString:@"\n"]);
+    XCTAssertNotEqualObjects([back attribute:NSForegroundColorAttributeName atIndex:0 effectiveRange:NULL],
+        [back attribute:NSForegroundColorAttributeName atIndex:4 effectiveRange:NULL]);
+}
+
+
+- (void)testANSI
+{
+    NSString *text = @"int x = 1; // comment\n";
+    NSString *res, *plain;
+    NSRegularExpression *escapes;
+    
+    fragaria.string = text;
+    res = [self stringForRange:NSMakeRange(0, text.length) format:MGSHighlightExportFormatANSI];
+    escapes = [NSRegularExpression regularExpressionWithPattern:@"\x1b\\[[0-9;]*m" options:0 error:nil];
+    plain = [escapes stringByReplacingMatchesInString:res options:0 range:NSMakeRange(0, res.length) withTemplate:@""];
+    
+    XCTAssertTrue([res containsString:@"\x1b[38;2;"]);
+    XCTAssertEqualObjects(plain, text);
+}
+
+
+- (void)testOnlyRangeIsColoured
+{
+    NSMutableIndexSet *valid = fragaria.syntaxColouring.inspectedCharacterIndexes;
+    NSString *line = @"int x = 1; // c\n";
+    NSUInteger lineLen = line.length;
+    NSString *res;
+    
+    fragaria.string = [@"" stringByPaddingToLength:lineLen * 1000 withString:line startingAtIndex:0];
+    [fragaria.syntaxColouring invalidateAllColouring];
+    
+    res = [self stringForRange:NSMakeRange(lineLen * 500, lineLen * 2) format:MGSHighlightExportFormatHTML];
+    XCTAssertTrue([res containsString:@"int x = 1;"]);
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(lineLen * 500, lineLen * 2)]);
+    XCTAssertFalse([valid containsIndex:0]);
+    XCTAssertFalse([valid containsIndex:lineLen * 999]);
+}
+
+
+- (void)testStreaming
+{
+    NSString *line = @"int x = 1; /* c */ \"s\"\n";
+    NSMutableData *streamed = [NSMutableData data];
+    __block NSUInteger chunks = 0;
+    NSRange all;
+    
+    fragaria.string = [@"" stringByPaddingToLength:line.length * 20000 withString:line startingAtIndex:0];
+    all = NSMakeRange(0, fragaria.string.length);
+    
+    [exporter exportRange:all format:MGSHighlightExportFormatHTML usingBlock:^(NSData *chunk) {
+        chunks++;
+        [streamed appendData:chunk];
+    }];
+    XCTAssertGreaterThan(chunks, 1);
+    XCTAssertEqualObjects(streamed, [exporter dataForRange:all format:MGSHighlightExportFormatHTML]);
+}
+
+
+- (void)testExportPerformance
+{
+    NSString *line = @"int x = 1; /* c */ \"s\"\n";
+    NSUInteger lineLen = line.length;
+    
+    fragaria.string = [@"" stringByPaddingToLength:lineLen * 50000 withString:line startingAtIndex:0];
+    [self measureBlock:^{
+        [self->exporter dataForRange:NSMakeRange(lineLen * 25000, lineLen * 10) format:MGSHighlightExportFormatRTF];
+    }];
+}
+
+
+@end
@@ -0,0 +1,162 @@
+//
+//  MGSIncrementalSyntaxParserTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSSyntaxParser.h"
+#import "MGSIncrementalSyntaxParser.h"
+#import "MGSTextView.h"
+
+
+/* A parser which records the edits it receives, and invalidates only the
+ * ranges it is told to. */
+@interface MGSTestIncrementalParser : MGSSyntaxParser <MGSIncrementalSyntaxParser>
+
+@property (nonatomic) NSString *resetString;
+@property (nonatomic) NSUInteger resetGeneration;
+@property (nonatomic) NSMutableArray<NSValue *> *deltas;
+@property (nonatomic) NSIndexSet *changedRanges;
+@property (nonatomic) NSUInteger lastParsedGeneration;
+
+@end
+
+
+@implementation MGSTestIncrementalParser
+
+
+- (instancetype)init
+{
+    self = [super init];
+    _deltas = [NSMutableArray array];
+    return self;
+}
+
+
+- (void)resetIncrementalParsingWithString:(NSString *)string generation:(NSUInteger)generation
+{
+    self.resetString = [string copy];
+    self.resetGeneration = generation;
+    [self.deltas removeAllObjects];
+}
+
+
+- (NSIndexSet *)applyEditDelta:(MGSTextEditDelta)delta toString:(NSString *)string
+{
+    [self.deltas addObject:[NSValue valueWithBytes:&delta objCType:@encode(MGSTextEditDelta)]];
+    return self.changedRanges;
+}
+
+
+- (NSRange)parseForClient:(id<MGSSyntaxParserClient>)client
+{
+    self.lastParsedGeneration = client.textGeneration;
+    return client.rangeToParse;
+}
+
+
+@end
+
+
+@interface MGSIncrementalSyntaxParserTests : XCTestCase
+
+@end
+
+
+@implementation MGSIncrementalSyntaxParserTests
+{
+    MGSFragariaView *fragaria;
+    MGSTestIncrementalParser *parser;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    fragaria.string = @"line one\nline two\nline three\n";
+    parser = [[MGSTestIncrementalParser alloc] init];
+    fragaria.syntaxColouring.parser = parser;
+}
+
+
+- (MGSTextEditDelta)deltaAtIndex:(NSUInteger)i
+{
+    MGSTextEditDelta d;
+    [parser.deltas[i] getValue:&d];
+    return d;
+}
+
+
+- (void)testReset
+{
+    XCTAssertEqualObjects(parser.resetString, fragaria.string);
+    
+    [fragaria replaceTextStorage:[[NSTextStorage alloc] initWithString:@"other"]];
+    XCTAssertEqualObjects(parser.resetString, @"other");
+    XCTAssertEqual(parser.deltas.count, 0);
+}
+
+
+- (void)testDeltas
+{
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    NSUInteger gen = parser.resetGeneration;
+    MGSTextEditDelta d;
+    
+    [ts replaceCharactersInRange:NSMakeRange(5, 3) withString:@"1"];
+    XCTAssertEqual(parser.deltas.count, 1);
+    d = [self deltaAtIndex:0];
+    XCTAssertTrue(NSEqualRanges(d.oldRange, NSMakeRange(5, 3)));
+    XCTAssertTrue(NSEqualRanges(d.newRange, NSMakeRange(5, 1)));
+    XCTAssertEqual(d.changeInLength, -2);
+    XCTAssertGreaterThan(d.generation, gen);
+    
+    /* Attribute changes are not edits */
+    [ts addAttribute:NSForegroundColorAttributeName value:[NSColor redColor] range:NSMakeRange(0, 3)];
+    XCTAssertEqual(parser.deltas.count, 1);
+    
+    [ts replaceCharactersInRange:NSMakeRange(0, 0) withString:@">"];
+    XCTAssertEqual(parser.deltas.count, 2);
+    XCTAssertGreaterThan([self deltaAtIndex:1].generation, d.generation);
+    
+    [fragaria.syntaxColouring recolourRange:NSMakeRange(0, ts.length)];
+    XCTAssertEqual(parser.lastParsedGeneration, [self deltaAtIndex:1].generation);
+}
+
+
+- (void)testParserChoosesInvalidRanges
+{
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    NSMutableIndexSet *valid = fragaria.syntaxColouring.inspectedCharacterIndexes;
+    NSUInteger len = ts.length;
+    
+    [fragaria.syntaxColouring recolourRange:NSMakeRange(0, len)];
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(0, len)]);
+    
+    /* Only the edited character and the range returned by the parser become
+     * invalid, not the whole line */
+    parser.changedRanges = [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(20, 2)];
+    [ts replaceCharactersInRange:NSMakeRange(2, 1) withString:@"N"];
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(0, 2)]);
+    XCTAssertFalse([valid containsIndex:2]);
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(3, 17)]);
+    XCTAssertFalse([valid intersectsIndexesInRange:NSMakeRange(20, 2)]);
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(22, len - 22)]);
+    
+    /* Returning nil falls back to invalidating the line */
+    [fragaria.syntaxColouring recolourRange:NSMakeRange(0, len)];
+    parser.changedRanges = nil;
+    [ts replaceCharactersInRange:NSMakeRange(2, 1) withString:@"n"];
+    XCTAssertFalse([valid intersectsIndexesInRange:NSMakeRange(0, 9)]);
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(9, len - 9)]);
+}
+
+
+@end
@@ -0,0 +1,144 @@
+//
+//  MGSLayoutManagerTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSLayoutManager.h"
+
+
+@interface MGSLayoutManager ()
+
+- (void)drawSubstituteForCharacter:(unichar)c atIndex:(NSUInteger)charIndex inGlyphRange:(NSRange)glyphRange context:(void *)gcContext;
+
+@end
+
+
+/* Records the characters for which a substitute is drawn. */
+@interface MGSRecordingLayoutManager : MGSLayoutManager
+
+@property (nonatomic, readonly) NSMutableIndexSet *substitutedIndexes;
+
+@end
+
+
+@implementation MGSRecordingLayoutManager
+
+
+- (instancetype)init
+{
+    self = [super init];
+    _substitutedIndexes = [NSMutableIndexSet indexSet];
+    return self;
+}
+
+
+- (void)drawSubstituteForCharacter:(unichar)c atIndex:(NSUInteger)charIndex inGlyphRange:(NSRange)glyphRange context:(void *)gcContext
+{
+    [self.substitutedIndexes addIndex:charIndex];
+    [super drawSubstituteForCharacter:c atIndex:charIndex inGlyphRange:glyphRange context:gcContext];
+}
+
+
+@end
+
+
+@interface MGSLayoutManagerTests : XCTestCase
+
+@end
+
+
+@implementation MGSLayoutManagerTests
+{
+    NSTextStorage *textStorage;
+    NSTextContainer *textContainer;
+    NSBitmapImageRep *bitmap;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    textStorage = [[NSTextStorage alloc] init];
+    textContainer = [[NSTextContainer alloc] initWithContainerSize:NSMakeSize(400, CGFLOAT_MAX)];
+    bitmap = [[NSBitmapImageRep alloc] initWithBitmapDataPlanes:NULL
+      pixelsWide:400 pixelsHigh:400 bitsPerSample:8 samplesPerPixel:4
+      hasAlpha:YES isPlanar:NO colorSpaceName:NSDeviceRGBColorSpace
+      bytesPerRow:0 bitsPerPixel:0];
+}
+
+
+- (void)attachLayoutManager:(MGSLayoutManager *)lm toString:(NSString *)str
+{
+    NSDictionary *attr = @{NSFontAttributeName: [NSFont fontWithName:@"Menlo" size:11]};
+    
+    [lm addTextContainer:textContainer];
+    [textStorage addLayoutManager:lm];
+    [textStorage replaceCharactersInRange:NSMakeRange(0, textStorage.length) withAttributedString:[[NSAttributedString alloc] initWithString:str attributes:attr]];
+    lm.showsInvisibleCharacters = YES;
+    [lm ensureLayoutForTextContainer:textContainer];
+}
+
+
+- (void)drawAllGlyphsOfLayoutManager:(MGSLayoutManager *)lm
+{
+    [NSGraphicsContext saveGraphicsState];
+    [NSGraphicsContext setCurrentContext:[NSGraphicsContext graphicsContextWithBitmapImageRep:bitmap]];
+    [lm drawGlyphsForGlyphRange:NSMakeRange(0, lm.numberOfGlyphs) atPoint:NSZeroPoint];
+    [NSGraphicsContext restoreGraphicsState];
+}
+
+
+- (void)testSubstitutesOnlyCharactersInBitmap
+{
+    MGSRecordingLayoutManager *lm = [[MGSRecordingLayoutManager alloc] init];
+    NSMutableIndexSet *expected = [NSMutableIndexSet indexSet];
+    
+    /* U+0120 and U+2009 have the same low byte as the space and the tab */
+    [self attachLayoutManager:lm toString:@"a b\tc\u0120d\u2009e\nf x"];
+    [self drawAllGlyphsOfLayoutManager:lm];
+    [expected addIndex:1];
+    [expected addIndex:3];
+    [expected addIndex:9];
+    [expected addIndex:11];
+    XCTAssertEqualObjects(lm.substitutedIndexes, expected);
+    
+    /* The bitmap follows the changes to the substitutes */
+    [lm removeSubstituteForInvisibleCharacter:' '];
+    [lm addSubstitute:@"*" forInvisibleCharacter:'x'];
+    [lm.substitutedIndexes removeAllIndexes];
+    [self drawAllGlyphsOfLayoutManager:lm];
+    [expected removeAllIndexes];
+    [expected addIndex:3];
+    [expected addIndex:9];
+    [expected addIndex:12];
+    XCTAssertEqualObjects(lm.substitutedIndexes, expected);
+    
+    /* Nothing is drawn when invisible characters are hidden */
+    lm.showsInvisibleCharacters = NO;
+    [lm.substitutedIndexes removeAllIndexes];
+    [self drawAllGlyphsOfLayoutManager:lm];
+    XCTAssertEqual(lm.substitutedIndexes.count, 0);
+}
+
+
+- (void)testInvisibleCharacterDrawingPerformance
+{
+    MGSLayoutManager *lm = [[MGSLayoutManager alloc] init];
+    NSMutableString *str = [NSMutableString string];
+    NSUInteger i;
+    
+    for (i = 0; i < 20000; i++)
+        [str appendString:@"\tint function(int a, int b) { return a * b; }  \n"];
+    [self attachLayoutManager:lm toString:str];
+    
+    [self measureBlock:^{
+        [self drawAllGlyphsOfLayoutManager:lm];
+    }];
+}
+
+
+@end
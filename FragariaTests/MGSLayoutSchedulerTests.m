@@ -0,0 +1,183 @@
+//
+//  MGSLayoutSchedulerTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSTextView.h"
+#import "MGSTextViewPrivate.h"
+#import "MGSLayoutScheduler.h"
+
+
+@interface MGSLayoutSchedulerTests : XCTestCase
+
+@end
+
+
+@implementation MGSLayoutSchedulerTests
+{
+    NSWindow *window;
+    MGSFragariaView *fragaria;
+    MGSLayoutScheduler *scheduler;
+}
+
+
+- (void)setUp
+{
+    NSMutableString *str = [NSMutableString string];
+    NSUInteger i;
+    
+    [super setUp];
+    window = [[NSWindow alloc] initWithContentRect:NSMakeRect(0, 0, 400, 400) styleMask:NSWindowStyleMaskTitled backing:NSBackingStoreBuffered defer:NO];
+    window.releasedWhenClosed = NO;
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    window.contentView = fragaria;
+    scheduler = fragaria.textView.layoutScheduler;
+    
+    for (i = 0; i < 20000; i++)
+        [str appendFormat:@"int function%lu(int a, int b) { return a * %lu + b; } /* %@ */\n", (unsigned long)i, (unsigned long)i, [@"" stringByPaddingToLength:i % 80 withString:@"x " startingAtIndex:0]];
+    fragaria.string = str;
+}
+
+
+- (void)tearDown
+{
+    [window close];
+    [super tearDown];
+}
+
+
+/* Scrolls the text view and informs the scheduler, as drawing would. */
+- (void)scrollTo:(CGFloat)y
+{
+    MGSTextView *tv = fragaria.textView;
+    
+    [tv scrollPoint:NSMakePoint(0, y)];
+    [scheduler textViewDidDrawRect:tv.visibleRect];
+}
+
+
+- (void)testScrollDirection
+{
+    NSRect visible, pending;
+    
+    [self scrollTo:2000];
+    [self scrollTo:2100];
+    visible = fragaria.textView.visibleRect;
+    pending = scheduler.pendingRect;
+    XCTAssertEqual(scheduler.direction, 1);
+    XCTAssertGreaterThan(scheduler.velocity, 0);
+    XCTAssertFalse(NSIsEmptyRect(pending));
+    XCTAssertGreaterThanOrEqual(NSMinY(pending), NSMaxY(visible));
+    
+    /* Reversing the scroll cancels the layout below */
+    [self scrollTo:2050];
+    visible = fragaria.textView.visibleRect;
+    pending = scheduler.pendingRect;
+    XCTAssertEqual(scheduler.direction, -1);
+    XCTAssertLessThan(scheduler.velocity, 0);
+    XCTAssertFalse(NSIsEmptyRect(pending));
+    XCTAssertLessThanOrEqual(NSMaxY(pending), NSMinY(visible));
+}
+
+
+- (void)testLayoutAhead
+{
+    NSDate *limit = [NSDate dateWithTimeIntervalSinceNow:0.2];
+    
+    [self scrollTo:2000];
+    [self scrollTo:2100];
+    XCTAssertFalse(NSIsEmptyRect(scheduler.pendingRect));
+    
+    /* The pending region is laid out while the run loop is idle */
+    while (!NSIsEmptyRect(scheduler.pendingRect) && [limit timeIntervalSinceNow] > 0)
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    XCTAssertTrue(NSIsEmptyRect(scheduler.pendingRect));
+    XCTAssertEqual(scheduler.direction, 1);
+}
+
+
+- (void)testStopCancels
+{
+    [self scrollTo:2000];
+    [self scrollTo:8000];
+    XCTAssertEqual(scheduler.direction, 1);
+    
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.5]];
+    XCTAssertEqual(scheduler.direction, 0);
+    XCTAssertTrue(NSIsEmptyRect(scheduler.pendingRect));
+    
+    [scheduler cancel];
+    [self scrollTo:8100];
+    XCTAssertEqual(scheduler.direction, 1);
+    [scheduler cancel];
+    XCTAssertEqual(scheduler.direction, 0);
+    XCTAssertTrue(NSIsEmptyRect(scheduler.pendingRect));
+}
+
+
+/* Scrolls through wrapped text at 60 frames per second, and records how
+ * long it takes to draw each frame. The time left in each frame is given to
+ * the run loop, as it would be while the user scrolls. The percentiles of
+ * the frame times are attached to the results of the test. */
+- (void)testScrollingFrameTimesPerformance
+{
+    const NSUInteger frames = 120;
+    const CFAbsoluteTime frameDuration = 1.0 / 60.0;
+    const CGFloat step = 80;
+    NSMutableArray<NSNumber *> *times = [NSMutableArray array];
+    NSString *str = fragaria.string;
+    __block NSArray<NSNumber *> *sorted;
+    XCTAttachment *attachment;
+    NSString *summary;
+    
+    fragaria.lineWrap = YES;
+    
+    [self measureMetrics:[[self class] defaultPerformanceMetrics] automaticallyStartMeasuring:NO forBlock:^{
+        MGSTextView *tv = self->fragaria.textView;
+        CFAbsoluteTime start, end;
+        NSUInteger i;
+        
+        /* Start from text which has not been laid out */
+        self->fragaria.string = @"";
+        self->fragaria.string = str;
+        [tv scrollPoint:NSZeroPoint];
+        [self->window displayIfNeeded];
+        [times removeAllObjects];
+        
+        [self startMeasuring];
+        for (i = 1; i <= frames; i++) {
+            start = CFAbsoluteTimeGetCurrent();
+            [tv scrollPoint:NSMakePoint(0, step * i)];
+            [self->window displayIfNeeded];
+            end = CFAbsoluteTimeGetCurrent();
+            [times addObject:@(end - start)];
+            if (end - start < frameDuration)
+                [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceReferenceDate:start + frameDuration]];
+        }
+        [self stopMeasuring];
+        
+        sorted = [times sortedArrayUsingSelector:@selector(compare:)];
+    }];
+    XCTAssertEqual(times.count, frames);
+    
+    summary = [NSString stringWithFormat:@"frame times: median %.2f ms, 95th percentile %.2f ms, max %.2f ms",
+      sorted[frames / 2].doubleValue * 1000.0,
+      sorted[frames * 95 / 100].doubleValue * 1000.0,
+      sorted.lastObject.doubleValue * 1000.0];
+    attachment = [XCTAttachment attachmentWithString:summary];
+    attachment.name = @"Frame times";
+    attachment.lifetime = XCTAttachmentLifetimeKeepAlways;
+    [self addAttachment:attachment];
+    
+    /* Most frames leave time to lay out ahead; a generous bound, so that
+     * only a regression to laying out whole screens at a time fails */
+    XCTAssertLessThan(sorted[frames * 95 / 100].doubleValue, 3 * frameDuration, @"%@", summary);
+}
+
+
+@end
@@ -0,0 +1,117 @@
+//
+//  MGSLineGeometryTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSTextView.h"
+#import "MGSTextViewPrivate.h"
+#import "MGSLineGeometry.h"
+#import "NSTextStorage+Fragaria.h"
+
+
+@interface MGSLineGeometryTests : XCTestCase
+
+@property MGSFragariaView *fragaria;
+
+@end
+
+
+@implementation MGSLineGeometryTests
+
+
+- (void)setUp
+{
+    NSMutableString *text = [NSMutableString string];
+
+    [super setUp];
+    self.fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    for (NSInteger i = 0; i < 20000; i++)
+        [text appendFormat:@"    line %ld = \"%@\";\n", (long)i, i % 3 ? @"abc" : @""];
+    self.fragaria.string = text;
+    self.fragaria.lineWrap = NO;
+    self.fragaria.textFont = [NSFont fontWithName:@"Menlo" size:11];
+}
+
+
+- (void)tearDown
+{
+    self.fragaria = nil;
+    [super tearDown];
+}
+
+
+- (void)testFixedLineHeightConditions
+{
+    MGSLineGeometry *geom = self.fragaria.textView.lineGeometry;
+
+    XCTAssertTrue(geom.hasFixedLineHeight);
+    self.fragaria.lineWrap = YES;
+    XCTAssertFalse(geom.hasFixedLineHeight);
+    self.fragaria.lineWrap = NO;
+    self.fragaria.textFont = [NSFont fontWithName:@"Times" size:11];
+    XCTAssertFalse(geom.hasFixedLineHeight);
+}
+
+
+- (void)testGeometryMatchesLayoutManager
+{
+    MGSTextView *tv = self.fragaria.textView;
+    NSLayoutManager *lm = tv.layoutManager;
+    MGSLineGeometry *geom = tv.lineGeometry;
+    NSRect rect, expectRect;
+    NSRange range, expectRange;
+
+    XCTAssertTrue(geom.hasFixedLineHeight);
+    [lm ensureLayoutForCharacterRange:NSMakeRange(0, tv.string.length)];
+
+    for (NSUInteger line = 0; line < 20000; line += 997) {
+        rect = [geom lineFragmentRectForLine:line];
+        NSUInteger glyph = [lm glyphIndexForCharacterAtIndex:[tv.textStorage mgs_firstCharacterInRow:line]];
+        expectRect = [lm lineFragmentRectForGlyphAtIndex:glyph effectiveRange:NULL];
+        XCTAssertEqualWithAccuracy(NSMinY(rect), NSMinY(expectRect), 0.5);
+        XCTAssertEqualWithAccuracy(NSHeight(rect), NSHeight(expectRect), 0.5);
+        XCTAssertEqual([geom lineAtVerticalPosition:NSMidY(rect)], line);
+    }
+
+    rect = NSMakeRect(0, 12345.0, 400, 400);
+    range = [geom characterRangeForRect:rect];
+    expectRange = [lm characterRangeForGlyphRange:[lm glyphRangeForBoundingRect:rect inTextContainer:tv.textContainer] actualGlyphRange:NULL];
+    XCTAssertTrue(NSEqualRanges(range, expectRange), @"%@ != %@", NSStringFromRange(range), NSStringFromRange(expectRange));
+    XCTAssertTrue(geom.hasFixedLineHeight);
+}
+
+
+- (void)testMixedLineHeightsFallback
+{
+    MGSTextView *tv = self.fragaria.textView;
+    NSLayoutManager *lm = tv.layoutManager;
+    MGSLineGeometry *geom = tv.lineGeometry;
+
+    [tv.textStorage addAttribute:NSFontAttributeName value:[NSFont fontWithName:@"Menlo" size:30] range:NSMakeRange(0, 10)];
+    [lm ensureLayoutForCharacterRange:NSMakeRange(0, tv.string.length)];
+
+    [geom characterRangeForRect:NSMakeRect(0, 5000, 400, 400)];
+    XCTAssertFalse(geom.hasFixedLineHeight);
+}
+
+
+- (void)testScrollingGeometryPerformance
+{
+    MGSLineGeometry *geom = self.fragaria.textView.lineGeometry;
+
+    [self measureBlock:^{
+        for (CGFloat y = 0; y < 20000 * 13; y += 200) {
+            NSRange lines = [geom lineRangeForRect:NSMakeRect(0, y, 400, 400)];
+            for (NSUInteger l = lines.location; l < NSMaxRange(lines); l++)
+                [geom lineFragmentRectForLine:l];
+        }
+    }];
+}
+
+
+@end
@@ -0,0 +1,125 @@
+//
+//  MGSLongLineHighlightingTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "NSString+Fragaria.h"
+
+
+@interface MGSLongLineHighlightingTests : XCTestCase
+
+@end
+
+
+@implementation MGSLongLineHighlightingTests
+
+
+- (NSString *)longLineOfLength:(NSUInteger)length
+{
+    NSString *chunk = @"var a=1;function f(x){return \"s\"+x/2;}";
+    NSMutableString *res = [NSMutableString stringWithCapacity:length + chunk.length];
+    
+    while (res.length < length)
+        [res appendString:chunk];
+    return res;
+}
+
+
+- (void)testShortLines
+{
+    NSString *s = @"1234\n1234567\r\n\n12";
+    NSRange r;
+    
+    for (NSUInteger i = 0; i < s.length; i++) {
+        for (NSUInteger l = 0; i + l <= s.length; l++) {
+            r = NSMakeRange(i, l);
+            XCTAssert(NSEqualRanges([s mgs_highlightingRangeForRange:r], [s lineRangeForRange:r]));
+        }
+    }
+}
+
+
+- (void)testLongLineWindows
+{
+    NSString *s = [NSString stringWithFormat:@"short\n%@\nshort", [self longLineOfLength:100000]];
+    NSRange w, w2, line;
+    NSUInteger i;
+    
+    line = [s lineRangeForRange:NSMakeRange(10, 0)];
+    
+    /* The windows cover the whole line without overlapping */
+    i = line.location;
+    while (i < NSMaxRange(line)) {
+        w = [s mgs_highlightingRangeForRange:NSMakeRange(i, 0)];
+        XCTAssertEqual(w.location, i);
+        XCTAssertLessThanOrEqual(w.length, MGSLongLineWindowLength * 2);
+        w2 = [s mgs_highlightingRangeForRange:NSMakeRange(NSMaxRange(w) - 1, 0)];
+        XCTAssert(NSEqualRanges(w, w2));
+        i = NSMaxRange(w);
+    }
+    XCTAssertEqual(i, NSMaxRange(line));
+    
+    /* Ranges across multiple windows are expanded to all of them */
+    w = [s mgs_highlightingRangeForRange:NSMakeRange(50000, 10000)];
+    XCTAssertEqual(w.location, [s mgs_highlightingRangeForRange:NSMakeRange(50000, 0)].location);
+    XCTAssertEqual(NSMaxRange(w), NSMaxRange([s mgs_highlightingRangeForRange:NSMakeRange(59999, 0)]));
+    
+    /* Ranges which include a short line also include all of it */
+    w = [s mgs_highlightingRangeForRange:NSMakeRange(s.length - 3, 0)];
+    XCTAssertEqual(NSMaxRange(w), s.length);
+    XCTAssertEqual(w.location, NSMaxRange(line));
+}
+
+
+- (void)testEditInvalidatesOnlyWindow
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 800, 400)];
+    MGSSyntaxColouring *sc = fragaria.syntaxColouring;
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    NSUInteger mid;
+    
+    fragaria.syntaxDefinitionName = @"JavaScript";
+    fragaria.string = [self longLineOfLength:1000000];
+    mid = ts.length / 2;
+    
+    [sc recolourRange:NSMakeRange(0, ts.length)];
+    XCTAssertTrue([sc.inspectedCharacterIndexes containsIndexesInRange:NSMakeRange(0, ts.length)]);
+    
+    [ts replaceCharactersInRange:NSMakeRange(mid, 0) withString:@"x"];
+    XCTAssertTrue([sc.inspectedCharacterIndexes containsIndexesInRange:NSMakeRange(0, mid - MGSLongLineWindowLength * 2)]);
+    XCTAssertTrue([sc.inspectedCharacterIndexes containsIndexesInRange:NSMakeRange(mid + MGSLongLineWindowLength * 2, ts.length - mid - MGSLongLineWindowLength * 2)]);
+    XCTAssertFalse([sc.inspectedCharacterIndexes containsIndex:mid]);
+}
+
+
+- (void)testTypingInLongLinePerformance
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 800, 400)];
+    MGSSyntaxColouring *sc = fragaria.syntaxColouring;
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    __block NSUInteger pos;
+    
+    fragaria.syntaxDefinitionName = @"JavaScript";
+    fragaria.lineWrap = NO;
+    fragaria.string = [self longLineOfLength:10 * 1024 * 1024];
+    pos = ts.length / 2;
+    [sc recolourRange:NSMakeRange(pos, 0)];
+    
+    [self measureBlock:^{
+        for (NSInteger i = 0; i < 50; i++) {
+            [ts replaceCharactersInRange:NSMakeRange(pos, 0) withString:@"x"];
+            pos++;
+            [sc recolourRange:NSMakeRange(pos - 100, 200)];
+        }
+    }];
+}
+
+
+@end
@@ -0,0 +1,240 @@
+//
+//  MGSMappedFileTextStorageTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSMappedFileTextStorage.h"
+#import "NSTextStorage+Fragaria.h"
+#import "NSString+Fragaria.h"
+
+
+@interface MGSMappedFileTextStorageTests : XCTestCase
+
+@end
+
+
+@implementation MGSMappedFileTextStorageTests
+{
+    NSMutableArray<NSURL *> *tempFiles;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    tempFiles = [NSMutableArray array];
+}
+
+
+- (void)tearDown
+{
+    for (NSURL *url in tempFiles)
+        [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+    [super tearDown];
+}
+
+
+- (NSURL *)temporaryFileWithData:(NSData *)data
+{
+    NSString *name = [[NSUUID UUID] UUIDString];
+    NSURL *url = [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:name]];
+    
+    [data writeToURL:url atomically:NO];
+    [tempFiles addObject:url];
+    return url;
+}
+
+
+- (MGSMappedFileTextStorage *)storageWithString:(NSString *)str
+{
+    NSURL *url = [self temporaryFileWithData:[str dataUsingEncoding:NSUTF8StringEncoding]];
+    NSError *err;
+    MGSMappedFileTextStorage *ts;
+    
+    ts = [[MGSMappedFileTextStorage alloc] initWithContentsOfURL:url error:&err];
+    XCTAssertNotNil(ts, @"%@", err);
+    return ts;
+}
+
+
+- (void)assertLinesOf:(NSTextStorage *)ts equalTo:(NSString *)str step:(NSUInteger)step
+{
+    NSTextStorage *expect = [[NSTextStorage alloc] initWithString:str];
+    NSUInteger i, l;
+    
+    for (i = 0; i < str.length; i += step)
+        XCTAssertEqual([ts mgs_rowOfCharacter:i], [expect mgs_rowOfCharacter:i], @"character %lu", (unsigned long)i);
+    XCTAssertEqual([ts mgs_rowOfCharacter:str.length], [expect mgs_rowOfCharacter:str.length]);
+    XCTAssertEqual([ts mgs_lineCount], [expect mgs_lineCount]);
+    for (l = 0; l < [expect mgs_lineCount]; l++) {
+        XCTAssertEqual([ts mgs_firstCharacterInRow:l], [expect mgs_firstCharacterInRow:l], @"line %lu", (unsigned long)l);
+        XCTAssertEqual([ts mgs_characterAtIndex:3 withinRow:l], [expect mgs_characterAtIndex:3 withinRow:l], @"line %lu", (unsigned long)l);
+    }
+}
+
+
+- (void)testDecoding
+{
+    NSString *str = @"abc\r\nèé€\n\U0001F600 x\r\ry\n\n";
+    MGSMappedFileTextStorage *ts = [self storageWithString:str];
+    
+    XCTAssertEqualObjects(ts.string, str);
+    XCTAssertEqual(ts.length, str.length);
+    [self assertLinesOf:ts equalTo:str step:1];
+}
+
+
+- (void)testInvalidSequences
+{
+    const uint8_t bytes[] = {'a', 0xC3, '\n', 0xE2, 0x82, 'b', 0xC0, 0xAF, 0xED, 0xA0, 0x80, 0xF0};
+    NSURL *url = [self temporaryFileWithData:[NSData dataWithBytes:bytes length:sizeof(bytes)]];
+    MGSMappedFileTextStorage *ts = [[MGSMappedFileTextStorage alloc] initWithContentsOfURL:url error:NULL];
+    
+    XCTAssertEqualObjects(ts.string, @"a�\n��b������");
+}
+
+
+- (void)testByteOrderMark
+{
+    const uint8_t bytes[] = {0xEF, 0xBB, 0xBF, 'h', 'i'};
+    NSURL *url = [self temporaryFileWithData:[NSData dataWithBytes:bytes length:sizeof(bytes)]];
+    MGSMappedFileTextStorage *ts = [[MGSMappedFileTextStorage alloc] initWithContentsOfURL:url error:NULL];
+    
+    XCTAssertEqualObjects(ts.string, @"hi");
+}
+
+
+- (void)testEmptyFile
+{
+    MGSMappedFileTextStorage *ts = [self storageWithString:@""];
+    
+    XCTAssertEqual(ts.length, 0);
+    XCTAssertTrue(ts.lineIndexComplete);
+    [self assertLinesOf:ts equalTo:@"" step:1];
+}
+
+
+- (void)testMultiplePages
+{
+    NSMutableString *str = [NSMutableString string];
+    MGSMappedFileTextStorage *ts;
+    
+    /* Multibyte characters and CRLFs straddle the page boundaries */
+    srandom(7);
+    while (str.length < 300000) {
+        switch (random() % 6) {
+            case 0: [str appendString:@"\r\n"]; break;
+            case 1: [str appendString:@"\r"]; break;
+            case 2: [str appendString:@"\n"]; break;
+            case 3: [str appendString:@"€"]; break;
+            case 4: [str appendString:@"\U0001F600"]; break;
+            default: [str appendString:@"lorem ipsum"]; break;
+        }
+    }
+    ts = [self storageWithString:str];
+    
+    XCTAssertEqualObjects(ts.string, str);
+    XCTAssertEqualObjects([ts.string substringWithRange:NSMakeRange(65530, 20)], [str substringWithRange:NSMakeRange(65530, 20)]);
+    [self assertLinesOf:ts equalTo:str step:13];
+}
+
+
+- (void)testIndexingNotification
+{
+    NSMutableString *str = [NSMutableString string];
+    MGSMappedFileTextStorage *ts;
+    
+    for (NSInteger i = 0; i < 100000; i++)
+        [str appendString:@"The quick brown fox jumps over the lazy dog.\n"];
+    ts = [self storageWithString:str];
+    
+    /* The lines indexed so far never go past the end of the text */
+    XCTAssertLessThanOrEqual([ts mgs_indexedLineCount], 100001);
+    
+    [self expectationForNotification:MGSMappedFileTextStorageDidFinishIndexingNotification object:ts handler:nil];
+    [self waitForExpectationsWithTimeout:30 handler:nil];
+    XCTAssertTrue(ts.lineIndexComplete);
+    XCTAssertFalse([ts mgs_lineCountIsEstimate]);
+    XCTAssertEqual([ts mgs_lineCount], 100001);
+    XCTAssertEqual([ts mgs_indexedLineCount], 100001);
+    XCTAssertEqual([ts mgs_firstCharacterInRow:50000], 50000 * 45);
+    XCTAssertEqual([ts mgs_rowOfCharacterIfIndexed:ts.length], 100000);
+}
+
+
+- (void)testReadOnly
+{
+    MGSMappedFileTextStorage *ts = [self storageWithString:@"abc"];
+    NSDictionary *a = @{NSForegroundColorAttributeName: [NSColor redColor]};
+    NSRange r;
+    
+    XCTAssertThrows([ts replaceCharactersInRange:NSMakeRange(1, 1) withString:@"x"]);
+    [ts setAttributes:a range:NSMakeRange(1, 1)];
+    XCTAssertEqualObjects([ts attributesAtIndex:1 effectiveRange:&r], a);
+    XCTAssertTrue(NSEqualRanges(r, NSMakeRange(1, 1)));
+}
+
+
+- (void)testOpenFileForViewing
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    NSString *str = @"line 1\nline 2\n";
+    NSURL *url = [self temporaryFileWithData:[str dataUsingEncoding:NSUTF8StringEncoding]];
+    NSURL *missing = [url URLByAppendingPathExtension:@"missing"];
+    NSError *err;
+    
+    XCTAssertFalse([fragaria openFileForViewingAtURL:missing error:&err]);
+    XCTAssertNotNil(err);
+    
+    XCTAssertTrue([fragaria openFileForViewingAtURL:url error:&err]);
+    XCTAssertTrue([fragaria.textStorage isKindOfClass:[MGSMappedFileTextStorage class]]);
+    XCTAssertEqualObjects(fragaria.string, str);
+    XCTAssertFalse(fragaria.textView.isEditable);
+    XCTAssertEqual([fragaria.textView.textStorage mgs_lineCount], 3);
+}
+
+
+- (void)testOpenFileForViewingDuringProgressiveLoad
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    NSString *str = @"line 1\nline 2\n";
+    NSURL *url = [self temporaryFileWithData:[str dataUsingEncoding:NSUTF8StringEncoding]];
+    NSError *err;
+    
+    XCTAssertTrue(fragaria.textView.isEditable);
+    [fragaria beginProgressiveLoadWithExpectedLength:100];
+    
+    XCTAssertTrue([fragaria openFileForViewingAtURL:url error:&err]);
+    XCTAssertFalse(fragaria.isLoading);
+    XCTAssertEqualObjects(fragaria.string, str);
+    XCTAssertFalse(fragaria.textView.isEditable);
+}
+
+
+- (void)testRandomAccessPerformance
+{
+    NSMutableString *str = [NSMutableString string];
+    MGSMappedFileTextStorage *ts;
+    
+    for (NSInteger i = 0; i < 500000; i++)
+        [str appendString:@"The quick brown fox jumps over the lazy dog.\n"];
+    ts = [self storageWithString:str];
+    
+    [self measureBlock:^{
+        NSUInteger len = ts.length;
+        srandom(3);
+        for (NSInteger i = 0; i < 10000; i++) {
+            NSUInteger c = random() % len;
+            [ts.string characterAtIndex:c];
+            [ts mgs_rowOfCharacter:c];
+        }
+    }];
+}
+
+
+@end
@@ -0,0 +1,139 @@
+//
+//  MGSMutableSubstringTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSMutableSubstring.h"
+
+
+@interface MGSMutableSubstringTests : XCTestCase
+
+@end
+
+
+@implementation MGSMutableSubstringTests
+
+
+- (NSString *)string:(NSString *)s editingLinesWithOptions:(MGSMutableSubstringEnumerationOptions)opts block:(void (^)(MGSMutableSubstring *line, BOOL *stop))b
+{
+    NSMutableString *res = [s mutableCopy];
+    
+    [res enumerateMutableSubstringsOfLinesWithOptions:opts usingBlock:b];
+    return res;
+}
+
+
+- (void)assertSameResultOnString:(NSString *)s block:(void (^)(MGSMutableSubstring *line, BOOL *stop))b
+{
+    NSString *immediate = [self string:s editingLinesWithOptions:0 block:b];
+    NSString *deferred = [self string:s editingLinesWithOptions:MGSMutableSubstringEnumerationDeferEdits block:b];
+    
+    XCTAssertEqualObjects(immediate, deferred);
+}
+
+
+- (void)testDeferredLineEdits
+{
+    NSCharacterSet *ws = [NSCharacterSet whitespaceCharacterSet];
+    NSArray *samples = @[@"", @"abc", @"abc\ndef\nghi", @"  a\r\n\tb\n\nc\n", @"x\ry z"];
+    
+    for (NSString *s in samples) {
+        [self assertSameResultOnString:s block:^(MGSMutableSubstring *line, BOOL *stop) {
+            [line insertString:@"// " atIndex:0];
+        }];
+        [self assertSameResultOnString:s block:^(MGSMutableSubstring *line, BOOL *stop) {
+            [[line mutableSubstringByLeftTrimmingCharactersFromSet:ws] insertString:@"#" atIndex:0];
+        }];
+        [self assertSameResultOnString:s block:^(MGSMutableSubstring *line, BOOL *stop) {
+            NSUInteger e;
+            
+            [line getLineStart:NULL end:NULL contentsEnd:&e forRange:NSMakeRange(0, 0)];
+            [line replaceCharactersInRange:NSMakeRange(e, line.length - e) withString:@""];
+        }];
+        [self assertSameResultOnString:s block:^(MGSMutableSubstring *line, BOOL *stop) {
+            [line appendString:@"\n"];
+            *stop = [line hasPrefix:@"d"];
+        }];
+    }
+}
+
+
+- (void)testDeferredNewlineRemoval
+{
+    NSMutableString *s = [@"abc\ndef\nghi" mutableCopy];
+    NSMutableArray *lines = [NSMutableArray array];
+    
+    [s enumerateMutableSubstringsOfLinesWithOptions:MGSMutableSubstringEnumerationDeferEdits usingBlock:^(MGSMutableSubstring *line, BOOL *stop) {
+        [lines addObject:[line copy]];
+        if ([line hasPrefix:@"abc"]) {
+            [line deleteCharactersInRange:NSMakeRange(3, 1)];
+            XCTAssertEqualObjects(line, @"abc");
+            /* The superstring is not changed until the enumeration ends */
+            XCTAssertEqualObjects(s, @"abc\ndef\nghi");
+        }
+    }];
+    
+    XCTAssertEqualObjects(lines, (@[@"abc\n", @"def\n", @"ghi"]));
+    XCTAssertEqualObjects(s, @"abcdef\nghi");
+}
+
+
+- (void)testDeferredRangeArray
+{
+    NSArray *ranges = @[[NSValue valueWithRange:NSMakeRange(1, 2)], [NSValue valueWithRange:NSMakeRange(5, 3)], [NSValue valueWithRange:NSMakeRange(9, 0)]];
+    NSMutableString *a = [@"0123456789" mutableCopy];
+    NSMutableString *b = [a mutableCopy];
+    NSArray *ra, *rb;
+    void (^block)(MGSMutableSubstring *, BOOL *) = ^(MGSMutableSubstring *substr, BOOL *stop) {
+        [substr setString:[substr.uppercaseString stringByAppendingString:@"xy"]];
+    };
+    
+    ra = [a enumerateMutableSubstringsFromRangeArray:ranges usingBlock:block];
+    rb = [b enumerateMutableSubstringsFromRangeArray:ranges options:MGSMutableSubstringEnumerationDeferEdits usingBlock:block];
+    XCTAssertEqualObjects(a, b);
+    XCTAssertEqualObjects(ra, rb);
+    
+    XCTAssertThrows([b enumerateMutableSubstringsFromRangeArray:[ranges reverseObjectEnumerator].allObjects options:MGSMutableSubstringEnumerationDeferEdits usingBlock:block]);
+}
+
+
+- (NSString *)manyLines
+{
+    NSMutableString *res = [NSMutableString string];
+    NSUInteger i;
+    
+    for (i = 0; i < 50000; i++)
+        [res appendString:@"    if (x) { return y; }\n"];
+    return res;
+}
+
+
+- (void)testImmediateLineEditsPerformance
+{
+    NSString *s = [self manyLines];
+    
+    [self measureBlock:^{
+        [self string:s editingLinesWithOptions:0 block:^(MGSMutableSubstring *line, BOOL *stop) {
+            [line insertString:@"// " atIndex:0];
+        }];
+    }];
+}
+
+
+- (void)testDeferredLineEditsPerformance
+{
+    NSString *s = [self manyLines];
+    
+    [self measureBlock:^{
+        [self string:s editingLinesWithOptions:MGSMutableSubstringEnumerationDeferEdits block:^(MGSMutableSubstring *line, BOOL *stop) {
+            [line insertString:@"// " atIndex:0];
+        }];
+    }];
+}
+
+
+@end
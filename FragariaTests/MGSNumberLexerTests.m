@@ -0,0 +1,149 @@
+//
+//  MGSNumberLexerTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSNumberLexer.h"
+#import "MGSClassicFragariaSyntaxDefinition.h"
+#import "MGSClassicFragariaSyntaxParser.h"
+
+
+#define MGSCDialect (MGSNumberDialectDecimal | MGSNumberDialectHexadecimal | \
+    MGSNumberDialectBinary | MGSNumberDialectExponent | \
+    MGSNumberDialectQuoteSeparator | MGSNumberDialectSuffixes | \
+    MGSNumberDialectLeadingDecimalPoint)
+
+
+@interface MGSNumberLexerTests : XCTestCase
+
+@end
+
+
+@implementation MGSNumberLexerTests
+
+
+- (NSUInteger)lengthOfNumberIn:(NSString *)s dialect:(MGSNumberDialect)d
+{
+    unichar buf[64];
+    
+    [s getCharacters:buf range:NSMakeRange(0, s.length)];
+    return MGSNumberLexerScan(buf, 0, s.length, d);
+}
+
+
+- (void)testDecimal
+{
+    MGSNumberDialect d = MGSNumberDialectDecimal;
+    
+    XCTAssertEqual([self lengthOfNumberIn:@"123;" dialect:d], 3);
+    XCTAssertEqual([self lengthOfNumberIn:@"1.5)" dialect:d], 3);
+    XCTAssertEqual([self lengthOfNumberIn:@"1." dialect:d], 1);
+    XCTAssertEqual([self lengthOfNumberIn:@"1..5" dialect:d], 1);
+    XCTAssertEqual([self lengthOfNumberIn:@"1.description" dialect:d], 1);
+    XCTAssertEqual([self lengthOfNumberIn:@"1e5" dialect:d], 1);
+    XCTAssertEqual([self lengthOfNumberIn:@".5" dialect:d], 0);
+    XCTAssertEqual([self lengthOfNumberIn:@"0x1F" dialect:d], 1);
+    XCTAssertEqual([self lengthOfNumberIn:@"abc" dialect:d], 0);
+}
+
+
+- (void)testDialects
+{
+    XCTAssertEqual([self lengthOfNumberIn:@"0x1Fu;" dialect:MGSCDialect], 5);
+    XCTAssertEqual([self lengthOfNumberIn:@"0x;" dialect:MGSCDialect], 2);
+    XCTAssertEqual([self lengthOfNumberIn:@"0x1.8p3" dialect:MGSCDialect], 3);
+    XCTAssertEqual([self lengthOfNumberIn:@"0x1p-3" dialect:MGSCDialect], 6);
+    XCTAssertEqual([self lengthOfNumberIn:@"0b1012" dialect:MGSCDialect | MGSNumberDialectSuffixes], 6);
+    XCTAssertEqual([self lengthOfNumberIn:@"0b1012" dialect:MGSNumberDialectBinary], 5);
+    XCTAssertEqual([self lengthOfNumberIn:@"0o17" dialect:MGSNumberDialectOctal], 4);
+    XCTAssertEqual([self lengthOfNumberIn:@"1.5e-3f+" dialect:MGSCDialect], 7);
+    XCTAssertEqual([self lengthOfNumberIn:@"1e+" dialect:MGSNumberDialectExponent], 1);
+    XCTAssertEqual([self lengthOfNumberIn:@".5f" dialect:MGSCDialect], 3);
+    XCTAssertEqual([self lengthOfNumberIn:@"1'000'000" dialect:MGSCDialect], 9);
+    XCTAssertEqual([self lengthOfNumberIn:@"1''0" dialect:MGSNumberDialectQuoteSeparator], 1);
+    XCTAssertEqual([self lengthOfNumberIn:@"1_000_" dialect:MGSNumberDialectUnderscoreSeparator], 5);
+    XCTAssertEqual([self lengthOfNumberIn:@"1..5" dialect:MGSCDialect], 1);
+}
+
+
+- (void)testDialectNames
+{
+    NSString *err = nil;
+    
+    XCTAssertEqual(MGSNumberDialectFromNames(@[], &err), MGSNumberDialectDecimal);
+    XCTAssertEqual(MGSNumberDialectFromNames(@[@"hexadecimal", @"suffixes"], &err), MGSNumberDialectDecimal | MGSNumberDialectHexadecimal | MGSNumberDialectSuffixes);
+    XCTAssertEqual(MGSNumberDialectFromNames(@[@"hexadecimal", @"roman"], &err), 0);
+    XCTAssertEqualObjects(err, @"roman");
+}
+
+
+- (void)testColouring
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    MGSSyntaxColouring *sc = fragaria.syntaxColouring;
+    MGSClassicFragariaSyntaxDefinition *def;
+    NSRange r;
+    
+    def = [[MGSClassicFragariaSyntaxDefinition alloc] initFromSyntaxDictionary:@{@"numberDialect": @[@"hexadecimal"]} name:@"Test"];
+    sc.parser = [[MGSClassicFragariaSyntaxParser alloc] initWithSyntaxDefinition:def];
+    fragaria.string = @"x1 = 0xFF; for 1..5";
+    [sc recolourRange:NSMakeRange(0, fragaria.string.length)];
+    
+    XCTAssertNil([sc groupOfTokenAtCharacterIndex:1]);
+    XCTAssertEqualObjects([sc groupOfTokenAtCharacterIndex:5 isAtomic:NULL range:&r], MGSSyntaxGroupNumber);
+    XCTAssertTrue(NSEqualRanges(r, NSMakeRange(5, 4)));
+    XCTAssertEqualObjects([sc groupOfTokenAtCharacterIndex:15 isAtomic:NULL range:&r], MGSSyntaxGroupNumber);
+    XCTAssertTrue(NSEqualRanges(r, NSMakeRange(15, 1)));
+    XCTAssertNil([sc groupOfTokenAtCharacterIndex:16]);
+    XCTAssertNil([sc groupOfTokenAtCharacterIndex:17]);
+    XCTAssertEqualObjects([sc groupOfTokenAtCharacterIndex:18], MGSSyntaxGroupNumber);
+    
+    XCTAssertNil([[MGSClassicFragariaSyntaxDefinition alloc] initFromSyntaxDictionary:@{@"numberDialect": @[@"roman"]} name:@"Invalid"]);
+}
+
+
+#pragma mark - Performance
+
+
+- (void)measureNumberColouringWithDefinition:(NSDictionary *)dict
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    MGSSyntaxColouring *sc = fragaria.syntaxColouring;
+    MGSClassicFragariaSyntaxDefinition *def;
+    NSString *chunk = @"int var_1 = 0x1F + 42 * 3.14 - 0b101; /* 7 */ f(x2, 100, 1.5);\n";
+    NSMutableString *s = [NSMutableString string];
+    
+    while (s.length < 1024 * 1024)
+        [s appendString:chunk];
+    def = [[MGSClassicFragariaSyntaxDefinition alloc] initFromSyntaxDictionary:dict name:@"Test"];
+    sc.parser = [[MGSClassicFragariaSyntaxParser alloc] initWithSyntaxDefinition:def];
+    fragaria.string = s;
+    
+    [self measureBlock:^{
+        [sc recolourChangedRange:NSMakeRange(0, s.length)];
+    }];
+}
+
+
+- (void)testNumberRegexPerformance
+{
+    [self measureNumberColouringWithDefinition:@{
+        @"numberDefinition": @"(?<=\\W)(([-+]?[0-9]+(\\.[0-9]*)?(?=[^xb]))|(0x[0-9A-Fa-f]+)|(0b[01]+))"}];
+}
+
+
+- (void)testNumberLexerPerformance
+{
+    [self measureNumberColouringWithDefinition:@{
+        @"numberDialect": @[@"hexadecimal", @"binary", @"exponent", @"quoteSeparator", @"suffixes", @"leadingDecimalPoint"]}];
+}
+
+
+@end
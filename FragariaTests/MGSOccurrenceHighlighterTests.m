@@ -0,0 +1,155 @@
+//
+//  MGSOccurrenceHighlighterTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSTextView.h"
+#import "MGSTextViewPrivate.h"
+#import "MGSOccurrenceHighlighter.h"
+#import "MGSLayoutManager.h"
+#import "MGSSyntaxError.h"
+
+
+@interface MGSOccurrenceHighlighterTests : XCTestCase
+
+@end
+
+
+@implementation MGSOccurrenceHighlighterTests
+{
+    MGSFragariaView *fragaria;
+    MGSOccurrenceHighlighter *highlighter;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    fragaria.highlightsOccurrencesOfSelectedWord = YES;
+    highlighter = fragaria.textView.occurrenceHighlighter;
+}
+
+
+- (BOOL)isHighlightedAtIndex:(NSUInteger)i
+{
+    NSLayoutManager *lm = fragaria.textView.layoutManager;
+    return [lm temporaryAttribute:MGSHighlightColourAttributeName atCharacterIndex:i effectiveRange:NULL] != nil;
+}
+
+
+- (BOOL)hasErrorBackgroundAtIndex:(NSUInteger)i
+{
+    NSLayoutManager *lm = fragaria.textView.layoutManager;
+    return [lm temporaryAttribute:NSBackgroundColorAttributeName atCharacterIndex:i effectiveRange:NULL] != nil;
+}
+
+
+- (void)testWholeWords
+{
+    fragaria.string = @"foo bar foo\nfoobar foo_x (foo)\n";
+    fragaria.textView.selectedRange = NSMakeRange(1, 0);
+    [highlighter updateWord];
+    
+    XCTAssertEqualObjects(highlighter.word, @"foo");
+    XCTAssertTrue([self isHighlightedAtIndex:0]);
+    XCTAssertTrue([self isHighlightedAtIndex:8]);
+    XCTAssertTrue([self isHighlightedAtIndex:26]);
+    XCTAssertFalse([self isHighlightedAtIndex:4]);
+    XCTAssertFalse([self isHighlightedAtIndex:12]);
+    XCTAssertFalse([self isHighlightedAtIndex:19]);
+    
+    /* A selection which is not a word highlights nothing */
+    fragaria.textView.selectedRange = NSMakeRange(2, 3);
+    [highlighter updateWord];
+    XCTAssertNil(highlighter.word);
+    XCTAssertFalse([self isHighlightedAtIndex:0]);
+}
+
+
+- (void)testOnlyVisibleTextIsSearched
+{
+    NSString *line = @"int foo = 1;\n";
+    NSUInteger lineLen = line.length;
+    
+    fragaria.string = [@"" stringByPaddingToLength:lineLen * 100000 withString:line startingAtIndex:0];
+    fragaria.textView.selectedRange = NSMakeRange(5, 0);
+    [highlighter updateWord];
+    
+    XCTAssertTrue([self isHighlightedAtIndex:4]);
+    XCTAssertTrue([self isHighlightedAtIndex:lineLen + 4]);
+    XCTAssertFalse([self isHighlightedAtIndex:lineLen * 99999 + 4]);
+}
+
+
+- (void)testDebounce
+{
+    fragaria.string = @"foo bar foo\n";
+    fragaria.textView.selectedRange = NSMakeRange(1, 0);
+    fragaria.textView.selectedRange = NSMakeRange(5, 0);
+    XCTAssertNil(highlighter.word);
+    
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:highlighter.delay * 2]];
+    XCTAssertEqualObjects(highlighter.word, @"bar");
+    XCTAssertTrue([self isHighlightedAtIndex:4]);
+    XCTAssertFalse([self isHighlightedAtIndex:0]);
+}
+
+
+- (void)testEdits
+{
+    NSTextStorage *ts;
+    
+    fragaria.string = @"foo\nbar\nfoo\n";
+    ts = fragaria.textView.textStorage;
+    fragaria.textView.selectedRange = NSMakeRange(0, 0);
+    [highlighter updateWord];
+    
+    [ts replaceCharactersInRange:NSMakeRange(4, 3) withString:@"foo x\nfoo"];
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:highlighter.delay * 2]];
+    
+    XCTAssertEqualObjects(highlighter.word, @"foo");
+    XCTAssertTrue([self isHighlightedAtIndex:0]);
+    XCTAssertTrue([self isHighlightedAtIndex:4]);
+    XCTAssertFalse([self isHighlightedAtIndex:8]);
+    XCTAssertTrue([self isHighlightedAtIndex:10]);
+    XCTAssertTrue([self isHighlightedAtIndex:14]);
+}
+
+
+- (void)testErrorLineHighlights
+{
+    fragaria.string = @"foo bar\nfoo\n";
+    fragaria.showsSyntaxErrors = YES;
+    fragaria.syntaxErrors = @[[MGSSyntaxError errorWithDescription:@"error" ofLevel:kMGSErrorCategoryError atLine:1]];
+    XCTAssertTrue([self hasErrorBackgroundAtIndex:0]);
+    
+    /* The occurrences on the error line do not remove its background */
+    fragaria.textView.selectedRange = NSMakeRange(1, 0);
+    [highlighter updateWord];
+    XCTAssertTrue([self isHighlightedAtIndex:0]);
+    XCTAssertTrue([self isHighlightedAtIndex:8]);
+    XCTAssertTrue([self hasErrorBackgroundAtIndex:0]);
+    XCTAssertTrue([self hasErrorBackgroundAtIndex:4]);
+    
+    /* Neither does removing them */
+    fragaria.textView.selectedRange = NSMakeRange(5, 0);
+    [highlighter updateWord];
+    XCTAssertFalse([self isHighlightedAtIndex:0]);
+    XCTAssertTrue([self isHighlightedAtIndex:4]);
+    XCTAssertTrue([self hasErrorBackgroundAtIndex:0]);
+    
+    /* Moving the error does not remove the occurrences */
+    fragaria.syntaxErrors = @[[MGSSyntaxError errorWithDescription:@"error" ofLevel:kMGSErrorCategoryError atLine:2]];
+    XCTAssertTrue([self isHighlightedAtIndex:4]);
+    XCTAssertFalse([self hasErrorBackgroundAtIndex:0]);
+    XCTAssertTrue([self hasErrorBackgroundAtIndex:8]);
+}
+
+
+@end
@@ -0,0 +1,129 @@
+//
+//  MGSPieceTableTextStorageTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSPieceTableTextStorage.h"
+#import "MGSAttributeOverlayTextStorage.h"
+#import "NSTextStorage+Fragaria.h"
+#import "NSString+Fragaria.h"
+
+
+@interface MGSPieceTableTextStorageTests : XCTestCase
+
+@end
+
+
+@implementation MGSPieceTableTextStorageTests
+
+
+- (void)testRandomEdits
+{
+    NSMutableString *expect = [@"Lorem ipsum dolor sit amet,\nconsectetur adipiscing elit.\n" mutableCopy];
+    MGSPieceTableTextStorage *ts = [[MGSPieceTableTextStorage alloc] initWithString:expect];
+    NSArray *inserts = @[@"", @"a", @"\n", @"\r\n", @"hello world", @"è "];
+    NSRange r;
+    
+    srandom(42);
+    for (NSInteger i = 0; i < 2000; i++) {
+        r.location = random() % (expect.length + 1);
+        r.length = random() % MIN(expect.length - r.location + 1, 8);
+        NSString *s = inserts[random() % inserts.count];
+        [expect replaceCharactersInRange:r withString:s];
+        [ts replaceCharactersInRange:r withString:s];
+        XCTAssertEqual(ts.length, expect.length);
+    }
+    XCTAssertEqualObjects(ts.string, expect);
+    XCTAssertEqual([ts mgs_lineCount], [[[NSTextStorage alloc] initWithString:expect] mgs_lineCount]);
+}
+
+
+- (void)testSnapshots
+{
+    MGSPieceTableTextStorage *ts = [[MGSPieceTableTextStorage alloc] initWithString:@"0123456789"];
+    NSString *live = ts.string;
+    NSString *snap1 = [ts stringSnapshot];
+    NSString *snap2;
+    
+    [ts replaceCharactersInRange:NSMakeRange(5, 0) withString:@"abc"];
+    snap2 = [live copy];
+    [ts replaceCharactersInRange:NSMakeRange(0, 3) withString:@""];
+    
+    XCTAssertEqualObjects(snap1, @"0123456789");
+    XCTAssertEqualObjects(snap2, @"01234abc56789");
+    XCTAssertEqualObjects(live, @"34abc56789");
+}
+
+
+- (void)testChunkedAccess
+{
+    MGSPieceTableTextStorage *ts = [[MGSPieceTableTextStorage alloc] initWithString:@"0123456789"];
+    NSMutableString *res = [NSMutableString string];
+    __block NSUInteger next = 2;
+    
+    [ts replaceCharactersInRange:NSMakeRange(5, 0) withString:@"abc"];
+    [ts.string mgs_enumerateCharacterChunksInRange:NSMakeRange(2, 9) usingBlock:^(const unichar *chars, NSRange chunkRange, BOOL *stop) {
+        XCTAssertEqual(chunkRange.location, next);
+        next = NSMaxRange(chunkRange);
+        [res appendString:[NSString stringWithCharacters:chars length:chunkRange.length]];
+    }];
+    XCTAssertEqualObjects(res, @"234abc567");
+}
+
+
+- (void)testAttributes
+{
+    NSDictionary *a1 = @{NSForegroundColorAttributeName: [NSColor redColor]};
+    NSDictionary *a2 = @{NSForegroundColorAttributeName: [NSColor blueColor]};
+    MGSPieceTableTextStorage *ts = [[MGSPieceTableTextStorage alloc] initWithString:@"0123456789" attributes:a1];
+    NSRange r;
+    
+    [ts setAttributes:a2 range:NSMakeRange(2, 3)];
+    [ts replaceCharactersInRange:NSMakeRange(3, 0) withString:@"xx"];
+    XCTAssertEqualObjects([ts attributesAtIndex:3 effectiveRange:&r], a2);
+    XCTAssertTrue(NSEqualRanges(r, NSMakeRange(2, 5)));
+    XCTAssertEqualObjects([ts attributesAtIndex:7 effectiveRange:NULL], a1);
+}
+
+
+- (void)testFragariaViewWithOverlay
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    MGSPieceTableTextStorage *ts = [[MGSPieceTableTextStorage alloc] initWithString:@"line 1\nline 2\n"];
+    NSTextStorage *overlay;
+    
+    [fragaria replaceTextStorage:ts];
+    overlay = fragaria.textView.textStorage;
+    XCTAssertTrue([overlay isKindOfClass:[MGSAttributeOverlayTextStorage class]]);
+    
+    [fragaria.textView setSelectedRange:NSMakeRange(7, 0)];
+    [fragaria.textView insertText:@"new\n" replacementRange:NSMakeRange(7, 0)];
+    XCTAssertEqualObjects(ts.string, @"line 1\nnew\nline 2\n");
+    XCTAssertEqualObjects(fragaria.string, ts.string);
+    XCTAssertEqual([overlay mgs_lineCount], 4);
+    XCTAssertEqual([overlay mgs_firstCharacterInRow:2], 11);
+}
+
+
+- (void)testMiddleInsertPerformance
+{
+    NSMutableString *text = [NSMutableString string];
+    
+    for (NSInteger i = 0; i < 500000; i++)
+        [text appendString:@"The quick brown fox jumps over the lazy dog.\n"];
+    MGSPieceTableTextStorage *ts = [[MGSPieceTableTextStorage alloc] initWithString:text];
+    
+    [self measureBlock:^{
+        for (NSInteger i = 0; i < 1000; i++) {
+            [ts replaceCharactersInRange:NSMakeRange(ts.length / 2 + i * 7, 0) withString:@"x"];
+        }
+    }];
+}
+
+
+@end
@@ -0,0 +1,127 @@
+//
+//  MGSProgressiveLoadTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSTextView.h"
+#import "NSTextStorage+Fragaria.h"
+#import "NSString+Fragaria.h"
+
+
+@interface MGSProgressiveLoadTests : XCTestCase
+
+@end
+
+
+@implementation MGSProgressiveLoadTests
+
+
+- (void)testChunks
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    NSProgress *progress;
+    
+    fragaria.string = @"old contents";
+    progress = [fragaria beginProgressiveLoadWithExpectedLength:14];
+    XCTAssertTrue(fragaria.isLoading);
+    XCTAssertEqualObjects(fragaria.string, @"");
+    XCTAssertFalse(fragaria.textView.isEditable);
+    
+    [fragaria appendStringToProgressiveLoad:@"line 1\n"];
+    XCTAssertTrue(fragaria.textView.isEditable);
+    XCTAssertEqual(progress.completedUnitCount, 7);
+    XCTAssertEqual([fragaria.textView.textStorage mgs_lineCount], 2);
+    
+    /* The user edits the text while it is loading */
+    [fragaria.textView insertText:@"> " replacementRange:NSMakeRange(0, 0)];
+    [fragaria appendStringToProgressiveLoad:@"line 2\n"];
+    [fragaria endProgressiveLoad];
+    
+    XCTAssertFalse(fragaria.isLoading);
+    XCTAssertEqualObjects(fragaria.string, @"> line 1\nline 2\n");
+    XCTAssertEqual([fragaria.textView.textStorage mgs_lineCount], 3);
+    XCTAssertEqual(progress.fractionCompleted, 1.0);
+}
+
+
+- (void)testSetStringCancels
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    NSProgress *progress;
+    
+    progress = [fragaria beginProgressiveLoadWithExpectedLength:-1];
+    fragaria.string = @"abc";
+    XCTAssertTrue(progress.isCancelled);
+    XCTAssertFalse(fragaria.isLoading);
+    XCTAssertTrue(fragaria.textView.isEditable);
+    XCTAssertThrows([fragaria appendStringToProgressiveLoad:@"x"]);
+}
+
+
+- (void)testStream
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    NSMutableString *str = [NSMutableString string];
+    XCTestExpectation *done = [self expectationWithDescription:@"load"];
+    NSInputStream *stream;
+    NSProgress *progress;
+    NSData *data;
+    
+    /* Multibyte characters straddle the chunk boundaries */
+    while (str.length < 3000000)
+        [str appendString:@"è€\U0001F600 The quick brown fox jumps over the lazy dog.\n"];
+    data = [str dataUsingEncoding:NSUTF8StringEncoding];
+    stream = [NSInputStream inputStreamWithData:data];
+    
+    progress = [fragaria loadStringFromStream:stream expectedLength:data.length completionHandler:^(NSError *error) {
+        XCTAssertNil(error);
+        [done fulfill];
+    }];
+    [self waitForExpectationsWithTimeout:60 handler:nil];
+    
+    XCTAssertEqualObjects(fragaria.string, str);
+    XCTAssertEqual(progress.completedUnitCount, (int64_t)data.length);
+    XCTAssertFalse(fragaria.isLoading);
+}
+
+
+- (void)testStreamCancel
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    XCTestExpectation *done = [self expectationWithDescription:@"load"];
+    NSMutableData *data = [NSMutableData dataWithLength:4000000];
+    NSProgress *progress;
+    
+    memset(data.mutableBytes, 'a', data.length);
+    progress = [fragaria loadStringFromStream:[NSInputStream inputStreamWithData:data] expectedLength:data.length completionHandler:^(NSError *error) {
+        XCTAssertEqualObjects(error.domain, NSCocoaErrorDomain);
+        XCTAssertEqual(error.code, NSUserCancelledError);
+        [done fulfill];
+    }];
+    fragaria.string = @"replaced";
+    [self waitForExpectationsWithTimeout:60 handler:nil];
+    
+    XCTAssertTrue(progress.isCancelled);
+    XCTAssertEqualObjects(fragaria.string, @"replaced");
+}
+
+
+- (void)testIncompleteUTF8Sequence
+{
+    const uint8_t bytes[] = {'a', 0xE2, 0x82, 0xAC, 0xF0, 0x9F, 0x98};
+    
+    XCTAssertEqual(MGSIncompleteUTF8SequenceLength(bytes, 1), 0);
+    XCTAssertEqual(MGSIncompleteUTF8SequenceLength(bytes, 2), 1);
+    XCTAssertEqual(MGSIncompleteUTF8SequenceLength(bytes, 3), 2);
+    XCTAssertEqual(MGSIncompleteUTF8SequenceLength(bytes, 4), 0);
+    XCTAssertEqual(MGSIncompleteUTF8SequenceLength(bytes, 7), 3);
+    XCTAssertEqualObjects([NSString mgs_stringWithUTF8Bytes:bytes length:4], @"a€");
+}
+
+
+@end
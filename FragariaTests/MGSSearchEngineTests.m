@@ -0,0 +1,195 @@
+//
+//  MGSSearchEngineTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSTextView.h"
+#import "MGSSearchEngine.h"
+
+
+@interface MGSSearchEngineTests : XCTestCase <MGSSearchEngineDelegate>
+
+@end
+
+
+@implementation MGSSearchEngineTests
+{
+    MGSFragariaView *fragaria;
+    NSRegularExpression *regex;
+    XCTestExpectation *finished;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    fragaria.searchEngine.delegate = self;
+    regex = [NSRegularExpression regularExpressionWithPattern:@"b[a-z]+" options:0 error:nil];
+}
+
+
+- (void)searchEngineDidFinishSearching:(MGSSearchEngine *)engine
+{
+    [finished fulfill];
+}
+
+
+- (void)searchAndWait
+{
+    finished = [self expectationWithDescription:@"search"];
+    [fragaria.searchEngine beginSearchingForRegularExpression:regex];
+    [self waitForExpectationsWithTimeout:60 handler:nil];
+}
+
+
+- (NSString *)linesOfLength:(NSUInteger)length
+{
+    NSArray *lines = @[@"foo bar baz\n", @"quux\n", @"\n", @"abc bcd\r\n", @"b"];
+    NSMutableString *res = [NSMutableString string];
+    NSUInteger i = 0;
+    
+    while (res.length < length)
+        [res appendString:lines[i++ % lines.count]];
+    return res;
+}
+
+
+- (void)assertMatchesAreValid
+{
+    MGSSearchEngine *se = fragaria.searchEngine;
+    NSString *string = fragaria.string;
+    NSArray *expected = [regex matchesInString:string options:0 range:NSMakeRange(0, string.length)];
+    NSUInteger i;
+    
+    XCTAssertEqual(se.numberOfMatches, expected.count);
+    for (i = 0; i < MIN(se.numberOfMatches, expected.count); i++)
+        XCTAssertTrue(NSEqualRanges([se rangeOfMatchAtIndex:i], [expected[i] range]), @"match %lu", (unsigned long)i);
+}
+
+
+- (void)testFindAll
+{
+    MGSSearchEngine *se = fragaria.searchEngine;
+    
+    fragaria.string = [self linesOfLength:2000000];
+    [self searchAndWait];
+    
+    XCTAssertFalse(se.isSearching);
+    [self assertMatchesAreValid];
+    
+    XCTAssertEqual([se indexOfFirstMatchAtOrAfterCharacterIndex:0], 0);
+    XCTAssertEqual([se indexOfFirstMatchAtOrAfterCharacterIndex:5], 1);
+    XCTAssertEqual([se rangesOfMatchesInRange:NSMakeRange(0, 12)].count, 2);
+    XCTAssertEqual([se indexOfFirstMatchAtOrAfterCharacterIndex:fragaria.string.length], NSNotFound);
+}
+
+
+- (void)testEdits
+{
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    
+    fragaria.string = [self linesOfLength:10000];
+    [self searchAndWait];
+    
+    [ts replaceCharactersInRange:NSMakeRange(4, 3) withString:@"xyz"];
+    [self assertMatchesAreValid];
+    [ts replaceCharactersInRange:NSMakeRange(100, 0) withString:@"bb b\nbe"];
+    [self assertMatchesAreValid];
+    [ts replaceCharactersInRange:NSMakeRange(200, 50) withString:@""];
+    [self assertMatchesAreValid];
+    [ts replaceCharactersInRange:NSMakeRange(ts.length, 0) withString:@"\nbottom"];
+    [self assertMatchesAreValid];
+    [ts replaceCharactersInRange:NSMakeRange(0, 0) withString:@"bo"];
+    [self assertMatchesAreValid];
+}
+
+
+- (void)testEditWhileSearching
+{
+    NSTextStorage *ts;
+    
+    fragaria.string = [self linesOfLength:4000000];
+    ts = fragaria.textView.textStorage;
+    finished = [self expectationWithDescription:@"search"];
+    [fragaria.searchEngine beginSearchingForRegularExpression:regex];
+    
+    [ts replaceCharactersInRange:NSMakeRange(10, 0) withString:@"bcd\n"];
+    [ts replaceCharactersInRange:NSMakeRange(ts.length / 2, 10) withString:@"b"];
+    [self waitForExpectationsWithTimeout:60 handler:nil];
+    
+    [self assertMatchesAreValid];
+}
+
+
+- (void)testReplaceAll
+{
+    MGSSearchEngine *se = fragaria.searchEngine;
+    NSString *text = [self linesOfLength:100000];
+    NSString *expected;
+    NSUInteger n;
+    
+    regex = [NSRegularExpression regularExpressionWithPattern:@"b([a-z])" options:0 error:nil];
+    fragaria.string = text;
+    [self searchAndWait];
+    
+    expected = [regex stringByReplacingMatchesInString:text options:0 range:NSMakeRange(0, text.length) withTemplate:@"<$1>"];
+    n = [se replaceAllMatchesWithTemplate:@"<$1>"];
+    
+    XCTAssertEqual(n, [regex numberOfMatchesInString:text options:0 range:NSMakeRange(0, text.length)]);
+    XCTAssertEqualObjects(fragaria.string, expected);
+    XCTAssertEqual(se.numberOfMatches, 0);
+}
+
+
+- (void)testReplaceAllEditsOnlyMatches
+{
+    NSLayoutManager *lm = fragaria.textView.layoutManager;
+    NSUInteger n;
+    
+    fragaria.string = @"bar\nfoo\nfoo\nbaz\n";
+    [self searchAndWait];
+    [lm addTemporaryAttribute:NSToolTipAttributeName value:@"kept" forCharacterRange:NSMakeRange(4, 7)];
+    
+    /* The text between the matches is not replaced */
+    n = [fragaria.searchEngine replaceAllMatchesWithTemplate:@"x"];
+    XCTAssertEqual(n, 2);
+    XCTAssertEqualObjects(fragaria.string, @"x\nfoo\nfoo\nx\n");
+    XCTAssertEqualObjects([lm temporaryAttribute:NSToolTipAttributeName atCharacterIndex:2 effectiveRange:NULL], @"kept");
+    XCTAssertEqualObjects([lm temporaryAttribute:NSToolTipAttributeName atCharacterIndex:8 effectiveRange:NULL], @"kept");
+}
+
+
+- (void)testReplaceAllWithoutWaiting
+{
+    NSString *text = [self linesOfLength:1000000];
+    NSUInteger n;
+    
+    fragaria.string = text;
+    [fragaria.searchEngine beginSearchingForRegularExpression:regex];
+    n = [fragaria.searchEngine replaceAllMatchesWithTemplate:@"x"];
+    
+    XCTAssertEqual(n, [regex numberOfMatchesInString:text options:0 range:NSMakeRange(0, text.length)]);
+    XCTAssertFalse(fragaria.searchEngine.isSearching);
+    XCTAssertFalse([fragaria.string containsString:@"bar"]);
+}
+
+
+- (void)testReplaceAllPerformance
+{
+    NSString *text = [self linesOfLength:5000000];
+    
+    [self measureBlock:^{
+        self->fragaria.string = text;
+        [self->fragaria.searchEngine beginSearchingForRegularExpression:self->regex];
+        [self->fragaria.searchEngine replaceAllMatchesWithTemplate:@"$0!"];
+    }];
+}
+
+
+@end
@@ -0,0 +1,144 @@
+//
+//  MGSSemanticTokensTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSSemanticTokenOverlay.h"
+#import "MGSColourScheme.h"
+#import "MGSTextView.h"
+
+
+@interface MGSSemanticTokensTests : XCTestCase
+
+@end
+
+
+@implementation MGSSemanticTokensTests
+{
+    MGSFragariaView *fragaria;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    fragaria.string = @"int foo;\nint bar;\n";
+    fragaria.semanticTokenTypes = @[MGSSyntaxGroupKeyword, MGSSyntaxGroupComment];
+}
+
+
+- (NSArray<NSValue *> *)tokenRanges
+{
+    NSMutableArray<NSValue *> *res = [NSMutableArray array];
+    
+    [fragaria.syntaxColouring.semanticTokens enumerateTokensInRange:NSMakeRange(0, NSUIntegerMax) usingBlock:^(NSRange tokenRange, MGSSyntaxGroup group, BOOL *stop) {
+        [res addObject:[NSValue valueWithRange:tokenRange]];
+    }];
+    return res;
+}
+
+
+- (void)testDecoding
+{
+    const uint32_t data[] = {0, 4, 3, 0, 0,   1, 4, 3, 1, 0,   0, 3, 100, 0, 0,   0, 1, 1, 9, 0};
+    NSArray *expect = @[[NSValue valueWithRange:NSMakeRange(4, 3)], [NSValue valueWithRange:NSMakeRange(13, 3)]];
+    
+    /* The token past the end of the line is truncated, the token with an
+     * unknown type is ignored */
+    [fragaria setSemanticTokens:data count:20];
+    XCTAssertEqualObjects([self tokenRanges], ([expect arrayByAddingObject:[NSValue valueWithRange:NSMakeRange(16, 1)]]));
+    XCTAssertTrue([fragaria applySemanticTokensEdits:NULL count:0]);
+    
+    [fragaria removeAllSemanticTokens];
+    XCTAssertEqual(fragaria.syntaxColouring.semanticTokens.count, 0);
+    XCTAssertFalse([fragaria applySemanticTokensEdits:NULL count:0]);
+}
+
+
+- (void)testColouring
+{
+    const uint32_t data[] = {0, 4, 3, 0, 0};
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    NSDictionary *attr = [fragaria.colourScheme attributesForSyntaxGroup:MGSSyntaxGroupKeyword textFont:fragaria.textFont];
+    NSColor *c;
+    
+    [fragaria setSemanticTokens:data count:5];
+    [fragaria.syntaxColouring recolourRange:NSMakeRange(0, ts.length)];
+    c = [ts attribute:NSForegroundColorAttributeName atIndex:5 effectiveRange:NULL];
+    XCTAssertEqualObjects(c, attr[NSForegroundColorAttributeName]);
+    
+    /* The semantic colours are removed with the tokens */
+    [fragaria removeAllSemanticTokens];
+    XCTAssertFalse([fragaria.syntaxColouring.inspectedCharacterIndexes containsIndex:5]);
+    [fragaria.syntaxColouring recolourRange:NSMakeRange(0, ts.length)];
+    c = [ts attribute:NSForegroundColorAttributeName atIndex:5 effectiveRange:NULL];
+    XCTAssertEqualObjects(c, fragaria.colourScheme.textColor);
+}
+
+
+- (void)testEditsOfText
+{
+    const uint32_t data[] = {0, 4, 3, 0, 0,   1, 4, 3, 0, 0};
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    
+    [fragaria setSemanticTokens:data count:10];
+    
+    [ts replaceCharactersInRange:NSMakeRange(0, 0) withString:@"//"];
+    XCTAssertEqualObjects([self tokenRanges], (@[[NSValue valueWithRange:NSMakeRange(6, 3)], [NSValue valueWithRange:NSMakeRange(15, 3)]]));
+    
+    /* Tokens overlapping with an edit are removed */
+    [ts replaceCharactersInRange:NSMakeRange(7, 1) withString:@"O"];
+    XCTAssertEqualObjects([self tokenRanges], (@[[NSValue valueWithRange:NSMakeRange(15, 3)]]));
+}
+
+
+- (void)testLegendChangeAfterEditsOfText
+{
+    const uint32_t data[] = {0, 4, 3, 0, 0,   1, 4, 3, 2, 0};
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    
+    /* The second token has a type which is not in the legend yet */
+    [fragaria setSemanticTokens:data count:10];
+    XCTAssertEqualObjects([self tokenRanges], (@[[NSValue valueWithRange:NSMakeRange(4, 3)]]));
+    
+    /* The tokens stay where the edit moved them when the legend changes */
+    [ts replaceCharactersInRange:NSMakeRange(0, 0) withString:@"//"];
+    fragaria.semanticTokenTypes = @[MGSSyntaxGroupKeyword, MGSSyntaxGroupComment, MGSSyntaxGroupString];
+    XCTAssertEqualObjects([self tokenRanges], (@[[NSValue valueWithRange:NSMakeRange(6, 3)], [NSValue valueWithRange:NSMakeRange(15, 3)]]));
+}
+
+
+- (void)testDeltaInvalidatesChangedSpans
+{
+    const uint32_t data[] = {0, 4, 3, 0, 0,   1, 4, 3, 0, 0};
+    const uint32_t newStart[] = {0};
+    MGSSemanticTokensEdit edit = {6, 1, newStart, 1};
+    MGSSemanticTokensEdit bad = {8, 5, newStart, 1};
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    NSMutableIndexSet *valid = fragaria.syntaxColouring.inspectedCharacterIndexes;
+    
+    [fragaria setSemanticTokens:data count:10];
+    [fragaria.syntaxColouring recolourRange:NSMakeRange(0, ts.length)];
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(0, ts.length)]);
+    
+    XCTAssertFalse([fragaria applySemanticTokensEdits:&bad count:1]);
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(0, ts.length)]);
+    
+    /* Move the second token to the start of its line; the first line stays
+     * valid */
+    XCTAssertTrue([fragaria applySemanticTokensEdits:&edit count:1]);
+    XCTAssertEqualObjects([self tokenRanges], (@[[NSValue valueWithRange:NSMakeRange(4, 3)], [NSValue valueWithRange:NSMakeRange(9, 3)]]));
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(0, 9)]);
+    XCTAssertFalse([valid intersectsIndexesInRange:NSMakeRange(9, 3)]);
+}
+
+
+@end
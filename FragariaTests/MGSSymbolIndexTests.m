@@ -0,0 +1,196 @@
+//
+//  MGSSymbolIndexTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSTextView.h"
+#import "MGSSymbolIndex.h"
+
+
+@interface MGSSymbolIndexTests : XCTestCase
+
+@end
+
+
+@implementation MGSSymbolIndexTests
+{
+    MGSFragariaView *fragaria;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    fragaria.syntaxDefinitionName = @"C";
+}
+
+
+- (void)waitForIndex:(MGSSymbolIndex *)index
+{
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:10.0];
+    
+    /* Edits are indexed again at the next iteration of the run loop */
+    [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    while (index.isIndexing && [timeout timeIntervalSinceNow] > 0)
+        [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
+    XCTAssertFalse(index.isIndexing);
+}
+
+
+- (NSArray<NSString *> *)namesOfSymbols:(NSArray<MGSSymbol *> *)symbols
+{
+    return [symbols valueForKey:@"name"];
+}
+
+
+- (void)testSymbols
+{
+    MGSSymbolIndex *index;
+    NSArray<MGSSymbol *> *all;
+    
+    fragaria.string = @"#define MAX 10\n"
+        "struct point {\n"
+        "    int x, y;\n"
+        "};\n"
+        "/*\n"
+        "int commented(void)\n"
+        "*/\n"
+        "static int add(int a, int b)\n"
+        "{\n"
+        "    return a + b;\n"
+        "}\n";
+    index = fragaria.symbolIndex;
+    [self waitForIndex:index];
+    
+    all = [index symbolsInRange:NSMakeRange(0, fragaria.string.length)];
+    XCTAssertEqualObjects([self namesOfSymbols:all], (@[@"MAX", @"point", @"add"]));
+    XCTAssertEqualObjects(all[0].kind, MGSSymbolKindMacro);
+    XCTAssertEqualObjects(all[1].kind, MGSSymbolKindType);
+    XCTAssertEqualObjects(all[2].kind, MGSSymbolKindFunction);
+    XCTAssertEqual(all[2].range.location, [fragaria.string rangeOfString:@"add"].location);
+    
+    XCTAssertEqual([index indexOfLastSymbolAtOrBeforeCharacterIndex:fragaria.string.length - 3], 2);
+    XCTAssertEqual([index indexOfLastSymbolAtOrBeforeCharacterIndex:0], NSNotFound);
+}
+
+
+- (void)testEditsUpdateIndex
+{
+    MGSSymbolIndex *index;
+    NSTextStorage *ts;
+    NSUInteger loc;
+    
+    fragaria.string = @"int one(void) {\n}\nint two(void) {\n}\n";
+    index = fragaria.symbolIndex;
+    [self waitForIndex:index];
+    XCTAssertEqual(index.numberOfSymbols, 2);
+    
+    /* Inserting a line before a symbol moves it */
+    ts = fragaria.textView.textStorage;
+    [ts replaceCharactersInRange:NSMakeRange(0, 0) withString:@"// header\n"];
+    XCTAssertEqual([index symbolAtIndex:1].range.location, [ts.string rangeOfString:@"two"].location);
+    
+    /* Renaming a symbol updates it once the line has been indexed again */
+    loc = [ts.string rangeOfString:@"one"].location;
+    [ts replaceCharactersInRange:NSMakeRange(loc, 3) withString:@"first"];
+    [self waitForIndex:index];
+    XCTAssertEqualObjects([self namesOfSymbols:[index symbolsInRange:NSMakeRange(0, ts.length)]], (@[@"first", @"two"]));
+    
+    /* Commenting out a symbol removes it */
+    loc = [ts.string rangeOfString:@"int two"].location;
+    [ts replaceCharactersInRange:NSMakeRange(loc, 0) withString:@"// "];
+    [self waitForIndex:index];
+    XCTAssertEqualObjects([self namesOfSymbols:[index symbolsInRange:NSMakeRange(0, ts.length)]], (@[@"first"]));
+}
+
+
+- (void)testChangingSyntaxDefinition
+{
+    MGSSymbolIndex *index;
+    
+    fragaria.string = @"def f():\n    pass\nclass K:\n    pass\n";
+    index = fragaria.symbolIndex;
+    [self waitForIndex:index];
+    XCTAssertEqualObjects([self namesOfSymbols:[index symbolsInRange:NSMakeRange(0, fragaria.string.length)]], (@[@"f"]));
+    
+    fragaria.syntaxDefinitionName = @"Python";
+    [self waitForIndex:index];
+    XCTAssertEqualObjects([self namesOfSymbols:[index symbolsInRange:NSMakeRange(0, fragaria.string.length)]], (@[@"f", @"K"]));
+}
+
+
+- (void)testNamePrefixSearch
+{
+    MGSSymbolIndex *index;
+    
+    fragaria.syntaxDefinitionName = @"Python";
+    fragaria.string = @"def beta():\n    pass\ndef Alpha():\n    pass\ndef alphabet():\n    pass\n";
+    index = fragaria.symbolIndex;
+    [self waitForIndex:index];
+    
+    XCTAssertEqualObjects([self namesOfSymbols:[index symbolsWithNamePrefix:@"alp"]], (@[@"Alpha", @"alphabet"]));
+    XCTAssertEqualObjects([self namesOfSymbols:[index symbolsWithNamePrefix:@"b"]], (@[@"beta"]));
+    XCTAssertEqual([index symbolsWithNamePrefix:@"gamma"].count, 0);
+    XCTAssertEqual([index symbolsWithNamePrefix:@""].count, 3);
+}
+
+
+- (void)testIndexingLargeText
+{
+    NSMutableString *str = [NSMutableString string];
+    MGSSymbolIndex *index;
+    NSUInteger i;
+    
+    for (i = 0; i < 20000; i++)
+        [str appendFormat:@"int function%lu(void)\n{\n    return %lu;\n}\n", (unsigned long)i, (unsigned long)i];
+    fragaria.string = str;
+    index = fragaria.symbolIndex;
+    
+    [self measureBlock:^{
+        /* Replacing the parser discards the tokens and the symbols */
+        MGSSyntaxColouring *sc = self->fragaria.syntaxColouring;
+        sc.parser = sc.parser;
+        [self waitForIndex:index];
+    }];
+    XCTAssertEqual(index.numberOfSymbols, 20000);
+    XCTAssertEqualObjects([index symbolAtIndex:19999].name, @"function19999");
+}
+
+
+- (void)testMappedFileIndexedOnlyWhenParsed
+{
+    NSURL *url = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    NSMutableString *str = [NSMutableString string];
+    NSTextStorage *ts;
+    MGSSymbolIndex *index;
+    NSUInteger i;
+    
+    for (i = 0; i < 20000; i++)
+        [str appendFormat:@"int function%lu(void)\n{\n    return %lu;\n}\n", (unsigned long)i, (unsigned long)i];
+    XCTAssertTrue([str writeToURL:url atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+    XCTAssertTrue([fragaria openFileForViewingAtURL:url error:nil]);
+    ts = fragaria.textView.textStorage;
+    index = fragaria.symbolIndex;
+    
+    /* The text which was not displayed is not parsed by the index */
+    [self waitForIndex:index];
+    XCTAssertFalse([fragaria.syntaxColouring.inspectedCharacterIndexes containsIndex:ts.length - 1]);
+    XCTAssertLessThan(index.numberOfSymbols, 20000);
+    
+    [fragaria.syntaxColouring recolourRange:NSMakeRange(ts.length - 100, 100)];
+    [self waitForIndex:index];
+    XCTAssertEqualObjects([index symbolAtIndex:index.numberOfSymbols - 1].name, @"function19999");
+    
+    [[NSFileManager defaultManager] removeItemAtURL:url error:nil];
+}
+
+
+@end
@@ -11,6 +11,8 @@
 
 #import "MGSSyntaxErrorController.h"
 #import "MGSSyntaxError.h"
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
 
 
 /**
@@ -164,4 +166,171 @@
 }
 
 
+/*
+ *  - test_lineIndexShift
+ *    Errors follow their lines when lines are added or removed above them.
+ */
+- (void)test_lineIndexShift
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 200, 200)];
+    NSMutableString *text = [NSMutableString string];
+    NSTextStorage *ts;
+    MGSSyntaxErrorController *ctrl;
+
+    for (NSInteger i = 0; i < 300; i++)
+        [text appendFormat:@"line %ld\n", (long)i + 1];
+    fragaria.string = text;
+    ctrl = fragaria.syntaxErrorController;
+    [ctrl setSyntaxErrors:self.errorController.syntaxErrors];
+    ts = fragaria.textView.textStorage;
+
+    // Add two lines before line 10
+    [ts replaceCharactersInRange:NSMakeRange([ts.string rangeOfString:@"line 10\n"].location, 0) withString:@"a\nb\n"];
+    XCTAssertEqualObjects([ctrl linesWithErrors], (@[@(4), @(39), @(191)]));
+    XCTAssertEqual([ctrl errorCountForLine:39], 2);
+    XCTAssertEqual([ctrl errorCountForLine:37], 0);
+    XCTAssertEqual([[[ctrl errorDecorations] objectForKey:@(191)] line], 189);
+
+    // Remove them again, joining line 9 and line 10
+    [ts replaceCharactersInRange:NSMakeRange([ts.string rangeOfString:@"line 9\n"].location + 6, 5) withString:@""];
+    XCTAssertEqualObjects([ctrl linesWithErrors], (@[@(4), @(36), @(188)]));
+
+    // Errors on removed lines are moved where the deletion took place
+    [ts replaceCharactersInRange:NSMakeRange([ts.string rangeOfString:@"line 35\n"].location + 7, 16) withString:@""];
+    XCTAssertEqualObjects([ctrl linesWithErrors], (@[@(4), @(34), @(186)]));
+    XCTAssertEqual([ctrl errorCountForLine:34], 2);
+    XCTAssertEqualObjects([[ctrl errorForLine:34] errorDescription], @"Sample error 3.");
+}
+
+
+/*
+ *  - test_lineIndexPerformance
+ *    Gutter queries for every line with 100k errors set.
+ */
+- (void)test_lineIndexPerformance
+{
+    NSMutableArray *errors = [NSMutableArray arrayWithCapacity:100000];
+    MGSSyntaxErrorController *ctrl = [[MGSSyntaxErrorController alloc] init];
+
+    for (NSUInteger i = 0; i < 100000; i++) {
+        MGSSyntaxError *err = [MGSSyntaxError errorWithDescription:@"Sample error." ofLevel:(float)(i % 7) * 100.0 + 50.0 atLine:i / 2 + 1];
+        [errors addObject:err];
+    }
+
+    [self measureBlock:^{
+        NSUInteger total = 0;
+        [ctrl setSyntaxErrors:errors];
+        for (NSInteger line = 1; line <= 50000; line++) {
+            total += [ctrl errorCountForLine:line];
+            XCTAssertNotNil([ctrl errorForLine:line]);
+        }
+        XCTAssertEqual(total, 100000);
+        XCTAssertEqual([[ctrl errorDecorations] count], 50000);
+    }];
+}
+
+
+/*
+ *  - test_errorRecords
+ *    Errors that did not change keep their objects, the others are replaced.
+ */
+- (void)test_errorRecords
+{
+    MGSSyntaxErrorController *ctrl = [[MGSSyntaxErrorController alloc] init];
+    MGSSyntaxErrorRecord recs[] = {
+        {4, 1, 0, kMGSErrorCategoryAccess, @"Sample error 1."},
+        {37, 2, 3, kMGSErrorCategoryDocument, @"Sample error 3."},
+        {37, 5, 0, kMGSErrorCategoryError, @"Sample error 4."},
+        {189, 1, 0, kMGSErrorCategoryError, @"Sample error 5."}
+    };
+    MGSSyntaxError *err4, *err37;
+
+    [ctrl setSyntaxErrorRecords:recs count:4];
+    XCTAssertEqualObjects([ctrl linesWithErrors], (@[@(4), @(37), @(189)]));
+    XCTAssertEqualObjects([[ctrl errorForLine:37] errorDescription], @"Sample error 4.");
+    XCTAssertEqual([[ctrl syntaxErrors] count], 4);
+    err4 = [ctrl errorForLine:4];
+    err37 = [ctrl errorForLine:37];
+
+    recs[1].length = 4;
+    recs[3].line = 190;
+    [ctrl setSyntaxErrorRecords:recs count:4];
+    XCTAssertEqualObjects([ctrl linesWithErrors], (@[@(4), @(37), @(190)]));
+    XCTAssertEqual([ctrl errorForLine:4], err4);
+    XCTAssertEqual([ctrl errorForLine:37], err37);
+    XCTAssertEqual([[[ctrl errorsForLine:37] firstObject] length], 4);
+    XCTAssertEqual([[[ctrl errorDecorations] objectForKey:@(190)] line], 190);
+    XCTAssertNil([[ctrl errorDecorations] objectForKey:@(189)]);
+}
+
+
+/*
+ *  - test_errorRecordsStreaming
+ *    Records added progressively replace the old errors line by line.
+ */
+- (void)test_errorRecordsStreaming
+{
+    MGSSyntaxErrorRecord recs[] = {
+        {4, 1, 0, kMGSErrorCategoryPanic, @"New error 1."},
+        {37, 1, 0, kMGSErrorCategoryError, @"New error 2."},
+        {300, 1, 0, kMGSErrorCategoryError, @"New error 3."}
+    };
+
+    [self.errorController beginSyntaxErrorRecordUpdate];
+    [self.errorController addSyntaxErrorRecords:recs count:1];
+    XCTAssertEqualObjects([[self.errorController errorForLine:4] errorDescription], @"New error 1.");
+    XCTAssertEqual([self.errorController errorCountForLine:37], 2);
+    XCTAssertEqual([self.errorController errorCountForLine:189], 1);
+
+    [self.errorController addSyntaxErrorRecords:recs+1 count:2];
+    XCTAssertEqual([self.errorController errorCountForLine:37], 1);
+    XCTAssertEqual([self.errorController errorCountForLine:189], 1);
+
+    [self.errorController endSyntaxErrorRecordUpdate];
+    XCTAssertEqualObjects([self.errorController linesWithErrors], (@[@(4), @(37), @(300)]));
+    XCTAssertEqual([[self.errorController nonHiddenErrors] count], 3);
+    
+    /* The hidden errors are still part of the syntax errors */
+    XCTAssertEqual([[self.errorController syntaxErrors] count], 5);
+    XCTAssertEqual([[[self.errorController syntaxErrors] filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"hidden == YES"]] count], 2);
+    XCTAssertThrows([self.errorController addSyntaxErrorRecords:recs count:1]);
+}
+
+
+/*
+ *  - test_errorRecordsLintCyclePerformance
+ *    Repeated lint runs on a large file, where few errors change each time.
+ */
+- (void)test_errorRecordsLintCyclePerformance
+{
+    MGSFragariaView *fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    NSMutableString *text = [NSMutableString string];
+    NSUInteger nrecs = 20000;
+    MGSSyntaxErrorRecord *recs = calloc(nrecs, sizeof(MGSSyntaxErrorRecord));
+
+    for (NSInteger i = 0; i < 100000; i++)
+        [text appendString:@"    int a = b + c;\n"];
+    fragaria.string = text;
+    for (NSUInteger i = 0; i < nrecs; i++) {
+        recs[i].line = i * 5 + 1;
+        recs[i].character = 5;
+        recs[i].length = 3;
+        recs[i].warningLevel = kMGSErrorCategoryWarning;
+        recs[i].errorDescription = @"Unused variable.";
+    }
+    [fragaria setSyntaxErrorRecords:recs count:nrecs];
+
+    [self measureBlock:^{
+        for (NSUInteger cycle = 0; cycle < 50; cycle++) {
+            recs[(cycle * 7919) % nrecs].warningLevel = kMGSErrorCategoryError;
+            recs[(cycle * 104729) % nrecs].length = 1 + cycle % 4;
+            [fragaria setSyntaxErrorRecords:recs count:nrecs];
+        }
+    }];
+    XCTAssertEqual([fragaria.syntaxErrors count], nrecs);
+
+    free(recs);
+}
+
+
 @end
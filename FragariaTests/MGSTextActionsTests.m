@@ -0,0 +1,245 @@
+//
+//  MGSTextActionsTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSTextView.h"
+#import "MGSTextView+MGSTextActions.h"
+#import "NSString+Fragaria.h"
+
+
+@interface MGSTextActionsTests : XCTestCase
+
+@end
+
+
+@implementation MGSTextActionsTests
+{
+    MGSFragariaView *fragaria;
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    fragaria.syntaxDefinitionName = @"C";
+}
+
+
+- (NSArray *)editsFromString:(NSString *)a toString:(NSString *)b
+{
+    NSMutableArray *res = [NSMutableArray array];
+    
+    [a mgs_enumerateLineEditsToString:b usingBlock:^(NSRange range, NSRange replacementRange) {
+        [res addObject:@[[NSValue valueWithRange:range], [b substringWithRange:replacementRange]]];
+    }];
+    return res;
+}
+
+
+- (NSString *)applyEdits:(NSArray *)edits toString:(NSString *)a
+{
+    NSMutableString *res = [a mutableCopy];
+    
+    for (NSArray *edit in [edits reverseObjectEnumerator])
+        [res replaceCharactersInRange:[edit[0] rangeValue] withString:edit[1]];
+    return res;
+}
+
+
+- (void)testLineEdits
+{
+    NSArray *edits;
+    NSArray *pairs = @[
+        @[@"a\nb\nc\n", @"a\nb\nc\n"],
+        @[@"a\nb\nc\n", @"a\nxbx\nc\n"],
+        @[@"a  \nb\nc \n", @"a\nb\nc\n"],
+        @[@"a\nb\nc", @"a\nb\r\nc"],
+        @[@"a\nb\nc\n", @"a\nc\n"],
+        @[@"a\nb\nc\n", @"abc"],
+        @[@"", @"a\n"],
+        @[@"a\n", @""]];
+    
+    for (NSArray *pair in pairs) {
+        edits = [self editsFromString:pair[0] toString:pair[1]];
+        XCTAssertEqualObjects([self applyEdits:edits toString:pair[0]], pair[1]);
+    }
+    
+    XCTAssertEqual([self editsFromString:@"a\nb\nc\n" toString:@"a\nb\nc\n"].count, 0);
+    
+    /* Each changed line is a separate edit, restricted to the changed
+     * characters */
+    edits = [self editsFromString:@"a  \nb\nc \n" toString:@"a\nb\nc\n"];
+    XCTAssertEqual(edits.count, 2);
+    XCTAssertEqual([edits[0][0] rangeValue].location, 1);
+    XCTAssertEqual([edits[0][0] rangeValue].length, 2);
+    XCTAssertEqual([edits[1][0] rangeValue].location, 7);
+    XCTAssertEqual([edits[1][0] rangeValue].length, 1);
+}
+
+
+- (void)testEntab
+{
+    XCTAssertEqualObjects([@"        a" mgs_stringByConvertingSpacesToTabsWithTabWidth:4], @"\t\ta");
+    XCTAssertEqualObjects([@"ab  c   d" mgs_stringByConvertingSpacesToTabsWithTabWidth:4], @"ab\tc\td");
+    /* A single space is left alone, even if it reaches a tab stop */
+    XCTAssertEqualObjects([@"abc d" mgs_stringByConvertingSpacesToTabsWithTabWidth:4], @"abc d");
+    XCTAssertEqualObjects([@"\t  a" mgs_stringByConvertingSpacesToTabsWithTabWidth:4], @"\t  a");
+    XCTAssertEqualObjects([@"a   \n    b\r\n  " mgs_stringByConvertingSpacesToTabsWithTabWidth:4], @"a\t\n\tb\r\n  ");
+    XCTAssertEqualObjects([@"    a" mgs_stringByConvertingSpacesToTabsWithTabWidth:0], @"    a");
+}
+
+
+- (void)testDetab
+{
+    XCTAssertEqualObjects([@"\ta" mgs_stringByConvertingTabsToSpacesWithTabWidth:4], @"    a");
+    XCTAssertEqualObjects([@"ab\tc\t\td" mgs_stringByConvertingTabsToSpacesWithTabWidth:4], @"ab  c       d");
+    XCTAssertEqualObjects([@"abc\n\tx" mgs_stringByConvertingTabsToSpacesWithTabWidth:4], @"abc\n    x");
+    XCTAssertEqualObjects([@"a\tb" mgs_stringByConvertingTabsToSpacesWithTabWidth:0], @"ab");
+}
+
+
+- (void)testTrimTrailingWhitespace
+{
+    XCTAssertEqualObjects([@"a  \n\t\nb \t\r\nc\u00A0 " mgs_stringByRemovingTrailingWhitespace], @"a\n\nb\r\nc");
+    XCTAssertEqualObjects([@"  a b" mgs_stringByRemovingTrailingWhitespace], @"  a b");
+    XCTAssertEqualObjects([@"" mgs_stringByRemovingTrailingWhitespace], @"");
+}
+
+
+- (void)testEntabAndDetabAction
+{
+    MGSTextView *tv = fragaria.textView;
+    
+    fragaria.string = @"x\n        a  \nb\n";
+    tv.selectedRange = NSMakeRange(2, 13);
+    [tv performEntabWithNumberOfSpaces:4];
+    XCTAssertEqualObjects(tv.string, @"x\n\t\ta  \nb\n");
+    
+    tv.selectedRange = NSMakeRange(0, tv.string.length);
+    [tv performDetabWithNumberOfSpaces:2];
+    XCTAssertEqualObjects(tv.string, @"x\n    a  \nb\n");
+    
+    tv.selectedRange = NSMakeRange(0, tv.string.length);
+    [tv removeNeedlessWhitespace:nil];
+    XCTAssertEqualObjects(tv.string, @"x\n    a\nb\n");
+}
+
+
+- (void)testRemoveNeedlessWhitespaceKeepsColouring
+{
+    MGSTextView *tv = fragaria.textView;
+    NSMutableIndexSet *valid = fragaria.syntaxColouring.inspectedCharacterIndexes;
+    NSMutableString *text = [NSMutableString string];
+    NSString *line = @"int x = 1; /* c */\n";
+    NSUInteger i, lineLen = line.length;
+    
+    for (i = 0; i < 200; i++)
+        [text appendString:line];
+    [text insertString:@"   " atIndex:lineLen * 101 - 1];
+    fragaria.string = text;
+    [fragaria.syntaxColouring recolourRange:NSMakeRange(0, text.length)];
+    
+    tv.selectedRange = NSMakeRange(0, text.length);
+    [tv removeNeedlessWhitespace:nil];
+    
+    XCTAssertEqual(tv.string.length, lineLen * 200);
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(0, lineLen * 99)]);
+    XCTAssertTrue([valid containsIndexesInRange:NSMakeRange(lineLen * 102, lineLen * 98)]);
+    XCTAssertTrue(NSEqualRanges(tv.selectedRange, NSMakeRange(0, lineLen * 200)));
+}
+
+
+- (void)testShiftRight
+{
+    MGSTextView *tv = fragaria.textView;
+    
+    fragaria.indentWithSpaces = YES;
+    fragaria.indentWidth = 4;
+    fragaria.string = @"a\n  b\nc";
+    tv.selectedRange = NSMakeRange(2, 3);
+    [tv shiftRight:nil];
+    
+    XCTAssertEqualObjects(tv.string, @"a\n      b\nc");
+    XCTAssertTrue(NSEqualRanges(tv.selectedRange, NSMakeRange(2, 8)));
+}
+
+
+- (void)testShiftRightProcessesOneEdit
+{
+    MGSTextView *tv = fragaria.textView;
+    __block NSUInteger edits = 0;
+    id observer;
+    
+    fragaria.indentWithSpaces = YES;
+    fragaria.indentWidth = 4;
+    fragaria.string = @"a\nb\nc\nd";
+    tv.selectedRange = NSMakeRange(0, tv.string.length);
+    observer = [[NSNotificationCenter defaultCenter] addObserverForName:NSTextStorageDidProcessEditingNotification object:tv.textStorage queue:nil usingBlock:^(NSNotification *note) {
+        edits++;
+    }];
+    [tv shiftRight:nil];
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    
+    XCTAssertEqualObjects(tv.string, @"    a\n    b\n    c\n    d");
+    XCTAssertEqual(edits, 1);
+}
+
+
+- (void)testShiftRightPerformance
+{
+    MGSTextView *tv = fragaria.textView;
+    NSMutableString *text = [NSMutableString string];
+    NSUInteger i;
+    
+    fragaria.indentWithSpaces = YES;
+    fragaria.indentWidth = 4;
+    for (i = 0; i < 200000; i++)
+        [text appendString:@"int x = 1;\n"];
+    [text deleteCharactersInRange:NSMakeRange(text.length - 1, 1)];
+    
+    [self measureMetrics:[[self class] defaultPerformanceMetrics] automaticallyStartMeasuring:NO forBlock:^{
+        self->fragaria.string = text;
+        tv.selectedRange = NSMakeRange(0, text.length);
+        [self startMeasuring];
+        [tv shiftRight:nil];
+        [self stopMeasuring];
+    }];
+    XCTAssertEqual(tv.string.length, text.length + 200000 * 4);
+}
+
+
+- (NSString *)mixedIndentationSampleOfLength:(NSUInteger)length
+{
+    NSString *chunk = @"int f(int x)\n{\n\tif (x)  \n        return 1;\n    \telse\n\t    return 2;   \n}\n\n";
+    NSMutableString *res = [NSMutableString stringWithCapacity:length + chunk.length];
+    
+    while (res.length < length)
+        [res appendString:chunk];
+    return res;
+}
+
+
+- (void)testWhitespaceTransformationPerformance
+{
+    NSString *sample = [self mixedIndentationSampleOfLength:50 * 1024 * 1024];
+    
+    [self measureBlock:^{
+        @autoreleasepool {
+            [sample mgs_stringByConvertingSpacesToTabsWithTabWidth:4];
+            [sample mgs_stringByConvertingTabsToSpacesWithTabWidth:4];
+            [sample mgs_stringByRemovingTrailingWhitespace];
+        }
+    }];
+}
+
+
+@end
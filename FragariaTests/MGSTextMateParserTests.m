@@ -0,0 +1,208 @@
+//
+//  MGSTextMateParserTests.m
+//  Fragaria Tests
+//
+//  Created on 19/10/2026.
+//
+
+#import <XCTest/XCTest.h>
+#define FRAGARIA_PRIVATE
+#import "MGSFragariaView.h"
+#import "MGSFragariaViewPrivate.h"
+#import "MGSSyntaxColouring.h"
+#import "MGSTextMateParserFactory.h"
+#import "MGSTextMateGrammar.h"
+#import "MGSTextView.h"
+
+
+@interface MGSTextMateParserTests : XCTestCase
+
+@end
+
+
+@implementation MGSTextMateParserTests
+{
+    MGSFragariaView *fragaria;
+    MGSTextMateParserFactory *factory;
+}
+
+
+- (NSDictionary *)testGrammar
+{
+    return @{
+        @"name": @"TestLang",
+        @"scopeName": @"source.test",
+        @"fileTypes": @[@"tst"],
+        @"firstLineMatch": @"^#!.*\\btest\\b",
+        @"patterns": @[
+            @{@"include": @"#comments"},
+            @{@"name": @"string.quoted.double.test", @"begin": @"\"", @"end": @"\"", @"patterns": @[
+                @{@"name": @"constant.character.escape.test", @"match": @"\\\\."}
+            ]},
+            @{@"name": @"string.unquoted.heredoc.test", @"begin": @"<<(\\w+)$", @"end": @"^\\1$"},
+            @{@"name": @"constant.numeric.test", @"match": @"\\b[0-9]+\\b"},
+            @{@"name": @"keyword.control.test", @"match": @"\\b(?:if|while|return|int|void)\\b"}
+        ],
+        @"repository": @{
+            @"comments": @{@"patterns": @[
+                @{@"name": @"comment.block.test", @"begin": @"/\\*", @"end": @"\\*/"},
+                @{@"name": @"comment.line.test", @"match": @"//.*$"}
+            ]}
+        }
+    };
+}
+
+
+- (void)setUp
+{
+    [super setUp];
+    factory = [[MGSTextMateParserFactory alloc] initWithGrammarDictionaries:@[[self testGrammar], @{@"name": @"Invalid"}]];
+    fragaria = [[MGSFragariaView alloc] initWithFrame:NSMakeRect(0, 0, 400, 400)];
+    fragaria.syntaxColouring.parser = [factory parserForSyntaxDefinitionName:@"TestLang"];
+}
+
+
+- (NSString *)sampleOfLength:(NSUInteger)length
+{
+    NSString *chunk = @"/* block\n   comment */\nint main(void) {\n    // line\n    if (x) return 42 + \"str\\n\";\n}\n";
+    NSMutableString *res = [NSMutableString stringWithCapacity:length + chunk.length];
+    
+    while (res.length < length)
+        [res appendString:chunk];
+    return res;
+}
+
+
+- (BOOL)characterAtIndex:(NSUInteger)i isInGroup:(MGSSyntaxGroup)group
+{
+    MGSSyntaxGroup g = [fragaria.syntaxColouring groupOfTokenAtCharacterIndex:i];
+    return [g isEqual:group] || [g hasPrefix:[group stringByAppendingString:@"."]];
+}
+
+
+- (void)colourAll
+{
+    [fragaria.syntaxColouring recolourRange:NSMakeRange(0, fragaria.textView.textStorage.length)];
+}
+
+
+- (void)testFactory
+{
+    XCTAssertEqualObjects(factory.syntaxDefinitionNames, @[@"TestLang"]);
+    XCTAssertEqualObjects([factory syntaxDefinitionNamesWithExtension:@"TST"], @[@"TestLang"]);
+    XCTAssertEqualObjects([factory extensionsForSyntaxDefinitionName:@"testlang"], @[@"tst"]);
+    XCTAssertEqualObjects([factory guessSyntaxDefinitionNamesFromFirstLine:@"#!/usr/bin/env test"], @[@"TestLang"]);
+    XCTAssertEqualObjects([factory guessSyntaxDefinitionNamesFromFirstLine:@"#!/bin/sh"], @[]);
+    XCTAssertNil([factory parserForSyntaxDefinitionName:@"Invalid"]);
+    XCTAssertTrue([factory.syntaxGroupsForParsers containsObject:MGSSyntaxGroupComment]);
+}
+
+
+- (void)testContentHash
+{
+    NSData *json = [NSJSONSerialization dataWithJSONObject:[self testGrammar] options:0 error:nil];
+    NSMutableDictionary *edited = [[self testGrammar] mutableCopy];
+    MGSTextMateGrammar *a, *b, *c;
+    
+    /* The hash does not depend on how the grammar was loaded */
+    a = [[MGSTextMateGrammar alloc] initWithDictionary:[self testGrammar]];
+    b = [[MGSTextMateGrammar alloc] initWithDictionary:[NSJSONSerialization JSONObjectWithData:json options:NSJSONReadingMutableContainers error:nil]];
+    edited[@"patterns"] = [edited[@"patterns"] subarrayWithRange:NSMakeRange(0, 2)];
+    c = [[MGSTextMateGrammar alloc] initWithDictionary:edited];
+    
+    XCTAssertEqualObjects(a.contentHash, b.contentHash);
+    XCTAssertNotEqualObjects(a.contentHash, c.contentHash);
+}
+
+
+- (void)testTokens
+{
+    fragaria.string = @"if 12 \"a\\\"b\" // c\nwhile";
+    [self colourAll];
+    
+    XCTAssertTrue([self characterAtIndex:0 isInGroup:MGSSyntaxGroupKeyword]);
+    XCTAssertTrue([self characterAtIndex:3 isInGroup:MGSSyntaxGroupNumber]);
+    XCTAssertTrue([self characterAtIndex:6 isInGroup:MGSSyntaxGroupString]);
+    /* The escaped quote does not end the string */
+    XCTAssertTrue([self characterAtIndex:10 isInGroup:MGSSyntaxGroupString]);
+    XCTAssertTrue([self characterAtIndex:15 isInGroup:MGSSyntaxGroupComment]);
+    XCTAssertTrue([self characterAtIndex:19 isInGroup:MGSSyntaxGroupKeyword]);
+    XCTAssertNil([fragaria.syntaxColouring groupOfTokenAtCharacterIndex:2]);
+}
+
+
+- (void)testMultiLineComment
+{
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    
+    fragaria.string = @"a /* b\nif 2\n*/ if\n";
+    [self colourAll];
+    XCTAssertTrue([self characterAtIndex:7 isInGroup:MGSSyntaxGroupComment]);
+    XCTAssertTrue([self characterAtIndex:15 isInGroup:MGSSyntaxGroupKeyword]);
+    
+    [ts replaceCharactersInRange:NSMakeRange(2, 2) withString:@""];
+    [self colourAll];
+    XCTAssertTrue([self characterAtIndex:5 isInGroup:MGSSyntaxGroupKeyword]);
+    XCTAssertTrue([self characterAtIndex:8 isInGroup:MGSSyntaxGroupNumber]);
+}
+
+
+- (void)testBackReferenceEnd
+{
+    fragaria.string = @"x <<EOT\nif 1\nEOT\nif\n";
+    [self colourAll];
+    
+    XCTAssertTrue([self characterAtIndex:8 isInGroup:MGSSyntaxGroupString]);
+    XCTAssertTrue([self characterAtIndex:14 isInGroup:MGSSyntaxGroupString]);
+    XCTAssertTrue([self characterAtIndex:17 isInGroup:MGSSyntaxGroupKeyword]);
+}
+
+
+- (void)testIncrementalReparse
+{
+    NSTextStorage *ts = fragaria.textView.textStorage;
+    NSString *line = @"if 1; // c\n";
+    NSUInteger lineLen = line.length;
+    NSRange coloured;
+    
+    fragaria.string = [@"" stringByPaddingToLength:lineLen * 200 withString:line startingAtIndex:0];
+    [self colourAll];
+    
+    /* An edit which does not change the context is parsed again alone */
+    [ts replaceCharactersInRange:NSMakeRange(lineLen * 100, 0) withString:@"x"];
+    coloured = [fragaria.syntaxColouring recolourChangedRange:NSMakeRange(lineLen * 100, lineLen + 1)];
+    XCTAssertGreaterThanOrEqual(coloured.location, lineLen * 98);
+    XCTAssertLessThanOrEqual(NSMaxRange(coloured), lineLen * 102 + 1);
+    
+    /* Opening a comment colours again all the following lines */
+    [ts replaceCharactersInRange:NSMakeRange(lineLen * 100, 0) withString:@"/*"];
+    coloured = [fragaria.syntaxColouring recolourChangedRange:NSMakeRange(lineLen * 100, lineLen + 3)];
+    XCTAssertEqual(NSMaxRange(coloured), ts.length);
+    XCTAssertTrue([self characterAtIndex:ts.length - 2 isInGroup:MGSSyntaxGroupComment]);
+}
+
+
+- (void)testTextMateParserPerformance
+{
+    MGSSyntaxColouring *sc = fragaria.syntaxColouring;
+    
+    fragaria.string = [self sampleOfLength:1024 * 1024];
+    [self measureBlock:^{
+        [sc recolourChangedRange:NSMakeRange(0, sc.textStorage.length)];
+    }];
+}
+
+
+- (void)testClassicParserPerformance
+{
+    MGSSyntaxColouring *sc = fragaria.syntaxColouring;
+    
+    fragaria.syntaxDefinitionName = @"C";
+    fragaria.string = [self sampleOfLength:1024 * 1024];
+    [self measureBlock:^{
+        [sc recolourChangedRange:NSMakeRange(0, sc.textStorage.length)];
+    }];
+}
+
+
+@end